@@ -0,0 +1,363 @@
+#include "bench.h"
+#include "metrics.h" // SARF_METRICS
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <regex>
+#include <thread>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <time.h>
+#include <unistd.h>
+#endif
+
+namespace bench {
+
+namespace {
+int64_t RealNow() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int64_t CpuNow() {
+#ifdef _WIN32
+    FILETIME created, exited, kernel, user;
+    if (!GetThreadTimes(GetCurrentThread(), &created, &exited, &kernel, &user)) return 0;
+    auto ticks = [](const FILETIME& t) { return ((int64_t)t.dwHighDateTime << 32) | t.dwLowDateTime; };
+    return (ticks(kernel) + ticks(user)) * 100;
+#else
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+std::vector<std::unique_ptr<Benchmark>>& Registry() {
+    static std::vector<std::unique_ptr<Benchmark>> benchmarks;
+    return benchmarks;
+}
+
+struct Options {
+    std::string filter = ".";
+    double minTime = 0.5;
+    int repetitions = 1;
+    bool json = false;       // on stdout, instead of the table
+    std::string out;         // JSON file, in addition
+    bool list = false;
+};
+
+struct Result {
+    std::string name;
+    std::string runType = "iteration"; // or "aggregate"
+    std::string aggregate;             // "mean", "median", "stddev"
+    int repetitions = 1, repetitionIndex = 0;
+    uint64_t iterations = 0;
+    double realNs = 0, cpuNs = 0;      // per iteration
+    double itemsPerSecond = 0, bytesPerSecond = 0;
+    std::string label, error;
+};
+
+std::string JsonString(const std::string& s) {
+    std::string out = "\"";
+    for (unsigned char c : s) {
+        if (c == '"' || c == '\\') { out += '\\'; out += (char)c; }
+        else if (c < 0x20) { char esc[8]; snprintf(esc, sizeof(esc), "\\u%04x", c); out += esc; }
+        else out += (char)c;
+    }
+    return out + "\"";
+}
+
+std::string FormatTime(double ns) {
+    char buf[32];
+    if (ns < 10) snprintf(buf, sizeof(buf), "%.2f ns", ns);
+    else if (ns < 1e4) snprintf(buf, sizeof(buf), "%.0f ns", ns);
+    else if (ns < 1e7) snprintf(buf, sizeof(buf), "%.0f us", ns / 1e3);
+    else snprintf(buf, sizeof(buf), "%.0f ms", ns / 1e6);
+    return buf;
+}
+
+std::string FormatRate(double perSecond, const char* unit) {
+    const char* prefixes[] = { "", "k", "M", "G", "T" };
+    int i = 0;
+    while (perSecond >= 1000 && i < 4) { perSecond /= 1000; i++; }
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.4g%s%s", perSecond, prefixes[i], unit);
+    return buf;
+}
+}
+
+void State::StartTiming() {
+    running = true;
+    realStart = RealNow();
+    cpuStart = CpuNow();
+}
+
+void State::StopTiming() {
+    if (!running) return;
+    cpuNs += CpuNow() - cpuStart;
+    realNs += RealNow() - realStart;
+    running = false;
+}
+
+void State::PauseTiming() { StopTiming(); }
+void State::ResumeTiming() { StartTiming(); }
+
+#if defined(_MSC_VER) && !defined(__clang__)
+void UseCharPointer(const volatile char*) {}
+#endif
+
+int64_t Latencies::Now() {
+    return RealNow();
+}
+
+int64_t Latencies::Percentile(double p) {
+    if (samples.empty()) return 0;
+    if (!sorted) std::sort(samples.begin(), samples.end());
+    sorted = true;
+    size_t i = (size_t)(p / 100 * (double)(samples.size() - 1) + 0.5);
+    return samples[(std::min)(i, samples.size() - 1)];
+}
+
+std::string Latencies::Summary() {
+    return "p50 " + FormatTime((double)Percentile(50)) + ", p90 " + FormatTime((double)Percentile(90)) +
+        ", p99 " + FormatTime((double)Percentile(99)) + ", max " + FormatTime((double)Percentile(100));
+}
+
+Benchmark* RegisterBenchmark(const char* name, void (*fn)(State&)) {
+    Registry().push_back(std::make_unique<Benchmark>(name, fn));
+    return Registry().back().get();
+}
+
+struct Runner {
+    static Result RunOnce(const Benchmark& b, const std::vector<int64_t>& args, uint64_t iterations) {
+        State state(iterations, args);
+        b.fn(state);
+        state.StopTiming();
+        Result r;
+        r.iterations = iterations;
+        r.realNs = (double)state.realNs / iterations;
+        r.cpuNs = (double)state.cpuNs / iterations;
+        double seconds = state.realNs / 1e9;
+        if (seconds > 0) {
+            r.itemsPerSecond = state.items / seconds;
+            r.bytesPerSecond = state.bytes / seconds;
+        }
+        r.label = state.label;
+        r.error = state.error;
+        return r;
+    }
+
+    // Grows the iteration count, as Google Benchmark does, until one run lasts minTime
+    static Result Run(const Benchmark& b, const std::vector<int64_t>& args, double minTime) {
+        if (b.fixedIterations) return RunOnce(b, args, b.fixedIterations);
+        uint64_t iterations = 1;
+        while (true) {
+            Result r = RunOnce(b, args, iterations);
+            double seconds = r.realNs * iterations / 1e9;
+            if (!r.error.empty() || seconds >= minTime || iterations >= 1000000000) return r;
+            double multiplier = seconds > 0 ? minTime * 1.4 / seconds : 10;
+            multiplier = (std::min)(multiplier, 10.0);
+            iterations = (std::max)((uint64_t)(iterations * multiplier), iterations + 1);
+        }
+    }
+};
+
+namespace {
+Result Aggregate(const std::vector<Result>& runs, const char* kind) {
+    Result a = runs[0];
+    a.runType = "aggregate";
+    a.aggregate = kind;
+    a.name += std::string("_") + kind;
+    a.repetitions = (int)runs.size();
+    auto pick = [&](double Result::*field) {
+        std::vector<double> v;
+        for (const Result& r : runs) v.push_back(r.*field);
+        double mean = 0;
+        for (double x : v) mean += x;
+        mean /= v.size();
+        if (!strcmp(kind, "mean")) return mean;
+        if (!strcmp(kind, "median")) {
+            std::sort(v.begin(), v.end());
+            return v.size() % 2 ? v[v.size() / 2] : (v[v.size() / 2 - 1] + v[v.size() / 2]) / 2;
+        }
+        double var = 0;
+        for (double x : v) var += (x - mean) * (x - mean);
+        return v.size() > 1 ? std::sqrt(var / (v.size() - 1)) : 0.0;
+    };
+    a.realNs = pick(&Result::realNs);
+    a.cpuNs = pick(&Result::cpuNs);
+    a.itemsPerSecond = pick(&Result::itemsPerSecond);
+    a.bytesPerSecond = pick(&Result::bytesPerSecond);
+    return a;
+}
+
+void PrintRow(const Result& r, size_t nameWidth) {
+    if (!r.error.empty()) {
+        printf("%-*s ERROR: %s\n", (int)nameWidth, r.name.c_str(), r.error.c_str());
+        return;
+    }
+    printf("%-*s %13s %13s %12llu", (int)nameWidth, r.name.c_str(), FormatTime(r.realNs).c_str(), FormatTime(r.cpuNs).c_str(),
+        (unsigned long long)r.iterations);
+    if (r.itemsPerSecond > 0) printf(" items/s=%s", FormatRate(r.itemsPerSecond, "").c_str());
+    if (r.bytesPerSecond > 0) printf(" bytes/s=%s", FormatRate(r.bytesPerSecond, "B").c_str());
+    if (!r.label.empty()) printf(" %s", r.label.c_str());
+    printf("\n");
+    fflush(stdout);
+}
+
+std::string ToJson(const std::vector<Result>& results) {
+    char date[64];
+    time_t now = time(nullptr);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+    char host[256] = "";
+#ifdef _WIN32
+    DWORD size = sizeof(host);
+    GetComputerNameA(host, &size);
+#else
+    gethostname(host, sizeof(host) - 1);
+#endif
+    std::string out = "{\n  \"context\": {\n";
+    out += "    \"date\": " + JsonString(date) + ",\n";
+    out += "    \"host_name\": " + JsonString(host) + ",\n";
+    out += "    \"num_cpus\": " + std::to_string(std::thread::hardware_concurrency()) + ",\n";
+#ifdef NDEBUG
+    out += "    \"library_build_type\": \"release\",\n";
+#else
+    out += "    \"library_build_type\": \"debug\",\n";
+#endif
+    out += "    \"sarf_metrics\": " + std::to_string(SARF_METRICS) + "\n  },\n  \"benchmarks\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& r = results[i];
+        char num[64];
+        out += i ? ",\n    {\n" : "\n    {\n";
+        out += "      \"name\": " + JsonString(r.name) + ",\n";
+        out += "      \"run_name\": " + JsonString(r.runType == "aggregate" ? r.name.substr(0, r.name.size() - r.aggregate.size() - 1) : r.name) + ",\n";
+        out += "      \"run_type\": " + JsonString(r.runType) + ",\n";
+        out += "      \"repetitions\": " + std::to_string(r.repetitions) + ",\n";
+        if (r.runType == "aggregate") out += "      \"aggregate_name\": " + JsonString(r.aggregate) + ",\n";
+        else out += "      \"repetition_index\": " + std::to_string(r.repetitionIndex) + ",\n";
+        if (!r.error.empty()) {
+            out += "      \"error_occurred\": true,\n      \"error_message\": " + JsonString(r.error) + "\n    }";
+            continue;
+        }
+        out += "      \"iterations\": " + std::to_string(r.iterations) + ",\n";
+        snprintf(num, sizeof(num), "%.6g", r.realNs);
+        out += std::string("      \"real_time\": ") + num + ",\n";
+        snprintf(num, sizeof(num), "%.6g", r.cpuNs);
+        out += std::string("      \"cpu_time\": ") + num + ",\n";
+        out += "      \"time_unit\": \"ns\"";
+        if (r.itemsPerSecond > 0) { snprintf(num, sizeof(num), "%.6g", r.itemsPerSecond); out += std::string(",\n      \"items_per_second\": ") + num; }
+        if (r.bytesPerSecond > 0) { snprintf(num, sizeof(num), "%.6g", r.bytesPerSecond); out += std::string(",\n      \"bytes_per_second\": ") + num; }
+        if (!r.label.empty()) out += ",\n      \"label\": " + JsonString(r.label);
+        out += "\n    }";
+    }
+    return out + "\n  ]\n}\n";
+}
+
+int Usage() {
+    fprintf(stderr, "usage: sarf_bench [--benchmark_filter=REGEX] [--benchmark_min_time=SECONDS] [--benchmark_repetitions=N]\n"
+                    "                  [--benchmark_format=console|json] [--benchmark_out=FILE] [--benchmark_list_tests]\n");
+    return 2;
+}
+}
+
+int RunBenchmarks(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto value = [&arg](const char* flag, std::string& out) {
+            size_t n = strlen(flag);
+            if (arg.compare(0, n, flag) != 0 || arg.size() <= n || arg[n] != '=') return false;
+            out = arg.substr(n + 1);
+            return true;
+        };
+        std::string v;
+        if (value("--benchmark_filter", v)) options.filter = v;
+        else if (value("--benchmark_min_time", v)) options.minTime = atof(v.c_str());
+        else if (value("--benchmark_repetitions", v)) options.repetitions = (std::max)(1, atoi(v.c_str()));
+        else if (value("--benchmark_format", v) && (v == "console" || v == "json")) options.json = v == "json";
+        else if (value("--benchmark_out", v)) options.out = v;
+        else if (arg == "--benchmark_list_tests") options.list = true;
+        else return Usage();
+    }
+    std::regex filter;
+    try { filter = std::regex(options.filter); }
+    catch (const std::regex_error&) { fprintf(stderr, "bad --benchmark_filter: %s\n", options.filter.c_str()); return 2; }
+
+    struct Instance { const Benchmark* b; std::vector<int64_t> args; std::string name; };
+    std::vector<Instance> instances;
+    for (const auto& b : Registry()) {
+        std::vector<std::vector<int64_t>> argSets = b->args.empty() ? std::vector<std::vector<int64_t>>{ {} } : b->args;
+        for (const auto& args : argSets) {
+            std::string name = b->name;
+            for (int64_t a : args) name += "/" + std::to_string(a);
+            if (std::regex_search(name, filter)) instances.push_back({ b.get(), args, name });
+        }
+    }
+    if (options.list) {
+        for (const Instance& inst : instances) printf("%s\n", inst.name.c_str());
+        return 0;
+    }
+
+    size_t nameWidth = 10;
+    for (const Instance& inst : instances) nameWidth = (std::max)(nameWidth, inst.name.size() + (options.repetitions > 1 ? 7 : 0));
+    if (!options.json) {
+        printf("%-*s %13s %13s %12s\n", (int)nameWidth, "Benchmark", "Time", "CPU", "Iterations");
+        printf("%s\n", std::string(nameWidth + 41, '-').c_str());
+    }
+    std::vector<Result> results;
+    bool failed = false;
+    for (const Instance& inst : instances) {
+        std::vector<Result> runs;
+        for (int rep = 0; rep < options.repetitions; rep++) {
+            Result r = Runner::Run(*inst.b, inst.args, options.minTime);
+            r.name = inst.name;
+            r.repetitions = options.repetitions;
+            r.repetitionIndex = rep;
+            failed |= !r.error.empty();
+            if (!options.json) PrintRow(r, nameWidth);
+            results.push_back(r);
+            runs.push_back(r);
+            if (!r.error.empty()) break;
+        }
+        if (runs.size() > 1) {
+            for (const char* kind : { "mean", "median", "stddev" }) {
+                Result a = Aggregate(runs, kind);
+                if (!options.json) PrintRow(a, nameWidth);
+                results.push_back(a);
+            }
+        }
+    }
+
+    std::string json = ToJson(results);
+    if (options.json) fputs(json.c_str(), stdout);
+    if (!options.out.empty()) {
+        FILE* f = fopen(options.out.c_str(), "wb");
+        if (!f || fwrite(json.data(), 1, json.size(), f) != json.size()) {
+            fprintf(stderr, "%s: cannot write results\n", options.out.c_str());
+            if (f) fclose(f);
+            return 2;
+        }
+        fclose(f);
+    }
+    return failed ? 1 : 0;
+}
+
+}
+
+int main(int argc, char** argv) {
+    return bench::RunBenchmarks(argc, argv);
+}
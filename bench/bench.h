@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// A small benchmark harness with the Google Benchmark interface, so the suite builds anywhere
+// the core does without another dependency, and its JSON output (--benchmark_out) works with
+// the usual comparison tooling.
+//
+//   static void BM_Thing(bench::State& state) {
+//       Setup(state.range(0));
+//       for (auto _ : state) bench::DoNotOptimize(Thing());
+//       state.SetItemsProcessed(state.iterations());
+//   }
+//   BENCHMARK(BM_Thing)->Arg(100)->Arg(10000);
+//
+// Iterations are calibrated until a run takes --benchmark_min_time seconds. Real time is wall
+// clock; CPU time is the benchmark thread's, so work handed to background threads shows only in
+// real time.
+namespace bench {
+
+class State {
+public:
+    struct Value {};
+    struct Iterator {
+        State* state;
+        uint64_t left;
+        Value operator*() const { return {}; }
+        Iterator& operator++() { left--; return *this; }
+        bool operator!=(const Iterator&) const {
+            if (left) return true;
+            state->StopTiming();
+            return false;
+        }
+    };
+    Iterator begin() { StartTiming(); return { this, maxIterations }; }
+    Iterator end() { return { this, 0 }; }
+
+    int64_t range(size_t i = 0) const { return i < args.size() ? args[i] : 0; }
+    uint64_t iterations() const { return maxIterations; }
+
+    // Excludes per-iteration setup from both clocks
+    void PauseTiming();
+    void ResumeTiming();
+
+    void SetItemsProcessed(int64_t n) { items = n; }
+    void SetBytesProcessed(int64_t n) { bytes = n; }
+    void SetLabel(std::string text) { label = std::move(text); }
+    void SkipWithError(std::string message) { error = std::move(message); }
+
+private:
+    friend struct Runner;
+    State(uint64_t iterations, std::vector<int64_t> args) : maxIterations(iterations), args(std::move(args)) {}
+
+    void StartTiming();
+    void StopTiming();
+
+    uint64_t maxIterations;
+    std::vector<int64_t> args;
+    int64_t items = 0, bytes = 0;
+    std::string label, error;
+    bool running = false;
+    int64_t realStart = 0, cpuStart = 0;
+    int64_t realNs = 0, cpuNs = 0;
+};
+
+class Benchmark {
+public:
+    Benchmark(std::string name, void (*fn)(State&)) : name(std::move(name)), fn(fn) {}
+
+    Benchmark* Arg(int64_t a) { args.push_back({ a }); return this; }
+    Benchmark* Args(std::vector<int64_t> a) { args.push_back(std::move(a)); return this; }
+    Benchmark* Iterations(uint64_t n) { fixedIterations = n; return this; } // skips calibration
+
+    std::string name;
+    void (*fn)(State&);
+    std::vector<std::vector<int64_t>> args;
+    uint64_t fixedIterations = 0;
+};
+
+// Wall-clock durations of single operations, for benchmarks where the tail matters more than
+// the mean: time each one with Now() and report Summary() in the label
+class Latencies {
+public:
+    static int64_t Now(); // steady clock, nanoseconds
+
+    void Add(int64_t ns) { samples.push_back(ns); sorted = false; }
+    size_t Count() const { return samples.size(); }
+    int64_t Percentile(double p); // p in [0, 100]; 0 without samples
+    std::string Summary();        // "p50 2 us, p90 5 us, p99 40 us, max 3 ms"
+
+private:
+    std::vector<int64_t> samples;
+    bool sorted = false;
+};
+
+Benchmark* RegisterBenchmark(const char* name, void (*fn)(State&));
+int RunBenchmarks(int argc, char** argv);
+
+// Keeps the compiler from discarding a result, or from assuming memory is unchanged
+#if defined(_MSC_VER) && !defined(__clang__)
+void UseCharPointer(const volatile char*);
+template <class T> inline void DoNotOptimize(const T& value) {
+    UseCharPointer(&reinterpret_cast<const volatile char&>(value));
+    _ReadWriteBarrier();
+}
+inline void ClobberMemory() { _ReadWriteBarrier(); }
+#else
+template <class T> inline void DoNotOptimize(const T& value) { asm volatile("" : : "r,m"(value) : "memory"); }
+template <class T> inline void DoNotOptimize(T& value) { asm volatile("" : "+r,m"(value) : : "memory"); }
+inline void ClobberMemory() { asm volatile("" : : : "memory"); }
+#endif
+
+}
+
+#define BENCH_CONCAT2(a, b) a##b
+#define BENCH_CONCAT(a, b) BENCH_CONCAT2(a, b)
+#define BENCHMARK(fn) \
+    static ::bench::Benchmark* BENCH_CONCAT(benchRegistered_, __LINE__) [[maybe_unused]] = ::bench::RegisterBenchmark(#fn, fn)
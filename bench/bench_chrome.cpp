@@ -0,0 +1,175 @@
+// Chrome painting: a frame of the tab strip and history sidebar, repainted after one tab's title
+// changes, either whole or only where the frame diff says it changed. The backend rasterizes
+// into a window-sized buffer, so a command costs in proportion to the pixels it covers, as GDI does.
+// Then the history sidebar's layout over the whole history: hovering and scrolling its rows.
+
+#include "bench.h"
+#include "corpus.h"
+
+#include "displaylist.h"
+#include "virtuallist.h"
+
+#include <algorithm>
+#include <random>
+
+namespace {
+const int WIDTH = 1280, HEIGHT = 800, STRIP_TOP = 66, STRIP_HEIGHT = 34, TABS = 30, ROWS = 40;
+
+class RasterBackend : public DisplayBackend {
+public:
+    RasterBackend() : pixels((size_t)WIDTH * HEIGHT) {}
+
+    void Fill(const DisplayCommand& c) override { Paint(c.bounds, c.color); }
+    // Glyphs cover a fraction of the box; filling it all is a fair stand-in for their cost
+    void Text(const DisplayCommand& c) override { Paint(c.bounds, c.color ^ (uint32_t)c.text.size()); }
+
+    DisplayRect clip = { 0, 0, WIDTH, HEIGHT };
+    std::vector<uint32_t> pixels;
+    size_t commands = 0, painted = 0;
+
+private:
+    void Paint(const DisplayRect& r, uint32_t value) {
+        int top = (std::max)(r.top, clip.top), bottom = (std::min)(r.bottom, clip.bottom);
+        int left = (std::max)(r.left, clip.left), right = (std::min)(r.right, clip.right);
+        commands++;
+        for (int y = top; y < bottom; y++) {
+            std::fill(pixels.begin() + (size_t)y * WIDTH + left, pixels.begin() + (size_t)y * WIDTH + right, value);
+            painted += (size_t)(right - left);
+        }
+    }
+};
+
+// As BuildChrome lays it out: the header, the strip's tabs with title and close glyph, and the
+// history rows in the sidebar
+void BuildFrame(DisplayList& frame, const std::vector<std::wstring>& titles, const std::vector<std::wstring>& rows) {
+    frame.Clear();
+    frame.Fill({ 0, 0, WIDTH, HEIGHT }, 0x202020);
+    frame.Fill({ 0, STRIP_TOP + STRIP_HEIGHT, 320, HEIGHT }, 0x181818);
+    frame.PushClip({ 0, STRIP_TOP, WIDTH, STRIP_TOP + STRIP_HEIGHT });
+    int tabWidth = WIDTH / TABS;
+    for (int i = 0; i < TABS; i++) {
+        DisplayRect tab = { i * tabWidth, STRIP_TOP, (i + 1) * tabWidth - 2, STRIP_TOP + STRIP_HEIGHT };
+        frame.Fill(tab, i == 0 ? 0x303030 : 0x282828);
+        if (i == 0) frame.Fill({ tab.left, tab.bottom - 2, tab.right, tab.bottom }, 0xFF8800);
+        frame.Text({ tab.left + 8, tab.top, tab.right - 20, tab.bottom }, titles[i], 1, 0xE0E0E0, 0);
+        frame.Text({ tab.right - 18, tab.top, tab.right - 4, tab.bottom }, L"✕", 1, 0xA0A0A0, 0);
+    }
+    frame.PopClip();
+    frame.PushClip({ 0, STRIP_TOP + STRIP_HEIGHT + 100, 320, HEIGHT });
+    for (int i = 0; i < ROWS; i++) {
+        int top = STRIP_TOP + STRIP_HEIGHT + 100 + i * 28;
+        frame.Text({ 20, top, 300, top + 24 }, rows[i], 2, 0x909090, 0);
+    }
+    frame.PopClip();
+}
+
+// Arg 0 repaints the whole window each frame; arg 1 diffs against the previous frame and
+// repaints only the dirty areas, each clipped, as the update region does
+void BM_ChromeRepaint(bench::State& state) {
+    bool diff = state.range(0) != 0;
+    std::vector<std::wstring> urls = corpus::PageUrls(ROWS, 7);
+    std::vector<std::wstring> titles, rows;
+    for (int i = 0; i < TABS; i++) titles.push_back(L"Story " + std::to_wstring(i) + L" - Site News");
+    for (int i = 0; i < ROWS; i++) rows.push_back(urls[(size_t)i]);
+    DisplayList previous, next;
+    BuildFrame(previous, titles, rows);
+    RasterBackend backend;
+    previous.Replay(backend, backend.clip);
+    backend.commands = backend.painted = 0;
+    size_t frames = 0, tick = 0;
+    for (auto _ : state) {
+        // A loading page counts up in its title, as progress or unread counts do
+        titles[tick % TABS] = L"(" + std::to_wstring(tick) + L") Story - Site News";
+        tick++;
+        BuildFrame(next, titles, rows);
+        if (diff) {
+            for (const DisplayRect& r : DiffDisplayLists(previous, next)) {
+                backend.clip = r;
+                next.Replay(backend, r);
+            }
+        }
+        else {
+            backend.clip = { 0, 0, WIDTH, HEIGHT };
+            next.Replay(backend, backend.clip);
+        }
+        std::swap(previous, next);
+        frames++;
+    }
+    bench::DoNotOptimize(backend.pixels.data());
+    state.SetItemsProcessed((int64_t)frames);
+    if (frames) state.SetLabel((diff ? "diff, " : "full, ") + std::to_string(backend.commands / frames) + " commands and " +
+        std::to_string(backend.painted / frames) + " pixels a frame");
+}
+BENCHMARK(BM_ChromeRepaint)->Arg(0)->Arg(1);
+
+// --- HISTORY SIDEBAR ---
+const DisplayRect SIDEBAR_VIEW = { 20, 200, 300, 745 };
+
+VirtualListLayout Sidebar(size_t rows) {
+    VirtualListLayout list;
+    list.SetViewport(SIDEBAR_VIEW);
+    list.SetCount(rows);
+    return list;
+}
+
+// Before the layout, each row's rect was built from its index to find the hovered one
+size_t LegacyHitTest(size_t rows, int64_t scroll, int x, int y) {
+    for (size_t i = 0; i < rows; i++) {
+        int top = (int)(SIDEBAR_VIEW.top + (int64_t)i * 30 - scroll);
+        DisplayRect r = { SIDEBAR_VIEW.left, top, SIDEBAR_VIEW.right, top + 25 };
+        if (x >= r.left && x < r.right && y >= r.top && y < r.bottom && y >= SIDEBAR_VIEW.top && y < SIDEBAR_VIEW.bottom) return i;
+    }
+    return VirtualListLayout::npos;
+}
+
+// A mouse move over the sidebar, scrolled to somewhere in the history
+void BM_HistorySidebarHover(bench::State& state) {
+    size_t rows = (size_t)state.range(0);
+    VirtualListLayout list = Sidebar(rows);
+    std::mt19937 rng(9);
+    list.ScrollBy((int64_t)(rng() % rows) * 30);
+    size_t hits = 0;
+    for (auto _ : state) {
+        size_t row = list.HitTest(SIDEBAR_VIEW.left + 40, SIDEBAR_VIEW.top + (int)(rng() % 545));
+        hits += row != VirtualListLayout::npos;
+        bench::DoNotOptimize(row);
+    }
+    state.SetItemsProcessed(state.iterations());
+    bench::DoNotOptimize(hits);
+}
+BENCHMARK(BM_HistorySidebarHover)->Arg(100000);
+
+void BM_HistorySidebarHoverLegacy(bench::State& state) {
+    size_t rows = (size_t)state.range(0);
+    VirtualListLayout list = Sidebar(rows);
+    std::mt19937 rng(9);
+    list.ScrollBy((int64_t)(rng() % rows) * 30);
+    for (auto _ : state) {
+        size_t row = LegacyHitTest(rows, list.ScrollOffset(), SIDEBAR_VIEW.left + 40, SIDEBAR_VIEW.top + (int)(rng() % 545));
+        bench::DoNotOptimize(row);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_HistorySidebarHoverLegacy)->Arg(100000);
+
+// A wheel notch, then the rows to draw: the visible range and each one's rect
+void BM_HistorySidebarScroll(bench::State& state) {
+    size_t rows = (size_t)state.range(0);
+    VirtualListLayout list = Sidebar(rows);
+    std::mt19937 rng(9);
+    int64_t area = 0;
+    for (auto _ : state) {
+        list.ScrollBy(rng() % 2 ? 90 : -90);
+        if (list.ScrollOffset() == 0 || rng() % 64 == 0) list.ScrollBy((int64_t)(rng() % rows) * 30 - list.ScrollOffset());
+        size_t first, end;
+        list.VisibleRange(first, end);
+        for (size_t i = first; i < end; i++) {
+            DisplayRect r = list.RowRect(i);
+            area += r.bottom - r.top;
+        }
+    }
+    bench::DoNotOptimize(area);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_HistorySidebarScroll)->Arg(100000);
+}
@@ -0,0 +1,131 @@
+// Request classification on the receiving thread versus through the classification service.
+// CPU time is the receiving thread's (the browser's UI thread), real time the throughput.
+
+#include "bench.h"
+#include "corpus.h"
+
+#include "classificationservice.h"
+#include "fakeeventsource.h"
+#include "requestclassifier.h"
+
+#include <atomic>
+#include <filesystem>
+#include <thread>
+
+namespace {
+// In page-load order: only host pairs that repeat can be answered from the cache, and so inline
+const std::vector<corpus::Request>& Requests() {
+    static const std::vector<corpus::Request> requests = corpus::PageLoads(16384, 9);
+    return requests;
+}
+
+// The browser before the service: every request decided inside the event handler
+void BM_ClassifyOnUiThread(bench::State& state) {
+    RequestClassifier classifier(corpus::Rules());
+    const auto& requests = Requests();
+    size_t i = 0;
+    for (auto _ : state) {
+        const corpus::Request& r = requests[i++ & 16383];
+        bench::DoNotOptimize(classifier.ShouldBlock(r.url, r.source, r.type));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ClassifyOnUiThread);
+
+// Args: workers, requests a page keeps in flight. Once that many are held open the UI thread
+// waits for the next post and completes what was decided, as its message loop would.
+void BM_ClassificationService(bench::State& state) {
+    RequestClassifier classifier(corpus::Rules());
+    FakeEventSource source;
+    ClassificationService service(classifier, (unsigned)state.range(0), [&source] { source.Post(); });
+    const auto& requests = Requests();
+    size_t inFlight = (size_t)state.range(1);
+    std::vector<ClassifyResult> decided;
+    uint64_t blocked = 0, i = 0;
+    auto complete = [&] {
+        source.WaitForPost();
+        decided.clear();
+        source.open -= service.Drain(decided);
+        for (const ClassifyResult& r : decided) blocked += r.blocked;
+    };
+    for (auto _ : state) {
+        const corpus::Request& r = requests[i & 16383];
+        bool block;
+        if (service.Submit({ i, i & 7, r.type, r.url, r.source }, block)) blocked += block;
+        else source.open++;
+        i++;
+        while (source.open >= inFlight) complete();
+    }
+    while (source.open) complete();
+    bench::DoNotOptimize(blocked);
+    ClassificationService::Stats stats = service.GetStats();
+    state.SetItemsProcessed(state.iterations());
+    char label[64];
+    snprintf(label, sizeof(label), "inline %.0f%%, max queued %zu",
+        100.0 * stats.decidedInline / (std::max<uint64_t>)(1, stats.decidedInline + stats.deferred), stats.maxQueued);
+    state.SetLabel(label);
+}
+BENCHMARK(BM_ClassificationService)->Args({ 1, 64 })->Args({ 2, 64 })->Args({ 4, 256 });
+
+// Args: classifying threads, milliseconds between publishes (0: none). Each publish loads a
+// fresh ruleset from a snapshot, as a list update would, and starts a new cache generation.
+// Reported: the benchmark thread's latency per request, the others classifying alongside it.
+void BM_ClassifyWhilePublishing(bench::State& state) {
+    size_t threads = (size_t)state.range(0);
+    int64_t everyMs = state.range(1);
+    std::filesystem::path snapshot = std::filesystem::temp_directory_path() / "sarf_bench";
+    std::filesystem::create_directories(snapshot);
+    snapshot /= "filters-publish.bin";
+    {
+        RulesetStore::Reader current(corpus::Rules());
+        current->filters.SaveSnapshot(snapshot, 1);
+    }
+    auto load = [&snapshot] {
+        auto ruleset = std::make_unique<Ruleset>();
+        ruleset->filters.LoadSnapshot(snapshot, ruleset->sourceStamp);
+        return ruleset;
+    };
+    RulesetStore store;
+    store.Publish(load());
+    RequestClassifier classifier(store);
+    const auto& requests = Requests();
+
+    std::atomic<bool> stop{ false };
+    std::vector<std::thread> others;
+    for (size_t t = 1; t < threads; t++) {
+        others.emplace_back([&, t] {
+            for (size_t i = t * 4099; !stop.load(std::memory_order_relaxed); i++) {
+                const corpus::Request& r = requests[i & 16383];
+                bench::DoNotOptimize(classifier.ShouldBlock(r.url, r.source, r.type));
+            }
+        });
+    }
+    uint64_t publishes = 0;
+    std::thread publisher;
+    if (everyMs) {
+        publisher = std::thread([&] {
+            while (!stop.load(std::memory_order_relaxed)) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(everyMs));
+                store.Publish(load());
+                store.Reclaim();
+                publishes++;
+            }
+        });
+    }
+
+    bench::Latencies latencies;
+    size_t i = 0;
+    for (auto _ : state) {
+        const corpus::Request& r = requests[i++ & 16383];
+        int64_t started = bench::Latencies::Now();
+        bench::DoNotOptimize(classifier.ShouldBlock(r.url, r.source, r.type));
+        latencies.Add(bench::Latencies::Now() - started);
+    }
+    stop = true;
+    for (std::thread& t : others) t.join();
+    if (publisher.joinable()) publisher.join();
+    state.SetItemsProcessed(state.iterations());
+    state.SetLabel(latencies.Summary() + ", " + std::to_string(publishes) + " publishes");
+}
+BENCHMARK(BM_ClassifyWhilePublishing)->Args({ 1, 0 })->Args({ 1, 5 })->Args({ 4, 0 })->Args({ 4, 5 });
+}
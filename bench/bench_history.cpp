@@ -0,0 +1,212 @@
+// History persistence and queries: startup load, recording visits, and the sidebar's reads
+
+#include "bench.h"
+#include "corpus.h"
+
+#include "historylog.h"
+#include "historystore.h"
+
+#include <filesystem>
+#include <fstream>
+#include <map>
+
+namespace {
+const int64_t DAY_MS = 24 * 60 * 60 * 1000;
+
+std::filesystem::path BenchDir() {
+    static const std::filesystem::path dir = [] {
+        std::filesystem::path d = std::filesystem::temp_directory_path() / "sarf_bench";
+        std::filesystem::create_directories(d);
+        return d;
+    }();
+    return dir;
+}
+
+// A history.db + history.log pair with `entries` URLs visited over the last year, written once
+// per size and reused by every benchmark that loads it
+std::filesystem::path HistoryFiles(size_t entries) {
+    static std::map<size_t, std::filesystem::path> built;
+    auto it = built.find(entries);
+    if (it != built.end()) return it->second;
+    std::filesystem::path stem = BenchDir() / ("history-" + std::to_string(entries));
+    std::filesystem::remove(stem.string() + ".db");
+    std::filesystem::remove(stem.string() + ".log");
+    {
+        HistoryStore store(stem.string() + ".db", stem.string() + ".log");
+        store.Load();
+        std::vector<std::wstring> urls = corpus::PageUrls(entries, 7);
+        int64_t now = HistoryLog::Now();
+        std::mt19937 rng(7);
+        for (size_t i = 0; i < urls.size(); i++) {
+            int64_t time = now - (int64_t)(rng() % 365) * DAY_MS;
+            store.RecordVisit(urls[i], time);
+            if (i % 4 == 0) store.RecordVisit(urls[i], time + 1000);
+            if (i % 2 == 0) store.SetTitle(urls[i], L"Story " + std::to_wstring(i) + L" - Site News");
+        }
+    }
+    {
+        // A second session finishes the checkpoint, as a real profile would have
+        HistoryStore store(stem.string() + ".db", stem.string() + ".log");
+        store.Load();
+    }
+    built.emplace(entries, stem);
+    return stem;
+}
+
+// Startup: open, map the base, replay the journal, and read the first screen of the sidebar
+void BM_HistoryLoad(bench::State& state) {
+    std::filesystem::path stem = HistoryFiles((size_t)state.range(0));
+    for (auto _ : state) {
+        HistoryStore store(stem.string() + ".db", stem.string() + ".log");
+        store.Load();
+        bench::DoNotOptimize(store.Top(50));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_HistoryLoad)->Arg(10000)->Arg(100000);
+
+// Navigation: one visit, journaled; checkpoints run on their own thread as in the browser
+void BM_HistoryRecordVisit(bench::State& state) {
+    std::filesystem::path stem = BenchDir() / "history-record";
+    std::filesystem::remove(stem.string() + ".db");
+    std::filesystem::remove(stem.string() + ".log");
+    std::vector<std::wstring> urls = corpus::PageUrls(8192, 11);
+    {
+        HistoryStore store(stem.string() + ".db", stem.string() + ".log");
+        store.Load();
+        int64_t now = HistoryLog::Now();
+        size_t i = 0;
+        for (auto _ : state) {
+            store.RecordVisit(urls[i & 8191], now + (int64_t)i);
+            i++;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_HistoryRecordVisit);
+
+// What one navigation costs the UI thread, and what reaches the disk per 1000 of them, with a
+// history already holding range(0) URLs. The pre-journal browser kept the most recent URLs in a
+// vector and rewrote the whole file after every navigation, flushing each line; it kept 25, and
+// keeping more made each rewrite longer.
+const size_t NAVIGATION_URLS = 8192;
+
+void SetNavigationLabel(bench::State& state, uint64_t bytes) {
+    char label[64];
+    snprintf(label, sizeof(label), "%.1f KB per 1000 navigations",
+        state.iterations() ? (double)bytes / state.iterations() * 1000 / 1024 : 0.0);
+    state.SetLabel(label);
+}
+
+void BM_HistoryNavigateLegacy(bench::State& state) {
+    size_t keep = (size_t)state.range(0);
+    std::filesystem::path file = BenchDir() / "history-legacy.dat";
+    std::vector<std::wstring> urls = corpus::PageUrls(NAVIGATION_URLS, 11);
+    std::vector<std::wstring> historyList;
+    for (size_t i = 0; i < keep; i++) historyList.push_back(urls[(i * 7919) % NAVIGATION_URLS]);
+    size_t fileBytes = 0; // one byte per character, as the C locale writes these
+    for (const std::wstring& url : historyList) fileBytes += url.size() + 1;
+    uint64_t bytes = 0;
+    size_t i = keep;
+    for (auto _ : state) {
+        const std::wstring& url = urls[(i++ * 7919) % NAVIGATION_URLS];
+        if (!historyList.empty() && historyList[0] == url) continue;
+        historyList.insert(historyList.begin(), url);
+        fileBytes += url.size() + 1;
+        if (historyList.size() > keep) {
+            fileBytes -= historyList.back().size() + 1;
+            historyList.pop_back();
+        }
+        std::wofstream out(file, std::ios::out | std::ios::trunc);
+        for (const std::wstring& u : historyList) out << u << std::endl;
+        out.close();
+        bytes += fileBytes;
+    }
+    state.SetItemsProcessed(state.iterations());
+    SetNavigationLabel(state, bytes);
+}
+BENCHMARK(BM_HistoryNavigateLegacy)->Arg(25)->Arg(5000);
+
+void BM_HistoryNavigate(bench::State& state) {
+    size_t keep = (size_t)state.range(0);
+    std::filesystem::path stem = BenchDir() / "history-navigate";
+    std::filesystem::remove(stem.string() + ".db");
+    std::filesystem::remove(stem.string() + ".log");
+    std::vector<std::wstring> urls = corpus::PageUrls(NAVIGATION_URLS, 11);
+    HistoryStore store(stem.string() + ".db", stem.string() + ".log");
+    store.Load();
+    int64_t now = HistoryLog::Now();
+    for (size_t i = 0; i < keep; i++) store.RecordVisit(urls[(i * 7919) % NAVIGATION_URLS], now + (int64_t)i);
+    store.Flush();
+    uint64_t before = store.BytesWritten();
+    size_t i = keep;
+    for (auto _ : state) {
+        store.RecordVisit(urls[(i * 7919) % NAVIGATION_URLS], now + (int64_t)i);
+        i++;
+    }
+    store.Flush();
+    state.SetItemsProcessed(state.iterations());
+    SetNavigationLabel(state, store.BytesWritten() - before);
+}
+BENCHMARK(BM_HistoryNavigate)->Arg(25)->Arg(5000);
+
+// Shutdown: everything recorded this session, written out
+void BM_HistorySave(bench::State& state) {
+    std::filesystem::path stem = BenchDir() / "history-save";
+    std::vector<std::wstring> urls = corpus::PageUrls((size_t)state.range(0), 13);
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::filesystem::remove(stem.string() + ".db");
+        std::filesystem::remove(stem.string() + ".log");
+        auto store = std::make_unique<HistoryStore>(stem.string() + ".db", stem.string() + ".log");
+        store->Load();
+        int64_t now = HistoryLog::Now();
+        for (size_t i = 0; i < urls.size(); i++) store->RecordVisit(urls[i], now + (int64_t)i);
+        state.ResumeTiming();
+        store.reset();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_HistorySave)->Arg(1000)->Arg(20000);
+
+struct LoadedHistory {
+    std::unique_ptr<HistoryStore> store;
+    std::vector<std::wstring> urls;
+};
+
+LoadedHistory& Loaded(size_t entries) {
+    static std::map<size_t, LoadedHistory> loaded;
+    LoadedHistory& h = loaded[entries];
+    if (!h.store) {
+        std::filesystem::path stem = HistoryFiles(entries);
+        h.store = std::make_unique<HistoryStore>(stem.string() + ".db", stem.string() + ".log");
+        h.store->Load();
+        h.urls = corpus::PageUrls(entries, 7);
+    }
+    return h;
+}
+
+void BM_HistoryFind(bench::State& state) {
+    LoadedHistory& h = Loaded((size_t)state.range(0));
+    HistoryEntry entry;
+    size_t i = 0;
+    for (auto _ : state) {
+        bench::DoNotOptimize(h.store->Find(h.urls[(i * 7919) % h.urls.size()], entry));
+        i++;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_HistoryFind)->Arg(100000);
+
+// A sidebar page at an arbitrary scroll position
+void BM_HistoryRange(bench::State& state) {
+    LoadedHistory& h = Loaded((size_t)state.range(0));
+    size_t size = h.store->Size(), i = 0;
+    for (auto _ : state) {
+        bench::DoNotOptimize(h.store->Range((i * 7919) % size, 40));
+        i++;
+    }
+    state.SetItemsProcessed(state.iterations() * 40);
+}
+BENCHMARK(BM_HistoryRange)->Arg(10000)->Arg(100000);
+}
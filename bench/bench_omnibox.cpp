@@ -0,0 +1,109 @@
+// Address bar: deciding what typed text means, and as-you-type suggestions
+
+#include "bench.h"
+#include "corpus.h"
+
+#include "omnibox.h"
+
+#include <map>
+#include <memory>
+
+namespace {
+void BM_ClassifyOmniboxInput(bench::State& state) {
+    std::vector<std::wstring> inputs = corpus::TypedInputs(4096);
+    std::wstring url;
+    size_t i = 0;
+    for (auto _ : state) bench::DoNotOptimize(ClassifyOmniboxInput(inputs[i++ & 4095], url));
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ClassifyOmniboxInput);
+
+void BM_OmniboxNavigationUrl(bench::State& state) {
+    std::vector<std::wstring> inputs = corpus::TypedInputs(4096);
+    size_t i = 0;
+    for (auto _ : state) bench::DoNotOptimize(OmniboxNavigationUrl(inputs[i++ & 4095]));
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_OmniboxNavigationUrl);
+
+// The background build the first time the address bar is focused
+void BM_OmniboxIndexBuild(bench::State& state) {
+    std::vector<std::wstring> urls = corpus::PageUrls((size_t)state.range(0), 3);
+    for (auto _ : state) {
+        OmniboxIndex index;
+        for (size_t i = 0; i < urls.size(); i++) index.Update(urls[i], L"Story " + std::to_wstring(i) + L" - Site News", (double)i);
+        bench::DoNotOptimize(index.Size());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_OmniboxIndexBuild)->Arg(10000)->Arg(100000);
+
+// Query keeps the last match set for refinement, so the shared index is not const
+OmniboxIndex& Index(size_t entries = 100000) {
+    static std::map<size_t, std::unique_ptr<OmniboxIndex>> built;
+    std::unique_ptr<OmniboxIndex>& index = built[entries];
+    if (!index) {
+        index = std::make_unique<OmniboxIndex>();
+        std::vector<std::wstring> urls = corpus::PageUrls(entries, 3);
+        for (size_t i = 0; i < urls.size(); i++) index->Update(urls[i], L"Story " + std::to_wstring(i) + L" - Site News", (double)i);
+    }
+    return *index;
+}
+
+// Typing "site1234.com/news" one keystroke at a time, each prefix a fresh query, so the
+// refinement path from the previous keystroke is what gets measured
+void BM_OmniboxQueryTyping(bench::State& state) {
+    OmniboxIndex& index = Index();
+    std::vector<std::wstring> words;
+    for (uint32_t i = 0; i < 64; i++) words.push_back(L"site" + std::to_wstring(i * 77) + L".com/news");
+    size_t w = 0, len = 1, results = 0;
+    for (auto _ : state) {
+        const std::wstring& word = words[w];
+        results += index.Query(std::wstring_view(word).substr(0, len)).size();
+        if (++len > word.size()) { len = 1; w = (w + 1) % words.size(); }
+    }
+    bench::DoNotOptimize(results);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_OmniboxQueryTyping);
+
+// Unrelated queries back to back: no refinement, every term looked up from scratch
+void BM_OmniboxQueryCold(bench::State& state) {
+    OmniboxIndex& index = Index();
+    static const wchar_t* queries[] = { L"story 42", L"site99", L"news 2019", L"comments", L"org/news", L"xyzzy", L"s", L"story 1 site" };
+    size_t i = 0, results = 0;
+    for (auto _ : state) results += index.Query(queries[i++ & 7]).size();
+    bench::DoNotOptimize(results);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_OmniboxQueryCold);
+
+// Typing real addresses and titles from the history, a keystroke at a time as the address bar
+// sends them, and timing every keystroke's query: what matters is the slowest, not the mean.
+// Addresses are typed the way people type them, without scheme or "www.", up to the path; one
+// target in four is looked up by its title instead. Each target starts afresh, so its first
+// keystrokes cannot refine the previous one's.
+void BM_OmniboxTypedReplay(bench::State& state) {
+    size_t entries = (size_t)state.range(0);
+    OmniboxIndex& index = Index(entries);
+    std::vector<std::wstring> urls = corpus::PageUrls(entries, 3);
+    std::mt19937 rng(17);
+    bench::Latencies keystrokes;
+    size_t results = 0;
+    for (auto _ : state) {
+        size_t target = rng() % entries;
+        std::wstring typed;
+        if (rng() % 4) typed = urls[target].substr(std::wstring(L"https://www.").size(), 28);
+        else typed = L"story " + std::to_wstring(target);
+        for (size_t len = 1; len <= typed.size(); len++) {
+            int64_t start = bench::Latencies::Now();
+            results += index.Query(std::wstring_view(typed).substr(0, len)).size();
+            keystrokes.Add(bench::Latencies::Now() - start);
+        }
+    }
+    bench::DoNotOptimize(results);
+    state.SetItemsProcessed((int64_t)keystrokes.Count());
+    state.SetLabel(keystrokes.Summary());
+}
+BENCHMARK(BM_OmniboxTypedReplay)->Arg(100000)->Arg(1000000);
+}
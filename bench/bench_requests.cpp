@@ -0,0 +1,102 @@
+// Per-request overheads around the blocking decision: the decision cache, metrics, and capture
+
+#include "bench.h"
+#include "corpus.h"
+
+#include "decisioncache.h"
+#include "filterlist.h"
+#include "metrics.h"
+#include "requesttrace.h"
+
+#include <filesystem>
+
+namespace {
+void BM_DecisionCacheLookup(bench::State& state) {
+    std::vector<corpus::Request> requests = corpus::Requests(16384);
+    std::vector<std::pair<std::wstring_view, std::wstring_view>> hosts;
+    for (const auto& r : requests) hosts.push_back({ UrlHost(r.source), UrlHost(r.url) });
+    DecisionCache cache;
+    for (size_t i = 0; i < hosts.size(); i++) cache.Store(hosts[i].first, hosts[i].second, requests[i].type, 1, i % 8 == 0);
+    size_t i = 0;
+    for (auto _ : state) {
+        size_t k = i++ & 16383;
+        bench::DoNotOptimize(cache.Lookup(hosts[k].first, hosts[k].second, requests[k].type, 1));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DecisionCacheLookup);
+
+// What the request handler adds on top of the decision when metrics are compiled in
+void BM_MetricsRequestClassified(bench::State& state) {
+    std::vector<corpus::Request> requests = corpus::Requests(4096);
+    std::vector<std::wstring_view> hosts;
+    for (const auto& r : requests) hosts.push_back(UrlHost(r.url));
+    RequestMetrics metrics;
+    size_t i = 0;
+    for (auto _ : state) {
+        size_t k = i++ & 4095;
+        metrics.RequestClassified(k & 31, hosts[k], k % 8 == 0, 250);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MetricsRequestClassified);
+
+// The same events with the host already hashed: the counter and histogram updates alone
+void BM_MetricsRequestClassifiedKeyed(bench::State& state) {
+    std::vector<corpus::Request> requests = corpus::Requests(4096);
+    std::vector<std::pair<uint64_t, std::wstring_view>> hosts;
+    for (const auto& r : requests) hosts.push_back({ RequestMetrics::HostKey(UrlHost(r.url)), UrlHost(r.url) });
+    RequestMetrics metrics;
+    size_t i = 0;
+    for (auto _ : state) {
+        size_t k = i++ & 4095;
+        metrics.RequestClassified(k & 31, hosts[k].first, hosts[k].second, k % 8 == 0, 250);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MetricsRequestClassifiedKeyed);
+
+// Capture on the request thread: only the queueing, encoding happens on the writer's thread
+void BM_RequestTraceAppend(bench::State& state) {
+    std::vector<corpus::Request> requests = corpus::Requests(4096);
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "sarf_bench_append.sarftrace";
+    {
+        RequestTraceWriter writer(path);
+        size_t i = 0;
+        for (auto _ : state) {
+            const corpus::Request& r = requests[i++ & 4095];
+            RequestTraceRecord record;
+            record.time = (int64_t)i * 1000;
+            record.tab = i & 7;
+            record.type = r.type;
+            record.url = r.url;
+            record.source = r.source;
+            writer.Append(std::move(record));
+        }
+    }
+    std::filesystem::remove(path);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RequestTraceAppend);
+
+void BM_RequestTraceRead(bench::State& state) {
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "sarf_bench_read.sarftrace";
+    size_t count = (size_t)state.range(0);
+    {
+        RequestTraceWriter writer(path);
+        std::vector<corpus::Request> requests = corpus::Requests(count);
+        for (size_t i = 0; i < count; i++) writer.Append({ (int64_t)i * 1000, i & 7, requests[i].type, i % 8 == 0, requests[i].url, requests[i].source });
+    }
+    int64_t bytes = (int64_t)std::filesystem::file_size(path);
+    for (auto _ : state) {
+        std::vector<RequestTraceRecord> records;
+        ReadRequestTrace(path, records);
+        if (records.size() != count) state.SkipWithError("trace did not round-trip");
+        bench::DoNotOptimize(records);
+    }
+    std::filesystem::remove(path);
+    state.SetItemsProcessed(state.iterations() * (int64_t)count);
+    state.SetBytesProcessed(state.iterations() * bytes);
+}
+BENCHMARK(BM_RequestTraceRead)->Arg(100000);
+}
@@ -0,0 +1,183 @@
+// Foreground page loads while background tabs keep loading, with and without the request
+// scheduler, on a simulated network: a 10 Mbit/s link shared evenly by the transfers on it, each
+// starting a round trip after it is sent. Background tabs poll, rotate carousel images, send
+// beacons and, one in four, autoplay video. After a few seconds of that the foreground tab loads
+// a page: its document, then scripts, stylesheets and images. Reported: the foreground load
+// time, what the background tabs still got through, how many of their requests were still held
+// when it finished, and the longest wait of one let go. Time per iteration is the simulation's,
+// scheduler included.
+
+#include "bench.h"
+
+#include "requestscheduler.h"
+
+#include <algorithm>
+#include <random>
+#include <unordered_map>
+
+namespace {
+const double LINK_BYTES_PER_MS = 1250; // 10 Mbit/s
+const int64_t ROUND_TRIP_MS = 60;
+const int64_t WARMUP_MS = 5000;        // background traffic before the navigation
+const int64_t TICK_MS = 1000;          // RequestScheduler::Tick, as the browser's timer
+const uint64_t FOREGROUND_TAB = 0;
+
+// What a background tab keeps asking for
+struct Source {
+    uint32_t type;
+    const wchar_t* name;
+    int64_t everyMs;
+    double bytes;
+    bool sameUrl; // the same URL every time, as beacons are
+};
+const Source SOURCES[] = {
+    { FT_XHR, L"poll", 2000, 4000, false },
+    { FT_IMAGE, L"carousel", 1500, 60000, false },
+    { FT_PING, L"beacon", 1000, 300, true },
+    { FT_MEDIA, L"video", 2000, 150000, false }, // only in every fourth tab
+};
+
+struct Transfer {
+    uint64_t tab;
+    std::wstring url;
+    int64_t startsAt; // after the round trip
+    double bytes;
+    double left;
+};
+
+class Network {
+public:
+    void Send(uint64_t tab, std::wstring url, double bytes, int64_t now) {
+        transfers.push_back({ tab, std::move(url), now + ROUND_TRIP_MS, bytes, bytes });
+    }
+
+    // One millisecond; calls done(transfer) for each that finishes
+    template <typename Done>
+    void Step(int64_t now, Done done) {
+        size_t active = 0;
+        for (const Transfer& t : transfers) active += t.startsAt <= now;
+        if (!active) return;
+        double share = LINK_BYTES_PER_MS / active;
+        for (size_t i = 0; i < transfers.size();) {
+            Transfer& t = transfers[i];
+            if (t.startsAt <= now && (t.left -= share) <= 0) {
+                Transfer finished = std::move(t);
+                t = std::move(transfers.back());
+                transfers.pop_back();
+                done(finished);
+            }
+            else i++;
+        }
+    }
+
+private:
+    std::vector<Transfer> transfers;
+};
+
+struct Result {
+    int64_t foregroundMs = 0;
+    double backgroundBytes = 0; // delivered from the navigation to the end of the load
+    RequestScheduler::Stats stats;
+};
+
+Result SimulateLoad(size_t backgroundTabs, bool scheduled, uint32_t seed) {
+    Network network;
+    RequestScheduler scheduler((RequestScheduler::Config()));
+    for (uint64_t tab = 1; tab <= backgroundTabs; tab++) scheduler.Add(tab);
+    scheduler.Activate(FOREGROUND_TAB, 0);
+    std::mt19937 rng(seed);
+    std::vector<int64_t> phases(backgroundTabs * 4);
+    for (int64_t& p : phases) p = rng() % 2000;
+    std::unordered_map<uint64_t, double> heldBytes; // by request id
+    std::vector<ScheduledRequest> released;
+    uint64_t nextId = 1, counter = 0;
+    size_t foregroundLeft = 0;
+    Result result;
+
+    auto request = [&](uint64_t tab, uint32_t type, std::wstring url, double bytes, int64_t now) {
+        if (!scheduled) { network.Send(tab, std::move(url), bytes, now); return; }
+        ScheduledRequest r{ nextId++, tab, type, std::move(url) };
+        switch (scheduler.Submit(r, now)) {
+        case REQUEST_SEND: network.Send(tab, std::move(r.url), bytes, now); break;
+        case REQUEST_HOLD: heldBytes[r.id] = bytes; break;
+        case REQUEST_COALESCED: break; // answered locally
+        }
+    };
+    auto loadForeground = [&](int64_t now) {
+        foregroundLeft = 1;
+        request(FOREGROUND_TAB, FT_DOCUMENT, L"https://front.example/", 50000, now);
+    };
+    auto subresources = [&](int64_t now) {
+        for (int i = 0; i < 8; i++) request(FOREGROUND_TAB, i < 3 ? FT_STYLESHEET : FT_SCRIPT, L"https://front.example/s" + std::to_wstring(i), 25000, now);
+        for (int i = 0; i < 16; i++) request(FOREGROUND_TAB, FT_IMAGE, L"https://front.example/i" + std::to_wstring(i), 35000, now);
+        foregroundLeft = 24;
+    };
+
+    for (int64_t now = 0;; now++) {
+        for (uint64_t tab = 1; tab <= backgroundTabs; tab++) {
+            for (size_t s = 0; s < 4; s++) {
+                const Source& source = SOURCES[s];
+                if (s == 3 && tab % 4) continue;
+                if ((now + phases[(tab - 1) * 4 + s]) % source.everyMs) continue;
+                std::wstring url = L"https://bg" + std::to_wstring(tab) + L".example/" + source.name;
+                if (!source.sameUrl) url += L"/" + std::to_wstring(counter++);
+                request(tab, source.type, std::move(url), source.bytes, now);
+            }
+        }
+        if (now == WARMUP_MS) loadForeground(now);
+        bool documentDone = false, loaded = false;
+        network.Step(now, [&](const Transfer& t) {
+            if (t.tab != FOREGROUND_TAB) {
+                if (now >= WARMUP_MS) result.backgroundBytes += t.bytes;
+                if (scheduled) scheduler.Finished(t.tab, t.url, now);
+                return;
+            }
+            if (t.url == L"https://front.example/") documentDone = true;
+            else if (--foregroundLeft == 0) loaded = true;
+        });
+        if (documentDone) subresources(now);
+        if (loaded) {
+            result.foregroundMs = now - WARMUP_MS;
+            break;
+        }
+        if (scheduled) {
+            if (now % TICK_MS == 0) scheduler.Tick(now);
+            released.clear();
+            scheduler.Drain(released);
+            for (ScheduledRequest& r : released) {
+                network.Send(r.tab, std::move(r.url), heldBytes[r.id], now);
+                heldBytes.erase(r.id);
+            }
+        }
+    }
+    result.stats = scheduler.GetStats();
+    return result;
+}
+
+// Args: background tabs, scheduled
+void BM_ForegroundLoad(bench::State& state) {
+    size_t backgroundTabs = (size_t)state.range(0);
+    bool scheduled = state.range(1) != 0;
+    uint32_t seed = 1;
+    int64_t loadMs = 0, worstMs = 0, maxWaitMs = 0;
+    double backgroundBytes = 0, holding = 0;
+    uint64_t loads = 0;
+    for (auto _ : state) {
+        Result r = SimulateLoad(backgroundTabs, scheduled, seed++);
+        loadMs += r.foregroundMs;
+        worstMs = (std::max)(worstMs, r.foregroundMs);
+        backgroundBytes += r.backgroundBytes;
+        maxWaitMs = (std::max)(maxWaitMs, r.stats.maxWaitMs);
+        holding += r.stats.holding;
+        loads++;
+        bench::DoNotOptimize(r);
+    }
+    state.SetItemsProcessed((int64_t)loads);
+    char label[160];
+    snprintf(label, sizeof(label), "load %.0f ms (worst %lld), background %.0f KB/s, %.0f held, waits up to %lld ms",
+        loads ? (double)loadMs / loads : 0.0, (long long)worstMs, loadMs ? backgroundBytes / loadMs : 0.0,
+        loads ? holding / loads : 0.0, (long long)maxWaitMs);
+    state.SetLabel(label);
+}
+BENCHMARK(BM_ForegroundLoad)->Args({ 0, 0 })->Args({ 4, 0 })->Args({ 4, 1 })->Args({ 16, 0 })->Args({ 16, 1 })->Args({ 32, 0 })->Args({ 32, 1 });
+}
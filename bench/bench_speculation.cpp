@@ -0,0 +1,159 @@
+// Speculative preloading of the address bar's predicted target, replayed against simulated
+// typing: each navigation types an address key by key into a real OmniboxIndex over a history
+// with a Zipf-shaped frecency, and picks the suggestion once it comes first or types on to the
+// end. Preloads are fakes whose pages take a stand-in server's load time, per site, on a
+// simulated clock. Reported: hit rate, load time already done when Enter was pressed, and
+// preloads wasted per navigation. Time per iteration is the engine's and the omnibox's work for
+// one navigation.
+
+#include "bench.h"
+
+#include "omnibox.h"
+#include "speculation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace {
+const int64_t KEY_MS = 150;    // between keystrokes
+const int64_t PICK_MS = 400;   // Down and Enter once the suggestion is first
+const size_t SITES = 2000;
+const size_t SESSION_NAVIGATIONS = 100; // one engine, and one budget, per browsing session
+
+// The stand-in server: a load time per site, 150 ms to about 2.5 s, most under a second
+int64_t LoadMs(uint32_t site) {
+    std::mt19937 rng(site * 2654435761u);
+    std::lognormal_distribution<double> load(std::log(600.0), 0.6);
+    return (std::min)((int64_t)2500, (std::max)((int64_t)150, (int64_t)load(rng)));
+}
+
+// Made-up host names, as varied in their first letters as real ones (corpus::SiteHost's all
+// begin "site", which no one's history does)
+std::wstring SiteHost(uint32_t site) {
+    static const wchar_t* syllables[] = { L"ka", L"lo", L"min", L"ter", L"sa", L"ven", L"ro", L"di", L"pla", L"nu",
+        L"gor", L"es", L"tri", L"mo", L"can", L"bel", L"fu", L"zen", L"ha", L"qui", L"bo", L"we", L"ix", L"jun" };
+    static const wchar_t* tlds[] = { L".com", L".org", L".net", L".co.uk", L".de", L".io" };
+    std::mt19937 rng(site + 1);
+    std::wstring host;
+    for (uint32_t k = 0, n = 2 + rng() % 2; k < n; k++) host += syllables[rng() % 24];
+    return L"www." + host + std::to_wstring(site % 10) + tlds[site % 6];
+}
+
+std::wstring SiteUrl(uint32_t site) { return L"https://" + SiteHost(site) + L"/"; }
+
+struct History {
+    OmniboxIndex index;
+    std::vector<double> cdf; // of visits over sites
+};
+
+// Every site's front page, with frecency falling off as Zipf's law, plus a few deeper pages on
+// the busiest ones to compete with them
+History& BuiltHistory() {
+    static History h = [] {
+        History built;
+        double sum = 0;
+        for (uint32_t i = 0; i < SITES; i++) {
+            double frecency = 10000 / std::pow(i + 1.0, 1.1);
+            built.index.Update(SiteUrl(i), L"Site " + std::to_wstring(i), frecency);
+            if (i < 200) {
+                for (int k = 0; k < 3; k++)
+                    built.index.Update(SiteUrl(i) + L"news/" + std::to_wstring(k), L"News " + std::to_wstring(k), frecency / (4 + k));
+            }
+            built.cdf.push_back(sum += frecency);
+        }
+        for (double& c : built.cdf) c /= sum;
+        return built;
+    }();
+    return h;
+}
+
+struct FakePreload : Preload {
+    std::wstring url;
+    int64_t doneAt = 0; // simulated
+};
+
+class FakePreloadBackend : public PreloadBackend {
+public:
+    int64_t now = 0;
+
+    std::unique_ptr<Preload> Start(const std::wstring& url) override {
+        auto p = std::make_unique<FakePreload>();
+        p->url = url;
+        p->doneAt = now + LoadMs(SiteOf(url));
+        return p;
+    }
+
+    static uint32_t SiteOf(const std::wstring& url) {
+        uint32_t h = 0;
+        for (wchar_t c : url) h = h * 31 + c;
+        return h;
+    }
+};
+
+// One navigation: a site drawn by frecency, or one in ten somewhere new
+struct Navigation {
+    uint32_t site;
+    bool known;
+};
+
+void BM_SpeculativePreload(bench::State& state) {
+    History& history = BuiltHistory();
+    SpeculationEngine::Config config;
+    config.threshold = state.range(0) / 100.0;
+    if (state.range(1) == 0) config.sessionWaste = UINT32_MAX; // unbudgeted, to compare
+    std::mt19937 rng(17);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    FakePreloadBackend backend;
+    std::unique_ptr<SpeculationEngine> engine;
+    SpeculationEngine::Stats total;
+    auto addStats = [&total, &engine] {
+        if (!engine) return;
+        SpeculationEngine::Stats s = engine->GetStats();
+        total.started += s.started;
+        total.hits += s.hits;
+        total.savedMs += s.savedMs;
+    };
+    int64_t loadMs = 0;
+    uint64_t navigations = 0, keystrokes = 0;
+    for (auto _ : state) {
+        if (navigations % SESSION_NAVIGATIONS == 0) {
+            addStats();
+            engine = std::make_unique<SpeculationEngine>(backend, config);
+        }
+        Navigation nav;
+        nav.known = uniform(rng) >= 0.1;
+        nav.site = nav.known ? (uint32_t)(std::lower_bound(history.cdf.begin(), history.cdf.end(), uniform(rng)) - history.cdf.begin())
+                             : (uint32_t)(SITES + rng() % 100000);
+        std::wstring address = SiteHost(nav.site).substr(4); // typed without "www."
+        std::wstring url = SiteUrl(nav.site);
+        std::wstring typed;
+        for (wchar_t c : address) {
+            typed += c;
+            backend.now += KEY_MS;
+            keystrokes++;
+            if (auto p = static_cast<const FakePreload*>(engine->Current()); p && p->doneAt <= backend.now) engine->Loaded(p, p->doneAt);
+            std::vector<OmniboxMatch> matches = history.index.Query(typed, 8);
+            engine->Input(typed, matches, backend.now);
+            if (nav.known && !matches.empty() && matches[0].url == url) {
+                backend.now += PICK_MS;
+                break;
+            }
+        }
+        if (auto p = static_cast<const FakePreload*>(engine->Current()); p && p->doneAt <= backend.now) engine->Loaded(p, p->doneAt);
+        bench::DoNotOptimize(engine->Take(url, backend.now));
+        loadMs += LoadMs(FakePreloadBackend::SiteOf(url));
+        navigations++;
+        backend.now += 60 * 1000; // reading the page
+    }
+    addStats();
+    state.SetItemsProcessed((int64_t)keystrokes);
+    char label[128];
+    snprintf(label, sizeof(label), "hits %.0f%%, %.0f of %.0f ms load saved/nav, %.2f wasted/nav",
+        navigations ? 100.0 * total.hits / navigations : 0.0, navigations ? (double)total.savedMs / navigations : 0.0,
+        navigations ? (double)loadMs / navigations : 0.0, navigations ? (double)(total.started - total.hits) / navigations : 0.0);
+    state.SetLabel(label);
+}
+// {threshold %, budgeted}
+BENCHMARK(BM_SpeculativePreload)->Args({ 40, 1 })->Args({ 60, 1 })->Args({ 80, 1 })->Args({ 60, 0 });
+}
@@ -0,0 +1,108 @@
+// Startup to first navigation, with every phase simulated by its latency: the order WinMain
+// used to run them in versus the startup graph. Real time is what counts; the phases sleep.
+
+#include "bench.h"
+
+#include "startup.h"
+
+#include <chrono>
+#include <thread>
+
+namespace {
+// A cold boot of a thin client, scaled down tenfold. The WebView2 environment and controller are
+// created out of process and complete through a callback; the rest is disk and window creation.
+struct Phases {
+    int environment = 12000; // us
+    int controller = 4000;
+    int window = 3000;       // fonts, window class, window and controls
+    int history = 6000;      // history.db mapped and the journal replayed
+    int filters = 3000;      // filter snapshot mapped and checked
+    int session = 1000;      // session.dat read and decoded
+    int tabs = 1000;         // tab pool, lifecycle policy, request service
+    int publish = 500;       // history handed to the UI thread
+    int restore = 500;       // placeholder tabs for the session
+};
+
+void Spend(int us) { std::this_thread::sleep_for(std::chrono::microseconds(us)); }
+
+// Completes `done` from another thread after `us`, as a WebView2 completion handler would
+class Callbacks {
+public:
+    ~Callbacks() { for (std::thread& t : threads) t.join(); }
+    void After(int us, StartupGraph::Done done) {
+        threads.emplace_back([us, done = std::move(done)] { Spend(us); done(); });
+    }
+
+private:
+    std::vector<std::thread> threads;
+};
+
+void BM_StartupSerial(bench::State& state) {
+    Phases p;
+    for (auto _ : state) {
+        Spend(p.window);
+        Spend(p.history);
+        Spend(p.filters);
+        Spend(p.tabs);
+        Spend(p.session);
+        Spend(p.restore);
+        Spend(p.environment); // requested by the tab pool, only now
+        Spend(p.controller);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_StartupSerial);
+
+// The browser's graph: the environment is requested first, loading runs on two workers
+void BM_StartupGraph(bench::State& state) {
+    Phases p;
+    int64_t navigationUs = 0;
+    for (auto _ : state) {
+        StartupTrace trace;
+        Callbacks callbacks;
+        StartupGraph graph(trace, 2, nullptr);
+        using T = StartupThread;
+        auto environment = graph.AddAsync("environment", T::Main, {}, [&](StartupGraph::Done done) { callbacks.After(p.environment, done); });
+        auto window = graph.Add("window", T::Main, {}, [&] { Spend(p.window); });
+        auto history = graph.Add("history.load", T::Worker, {}, [&] { Spend(p.history); });
+        auto filters = graph.Add("filters.load", T::Worker, {}, [&] { Spend(p.filters); });
+        auto session = graph.Add("session.load", T::Worker, {}, [&] { Spend(p.session); });
+        auto tabs = graph.Add("tabs", T::Main, { window }, [&] { Spend(p.tabs); });
+        graph.Add("history.publish", T::Main, { window, history }, [&] { Spend(p.publish); });
+        graph.Add("filters.publish", T::Main, { tabs, filters }, [] {});
+        auto restore = graph.Add("session.restore", T::Main, { tabs, session }, [&] { Spend(p.restore); });
+        graph.AddAsync("first navigation", T::Main, { environment, restore }, [&](StartupGraph::Done done) { callbacks.After(p.controller, done); });
+        graph.Start();
+        graph.Wait();
+        for (const StartupTrace::Event& e : trace.Events()) {
+            if (e.name == "first navigation") navigationUs = e.beginUs;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    char label[48];
+    snprintf(label, sizeof(label), "first navigation starts at %.1f ms", navigationUs / 1e3);
+    state.SetLabel(label);
+}
+BENCHMARK(BM_StartupGraph);
+
+// The executor's own cost: the same shape of graph with empty tasks
+void BM_StartupGraphOverhead(bench::State& state) {
+    for (auto _ : state) {
+        StartupTrace trace;
+        StartupGraph graph(trace, 2, nullptr);
+        using T = StartupThread;
+        auto window = graph.Add("window", T::Main, {}, [] {});
+        auto history = graph.Add("history.load", T::Worker, {}, [] {});
+        auto filters = graph.Add("filters.load", T::Worker, {}, [] {});
+        auto session = graph.Add("session.load", T::Worker, {}, [] {});
+        auto tabs = graph.Add("tabs", T::Main, { window }, [] {});
+        graph.Add("history.publish", T::Main, { window, history }, [] {});
+        graph.Add("filters.publish", T::Main, { tabs, filters }, [] {});
+        graph.Add("session.restore", T::Main, { tabs, session }, [] {});
+        graph.Start();
+        graph.Wait();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_StartupGraphOverhead);
+}
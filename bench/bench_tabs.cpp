@@ -0,0 +1,168 @@
+// Tab bookkeeping: the registry, the strip's layout, and the session written on every change
+
+#include "bench.h"
+#include "corpus.h"
+
+#include "session.h"
+#include "tabregistry.h"
+#include "tabstrip.h"
+
+#include <memory>
+
+namespace {
+struct FakeTab {
+    std::wstring url;
+    std::wstring title;
+};
+
+// A WebView2 view as the browser holds one: its event handlers reach their tab through the
+// handle the tab filled in when it claimed the view
+struct FakeView {
+    std::shared_ptr<TabHandle> owner = std::make_shared<TabHandle>();
+};
+
+// Open a tab next to the active one and close another, at a steady number of open tabs. Between
+// the two, the open tabs' views fire what a page load sends: source and title changes, each
+// resolving its view's tab, plus one late event from the closed tab's view, which resolves to
+// nothing. The strip then finds the active tab's position.
+void BM_TabRegistryChurn(bench::State& state) {
+    TabRegistry<FakeTab> tabs;
+    std::vector<FakeView> views((size_t)state.range(0));
+    for (FakeView& view : views) *view.owner = tabs.Open({ L"https://example.com/", L"Example" });
+    std::vector<std::wstring> titles;
+    for (int i = 0; i < 64; i++) titles.push_back(L"Story " + std::to_wstring(i) + L" - Site News");
+    std::mt19937 rng(5);
+    for (auto _ : state) {
+        size_t victim = rng() % views.size();
+        std::shared_ptr<TabHandle> closed = views[victim].owner;
+        tabs.Close(*closed);
+        views[victim] = FakeView();
+        *views[victim].owner = tabs.Open({ L"https://example.com/", L"" }, rng() % tabs.Size());
+        for (int e = 0; e < 8; e++) {
+            const FakeView& view = views[rng() % views.size()];
+            if (FakeTab* tab = tabs.Get(*view.owner)) {
+                if (e & 1) tab->title = titles[rng() & 63];
+                else tab->url = L"https://example.com/";
+            }
+        }
+        bench::DoNotOptimize(tabs.Get(*closed));
+        bench::DoNotOptimize(tabs.PositionOf(*views[rng() % views.size()].owner));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TabRegistryChurn)->Arg(10)->Arg(500);
+
+// Mouse moves along the strip, halfway down it
+const int STRIP_Y = 66 + 34 / 2;
+
+void BM_TabStripHitTest(bench::State& state) {
+    TabStripLayout strip;
+    strip.SetWidth(1280);
+    strip.SetCount((size_t)state.range(0));
+    strip.EnsureVisible((size_t)state.range(0) / 2);
+    int x = 0;
+    for (auto _ : state) {
+        size_t position;
+        bench::DoNotOptimize(strip.HitTest(x, STRIP_Y, position));
+        x = (x + 37) % 1280;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TabStripHitTest)->Arg(10)->Arg(1000);
+
+// The baselines: the strip as it was before TabStripLayout, every tab's rectangles stored by
+// the paint and the mouse tested against each in turn
+struct LegacyTabRects {
+    StripRect tab, close;
+};
+
+void LegacyLayout(std::vector<LegacyTabRects>& tabs) {
+    int tx = 10;
+    for (LegacyTabRects& t : tabs) {
+        t.tab = { tx, 66, tx + 200, 100 };
+        t.close = { t.tab.right - 28, 71, t.tab.right - 4, 95 };
+        tx += 200 + 4;
+    }
+}
+
+bool Inside(const StripRect& r, int x, int y) {
+    return x >= r.left && x < r.right && y >= r.top && y < r.bottom;
+}
+
+void BM_TabStripHitTestLegacy(bench::State& state) {
+    std::vector<LegacyTabRects> tabs((size_t)state.range(0));
+    LegacyLayout(tabs);
+    int x = 0;
+    for (auto _ : state) {
+        int hit = -1;
+        for (size_t i = 0; i < tabs.size() && hit < 0; i++) {
+            if (Inside(tabs[i].close, x, STRIP_Y) || Inside(tabs[i].tab, x, STRIP_Y)) hit = (int)i;
+        }
+        bench::DoNotOptimize(hit);
+        x = (x + 37) % 1280;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TabStripHitTestLegacy)->Arg(10)->Arg(1000);
+
+// The geometry of one paint after a resize: the strip laid out again, then the rectangles of
+// every tab it draws and of the new-tab button
+void BM_TabStripLayout(bench::State& state) {
+    TabStripLayout strip;
+    strip.SetCount((size_t)state.range(0));
+    int width = 1280;
+    for (auto _ : state) {
+        width = width == 1280 ? 1279 : 1280;
+        strip.SetWidth(width);
+        size_t first, end;
+        strip.VisibleRange(first, end);
+        for (size_t i = first; i < end; i++) {
+            bench::DoNotOptimize(strip.TabRect(i));
+            bench::DoNotOptimize(strip.CloseRect(i));
+        }
+        bench::DoNotOptimize(strip.ButtonRect());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TabStripLayout)->Arg(10)->Arg(1000);
+
+void BM_TabStripLayoutLegacy(bench::State& state) {
+    std::vector<LegacyTabRects> tabs((size_t)state.range(0));
+    for (auto _ : state) {
+        LegacyLayout(tabs);
+        bench::DoNotOptimize(tabs.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TabStripLayoutLegacy)->Arg(10)->Arg(1000);
+
+Session MakeSession(size_t tabs) {
+    Session session;
+    std::vector<std::wstring> urls = corpus::PageUrls(tabs, 17);
+    for (size_t i = 0; i < tabs; i++) session.tabs.push_back({ urls[i], L"Story " + std::to_wstring(i) + L" - Site News" });
+    session.active = tabs / 2;
+    return session;
+}
+
+void BM_SessionEncode(bench::State& state) {
+    Session session = MakeSession((size_t)state.range(0));
+    int64_t bytes = 0;
+    for (auto _ : state) {
+        std::string encoded = EncodeSession(session);
+        bytes += (int64_t)encoded.size();
+        bench::DoNotOptimize(encoded);
+    }
+    state.SetBytesProcessed(bytes);
+}
+BENCHMARK(BM_SessionEncode)->Arg(10)->Arg(500);
+
+void BM_SessionDecode(bench::State& state) {
+    std::string encoded = EncodeSession(MakeSession((size_t)state.range(0)));
+    for (auto _ : state) {
+        Session session;
+        bench::DoNotOptimize(DecodeSession((const uint8_t*)encoded.data(), encoded.size(), session));
+    }
+    state.SetBytesProcessed(state.iterations() * (int64_t)encoded.size());
+}
+BENCHMARK(BM_SessionDecode)->Arg(10)->Arg(500);
+}
@@ -0,0 +1,195 @@
+// Full-text page index: tokenizing, ingest through the background indexer to searchable
+// segments, and ranked queries. Pages are synthetic prose over a Zipf-distributed vocabulary,
+// unless SARF_TEXT_CORPUS names a folder of .txt files to index instead, one page each.
+
+#include "bench.h"
+#include "corpus.h"
+
+#include "textindex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+
+namespace {
+std::filesystem::path BenchDir() {
+    static const std::filesystem::path dir = [] {
+        std::filesystem::path d = std::filesystem::temp_directory_path() / "sarf_bench";
+        std::filesystem::create_directories(d);
+        return d;
+    }();
+    return dir;
+}
+
+// Pronounceable made-up words, the common ones short, as in real text
+const std::vector<std::wstring>& Vocabulary() {
+    static const std::vector<std::wstring> words = [] {
+        static const wchar_t* syllables[] = { L"ka", L"lo", L"min", L"ter", L"sa", L"ven", L"ro", L"di", L"pla", L"nu",
+            L"gor", L"es", L"tri", L"mo", L"can", L"bel", L"fu", L"zen", L"ha", L"qui" };
+        std::vector<std::wstring> out;
+        std::mt19937 rng(3);
+        for (size_t i = 0; i < 50000; i++) {
+            std::wstring w;
+            size_t n = 1 + (i > 100) + (i > 3000) + rng() % 2;
+            for (size_t k = 0; k < n; k++) w += syllables[rng() % 20];
+            out.push_back(w + (i > 20000 ? std::to_wstring(i % 97) : L""));
+        }
+        return out;
+    }();
+    return words;
+}
+
+struct TextPage {
+    std::wstring url, title, text;
+};
+
+// `n` pages of about `words` words; the Zipf exponent is English's, near 1
+std::vector<TextPage> Pages(size_t n, size_t words, uint32_t seed) {
+    std::vector<TextPage> pages;
+    if (const char* folder = getenv("SARF_TEXT_CORPUS")) {
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(folder, ec)) {
+            if (pages.size() == n) break;
+            if (entry.path().extension() != ".txt") continue;
+            std::ifstream in(entry.path(), std::ios::binary);
+            std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+            TextPage p;
+            p.url = L"file:///" + entry.path().generic_wstring();
+            p.title = entry.path().stem().wstring();
+            p.text.assign(bytes.begin(), bytes.end()); // as Latin-1; enough for timing
+            pages.push_back(std::move(p));
+        }
+        if (!pages.empty()) return pages;
+    }
+    const std::vector<std::wstring>& vocabulary = Vocabulary();
+    static const std::vector<double> cdf = [&vocabulary] {
+        std::vector<double> c(vocabulary.size());
+        double sum = 0;
+        for (size_t i = 0; i < c.size(); i++) c[i] = sum += 1.0 / std::pow((double)(i + 1), 1.07);
+        for (double& v : c) v /= sum;
+        return c;
+    }();
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    auto word = [&] { return vocabulary[std::lower_bound(cdf.begin(), cdf.end(), uniform(rng)) - cdf.begin()]; };
+    std::vector<std::wstring> urls = corpus::PageUrls(n, seed);
+    pages.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+        TextPage p;
+        p.url = std::move(urls[i]);
+        for (int k = 0; k < 5; k++) p.title += (k ? L" " : L"") + word();
+        size_t length = words / 2 + rng() % words;
+        p.text.reserve(length * 8);
+        for (size_t k = 0; k < length; k++) {
+            p.text += word();
+            p.text += k % 12 == 11 ? L". " : L" ";
+        }
+        pages.push_back(std::move(p));
+    }
+    return pages;
+}
+
+TextIndex::Config BenchConfig(size_t pages) {
+    TextIndex::Config config;
+    config.queuedPages = pages; // the benchmark adds faster than pages arrive; drop none
+    return config;
+}
+
+void BM_TextTokenize(bench::State& state) {
+    std::vector<TextPage> pages = Pages(256, 400, 5);
+    std::vector<std::string> words;
+    size_t chars = 0, i = 0;
+    for (auto _ : state) {
+        words.clear();
+        TokenizeText(pages[i++ & 255].text, words);
+        bench::DoNotOptimize(words.data());
+    }
+    for (const TextPage& p : pages) chars += p.text.size();
+    state.SetBytesProcessed((int64_t)(state.iterations() * chars / pages.size() * sizeof(wchar_t)));
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TextTokenize);
+
+// Pages added and flushed to searchable segments, merges included
+void BM_TextIndexIngest(bench::State& state) {
+    size_t n = (size_t)state.range(0);
+    std::vector<TextPage> pages = Pages(n, 400, 9);
+    std::filesystem::path dir = BenchDir() / "textindex-ingest";
+    TextIndex::Stats stats;
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::filesystem::remove_all(dir);
+        state.ResumeTiming();
+        TextIndex index(dir, BenchConfig(n));
+        for (const TextPage& p : pages) index.Add(p.url, p.title, p.text);
+        index.Flush();
+        stats = index.GetStats();
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+    char label[64];
+    snprintf(label, sizeof(label), "%zu segments, %.0f bytes/page", stats.segments, (double)stats.diskBytes / n);
+    state.SetLabel(label);
+}
+BENCHMARK(BM_TextIndexIngest)->Arg(5000)->Arg(20000);
+
+// An index of `pages` pages, built once per size and reopened from disk as at startup
+TextIndex& Built(size_t pages) {
+    static std::map<size_t, std::unique_ptr<TextIndex>> built;
+    std::unique_ptr<TextIndex>& index = built[pages];
+    if (!index) {
+        std::filesystem::path dir = BenchDir() / ("textindex-" + std::to_string(pages));
+        if (!std::filesystem::exists(dir / "complete")) {
+            std::filesystem::remove_all(dir);
+            size_t chunk = 20000;
+            TextIndex writer(dir, BenchConfig(chunk));
+            for (size_t first = 0; first < pages; first += chunk) {
+                for (TextPage& p : Pages((std::min)(chunk, pages - first), 300, (uint32_t)(first / chunk + 1))) writer.Add(p.url, p.title, p.text);
+                writer.Flush();
+            }
+            std::ofstream(dir / "complete") << pages;
+        }
+        index = std::make_unique<TextIndex>(dir, TextIndex::Config());
+        index->Flush(); // returns once the segments are open
+    }
+    return *index;
+}
+
+// Typed into the address bar: common and rare words, two words, and a word being typed
+std::vector<std::wstring> Queries(size_t n) {
+    const std::vector<std::wstring>& vocabulary = Vocabulary();
+    std::mt19937 rng(21);
+    std::vector<std::wstring> out;
+    for (size_t i = 0; i < n; i++) {
+        const std::wstring& common = vocabulary[rng() % 200];
+        const std::wstring& rare = vocabulary[200 + rng() % 20000];
+        switch (i % 4) {
+        case 0: out.push_back(rare + L" "); break;
+        case 1: out.push_back(common + L" " + rare + L" "); break;
+        case 2: out.push_back(rare + L" " + vocabulary[rng() % 2000].substr(0, 3)); break;
+        default: out.push_back(common + L" " + vocabulary[rng() % 200] + L" "); break;
+        }
+    }
+    return out;
+}
+
+void BM_TextIndexQuery(bench::State& state) {
+    TextIndex& index = Built((size_t)state.range(0));
+    std::vector<std::wstring> queries = Queries(1024);
+    size_t i = 0, hits = 0;
+    for (auto _ : state) {
+        std::vector<TextSearchResult> results = index.Search(queries[i++ & 1023], 8);
+        hits += results.size();
+        bench::DoNotOptimize(results.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+    TextIndex::Stats stats = index.GetStats();
+    char label[96];
+    snprintf(label, sizeof(label), "%zu segments, %.0f MB, %.1f results/query", stats.segments, stats.diskBytes / 1e6, (double)hits / state.iterations());
+    state.SetLabel(label);
+}
+BENCHMARK(BM_TextIndexQuery)->Arg(20000)->Arg(200000);
+}
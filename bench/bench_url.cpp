@@ -0,0 +1,183 @@
+// URL parsing and request matching: everything the request handler runs per subresource
+
+#include "bench.h"
+#include "corpus.h"
+
+#include "filterlist.h"
+#include "psl.h"
+#include "requestclassifier.h"
+#include "url.h"
+
+#include <algorithm>
+#include <cwctype>
+#include <filesystem>
+
+namespace {
+const std::vector<std::wstring>& Pages() {
+    static const std::vector<std::wstring> urls = corpus::PageUrls(4096);
+    return urls;
+}
+
+const std::vector<corpus::Request>& Requests() {
+    static const std::vector<corpus::Request> requests = corpus::Requests(16384);
+    return requests;
+}
+
+const FilterSet& Filters() {
+    static const FilterSet filters = [] {
+        FilterListBuilder builder;
+        builder.AddList(corpus::FilterList(40000));
+        return builder.Build();
+    }();
+    return filters;
+}
+
+void BM_ParseUrl(bench::State& state) {
+    const auto& urls = Pages();
+    size_t i = 0;
+    for (auto _ : state) {
+        Url parsed;
+        bench::DoNotOptimize(ParseUrl(urls[i++ & 4095], parsed));
+        bench::DoNotOptimize(parsed);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ParseUrl);
+
+void BM_CanonicalizeUrl(bench::State& state) {
+    const auto& urls = Pages();
+    wchar_t out[1024];
+    size_t i = 0;
+    for (auto _ : state) {
+        Url parsed;
+        ParseUrl(urls[i++ & 4095], parsed);
+        bench::DoNotOptimize(CanonicalizeUrl(parsed, out, 1024));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CanonicalizeUrl);
+
+void BM_RegistrableDomain(bench::State& state) {
+    std::vector<std::wstring> hosts;
+    for (const auto& r : Requests()) hosts.emplace_back(UrlHost(r.url));
+    size_t i = 0;
+    for (auto _ : state) bench::DoNotOptimize(RegistrableDomain(hosts[i++ & 16383]));
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RegistrableDomain);
+
+// The built-in keyword list, used until a filter list is loaded
+void BM_IsAdUrl(bench::State& state) {
+    const auto& requests = Requests();
+    size_t i = 0;
+    for (auto _ : state) bench::DoNotOptimize(IsAdUrl(requests[i++ & 16383].url));
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_IsAdUrl);
+
+// BM_IsAdUrl's baseline: the keyword check as it first shipped, a lowercased copy of the whole
+// URL searched once per keyword
+bool IsAdUrlLegacy(std::wstring url) {
+    std::transform(url.begin(), url.end(), url.begin(), ::towlower);
+    const wchar_t* adKeywords[] = {
+        L"doubleclick.net", L"googlesyndication.com", L"googleadservices.com", L"adnxs.com",
+        L"criteo.com", L"pubmatic.com", L"rubiconproject.com", L"adsystem", L"/ads/", L"pagead2",
+        L"amazon-adsystem", L"ads.twitter.com", L"facebook.com/tr/", L"moatads.com"
+    };
+    for (const auto& keyword : adKeywords) {
+        if (url.find(keyword) != std::wstring::npos) return true;
+    }
+    return false;
+}
+
+void BM_IsAdUrlLegacy(bench::State& state) {
+    const auto& requests = Requests();
+    size_t i = 0;
+    for (auto _ : state) bench::DoNotOptimize(IsAdUrlLegacy(requests[i++ & 16383].url));
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_IsAdUrlLegacy);
+
+void BM_FilterListCompile(bench::State& state) {
+    std::string list = corpus::FilterList((uint32_t)state.range(0));
+    for (auto _ : state) {
+        FilterListBuilder builder;
+        builder.AddList(list);
+        FilterSet filters = builder.Build();
+        bench::DoNotOptimize(filters.RuleCount());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetBytesProcessed(state.iterations() * (int64_t)list.size());
+}
+BENCHMARK(BM_FilterListCompile)->Arg(1000)->Arg(40000);
+
+// Startup with a snapshot from an earlier run: map it and check it instead of compiling the lists
+void BM_FilterSnapshotLoad(bench::State& state) {
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "sarf_bench";
+    std::filesystem::create_directories(path);
+    path /= "filters-" + std::to_string(state.range(0)) + ".bin";
+    {
+        FilterListBuilder builder;
+        builder.AddList(corpus::FilterList((uint32_t)state.range(0)));
+        builder.Build().SaveSnapshot(path, 1);
+    }
+    for (auto _ : state) {
+        FilterSet filters;
+        uint64_t stamp = 0;
+        bench::DoNotOptimize(filters.LoadSnapshot(path, stamp));
+        bench::DoNotOptimize(filters.RuleCount());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetBytesProcessed(state.iterations() * (int64_t)std::filesystem::file_size(path));
+}
+BENCHMARK(BM_FilterSnapshotLoad)->Arg(1000)->Arg(40000);
+
+// The filter engine alone, no cache
+void BM_FilterClassify(bench::State& state) {
+    const FilterSet& filters = Filters();
+    const auto& requests = Requests();
+    size_t i = 0;
+    for (auto _ : state) {
+        const corpus::Request& r = requests[i++ & 16383];
+        FilterRequest req;
+        req.url = r.url;
+        req.host = UrlHost(r.url);
+        req.sourceHost = UrlHost(r.source);
+        req.type = r.type;
+        req.thirdParty = IsThirdPartyHost(req.host, req.sourceHost);
+        bench::DoNotOptimize(filters.Classify(req));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FilterClassify);
+
+// As the browser decides, over a replay of page loads: the published ruleset with the decision
+// cache in front (arg 1), or the same ruleset asked every time (arg 0)
+void BM_RequestClassifier(bench::State& state) {
+    bool cached = state.range(0) != 0;
+    RequestClassifier classifier(corpus::Rules());
+    RulesetStore::Reader ruleset(corpus::Rules());
+    static const std::vector<corpus::Request> requests = corpus::PageLoads(200000);
+    size_t i = 0;
+    for (auto _ : state) {
+        const corpus::Request& r = requests[i++ % requests.size()];
+        if (cached) {
+            bench::DoNotOptimize(classifier.ShouldBlock(r.url, r.source, r.type));
+            continue;
+        }
+        FilterRequest req;
+        req.url = r.url;
+        req.host = UrlHost(r.url);
+        req.sourceHost = UrlHost(r.source);
+        req.type = r.type;
+        req.thirdParty = IsThirdPartyHost(req.host, req.sourceHost);
+        bench::DoNotOptimize(ruleset->filters.Classify(req));
+    }
+    state.SetItemsProcessed(state.iterations());
+    char label[32];
+    if (cached) snprintf(label, sizeof(label), "cache hits %.0f%%", 100 * classifier.CacheStats().HitRate());
+    else snprintf(label, sizeof(label), "no cache");
+    state.SetLabel(label);
+}
+BENCHMARK(BM_RequestClassifier)->Arg(0)->Arg(1);
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "filterlist.h"
+#include "ruleset.h"
+
+// Deterministic synthetic inputs shared by the benchmarks, shaped like real browsing: a few
+// hundred sites, each page pulling subresources from its own host, CDNs and ad networks.
+namespace corpus {
+
+inline std::wstring Widen(const std::string& s) { return std::wstring(s.begin(), s.end()); }
+
+inline std::wstring SiteHost(uint32_t i) {
+    static const wchar_t* tlds[] = { L".com", L".org", L".net", L".co.uk", L".de", L".io" };
+    return L"www.site" + std::to_wstring(i) + tlds[i % 6];
+}
+
+inline std::wstring AdHost(uint32_t i) {
+    return (i % 3 ? L"ads" : L"pixel") + std::to_wstring(i) + L".adnetwork" + std::to_wstring(i % 40) + L".com";
+}
+
+// An EasyList-like list: host anchors, a share with type and party options, generic path
+// patterns, and exceptions, half of them for one site each
+inline std::string FilterList(uint32_t rules) {
+    std::string out = "[Adblock Plus 2.0]\n! synthetic\n";
+    for (uint32_t i = 0; i < rules; i++) {
+        std::string n = std::to_string(i);
+        switch (i % 8) {
+        case 0: case 1: case 2: out += "||ads" + n + ".adnetwork" + std::to_string(i % 40) + ".com^\n"; break;
+        case 3: out += "||pixel" + n + ".adnetwork" + std::to_string(i % 40) + ".com^$third-party\n"; break;
+        case 4: out += "||tracker" + n + ".example^$script,image\n"; break;
+        case 5: out += "/banner" + n + "/*\n"; break;
+        case 6: out += "||cdn" + std::to_string(i % 50) + ".net/ads/slot" + n + "^$domain=site" + std::to_string(i % 300) + ".com\n"; break;
+        default:
+            if (i % 16 == 7) out += "@@||ads" + std::to_string(i - 7) + ".adnetwork" + std::to_string((i - 7) % 40) + ".com/allowed/*\n";
+            else out += "@@/banner" + std::to_string(i - 2) + "/*$domain=site" + std::to_string(i * 7 % 3000) + ".com\n"; // a site fix
+            break;
+        }
+    }
+    return out;
+}
+
+// FilterList(40000) compiled and published, as the browser has it once its lists are loaded
+inline const RulesetStore& Rules() {
+    static RulesetStore store;
+    static bool published = [] {
+        auto ruleset = std::make_unique<Ruleset>();
+        FilterListBuilder builder;
+        builder.AddList(FilterList(40000));
+        ruleset->filters = builder.Build();
+        store.Publish(std::move(ruleset));
+        return true;
+    }();
+    (void)published;
+    return store;
+}
+
+struct Request {
+    std::wstring url;
+    std::wstring source;
+    uint32_t type;
+};
+
+// Subresource requests: mostly first-party and CDN, about one in eight to an ad host
+inline std::vector<Request> Requests(size_t n, uint32_t seed = 1) {
+    std::mt19937 rng(seed);
+    std::vector<Request> out;
+    out.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+        uint32_t site = rng() % 300;
+        Request r;
+        r.source = L"https://" + SiteHost(site) + L"/article/" + std::to_wstring(rng() % 1000);
+        r.type = 1u << (rng() % 12);
+        uint32_t pick = rng() % 8;
+        if (pick == 0) r.url = L"https://" + AdHost(rng() % 4000) + L"/serve?slot=" + std::to_wstring(rng() % 100);
+        else if (pick <= 3) r.url = L"https://cdn" + std::to_wstring(rng() % 50) + L".net/assets/" + std::to_wstring(rng() % 5000) + L".js";
+        else r.url = L"https://" + SiteHost(site) + L"/static/img/" + std::to_wstring(rng()) + L".png?v=" + std::to_wstring(rng() % 10);
+        out.push_back(std::move(r));
+    }
+    return out;
+}
+
+// Subresource requests in page-load order, as a capture of a browsing session would have them:
+// page views of a few hundred sites, popular ones far more often, each pulling ~70 requests
+// from its own host, its CDN, the third parties it embeds and its ad slots. A site embeds the
+// same hosts on every page, so host-level verdicts repeat as they do in real browsing.
+inline std::vector<Request> PageLoads(size_t n, uint32_t seed = 1) {
+    static const uint32_t TYPES[] = { FT_SCRIPT, FT_SCRIPT, FT_SCRIPT, FT_IMAGE, FT_IMAGE, FT_IMAGE, FT_IMAGE,
+        FT_STYLESHEET, FT_XHR, FT_XHR, FT_FONT, FT_PING };
+    std::mt19937 rng(seed);
+    std::vector<Request> out;
+    out.reserve(n + 128);
+    while (out.size() < n) {
+        uint32_t site = (uint32_t)(300 * std::pow((double)(rng() % 10000) / 10000, 3)); // skewed to the first sites
+        std::wstring page = L"https://" + SiteHost(site) + L"/article/" + std::to_wstring(rng() % 1000);
+        out.push_back({ page, page, FT_DOCUMENT });
+        std::mt19937 embeds(site); // what this site embeds, the same on every page
+        uint32_t cdn = embeds() % 50, thirdParties[6], adHosts[4];
+        for (uint32_t& t : thirdParties) t = embeds() % 40 * 8 + 4; // FilterList lists these trackers
+        for (uint32_t& a : adHosts) a = embeds() % 500 * 8;          // and two in three of these ad hosts
+        for (uint32_t i = 0, count = 40 + rng() % 60; i < count; i++) {
+            Request r;
+            r.source = page;
+            r.type = TYPES[rng() % 12];
+            uint32_t pick = rng() % 16;
+            if (pick < 6) r.url = L"https://" + SiteHost(site) + L"/static/" + std::to_wstring(rng() % 200) + (r.type == FT_IMAGE ? L".png" : L".js");
+            else if (pick < 10) r.url = L"https://cdn" + std::to_wstring(cdn) + L".net/assets/" + std::to_wstring(rng() % 5000) + L".js";
+            else if (pick < 14) r.url = L"https://tracker" + std::to_wstring(thirdParties[rng() % 6]) + L".example/collect?v=" + std::to_wstring(rng() % 100);
+            else r.url = L"https://" + AdHost(adHosts[rng() % 4]) + L"/serve?slot=" + std::to_wstring(rng() % 100);
+            out.push_back(std::move(r));
+        }
+    }
+    return out;
+}
+
+// Page URLs as they reach history: long paths, tracking parameters, fragments
+inline std::vector<std::wstring> PageUrls(size_t n, uint32_t seed = 1) {
+    std::mt19937 rng(seed);
+    std::vector<std::wstring> out;
+    out.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+        out.push_back(L"https://" + SiteHost(rng() % 5000) + L"/news/" + std::to_wstring(rng() % 2020) + L"/story-" + std::to_wstring(rng()) +
+            L"/index.html?utm_source=newsletter&utm_medium=email&id=" + std::to_wstring(rng() % 100000) + L"#comments");
+    }
+    return out;
+}
+
+// What gets typed into the address bar: host names, partial URLs, and searches
+inline std::vector<std::wstring> TypedInputs(size_t n, uint32_t seed = 1) {
+    static const wchar_t* words[] = { L"weather", L"news", L"c++ string_view", L"github", L"how to", L"rust vs go", L"recipes", L"cmake" };
+    std::mt19937 rng(seed);
+    std::vector<std::wstring> out;
+    out.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+        switch (rng() % 6) {
+        case 0: out.push_back(L"site" + std::to_wstring(rng() % 5000) + L".com"); break;
+        case 1: out.push_back(L"https://" + SiteHost(rng() % 5000) + L"/news/"); break;
+        case 2: out.push_back(L"localhost:" + std::to_wstring(3000 + rng() % 6000)); break;
+        case 3: out.push_back(L"192.168.0." + std::to_wstring(rng() % 255)); break;
+        case 4: out.push_back(std::wstring(words[rng() % 8]) + L" " + std::to_wstring(rng() % 100)); break;
+        default: out.push_back(L"node.js"); break;
+        }
+    }
+    return out;
+}
+
+}
@@ -0,0 +1,69 @@
+#include "admatcher.h"
+
+#include <queue>
+
+static wchar_t FoldAscii(wchar_t c) {
+    return (c >= L'A' && c <= L'Z') ? (wchar_t)(c - L'A' + L'a') : c;
+}
+
+AdMatcher::AdMatcher(std::initializer_list<const wchar_t*> keywords) {
+    // Assign one class per distinct (lowercased) character used by any keyword.
+    for (const wchar_t* kw : keywords) {
+        for (const wchar_t* p = kw; *p; p++) {
+            wchar_t c = FoldAscii(*p);
+            if (c < 128 && charClass[c] == 0) charClass[c] = (uint8_t)classCount++;
+        }
+    }
+    for (wchar_t c = L'A'; c <= L'Z'; c++) charClass[c] = charClass[c - L'A' + L'a'];
+
+    // Trie: 0 in a transition slot means "no edge yet" (the root is never a target).
+    next.assign(classCount, 0);
+    accepts.assign(1, 0);
+    for (const wchar_t* kw : keywords) {
+        uint32_t state = 0;
+        for (const wchar_t* p = kw; *p; p++) {
+            uint32_t cls = charClass[FoldAscii(*p)];
+            uint16_t& slot = next[state * classCount + cls];
+            if (slot == 0) {
+                slot = (uint16_t)accepts.size();
+                accepts.push_back(0);
+                next.resize(next.size() + classCount, 0);
+            }
+            state = next[state * classCount + cls];
+        }
+        accepts[state] = 1;
+    }
+
+    // Breadth-first: fill missing edges from the failure state so the trie becomes a full DFA.
+    std::vector<uint16_t> fail(accepts.size(), 0);
+    std::queue<uint16_t> pending;
+    for (uint32_t cls = 1; cls < classCount; cls++) {
+        if (uint16_t child = next[cls]) pending.push(child);
+    }
+    while (!pending.empty()) {
+        uint16_t state = pending.front();
+        pending.pop();
+        accepts[state] |= accepts[fail[state]];
+        for (uint32_t cls = 1; cls < classCount; cls++) {
+            uint16_t& slot = next[state * classCount + cls];
+            uint16_t viaFail = next[fail[state] * classCount + cls];
+            if (slot) {
+                fail[slot] = viaFail;
+                pending.push(slot);
+            }
+            else slot = viaFail;
+        }
+    }
+}
+
+bool AdMatcher::Matches(std::wstring_view text) const {
+    const uint16_t* table = next.data();
+    const uint8_t* acc = accepts.data();
+    uint32_t state = 0;
+    for (wchar_t c : text) {
+        uint32_t cls = ((uint32_t)c < 128) ? charClass[c] : 0;
+        state = table[state * classCount + cls];
+        if (acc[state]) return true;
+    }
+    return false;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+#include <string_view>
+#include <vector>
+
+// Case-insensitive multi-keyword matcher (Aho-Corasick compiled into a dense DFA).
+// Built once; Matches() walks the input a single time without copying or allocating.
+class AdMatcher {
+public:
+    AdMatcher(std::initializer_list<const wchar_t*> keywords);
+
+    bool Matches(std::wstring_view text) const;
+
+private:
+    // Keywords are ASCII; every other code unit folds into class 0, which never advances a match.
+    uint8_t charClass[128] = {};
+    uint32_t classCount = 1;
+    std::vector<uint16_t> next;   // next[state * classCount + class]
+    std::vector<uint8_t> accepts; // 1 if a keyword ends at (or is a suffix of) this state
+};
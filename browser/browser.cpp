@@ -5,8 +5,30 @@
 #include <wil/com.h>
 #include <fstream>
 #include <filesystem>
-#include <algorithm> // For transform
+#include <string_view>
+#include <thread>
+#include <unordered_map>
 #include "WebView2.h"
+#include "filterlist.h"
+#include "ruleset.h"
+#include "requestclassifier.h"
+#include "requestscheduler.h"
+#include "classificationservice.h"
+#include "requesttrace.h"
+#include "historystore.h"
+#include "omnibox.h"
+#include "url.h"
+#include "tabpool.h"
+#include "tabregistry.h"
+#include "tabstrip.h"
+#include "tablifecycle.h"
+#include "session.h"
+#include "displaylist.h"
+#include "virtuallist.h"
+#include "metrics.h"
+#include "startup.h"
+#include "textindex.h"
+#include "speculation.h"
 
 #pragma comment(lib, "user32.lib")
 #pragma comment(lib, "gdi32.lib")
@@ -26,39 +48,61 @@ const int IDC_WIN_MIN = 108;
 const int IDC_WIN_MAX = 110;
 const int IDC_WIN_CLOSE = 109;
 const int IDC_OPEN_DATA_BTN = 111;
+const int IDC_EXPORT_METRICS_BTN = 112;
+const int IDC_RECORD_REQUESTS_BTN = 113;
+const int IDC_PAGE_INDEX_BTN = 114;
 
 const int IDM_DUPLICATE_TAB = 201;
 const int IDM_MUTE_TAB = 202;
 const int IDM_CLOSE_TAB = 203;
 
+const UINT WM_APP_OMNIBOX_READY = WM_APP + 1; // lParam: OmniboxIndex* built off the UI thread
+const UINT WM_APP_REQUESTS_DECIDED = WM_APP + 2; // the classification service has results to drain
+const UINT WM_APP_RULES_CHANGED = WM_APP + 3;    // the reloader published a new ruleset
+const UINT WM_APP_STARTUP_TASKS = WM_APP + 4;    // startup tasks are waiting for the UI thread
+const UINT_PTR IDT_TAB_LIFECYCLE = 1;
+const UINT_PTR IDT_SESSION_SNAPSHOT = 2;
+const UINT_PTR IDT_SETTINGS_REFRESH = 3; // while the settings panel is open
+const UINT_PTR IDT_REQUEST_SCHEDULER = 4;
+
 const int HEADER_TOTAL_HEIGHT = 100;
 const int SIDEBAR_MIN_WIDTH = 260;
 const int SIDEBAR_MAX_WIDTH = 450;
 const int TAB_WIDTH = 200;
 const int TAB_HEIGHT = 34;
+const int SUGGESTION_LIMIT = 8;
+const wchar_t* NEW_TAB_URL = L"https://www.google.com/?zx=1766092908811&no_sw_cr=1";
 
 struct BrowserTab {
-    wil::com_ptr<ICoreWebView2Controller> controller;
+    wil::com_ptr<ICoreWebView2Controller> controller; // null while discarded
     wil::com_ptr<ICoreWebView2> webview;
     std::wstring title = L"New Tab";
-    RECT tabRect;
-    RECT closeRect;
+    std::wstring url; // last committed; what a discarded tab reloads
+    POINT savedScroll = {}; // where a discarded tab was scrolled to
+    uint32_t requestContexts = 0; // resource contexts its view raises WebResourceRequested for, as bits
 };
 
 // --- GLOBAL STATE ---
-std::vector<BrowserTab> tabs;
-std::vector<std::wstring> historyList;
-int activeTabIndex = -1;
-int hoveredHistoryIndex = -1;
+TabRegistry<BrowserTab> tabs;
+TabHandle activeTab;
+size_t hoveredHistoryRow = VirtualListLayout::npos;
 int currentSidebarWidth = SIDEBAR_MIN_WIDTH;
-HWND hEdit, hSidebarBtn, hNewTabBtn, hClearBtn, hSettingsBtn, hExpandBtn, hBtnMin, hBtnMax, hBtnClose, hBtnOpenData;
+HWND hEdit, hSuggest, hSidebarBtn, hNewTabBtn, hClearBtn, hSettingsBtn, hExpandBtn, hBtnMin, hBtnMax, hBtnClose, hBtnOpenData, hBtnExportMetrics, hBtnRecordRequests, hBtnPageIndex;
 WNDPROC OldEditProc;
 HFONT hFontMain, hFontSmall, hFontSymbols;
-HBRUSH hBrushEdit;
 bool isSidebarOpen = true;
 bool isSettingsView = false;
 bool isExpanded = false;
 bool isVideoFullScreen = false;
+wil::com_ptr<ICoreWebView2Environment> webviewEnv; // shared by every tab
+std::unique_ptr<TabHostBackend> tabBackend;
+const size_t WARM_TAB_COUNT = 1; // hidden controllers kept ready for the next tab, none while memory is low
+std::unique_ptr<WarmTabPool> tabPool;
+std::unique_ptr<TabLifecycleBackend> lifecycleBackend;
+std::unique_ptr<TabLifecyclePolicy> tabLifecycle;
+std::unique_ptr<SessionStore> sessionStore;
+std::unique_ptr<SessionStore> loadedSessionStore; // loaded, not yet handed to the UI thread
+Session loadedSession;
 
 // --- DARK THEME COLORS ---
 COLORREF colBgHeader = RGB(24, 24, 28);
@@ -74,75 +118,497 @@ COLORREF colBtnBg = RGB(38, 38, 42);
 // --- FORWARD DECLARATIONS ---
 LRESULT CALLBACK WndProc(HWND, UINT, WPARAM, LPARAM);
 LRESULT CALLBACK EditProc(HWND, UINT, WPARAM, LPARAM);
-void CreateNewTab(HWND hWnd);
-void SwitchToTab(int index, HWND hWnd);
-void CloseTab(int index, HWND hWnd);
+void WithWebViewEnvironment(std::function<void(ICoreWebView2Environment*)> use);
+void CreateTabPool(HWND hWnd);
+void CreateTabLifecycle(HWND hWnd);
+void LoadSession();
+void RestoreSession(HWND hWnd);
+void MarkSessionDirty();
+void SaveSession();
+void RestoreTab(HWND hWnd, TabHandle handle);
+int64_t NowMs();
+void CreateNewTab(HWND hWnd, const std::wstring& url = NEW_TAB_URL);
+void SwitchToTab(TabHandle handle, HWND hWnd);
+void SwitchToNextTab(HWND hWnd);
+void CloseTab(TabHandle handle, HWND hWnd);
 void UpdateLayout(HWND hWnd);
+void RefreshChrome(HWND hWnd);
+void UpdateOmnibox(const wchar_t* url);
+void Speculate(const wchar_t* typed);
+void CancelSpeculation();
+bool ShowPreloaded(HWND hWnd, const std::wstring& url);
+void ApplyPreloadFilters();
+void PreloadLoaded(ICoreWebView2* webview);
+RECT TabViewBounds(HWND hWnd);
 
 // --- AD BLOCKER LOGIC ---
-bool IsAdUrl(std::wstring url) {
-    // Convert to lowercase for easier matching
-    std::transform(url.begin(), url.end(), url.begin(), ::towlower);
-
-    // List of common ad server keywords
-    const wchar_t* adKeywords[] = {
-        L"doubleclick.net",
-        L"googlesyndication.com",
-        L"googleadservices.com",
-        L"adnxs.com",
-        L"criteo.com",
-        L"pubmatic.com",
-        L"rubiconproject.com",
-        L"adsystem",
-        L"/ads/",
-        L"pagead2",
-        L"amazon-adsystem",
-        L"ads.twitter.com",
-        L"facebook.com/tr/", // Pixel trackers
-        L"moatads.com"
-    };
-
-    for (const auto& keyword : adKeywords) {
-        if (url.find(keyword) != std::wstring::npos) {
-            return true;
+// EasyList-style filter lists loaded from the "filters" folder; a built-in keyword list is the
+// fallback. Rules are swapped in by a background reloader without ever locking the request path.
+RulesetStore adRules;
+std::unique_ptr<RulesetReloader> filterReloader;
+RequestClassifier adClassifier(adRules);
+const wchar_t* FILTER_SNAPSHOT_PATH = L"filters\\filters.bin";
+uint64_t filterSnapshotStamp = 0; // source stamp of the published snapshot, 0 if there was none
+
+// Publishes the precompiled snapshot straight away, even if stale. Runs on a startup worker;
+// until it has, requests are decided by the keyword list.
+void LoadFilterSnapshot() {
+    auto snapshot = std::make_unique<Ruleset>();
+    uint64_t stamp = 0;
+    if (snapshot->filters.LoadSnapshot(FILTER_SNAPSHOT_PATH, stamp)) {
+        snapshot->sourceStamp = stamp;
+        adRules.Publish(std::move(snapshot));
+    }
+    filterSnapshotStamp = stamp;
+}
+
+// Rebuilds in the background whenever the lists on disk differ from what is published
+void StartFilterReloader(HWND hWnd) {
+    filterReloader = std::make_unique<RulesetReloader>(adRules, L"filters", FILTER_SNAPSHOT_PATH, std::chrono::seconds(10));
+    filterReloader->OnPublish([hWnd]() { PostMessage(hWnd, WM_APP_RULES_CHANGED, 0, 0); });
+    filterReloader->Start(filterSnapshotStamp);
+}
+
+uint32_t FilterTypeFromContext(COREWEBVIEW2_WEB_RESOURCE_CONTEXT context) {
+    switch (context) {
+    case COREWEBVIEW2_WEB_RESOURCE_CONTEXT_DOCUMENT: return FT_DOCUMENT;
+    case COREWEBVIEW2_WEB_RESOURCE_CONTEXT_STYLESHEET: return FT_STYLESHEET;
+    case COREWEBVIEW2_WEB_RESOURCE_CONTEXT_IMAGE: return FT_IMAGE;
+    case COREWEBVIEW2_WEB_RESOURCE_CONTEXT_MEDIA: return FT_MEDIA;
+    case COREWEBVIEW2_WEB_RESOURCE_CONTEXT_FONT: return FT_FONT;
+    case COREWEBVIEW2_WEB_RESOURCE_CONTEXT_SCRIPT: return FT_SCRIPT;
+    case COREWEBVIEW2_WEB_RESOURCE_CONTEXT_XML_HTTP_REQUEST:
+    case COREWEBVIEW2_WEB_RESOURCE_CONTEXT_FETCH: return FT_XHR;
+    case COREWEBVIEW2_WEB_RESOURCE_CONTEXT_WEBSOCKET: return FT_WEBSOCKET;
+    case COREWEBVIEW2_WEB_RESOURCE_CONTEXT_PING: return FT_PING;
+    default: return FT_OTHER;
+    }
+}
+
+// --- REQUEST FILTERING ---
+// Requests are classified off the UI thread. The WebResourceRequested handler answers at once
+// when the verdict is cached; otherwise it takes a deferral and queues the request with the
+// classification service, whose workers post WM_APP_REQUESTS_DECIDED as decisions come in.
+// WebView2 objects belong to the UI thread, so the responses are completed there.
+// Views raise the event only for resource contexts that some loaded rule can block, and
+// background tabs for every context, for the request scheduler.
+struct PendingRequest {
+    wil::com_ptr<ICoreWebView2WebResourceRequestedEventArgs> args;
+    wil::com_ptr<ICoreWebView2Deferral> deferral;
+    wil::com_ptr<ICoreWebView2Environment> env;
+    int64_t arrived = 0; // RequestTraceRecord::time, when recording
+};
+std::unique_ptr<ClassificationService> requestService;
+std::unordered_map<uint64_t, PendingRequest> pendingRequests; // by id, held for a decision or by the scheduler
+uint64_t nextRequestId = 1;
+uint32_t requestContexts = 0; // what views should filter on, as bits by context
+
+const COREWEBVIEW2_WEB_RESOURCE_CONTEXT FILTERABLE_CONTEXTS[] = {
+    COREWEBVIEW2_WEB_RESOURCE_CONTEXT_DOCUMENT, COREWEBVIEW2_WEB_RESOURCE_CONTEXT_STYLESHEET,
+    COREWEBVIEW2_WEB_RESOURCE_CONTEXT_IMAGE, COREWEBVIEW2_WEB_RESOURCE_CONTEXT_MEDIA,
+    COREWEBVIEW2_WEB_RESOURCE_CONTEXT_FONT, COREWEBVIEW2_WEB_RESOURCE_CONTEXT_SCRIPT,
+    COREWEBVIEW2_WEB_RESOURCE_CONTEXT_XML_HTTP_REQUEST, COREWEBVIEW2_WEB_RESOURCE_CONTEXT_FETCH,
+    COREWEBVIEW2_WEB_RESOURCE_CONTEXT_TEXT_TRACK, COREWEBVIEW2_WEB_RESOURCE_CONTEXT_EVENT_SOURCE,
+    COREWEBVIEW2_WEB_RESOURCE_CONTEXT_WEBSOCKET, COREWEBVIEW2_WEB_RESOURCE_CONTEXT_MANIFEST,
+    COREWEBVIEW2_WEB_RESOURCE_CONTEXT_SIGNED_EXCHANGE, COREWEBVIEW2_WEB_RESOURCE_CONTEXT_PING,
+    COREWEBVIEW2_WEB_RESOURCE_CONTEXT_CSP_VIOLATION_REPORT, COREWEBVIEW2_WEB_RESOURCE_CONTEXT_OTHER,
+};
+
+void StartRequestService(HWND hWnd) {
+    requestService = std::make_unique<ClassificationService>(adClassifier, ClassificationService::DefaultWorkers(),
+        [hWnd]() { PostMessage(hWnd, WM_APP_REQUESTS_DECIDED, 0, 0); });
+}
+
+// Contexts whose FilterType some blocking rule applies to; every context while the built-in
+// keyword list decides, since it ignores the type
+uint32_t RequestContextsForRules() {
+    RulesetStore::Reader ruleset(adRules);
+    uint32_t types = ruleset.Get() && ruleset->filters.RuleCount() ? ruleset->filters.BlockableTypes() : FT_ALL;
+    uint32_t contexts = 0;
+    for (COREWEBVIEW2_WEB_RESOURCE_CONTEXT c : FILTERABLE_CONTEXTS)
+        if (FilterTypeFromContext(c) & types) contexts |= 1u << c;
+    return contexts;
+}
+
+// Background tabs raise the event for every context, so the scheduler sees all they load
+uint32_t AllRequestContexts() {
+    uint32_t contexts = 0;
+    for (COREWEBVIEW2_WEB_RESOURCE_CONTEXT c : FILTERABLE_CONTEXTS) contexts |= 1u << c;
+    return contexts;
+}
+
+void ApplyRequestFilters(BrowserTab& tab, bool background = false) {
+    uint32_t wanted = background ? AllRequestContexts() : requestContexts;
+    if (!tab.webview || tab.requestContexts == wanted) return;
+    for (COREWEBVIEW2_WEB_RESOURCE_CONTEXT c : FILTERABLE_CONTEXTS) {
+        bool want = (wanted >> c) & 1, has = (tab.requestContexts >> c) & 1;
+        if (want && !has) tab.webview->AddWebResourceRequestedFilter(L"*", c);
+        if (has && !want) tab.webview->RemoveWebResourceRequestedFilter(L"*", c);
+    }
+    tab.requestContexts = wanted;
+}
+
+void RefreshRequestFilters() {
+    requestContexts = RequestContextsForRules();
+    for (TabHandle handle : tabs.Order()) if (BrowserTab* tab = tabs.Get(handle)) ApplyRequestFilters(*tab, handle != activeTab);
+    ApplyPreloadFilters();
+}
+
+void RespondBlocked(ICoreWebView2Environment* env, ICoreWebView2WebResourceRequestedEventArgs* args) {
+    // An empty "403 Forbidden" keeps the request off the network
+    wil::com_ptr<ICoreWebView2WebResourceResponse> response;
+    env->CreateWebResourceResponse(nullptr, 403, L"Blocked", L"", &response);
+    args->put_Response(response.get());
+}
+
+// --- REQUEST SCHEDULING ---
+// Requests the ad blocker lets through go to the scheduler (requestscheduler.h), which keeps
+// background tabs to a few at a time and holds their images, media and pings until they are
+// shown. A held request keeps its deferral in pendingRequests until the scheduler lets it go.
+// Slots are freed when a response arrives, as WebResourceResponseReceived reports, or by the
+// scheduler's timeout for responses never seen.
+RequestScheduler requestScheduler((RequestScheduler::Config()));
+const UINT REQUEST_SCHEDULER_TICK_MS = 1000;
+
+void StartRequestScheduler(HWND hWnd) {
+    SetTimer(hWnd, IDT_REQUEST_SCHEDULER, REQUEST_SCHEDULER_TICK_MS, NULL);
+}
+
+// Lets `pending` through, holds it, or answers it here as a duplicate of a held ping. It may
+// already hold a deferral, if it waited for classification.
+void ScheduleRequest(uint64_t id, uint64_t tab, uint32_t type, std::wstring url, PendingRequest pending) {
+    switch (requestScheduler.Submit({ id, tab, type, std::move(url) }, NowMs())) {
+    case REQUEST_SEND:
+        break;
+    case REQUEST_COALESCED: {
+        wil::com_ptr<ICoreWebView2WebResourceResponse> response;
+        pending.env->CreateWebResourceResponse(nullptr, 204, L"No Content", L"", &response);
+        pending.args->put_Response(response.get());
+    } break;
+    case REQUEST_HOLD:
+        if (!pending.deferral) pending.args->GetDeferral(&pending.deferral);
+        pendingRequests.insert_or_assign(id, std::move(pending));
+        return;
+    }
+    if (pending.deferral) pending.deferral->Complete();
+}
+
+// Sends what the scheduler has let go; call after anything that can free a slot
+void CompleteReleasedRequests() {
+    static std::vector<ScheduledRequest> released;
+    released.clear();
+    requestScheduler.Drain(released);
+    for (const ScheduledRequest& r : released) {
+        auto it = pendingRequests.find(r.id);
+        if (it == pendingRequests.end()) continue;
+        it->second.deferral->Complete();
+        pendingRequests.erase(it);
+    }
+}
+
+// --- REQUEST METRICS ---
+// Counted per tab (by TabHandle::Key) and per host as requests are classified, plus navigation
+// timings. Shown in the settings panel and exported as JSON on demand. Building with
+// SARF_METRICS=0 compiles all of it out.
+RequestMetrics requestMetrics;
+const wchar_t* METRICS_EXPORT_PATH = L"metrics.json";
+const UINT SETTINGS_REFRESH_MS = 1000;
+
+// Milliseconds since navigation start, as the page's performance timeline has it; the paint
+// entries are missing until the page has painted, and always on pages that never do
+const wchar_t* FIRST_PAINT_SCRIPT =
+    L"(performance.getEntriesByName('first-contentful-paint')[0] || performance.getEntriesByName('first-paint')[0] || {}).startTime";
+
+std::wstring FormatLatency(uint64_t ns) {
+    wchar_t text[32];
+    if (ns < 1000) swprintf_s(text, L"%llu ns", (unsigned long long)ns);
+    else if (ns < 1000000) swprintf_s(text, L"%.1f us", ns / 1e3);
+    else if (ns < 1000000000) swprintf_s(text, L"%.0f ms", ns / 1e6);
+    else swprintf_s(text, L"%.1f s", ns / 1e9);
+    return text;
+}
+
+bool ExportMetrics() {
+    std::string json = requestMetrics.Snapshot().ToJson();
+    std::ofstream file(METRICS_EXPORT_PATH, std::ios::binary | std::ios::trunc);
+    file.write(json.data(), (std::streamsize)json.size());
+    return (bool)file;
+}
+
+// --- REQUEST CAPTURE ---
+// While recording, every request the handler classifies is appended to a trace in the "traces"
+// folder, for replaying offline with tools/tracereplay.
+std::unique_ptr<RequestTraceWriter> requestTrace;
+
+// Counts and captures a decision, whether made in the handler or by the classification service
+void RecordDecision(uint64_t tab, uint32_t type, bool block, uint64_t ns, int64_t arrived, std::wstring_view url, std::wstring_view source) {
+    requestMetrics.RequestClassified(tab, UrlHost(url), block, ns);
+    if (requestTrace) requestTrace->Append({ arrived, tab, type, block, std::wstring(url), std::wstring(source) });
+}
+
+void CompleteDecidedRequests() {
+    static std::vector<ClassifyResult> decided;
+    decided.clear();
+    requestService->Drain(decided);
+    for (const ClassifyResult& r : decided) {
+        auto it = pendingRequests.find(r.request.id);
+        if (it == pendingRequests.end()) continue;
+        PendingRequest pending = std::move(it->second);
+        pendingRequests.erase(it);
+        RecordDecision(r.request.tab, r.request.type, r.blocked, r.classifyNs, pending.arrived, r.request.url, r.request.source);
+        if (r.blocked) {
+            RespondBlocked(pending.env.get(), pending.args.get());
+            pending.deferral->Complete();
         }
+        else ScheduleRequest(r.request.id, r.request.tab, r.request.type, r.request.url, std::move(pending));
     }
+}
+
+bool StartRequestTrace() {
+    std::error_code ec;
+    std::filesystem::create_directories(L"traces", ec);
+    SYSTEMTIME t; GetLocalTime(&t);
+    wchar_t name[64];
+    swprintf_s(name, L"traces\\requests-%04u%02u%02u-%02u%02u%02u.sarftrace", t.wYear, t.wMonth, t.wDay, t.wHour, t.wMinute, t.wSecond);
+    requestTrace = std::make_unique<RequestTraceWriter>(name);
+    if (requestTrace->IsOpen()) return true;
+    requestTrace.reset();
     return false;
 }
 
+std::filesystem::path StopRequestTrace() {
+    std::filesystem::path path = requestTrace->Path();
+    requestTrace.reset(); // writes what is still queued
+    return path;
+}
+
+// --- PAGE TEXT INDEX ---
+// Opt-in: while the "pageindex" folder exists, the text of every http(s) page loaded is indexed
+// there on a background thread (textindex.h), and the address bar also suggests pages by what
+// they say. Turning it off deletes the folder.
+const wchar_t* PAGE_INDEX_DIR = L"pageindex";
+const size_t PAGE_TEXT_MIN_QUERY = 3; // shorter prefixes match too much to be worth the lookup
+// innerText is the text as rendered: no markup, scripts or hidden elements
+const wchar_t* PAGE_TEXT_SCRIPT = L"document.body ? document.body.innerText.slice(0, 65536) : ''";
+std::unique_ptr<TextIndex> pageIndex;
+
+void OpenPageIndex() {
+    pageIndex = std::make_unique<TextIndex>(PAGE_INDEX_DIR, TextIndex::Config()); // segments open on its thread
+}
+
+void LoadPageIndex() {
+    std::error_code ec;
+    if (std::filesystem::is_directory(PAGE_INDEX_DIR, ec)) OpenPageIndex();
+}
+
+void StopPageIndex() {
+    pageIndex->Clear(); // so the queue is dropped rather than indexed on the way out
+    pageIndex.reset();
+    std::error_code ec;
+    std::filesystem::remove_all(PAGE_INDEX_DIR, ec);
+}
+
+// The script runs after the page's own; the index takes the text from there
+void IndexPageText(ICoreWebView2* webview) {
+    if (!pageIndex) return;
+    wil::unique_cotaskmem_string url, title;
+    if (FAILED(webview->get_Source(&url)) || !url) return;
+    std::wstring_view source = url.get();
+    if (source.rfind(L"https://", 0) != 0 && source.rfind(L"http://", 0) != 0) return;
+    webview->get_DocumentTitle(&title);
+    std::wstring canonical = CanonicalUrl(url.get());
+    std::wstring pageTitle = title ? title.get() : L"";
+    webview->ExecuteScript(PAGE_TEXT_SCRIPT, Callback<ICoreWebView2ExecuteScriptCompletedHandler>(
+        [canonical, pageTitle](HRESULT hr, LPCWSTR result) -> HRESULT {
+            if (SUCCEEDED(hr) && result && pageIndex) pageIndex->Add(canonical, pageTitle, JsonStringValue(result));
+            return S_OK;
+        }).Get());
+}
+
 // --- PERSISTENCE FUNCTIONS ---
-void SaveHistoryToFile() {
-    std::wofstream file("history.dat", std::ios::out | std::ios::trunc);
-    if (file.is_open()) {
-        for (const auto& url : historyList) {
-            file << url << std::endl;
-        }
-        file.close();
+// history.db holds the full history (mapped lazily); history.log journals changes made since it was written.
+// It is loaded on a startup worker; until it is handed over, changes are kept in earlyHistory.
+std::unique_ptr<HistoryStore> historyStore;
+std::unique_ptr<HistoryStore> loadedHistory; // loaded, not yet handed to the UI thread
+std::wstring lastVisitedUrl;
+
+struct EarlyHistoryChange {
+    std::wstring url;
+    std::wstring title;
+    int64_t time = 0;
+    bool visit = true; // else a title
+};
+std::vector<EarlyHistoryChange> earlyHistory;
+bool earlyHistoryCleared = false;
+
+// The sidebar lists the whole history by frecency. Only a window of rows around what is on
+// screen is held, fetched again when scrolling leaves it or history changes.
+const size_t HISTORY_ROW_WINDOW = 256;
+VirtualListLayout historyView;
+std::vector<HistoryEntry> historyRows; // rows [historyRowsFirst, historyRowsFirst + size)
+size_t historyRowsFirst = 0;
+
+void RefreshHistoryList() {
+    historyRows.clear();
+    historyView.SetCount(historyStore ? historyStore->Size() : 0);
+}
+
+// Null past the end of history
+const HistoryEntry* HistoryRow(size_t row) {
+    if (!historyStore) return nullptr;
+    if (row < historyRowsFirst || row >= historyRowsFirst + historyRows.size()) {
+        historyRowsFirst = row - (std::min)(row, HISTORY_ROW_WINDOW / 2);
+        historyRows = historyStore->Range(historyRowsFirst, HISTORY_ROW_WINDOW);
     }
+    size_t i = row - historyRowsFirst;
+    return i < historyRows.size() ? &historyRows[i] : nullptr;
+}
+
+// History is keyed on the canonical URL, so spellings of the same address share one entry
+void RecordVisit(const wchar_t* url) {
+    std::wstring canonical = CanonicalUrl(url);
+    if (lastVisitedUrl == canonical) return;
+    lastVisitedUrl = canonical;
+    if (!historyStore) { earlyHistory.push_back({ canonical, {}, HistoryLog::Now(), true }); return; }
+    historyStore->RecordVisit(canonical, HistoryLog::Now());
+    UpdateOmnibox(canonical.c_str());
+    RefreshHistoryList();
+}
+
+void RecordTitle(const wchar_t* url, const wchar_t* title) {
+    std::wstring canonical = CanonicalUrl(url);
+    if (!historyStore) { earlyHistory.push_back({ canonical, title, 0, false }); return; }
+    historyStore->SetTitle(canonical, title);
+    UpdateOmnibox(canonical.c_str());
 }
 
+// Runs on a startup worker; PublishHistory hands the store to the UI thread
 void LoadHistoryFromFile() {
-    std::wifstream file("history.dat");
-    if (file.is_open()) {
-        historyList.clear();
-        std::wstring line;
-        while (std::getline(file, line)) {
-            if (!line.empty()) {
-                historyList.push_back(line);
-            }
-        }
-        file.close();
+    loadedHistory = std::make_unique<HistoryStore>(L"history.db", L"history.log");
+    loadedHistory->Load();
+    if (loadedHistory->Size() == 0) loadedHistory->Import(ReadLegacyHistory(L"history.dat", HistoryLog::Now()));
+}
+
+// --- OMNIBOX ---
+// Suggestions come from an in-memory index over history. It is built on a background thread
+// the first time the address bar is focused; changes made meanwhile are replayed into it.
+OmniboxIndex omniboxIndex;
+bool omniboxReady = false;
+bool omniboxBuilding = false;
+bool omniboxCleared = false;             // history was cleared while building
+std::vector<std::wstring> omniboxPending; // URLs changed while building
+std::vector<OmniboxMatch> suggestions;
+
+void StartOmniboxBuild(HWND hWnd) {
+    if (omniboxReady || omniboxBuilding || !historyStore) return; // built once history is published
+    omniboxBuilding = true;
+    std::vector<HistoryEntry> entries;
+    entries.reserve(historyStore->Size());
+    historyStore->ForEach([&entries](const HistoryEntry& e) { entries.push_back(e); });
+    std::thread([hWnd, entries = std::move(entries)]() {
+        OmniboxIndex* built = new OmniboxIndex();
+        for (const HistoryEntry& e : entries) built->Update(e.url, e.title, e.frecency);
+        if (!PostMessage(hWnd, WM_APP_OMNIBOX_READY, 0, (LPARAM)built)) delete built;
+    }).detach();
+}
+
+void FinishOmniboxBuild(OmniboxIndex* built) {
+    omniboxIndex = std::move(*built);
+    if (omniboxCleared) omniboxIndex.Clear();
+    omniboxCleared = false;
+    omniboxReady = true;
+    omniboxBuilding = false;
+    for (const std::wstring& url : omniboxPending) UpdateOmnibox(url.c_str());
+    omniboxPending.clear();
+}
+
+void UpdateOmnibox(const wchar_t* url) {
+    if (!omniboxReady) {
+        if (omniboxBuilding) omniboxPending.push_back(url);
+        return;
+    }
+    HistoryEntry e;
+    if (historyStore->Find(url, e)) omniboxIndex.Update(e.url, e.title, e.frecency);
+}
+
+void HideSuggestions() {
+    suggestions.clear();
+    ShowWindow(hSuggest, SW_HIDE);
+}
+
+// Pages whose text matches fill what history leaves of the list
+void AppendPageTextSuggestions(std::wstring_view text) {
+    if (!pageIndex || text.size() < PAGE_TEXT_MIN_QUERY || suggestions.size() >= SUGGESTION_LIMIT) return;
+    for (TextSearchResult& r : pageIndex->Search(text, SUGGESTION_LIMIT)) {
+        if (suggestions.size() >= SUGGESTION_LIMIT) break;
+        bool listed = false;
+        for (const OmniboxMatch& m : suggestions) listed = listed || m.url == r.url;
+        if (!listed) suggestions.push_back({ std::move(r.url), std::move(r.title), 0 });
     }
 }
 
+// Recomputed on every edit of the address bar
+void UpdateSuggestions() {
+    wchar_t text[2048]; GetWindowText(hEdit, text, 2048);
+    suggestions = omniboxReady ? omniboxIndex.Query(text, SUGGESTION_LIMIT) : std::vector<OmniboxMatch>();
+    AppendPageTextSuggestions(text);
+    Speculate(text);
+    SendMessage(hSuggest, LB_RESETCONTENT, 0, 0);
+    if (suggestions.empty()) { ShowWindow(hSuggest, SW_HIDE); return; }
+    for (const OmniboxMatch& m : suggestions) {
+        std::wstring row = m.title.empty() ? m.url : m.title + L"  —  " + m.url;
+        SendMessage(hSuggest, LB_ADDSTRING, 0, (LPARAM)row.c_str());
+    }
+    RECT er; GetWindowRect(hEdit, &er);
+    int h = (int)SendMessage(hSuggest, LB_GETITEMHEIGHT, 0, 0) * (int)suggestions.size() + 2;
+    SetWindowPos(hSuggest, HWND_TOP, er.left, er.bottom, er.right - er.left, h, SWP_NOACTIVATE | SWP_SHOWWINDOW);
+}
+
+void ClearHistory() {
+    if (historyStore) historyStore->Clear();
+    else { earlyHistory.clear(); earlyHistoryCleared = true; }
+    lastVisitedUrl.clear();
+    RefreshHistoryList();
+    omniboxIndex.Clear();
+    if (omniboxBuilding) { omniboxCleared = true; omniboxPending.clear(); }
+    if (pageIndex) pageIndex->Clear();
+}
+
+void PublishHistory(HWND hWnd) {
+    historyStore = std::move(loadedHistory);
+    if (earlyHistoryCleared) historyStore->Clear();
+    for (const EarlyHistoryChange& c : earlyHistory) {
+        if (c.visit) historyStore->RecordVisit(c.url, c.time);
+        else historyStore->SetTitle(c.url, c.title);
+    }
+    earlyHistory.clear();
+    RefreshHistoryList();
+    RefreshChrome(hWnd);
+    if (GetFocus() == hEdit) StartOmniboxBuild(hWnd); // focused while history was loading
+}
+
+// Null when there is no active tab or it is still being restored from a discard
+ICoreWebView2* ActiveWebView() {
+    BrowserTab* tab = tabs.Get(activeTab);
+    return tab ? tab->webview.get() : nullptr;
+}
+
+// From the address bar: a page preloaded for it is shown rather than navigated to again
+void NavigateActiveTab(HWND hWnd, const std::wstring& input) {
+    std::wstring url = OmniboxNavigationUrl(input);
+    if (ShowPreloaded(hWnd, url)) return;
+    if (ICoreWebView2* wv = ActiveWebView()) wv->Navigate(url.c_str());
+}
+
 void SyncAddressBar() {
-    if (activeTabIndex != -1 && activeTabIndex < (int)tabs.size() && tabs[activeTabIndex].webview) {
-        if (GetFocus() != hEdit) {
-            wil::unique_cotaskmem_string url;
-            tabs[activeTabIndex].webview->get_Source(&url);
-            SetWindowText(hEdit, url.get());
-        }
+    const BrowserTab* tab = tabs.Get(activeTab);
+    if (!tab || GetFocus() == hEdit) return;
+    if (tab->webview) {
+        wil::unique_cotaskmem_string url;
+        tab->webview->get_Source(&url);
+        SetWindowText(hEdit, url.get());
     }
+    else SetWindowText(hEdit, tab->url.c_str());
 }
 
 void ToggleUIElements(bool show) {
@@ -163,22 +629,33 @@ void ToggleUIElements(bool show) {
 
     int settCmd = (sidebarCmd == SW_SHOW && isSettingsView) ? SW_SHOW : SW_HIDE;
     ShowWindow(hBtnOpenData, settCmd);
+    ShowWindow(hBtnExportMetrics, settCmd);
+    ShowWindow(hBtnRecordRequests, settCmd);
+    ShowWindow(hBtnPageIndex, settCmd);
+}
+
+// Where the active tab's view goes, beside the sidebar and below the header
+RECT TabViewBounds(HWND hWnd) {
+    RECT rc;
+    GetClientRect(hWnd, &rc);
+    return { isSidebarOpen ? currentSidebarWidth : 0, HEADER_TOTAL_HEIGHT, rc.right, rc.bottom };
 }
 
 void UpdateLayout(HWND hWnd) {
-    if (activeTabIndex == -1 || activeTabIndex >= (int)tabs.size()) return;
     RECT rc;
     GetClientRect(hWnd, &rc);
+    historyView.SetViewport({ 20, HEADER_TOTAL_HEIGHT + 100, currentSidebarWidth - 20, rc.bottom - 55 }); // above Clear History
+    BrowserTab* tab = tabs.Get(activeTab);
+    if (!tab) return;
+    ICoreWebView2Controller* controller = tab->controller.get(); // null while restoring
 
     if (isVideoFullScreen) {
         RECT full = { 0, 0, rc.right, rc.bottom };
-        tabs[activeTabIndex].controller->put_Bounds(full);
+        if (controller) controller->put_Bounds(full);
         ToggleUIElements(false);
     }
     else {
-        int xOff = isSidebarOpen ? currentSidebarWidth : 0;
-        RECT webBounds = { xOff, HEADER_TOTAL_HEIGHT, rc.right, rc.bottom };
-        tabs[activeTabIndex].controller->put_Bounds(webBounds);
+        if (controller) controller->put_Bounds(TabViewBounds(hWnd));
 
         MoveWindow(hBtnClose, rc.right - 46, 0, 46, 32, TRUE);
         MoveWindow(hBtnMax, rc.right - 92, 0, 46, 32, TRUE);
@@ -194,34 +671,311 @@ void UpdateLayout(HWND hWnd) {
             MoveWindow(hSettingsBtn, currentSidebarWidth - 45, HEADER_TOTAL_HEIGHT + 10, 32, 28, TRUE);
             MoveWindow(hClearBtn, 15, rc.bottom - 45, currentSidebarWidth - 30, 30, TRUE);
             MoveWindow(hBtnOpenData, 15, HEADER_TOTAL_HEIGHT + 100, currentSidebarWidth - 30, 30, TRUE);
+            MoveWindow(hBtnExportMetrics, 15, HEADER_TOTAL_HEIGHT + 285, currentSidebarWidth - 30, 30, TRUE);
+            MoveWindow(hBtnRecordRequests, 15, HEADER_TOTAL_HEIGHT + 325, currentSidebarWidth - 30, 30, TRUE);
+            MoveWindow(hBtnPageIndex, 15, HEADER_TOTAL_HEIGHT + 365, currentSidebarWidth - 30, 30, TRUE);
         }
         ToggleUIElements(true);
     }
 }
 
+// --- TAB STRIP ---
+// Geometry lives in a TabStripLayout that is told when tabs open or close and when the window
+// resizes. Painting goes through the chrome display list like the rest of the window.
+TabStripLayout::Metrics TabStripMetrics() {
+    TabStripLayout::Metrics m;
+    m.top = HEADER_TOTAL_HEIGHT - TAB_HEIGHT;
+    m.height = TAB_HEIGHT;
+    m.maxTabWidth = TAB_WIDTH;
+    return m;
+}
+
+TabStripLayout tabStrip(TabStripMetrics());
+
+RECT ToRect(const StripRect& r) {
+    return { r.left, r.top, r.right, r.bottom };
+}
+
+TabHandle TabAt(POINT pt, bool* onClose) {
+    size_t position = 0;
+    TabStripLayout::Part part = tabStrip.HitTest(pt.x, pt.y, position);
+    if (part == TabStripLayout::NOTHING) return {};
+    if (onClose) *onClose = (part == TabStripLayout::CLOSE_BUTTON);
+    return tabs.At(position);
+}
+
+// Keeps the new-tab button after the last tab and repaints what changed
+void UpdateTabStrip(HWND hWnd) {
+    RECT want = ToRect(tabStrip.ButtonRect());
+    RECT now;
+    GetWindowRect(hNewTabBtn, &now);
+    MapWindowPoints(NULL, hWnd, (POINT*)&now, 2);
+    if (now.left != want.left || now.top != want.top) MoveWindow(hNewTabBtn, want.left, want.top, want.right - want.left, want.bottom - want.top, TRUE);
+    RefreshChrome(hWnd);
+}
+
+// --- HISTORY SIDEBAR ---
+const int HISTORY_WHEEL_ROWS = 3; // per wheel notch; finer wheels and touchpads scroll by the pixel
+
+// Finds the row under the pointer; true if that is a different row than before
+bool HoverHistoryRow(POINT pt) {
+    size_t lastHover = hoveredHistoryRow;
+    hoveredHistoryRow = VirtualListLayout::npos;
+    if (isSidebarOpen && !isSettingsView && !isVideoFullScreen) hoveredHistoryRow = historyView.HitTest(pt.x, pt.y);
+    if (hoveredHistoryRow != VirtualListLayout::npos) SetCursor(LoadCursor(NULL, IDC_HAND));
+    return lastHover != hoveredHistoryRow;
+}
+
+bool ScrollHistory(HWND hWnd, POINT pt, int wheelDelta) {
+    RECT view = ToRect(historyView.ViewRect());
+    if (!isSidebarOpen || isSettingsView || isVideoFullScreen || !PtInRect(&view, pt)) return false;
+    historyView.ScrollBy(-(int64_t)wheelDelta * HISTORY_WHEEL_ROWS * historyView.RowPitch() / WHEEL_DELTA);
+    HoverHistoryRow(pt); // the list moved under the pointer
+    RefreshChrome(hWnd);
+    return true;
+}
+
+// --- CHROME RENDERING ---
+// Everything the window paints itself is described as a DisplayList, rebuilt from the current
+// state whenever something shown changes. RefreshChrome diffs it against the last frame and
+// invalidates only where the two differ. WM_PAINT replays the frame into an off-screen buffer
+// and copies the painted area to the window in one blit, so nothing is erased on screen first.
+enum ChromeFont { FONT_MAIN, FONT_SMALL, FONT_SYMBOLS };
+
+const UINT CHROME_TEXT_LINE = DT_LEFT | DT_VCENTER | DT_SINGLELINE;
+
+HFONT ChromeFontHandle(int font) {
+    switch (font) {
+    case FONT_MAIN: return hFontMain;
+    case FONT_SYMBOLS: return hFontSymbols;
+    default: return hFontSmall;
+    }
+}
+
+// One brush per color, made on first use and kept for the life of the process
+class BrushCache {
+public:
+    ~BrushCache() { for (auto& entry : brushes) DeleteObject(entry.second); }
+    HBRUSH Get(COLORREF color) {
+        HBRUSH& brush = brushes[color];
+        if (!brush) brush = CreateSolidBrush(color);
+        return brush;
+    }
+
+private:
+    std::unordered_map<COLORREF, HBRUSH> brushes;
+};
+
+BrushCache chromeBrushes;
+DisplayList chromeFrame; // what the window shows, or will once pending paints are done
+DisplayList nextChromeFrame; // kept to reuse its storage
+
+// Grows to the largest area painted so far and is reused by every paint after
+struct ChromeBuffer {
+    HDC dc = NULL;
+    HBITMAP bitmap = NULL;
+    HGDIOBJ original = NULL;
+    int width = 0, height = 0;
+} chromeBuffer;
+
+RECT ToRect(const DisplayRect& r) {
+    return { r.left, r.top, r.right, r.bottom };
+}
+
+DisplayRect ToDisplayRect(const StripRect& r) {
+    return { r.left, r.top, r.right, r.bottom };
+}
+
+class GdiDisplayBackend : public DisplayBackend {
+public:
+    explicit GdiDisplayBackend(HDC dc) : dc(dc) { SetBkMode(dc, TRANSPARENT); }
+
+    void Fill(const DisplayCommand& c) override {
+        RECT r = ToRect(c.bounds);
+        FillRect(dc, &r, chromeBrushes.Get(c.color));
+    }
+
+    void Text(const DisplayCommand& c) override {
+        if (c.font != font) { SelectObject(dc, ChromeFontHandle(c.font)); font = c.font; }
+        if (c.color != color) { SetTextColor(dc, c.color); color = c.color; }
+        RECT r = ToRect(c.rect);
+        bool clipped = c.bounds != c.rect; // laid out in the full box, shown only where the clip allows
+        if (clipped) { SaveDC(dc); IntersectClipRect(dc, c.bounds.left, c.bounds.top, c.bounds.right, c.bounds.bottom); }
+        DrawText(dc, c.text.c_str(), (int)c.text.size(), &r, c.format);
+        if (clipped) RestoreDC(dc, -1);
+    }
+
+private:
+    HDC dc;
+    int font = -1;
+    COLORREF color = CLR_INVALID;
+};
+
+void BuildChrome(HWND hWnd, DisplayList& frame) {
+    frame.Clear();
+    RECT rc; GetClientRect(hWnd, &rc);
+    DisplayRect client = { 0, 0, rc.right, rc.bottom };
+    if (isVideoFullScreen) { frame.Fill(client, RGB(0, 0, 0)); return; }
+    frame.Fill(client, colBgHeader);
+    if (isSidebarOpen) {
+        frame.Fill({ 0, HEADER_TOTAL_HEIGHT, currentSidebarWidth, rc.bottom }, colBgSidebar);
+        DisplayRect heading = { 20, HEADER_TOTAL_HEIGHT + 60, currentSidebarWidth - 20, HEADER_TOTAL_HEIGHT + 85 };
+        if (isSettingsView) {
+            frame.Text(heading, L"SETTINGS", FONT_MAIN, colAccent, CHROME_TEXT_LINE);
+            TabLifecyclePolicy::Stats ls = tabLifecycle->GetStats();
+            MetricsSnapshot ms = requestMetrics.Snapshot();
+            std::wstring lines[5];
+            wchar_t line[160];
+            swprintf_s(line, L"Tabs suspended %llu, discarded %llu, %llu MB reclaimed",
+                (unsigned long long)ls.suspends, (unsigned long long)ls.discards, (unsigned long long)(ls.reclaimedBytes >> 20));
+            lines[0] = line;
+            swprintf_s(line, L"Requests %llu, blocked %llu", (unsigned long long)ms.requests, (unsigned long long)ms.blocked);
+            lines[1] = line;
+            lines[2] = L"Classify p50 " + FormatLatency(ms.classify.Percentile(0.5)) + L", p99 " + FormatLatency(ms.classify.Percentile(0.99));
+            lines[3] = L"Load p50 " + FormatLatency(ms.load.Percentile(0.5)) + L", first paint p50 " + FormatLatency(ms.firstPaint.Percentile(0.5));
+            if (!ms.hosts.empty()) {
+                swprintf_s(line, L"Busiest host %ls (%llu)", ms.hosts[0].host.c_str(), (unsigned long long)ms.hosts[0].requests);
+                lines[4] = line;
+            }
+            for (int i = 0; i < 5; i++) {
+                int top = HEADER_TOTAL_HEIGHT + 150 + i * 25;
+                frame.Text({ 20, top, currentSidebarWidth - 20, top + 20 }, lines[i], FONT_SMALL, colTextDim, CHROME_TEXT_LINE | DT_END_ELLIPSIS);
+            }
+            if (pageIndex) {
+                TextIndex::Stats ts = pageIndex->GetStats();
+                swprintf_s(line, L"%llu pages indexed, %.1f MB", (unsigned long long)ts.pages, ts.diskBytes / 1048576.0);
+                int top = HEADER_TOTAL_HEIGHT + 405;
+                frame.Text({ 20, top, currentSidebarWidth - 20, top + 20 }, line, FONT_SMALL, colTextDim, CHROME_TEXT_LINE | DT_END_ELLIPSIS);
+            }
+            if (speculation) {
+                SpeculationEngine::Stats ss = speculation->GetStats();
+                swprintf_s(line, L"Preloads %llu, opened %llu, %.1f s of loading saved",
+                    (unsigned long long)ss.started, (unsigned long long)ss.hits, ss.savedMs / 1e3);
+                int top = HEADER_TOTAL_HEIGHT + 430;
+                frame.Text({ 20, top, currentSidebarWidth - 20, top + 20 }, line, FONT_SMALL, colTextDim, CHROME_TEXT_LINE | DT_END_ELLIPSIS);
+            }
+            RequestScheduler::Stats rs = requestScheduler.GetStats();
+            swprintf_s(line, L"Background requests held %llu, now %zu, longest %.1f s",
+                (unsigned long long)rs.held, rs.holding, rs.maxWaitMs / 1e3);
+            frame.Text({ 20, HEADER_TOTAL_HEIGHT + 455, currentSidebarWidth - 20, HEADER_TOTAL_HEIGHT + 475 }, line, FONT_SMALL, colTextDim, CHROME_TEXT_LINE | DT_END_ELLIPSIS);
+        }
+        else {
+            frame.Text(heading, L"HISTORY", FONT_MAIN, colAccent, CHROME_TEXT_LINE);
+            size_t firstRow, endRow;
+            historyView.VisibleRange(firstRow, endRow);
+            frame.PushClip(historyView.ViewRect()); // rows scrolled half out
+            for (size_t i = firstRow; i < endRow; i++) {
+                const HistoryEntry* entry = HistoryRow(i);
+                if (!entry) break;
+                DisplayRect hr = historyView.RowRect(i);
+                bool hovered = (i == hoveredHistoryRow);
+                if (hovered) frame.Fill(hr, colHoverGlow);
+                frame.Text(hr, entry->url, FONT_SMALL, hovered ? colAccent : colTextDim, CHROME_TEXT_LINE | DT_PATH_ELLIPSIS);
+            }
+            frame.PopClip();
+        }
+    }
+    size_t firstTab, endTab;
+    tabStrip.VisibleRange(firstTab, endTab);
+    frame.PushClip(ToDisplayRect(tabStrip.ViewRect())); // tabs scrolled half out
+    for (size_t i = firstTab; i < endTab; i++) {
+        TabHandle handle = tabs.At(i);
+        DisplayRect tabRect = ToDisplayRect(tabStrip.TabRect(i));
+        bool active = (handle == activeTab);
+        COLORREF text = active ? colTextMain : colTextDim;
+        frame.Fill(tabRect, active ? colTabActive : colTabInactive);
+        if (active) frame.Fill({ tabRect.left, tabRect.bottom - 3, tabRect.right, tabRect.bottom }, colAccent);
+        frame.Text({ tabRect.left + 10, tabRect.top, tabRect.right - 30, tabRect.bottom }, tabs.Get(handle)->title, FONT_SMALL, text,
+            CHROME_TEXT_LINE | DT_END_ELLIPSIS);
+        frame.Text(ToDisplayRect(tabStrip.CloseRect(i)), L"✕", FONT_SMALL, text, DT_CENTER | DT_VCENTER | DT_SINGLELINE);
+    }
+    frame.PopClip();
+}
+
+void RefreshChrome(HWND hWnd) {
+    BuildChrome(hWnd, nextChromeFrame);
+    for (const DisplayRect& dirty : DiffDisplayLists(chromeFrame, nextChromeFrame)) {
+        RECT r = ToRect(dirty);
+        InvalidateRect(hWnd, &r, FALSE);
+    }
+    std::swap(chromeFrame, nextChromeFrame);
+}
+
+HDC ChromeBufferFor(HDC target, int width, int height) {
+    if (!chromeBuffer.dc) chromeBuffer.dc = CreateCompatibleDC(target);
+    if (width > chromeBuffer.width || height > chromeBuffer.height) {
+        chromeBuffer.width = (std::max)(width, chromeBuffer.width);
+        chromeBuffer.height = (std::max)(height, chromeBuffer.height);
+        HBITMAP bitmap = CreateCompatibleBitmap(target, chromeBuffer.width, chromeBuffer.height);
+        HGDIOBJ previous = SelectObject(chromeBuffer.dc, bitmap);
+        if (chromeBuffer.bitmap) DeleteObject(previous);
+        else chromeBuffer.original = previous;
+        chromeBuffer.bitmap = bitmap;
+    }
+    return chromeBuffer.dc;
+}
+
+void ReleaseChromeBuffer() {
+    if (!chromeBuffer.dc) return;
+    SelectObject(chromeBuffer.dc, chromeBuffer.original);
+    DeleteObject(chromeBuffer.bitmap);
+    DeleteDC(chromeBuffer.dc);
+    chromeBuffer = {};
+}
+
+void PaintChrome(HWND hWnd) {
+    RefreshChrome(hWnd); // catches changes made without a refresh, before BeginPaint takes the update region
+    PAINTSTRUCT ps;
+    HDC hdc = BeginPaint(hWnd, &ps);
+    const RECT& area = ps.rcPaint;
+    int width = area.right - area.left, height = area.bottom - area.top;
+    if (width > 0 && height > 0) {
+        HDC buffer = ChromeBufferFor(hdc, width, height);
+        SetViewportOrgEx(buffer, -area.left, -area.top, NULL); // draw in client coordinates
+        GdiDisplayBackend backend(buffer);
+        chromeFrame.Replay(backend, { area.left, area.top, area.right, area.bottom });
+        BitBlt(hdc, area.left, area.top, width, height, buffer, area.left, area.top, SRCCOPY);
+    }
+    EndPaint(hWnd, &ps);
+}
+
 // --- EDIT PROC (Address Bar) ---
 LRESULT CALLBACK EditProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) {
     static bool needsSelectAll = false;
     switch (msg) {
     case WM_KEYDOWN:
         if (wParam == VK_RETURN) {
-            wchar_t url[2048]; GetWindowText(hWnd, url, 2048);
-            std::wstring urlStr(url);
-            if (urlStr.find(L"://") == std::wstring::npos) urlStr = L"https://www.google.com/search?q=" + urlStr;
-            if (activeTabIndex != -1 && tabs[activeTabIndex].webview) tabs[activeTabIndex].webview->Navigate(urlStr.c_str());
+            int sel = suggestions.empty() ? LB_ERR : (int)SendMessage(hSuggest, LB_GETCURSEL, 0, 0);
+            std::wstring urlStr;
+            if (sel != LB_ERR) urlStr = suggestions[sel].url;
+            else { wchar_t url[2048]; GetWindowText(hWnd, url, 2048); urlStr = url; }
+            HideSuggestions();
+            NavigateActiveTab(GetParent(hWnd), urlStr);
             return 0;
         }
+        if ((wParam == VK_DOWN || wParam == VK_UP) && !suggestions.empty()) {
+            int sel = (int)SendMessage(hSuggest, LB_GETCURSEL, 0, 0);
+            int count = (int)suggestions.size();
+            sel = (wParam == VK_DOWN) ? (sel == LB_ERR ? 0 : (sel + 1) % count) : (sel == LB_ERR ? count - 1 : (sel + count - 1) % count);
+            SendMessage(hSuggest, LB_SETCURSEL, sel, 0);
+            return 0;
+        }
+        if (wParam == VK_ESCAPE && !suggestions.empty()) { HideSuggestions(); CancelSpeculation(); return 0; }
         if (wParam == 'A' && (GetKeyState(VK_CONTROL) & 0x8000)) {
             SendMessage(hWnd, EM_SETSEL, 0, -1);
             return 0;
         }
         break;
     case WM_SETFOCUS: {
+        StartOmniboxBuild(GetParent(hWnd));
         LRESULT res = CallWindowProc(OldEditProc, hWnd, msg, wParam, lParam);
         if (GetKeyState(VK_LBUTTON) < 0) needsSelectAll = true;
         else SendMessage(hWnd, EM_SETSEL, 0, -1);
         return res;
     }
+    case WM_KILLFOCUS:
+        if ((HWND)wParam != hSuggest) { HideSuggestions(); CancelSpeculation(); } // a click on a suggestion takes focus first
+        break;
     case WM_LBUTTONUP: {
         LRESULT res = CallWindowProc(OldEditProc, hWnd, msg, wParam, lParam);
         if (needsSelectAll) { SendMessage(hWnd, EM_SETSEL, 0, -1); needsSelectAll = false; }
@@ -231,39 +985,118 @@ LRESULT CALLBACK EditProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) {
     return CallWindowProc(OldEditProc, hWnd, msg, wParam, lParam);
 }
 
-int WINAPI WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPSTR lpCmdLine, _In_ int nCmdShow) {
+// --- STARTUP ---
+// Startup runs as a graph (startup.h), so nothing waits on what it does not need: the WebView2
+// environment is requested before the window exists, and history, the session and the filter
+// snapshot load on workers meanwhile, each handed to the UI thread as it finishes. Every phase
+// is recorded in startupTrace, which Export Metrics writes next to the metrics; started with
+// --trace-startup, the browser writes it once the first navigation completes.
+StartupTrace startupTrace; // constructed before WinMain, so times count from about process start
+std::unique_ptr<StartupGraph> startup;
+const wchar_t* STARTUP_TRACE_PATH = L"startup-trace.json";
+bool traceStartup = false; // --trace-startup
+bool firstNavigationStarted = false;
+bool firstNavigationCompleted = false;
+
+bool ExportStartupTrace() {
+    std::string json = startupTrace.ToJson();
+    std::ofstream file(STARTUP_TRACE_PATH, std::ios::binary | std::ios::trunc);
+    file.write(json.data(), (std::streamsize)json.size());
+    return (bool)file;
+}
+
+void MarkFirstNavigation(bool completed) {
+    bool& seen = completed ? firstNavigationCompleted : firstNavigationStarted;
+    if (seen) return;
+    seen = true;
+    startupTrace.Mark(completed ? "first navigation completed" : "first navigation");
+    if (completed && traceStartup) ExportStartupTrace();
+}
+
+HWND CreateMainWindow(HINSTANCE hInstance) {
     hFontMain = CreateFont(19, 0, 0, 0, FW_MEDIUM, FALSE, FALSE, FALSE, ANSI_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY, DEFAULT_PITCH | FF_SWISS, L"Segoe UI");
     hFontSmall = CreateFont(15, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE, ANSI_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY, DEFAULT_PITCH | FF_SWISS, L"Segoe UI");
     hFontSymbols = CreateFont(20, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE, ANSI_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY, DEFAULT_PITCH | FF_SWISS, L"Segoe UI Symbol");
 
-    hBrushEdit = CreateSolidBrush(colBtnBg);
-
     WNDCLASSEX wcex = { sizeof(WNDCLASSEX), CS_HREDRAW | CS_VREDRAW, WndProc, 0, 0, hInstance, NULL,
                         LoadCursor(NULL, IDC_ARROW), CreateSolidBrush(colBgHeader), NULL, L"SARF_CORE", NULL };
     RegisterClassEx(&wcex);
 
-    HWND hWnd = CreateWindowEx(0, L"SARF_CORE", L"SARF Browser", WS_POPUP | WS_VISIBLE | WS_SYSMENU | WS_THICKFRAME,
+    HWND hWnd = CreateWindowEx(0, L"SARF_CORE", L"SARF Browser", WS_POPUP | WS_VISIBLE | WS_SYSMENU | WS_THICKFRAME | WS_CLIPCHILDREN,
         CW_USEDEFAULT, CW_USEDEFAULT, 1280, 800, NULL, NULL, hInstance, NULL);
 
     hSidebarBtn = CreateWindow(L"BUTTON", L"☰", WS_CHILD | WS_VISIBLE | BS_OWNERDRAW, 0, 0, 0, 0, hWnd, (HMENU)IDC_SIDEBAR_BTN, hInstance, NULL);
     hEdit = CreateWindowEx(0, L"EDIT", L"Search...", WS_CHILD | WS_VISIBLE | ES_CENTER | ES_AUTOHSCROLL | WS_BORDER, 0, 0, 0, 0, hWnd, (HMENU)IDC_ADDRESS_BAR, hInstance, NULL);
     SendMessage(hEdit, WM_SETFONT, (WPARAM)hFontMain, TRUE);
     OldEditProc = (WNDPROC)SetWindowLongPtr(hEdit, GWLP_WNDPROC, (LONG_PTR)EditProc);
+    hSuggest = CreateWindowEx(WS_EX_TOOLWINDOW | WS_EX_NOACTIVATE, L"LISTBOX", NULL, WS_POPUP | WS_BORDER | LBS_NOTIFY | LBS_NOINTEGRALHEIGHT, 0, 0, 0, 0, hWnd, NULL, hInstance, NULL);
+    SendMessage(hSuggest, WM_SETFONT, (WPARAM)hFontSmall, TRUE);
 
     hNewTabBtn = CreateWindow(L"BUTTON", L"+", WS_CHILD | WS_VISIBLE | BS_OWNERDRAW, 0, 0, 0, 0, hWnd, (HMENU)IDC_NEW_TAB_BTN, hInstance, NULL);
     hBtnClose = CreateWindow(L"BUTTON", L"✕", WS_CHILD | WS_VISIBLE | BS_OWNERDRAW, 0, 0, 0, 0, hWnd, (HMENU)IDC_WIN_CLOSE, hInstance, NULL);
     hBtnMax = CreateWindow(L"BUTTON", L"▢", WS_CHILD | WS_VISIBLE | BS_OWNERDRAW, 0, 0, 0, 0, hWnd, (HMENU)IDC_WIN_MAX, hInstance, NULL);
     hBtnMin = CreateWindow(L"BUTTON", L"—", WS_CHILD | WS_VISIBLE | BS_OWNERDRAW, 0, 0, 0, 0, hWnd, (HMENU)IDC_WIN_MIN, hInstance, NULL);
+    return hWnd;
+}
 
-    LoadHistoryFromFile();
-    CreateNewTab(hWnd);
+int WINAPI WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPSTR lpCmdLine, _In_ int nCmdShow) {
+    startupTrace.NameThread("UI thread");
+    traceStartup = std::string_view(lpCmdLine).find("--trace-startup") != std::string_view::npos;
+    HWND hWnd = NULL;
+    // Worker tasks are only ever followed by UI tasks that come after the window, so it exists
+    // by the time a worker posts
+    startup = std::make_unique<StartupGraph>(startupTrace, 2, [&hWnd]() { PostMessage(hWnd, WM_APP_STARTUP_TASKS, 0, 0); });
+    using T = StartupThread;
+    startup->AddAsync("webview environment", T::Main, {}, [](StartupGraph::Done done) {
+        WithWebViewEnvironment([done](ICoreWebView2Environment*) { done(); });
+    });
+    auto window = startup->Add("window", T::Main, {}, [&hWnd, hInstance]() { hWnd = CreateMainWindow(hInstance); });
+    auto history = startup->Add("history.load", T::Worker, {}, []() { LoadHistoryFromFile(); });
+    auto filters = startup->Add("filters.load", T::Worker, {}, []() { LoadFilterSnapshot(); });
+    auto session = startup->Add("session.load", T::Worker, {}, []() { LoadSession(); });
+    auto tabSetup = startup->Add("tabs", T::Main, { window }, [&hWnd]() {
+        StartRequestService(hWnd);
+        StartRequestScheduler(hWnd);
+        RefreshRequestFilters();
+        CreateTabPool(hWnd);
+        CreateTabLifecycle(hWnd);
+        CreateSpeculation(hWnd);
+    });
+    startup->Add("history.publish", T::Main, { window, history }, [&hWnd]() { PublishHistory(hWnd); });
+    startup->Add("filters.publish", T::Main, { window, filters }, [&hWnd]() {
+        StartFilterReloader(hWnd);
+        RefreshRequestFilters();
+    });
+    startup->Add("session.restore", T::Main, { tabSetup, session }, [&hWnd]() { RestoreSession(hWnd); });
+    startup->Add("pageindex.open", T::Main, { window }, []() {
+        LoadPageIndex();
+        if (pageIndex) SetWindowText(hBtnPageIndex, L"Stop Indexing Page Text");
+    });
+    startup->Start();
 
     MSG msg;
     while (GetMessage(&msg, NULL, 0, 0)) {
         TranslateMessage(&msg);
         DispatchMessage(&msg);
     }
-    DeleteObject(hBrushEdit);
+    startup.reset(); // waits for a load still running
+    if (sessionStore && sessionStore->IsDirty()) SaveSession();
+    sessionStore.reset(); // waits for the last snapshot to be written
+    loadedSessionStore.reset();
+    tabLifecycle.reset();
+    lifecycleBackend.reset();
+    speculation.reset(); // closes a preload's view
+    preloadBackend.reset();
+    tabPool.reset(); // closes the warm controllers
+    tabBackend.reset();
+    webviewEnv.reset();
+    requestService.reset();
+    filterReloader.reset();
+    historyStore.reset(); // writes any queued history
+    loadedHistory.reset();
+    pageIndex.reset(); // indexes what is queued
+    requestTrace.reset();
+    ReleaseChromeBuffer();
     return (int)msg.wParam;
 }
 
@@ -274,15 +1107,30 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) {
         hSettingsBtn = CreateWindow(L"BUTTON", L"⚙", WS_CHILD | WS_VISIBLE | BS_OWNERDRAW, 0, 0, 0, 0, hWnd, (HMENU)IDC_SETTINGS_BTN, NULL, NULL);
         hClearBtn = CreateWindow(L"BUTTON", L"Clear History", WS_CHILD | WS_VISIBLE | BS_OWNERDRAW, 0, 0, 0, 0, hWnd, (HMENU)IDC_CLEAR_HISTORY_BTN, NULL, NULL);
         hBtnOpenData = CreateWindow(L"BUTTON", L"Open Data Location", WS_CHILD | BS_OWNERDRAW, 0, 0, 0, 0, hWnd, (HMENU)IDC_OPEN_DATA_BTN, NULL, NULL);
+        hBtnExportMetrics = CreateWindow(L"BUTTON", L"Export Metrics", WS_CHILD | BS_OWNERDRAW, 0, 0, 0, 0, hWnd, (HMENU)IDC_EXPORT_METRICS_BTN, NULL, NULL);
+        hBtnRecordRequests = CreateWindow(L"BUTTON", L"Record Requests", WS_CHILD | BS_OWNERDRAW, 0, 0, 0, 0, hWnd, (HMENU)IDC_RECORD_REQUESTS_BTN, NULL, NULL);
+        hBtnPageIndex = CreateWindow(L"BUTTON", L"Index Page Text", WS_CHILD | BS_OWNERDRAW, 0, 0, 0, 0, hWnd, (HMENU)IDC_PAGE_INDEX_BTN, NULL, NULL);
     } break;
 
-    case WM_SIZE: UpdateLayout(hWnd); break;
+    case WM_SIZE: HideSuggestions(); UpdateLayout(hWnd); tabStrip.SetWidth(LOWORD(lParam)); UpdateTabStrip(hWnd); break;
+    case WM_MOUSEWHEEL: {
+        POINT pt = { (short)LOWORD(lParam), (short)HIWORD(lParam) };
+        ScreenToClient(hWnd, &pt);
+        RECT view = ToRect(tabStrip.ViewRect());
+        if (PtInRect(&view, pt)) {
+            tabStrip.ScrollBy(-GET_WHEEL_DELTA_WPARAM(wParam) * tabStrip.TabWidth() / WHEEL_DELTA); // a tab per notch
+            UpdateTabStrip(hWnd);
+        }
+        else if (!ScrollHistory(hWnd, pt, GET_WHEEL_DELTA_WPARAM(wParam))) return DefWindowProc(hWnd, msg, wParam, lParam);
+    } break;
+    case WM_MOVE: HideSuggestions(); break;
 
+    case WM_CTLCOLORLISTBOX:
     case WM_CTLCOLOREDIT: {
         HDC hdcEdit = (HDC)wParam;
         SetTextColor(hdcEdit, colTextMain);
         SetBkColor(hdcEdit, colBtnBg);
-        return (LRESULT)hBrushEdit;
+        return (LRESULT)chromeBrushes.Get(colBtnBg);
     }
 
     case WM_KEYDOWN: {
@@ -290,76 +1138,65 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) {
         bool alt = GetKeyState(VK_MENU) & 0x8000;
         if (ctrl) {
             if (wParam == 'T') CreateNewTab(hWnd);
-            if (wParam == 'W') CloseTab(activeTabIndex, hWnd);
+            if (wParam == 'W') CloseTab(activeTab, hWnd);
             if (wParam == 'L') { SetFocus(hEdit); }
-            if (wParam == 'R') if (activeTabIndex != -1) tabs[activeTabIndex].webview->Reload();
-            if (wParam == 'H') { isSidebarOpen = !isSidebarOpen; UpdateLayout(hWnd); InvalidateRect(hWnd, NULL, TRUE); }
-            if (wParam == VK_TAB) { if (!tabs.empty()) SwitchToTab((activeTabIndex + 1) % tabs.size(), hWnd); }
+            if (wParam == 'R') if (ICoreWebView2* wv = ActiveWebView()) wv->Reload();
+            if (wParam == 'H') { isSidebarOpen = !isSidebarOpen; UpdateLayout(hWnd); RefreshChrome(hWnd); }
+            if (wParam == VK_TAB) SwitchToNextTab(hWnd);
         }
-        if (activeTabIndex != -1) {
-            if (wParam == VK_F5) tabs[activeTabIndex].webview->Reload();
-            if ((alt && wParam == VK_LEFT) || wParam == VK_BACK) tabs[activeTabIndex].webview->GoBack();
-            if (alt && wParam == VK_RIGHT) tabs[activeTabIndex].webview->GoForward();
+        if (ICoreWebView2* wv = ActiveWebView()) {
+            if (wParam == VK_F5) wv->Reload();
+            if ((alt && wParam == VK_LEFT) || wParam == VK_BACK) wv->GoBack();
+            if (alt && wParam == VK_RIGHT) wv->GoForward();
         }
     } break;
 
     case WM_MOUSEMOVE: {
         POINT pt = { LOWORD(lParam), HIWORD(lParam) };
-        int lastHover = hoveredHistoryIndex;
-        hoveredHistoryIndex = -1;
-        if (isSidebarOpen && !isSettingsView && !isVideoFullScreen) {
-            int hy = HEADER_TOTAL_HEIGHT + 100;
-            for (int i = 0; i < (int)historyList.size(); i++) {
-                RECT r = { 20, hy, currentSidebarWidth - 20, hy + 25 };
-                if (PtInRect(&r, pt)) { hoveredHistoryIndex = i; break; }
-                hy += 30;
-            }
-        }
-        if (hoveredHistoryIndex != -1) SetCursor(LoadCursor(NULL, IDC_HAND));
-        if (lastHover != hoveredHistoryIndex) InvalidateRect(hWnd, NULL, FALSE);
+        if (HoverHistoryRow(pt)) RefreshChrome(hWnd); // the frame diff repaints just the two rows
     } break;
 
     case WM_LBUTTONDOWN: {
         if (isVideoFullScreen) return 0;
         POINT pt = { LOWORD(lParam), HIWORD(lParam) };
-        if (hoveredHistoryIndex != -1) {
-            tabs[activeTabIndex].webview->Navigate(historyList[hoveredHistoryIndex].c_str());
+        if (hoveredHistoryRow != VirtualListLayout::npos) {
+            const HistoryEntry* entry = HistoryRow(hoveredHistoryRow);
+            ICoreWebView2* wv = ActiveWebView();
+            if (entry && wv) wv->Navigate(entry->url.c_str());
             return 0;
         }
-        for (int i = 0; i < (int)tabs.size(); i++) {
-            if (PtInRect(&tabs[i].closeRect, pt)) { CloseTab(i, hWnd); return 0; }
-            if (PtInRect(&tabs[i].tabRect, pt)) { SwitchToTab(i, hWnd); return 0; }
+        bool onClose = false;
+        if (TabHandle hit = TabAt(pt, &onClose)) {
+            if (onClose) CloseTab(hit, hWnd);
+            else SwitchToTab(hit, hWnd);
+            return 0;
         }
     } break;
 
     case WM_RBUTTONDOWN: {
         if (isVideoFullScreen) return 0;
         POINT pt = { LOWORD(lParam), HIWORD(lParam) };
-        for (int i = 0; i < (int)tabs.size(); i++) {
-            if (PtInRect(&tabs[i].tabRect, pt)) {
-                SwitchToTab(i, hWnd);
-                HMENU hMenu = CreatePopupMenu();
-                BOOL isMuted = FALSE;
-                wil::com_ptr<ICoreWebView2_8> wv8;
-                if (tabs[i].webview->QueryInterface(IID_PPV_ARGS(&wv8)) == S_OK) wv8->get_IsMuted(&isMuted);
-                AppendMenu(hMenu, MF_STRING, IDM_DUPLICATE_TAB, L"Duplicate Tab");
-                AppendMenu(hMenu, MF_STRING, IDM_MUTE_TAB, isMuted ? L"Unmute Tab" : L"Mute Tab");
-                AppendMenu(hMenu, MF_SEPARATOR, 0, NULL);
-                AppendMenu(hMenu, MF_STRING, IDM_CLOSE_TAB, L"Close Tab");
-                POINT screenPt = pt;
-                ClientToScreen(hWnd, &screenPt);
-                TrackPopupMenu(hMenu, TPM_RIGHTBUTTON, screenPt.x, screenPt.y, 0, hWnd, NULL);
-                DestroyMenu(hMenu);
-                return 0;
-            }
+        if (TabHandle hit = TabAt(pt, nullptr)) {
+            SwitchToTab(hit, hWnd);
+            HMENU hMenu = CreatePopupMenu();
+            BOOL isMuted = FALSE;
+            wil::com_ptr<ICoreWebView2_8> wv8;
+            if (ICoreWebView2* wv = ActiveWebView()) if (wv->QueryInterface(IID_PPV_ARGS(&wv8)) == S_OK) wv8->get_IsMuted(&isMuted);
+            AppendMenu(hMenu, MF_STRING, IDM_DUPLICATE_TAB, L"Duplicate Tab");
+            AppendMenu(hMenu, MF_STRING, IDM_MUTE_TAB, isMuted ? L"Unmute Tab" : L"Mute Tab");
+            AppendMenu(hMenu, MF_SEPARATOR, 0, NULL);
+            AppendMenu(hMenu, MF_STRING, IDM_CLOSE_TAB, L"Close Tab");
+            POINT screenPt = pt;
+            ClientToScreen(hWnd, &screenPt);
+            TrackPopupMenu(hMenu, TPM_RIGHTBUTTON, screenPt.x, screenPt.y, 0, hWnd, NULL);
+            DestroyMenu(hMenu);
+            return 0;
         }
     } break;
 
     case WM_DRAWITEM: {
         LPDRAWITEMSTRUCT pdis = (LPDRAWITEMSTRUCT)lParam;
-        HBRUSH hBtnBrush = CreateSolidBrush(colBtnBg);
-        FillRect(pdis->hDC, &pdis->rcItem, hBtnBrush);
-        DeleteObject(hBtnBrush);
+        FillRect(pdis->hDC, &pdis->rcItem, chromeBrushes.Get(colBtnBg));
         SetTextColor(pdis->hDC, colTextMain);
         SetBkMode(pdis->hDC, TRANSPARENT);
         wchar_t txt[64]; GetWindowText(pdis->hwndItem, txt, 64);
@@ -367,93 +1204,61 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) {
         DrawText(pdis->hDC, txt, -1, &pdis->rcItem, DT_CENTER | DT_VCENTER | DT_SINGLELINE);
         return TRUE;
     }
-    case WM_PAINT: {
-        PAINTSTRUCT ps;
-        HDC hdc = BeginPaint(hWnd, &ps);
-        RECT rc; GetClientRect(hWnd, &rc);
-        if (isVideoFullScreen) {
-            HBRUSH hBlack = CreateSolidBrush(RGB(0, 0, 0));
-            FillRect(hdc, &rc, hBlack);
-            DeleteObject(hBlack);
-            EndPaint(hWnd, &ps);
-            return 0;
-        }
-        RECT headerR = { 0, 0, rc.right, HEADER_TOTAL_HEIGHT };
-        HBRUSH hHead = CreateSolidBrush(colBgHeader);
-        FillRect(hdc, &headerR, hHead);
-        DeleteObject(hHead);
-        SetBkMode(hdc, TRANSPARENT);
-        if (isSidebarOpen) {
-            RECT sideR = { 0, HEADER_TOTAL_HEIGHT, currentSidebarWidth, rc.bottom };
-            HBRUSH hSide = CreateSolidBrush(colBgSidebar);
-            FillRect(hdc, &sideR, hSide);
-            DeleteObject(hSide);
-            SelectObject(hdc, hFontMain);
-            SetTextColor(hdc, colAccent);
-            if (isSettingsView) {
-                TextOut(hdc, 20, HEADER_TOTAL_HEIGHT + 60, L"SETTINGS", 8);
-            }
-            else {
-                TextOut(hdc, 20, HEADER_TOTAL_HEIGHT + 60, L"HISTORY", 7);
-                int hy = HEADER_TOTAL_HEIGHT + 100;
-                SelectObject(hdc, hFontSmall);
-                for (int i = 0; i < (int)historyList.size(); i++) {
-                    if (hy > rc.bottom - 60) break;
-                    RECT hr = { 20, hy, currentSidebarWidth - 20, hy + 25 };
-                    if (i == hoveredHistoryIndex) {
-                        HBRUSH hGlow = CreateSolidBrush(colHoverGlow);
-                        FillRect(hdc, &hr, hGlow);
-                        DeleteObject(hGlow);
-                        SetTextColor(hdc, colAccent);
-                    }
-                    else SetTextColor(hdc, colTextDim);
-                    DrawText(hdc, historyList[i].c_str(), -1, &hr, DT_LEFT | DT_VCENTER | DT_SINGLELINE | DT_PATH_ELLIPSIS);
-                    hy += 30;
-                }
-            }
-        }
-        int tx = 10;
-        for (int i = 0; i < (int)tabs.size(); i++) {
-            tabs[i].tabRect = { tx, 66, tx + TAB_WIDTH, 100 };
-            tabs[i].closeRect = { tabs[i].tabRect.right - 28, 71, tabs[i].tabRect.right - 4, 95 };
-            bool active = (i == activeTabIndex);
-            HBRUSH hTb = CreateSolidBrush(active ? colTabActive : colTabInactive);
-            FillRect(hdc, &tabs[i].tabRect, hTb);
-            DeleteObject(hTb);
-            if (active) {
-                RECT acc = { tabs[i].tabRect.left, tabs[i].tabRect.bottom - 3, tabs[i].tabRect.right, tabs[i].tabRect.bottom };
-                HBRUSH hAcc = CreateSolidBrush(colAccent);
-                FillRect(hdc, &acc, hAcc);
-                DeleteObject(hAcc);
+    case WM_ERASEBKGND: return 1; // every paint covers its whole area
+    case WM_PAINT: PaintChrome(hWnd); break;
+    case WM_COMMAND:
+        if (hSuggest && (HWND)lParam == hSuggest) {
+            if (HIWORD(wParam) == LBN_SELCHANGE) { // mouse pick; the keyboard selects without notifying
+                int sel = (int)SendMessage(hSuggest, LB_GETCURSEL, 0, 0);
+                std::wstring url = (sel != LB_ERR && sel < (int)suggestions.size()) ? suggestions[sel].url : std::wstring();
+                HideSuggestions();
+                if (!url.empty()) { SetWindowText(hEdit, url.c_str()); NavigateActiveTab(hWnd, url); SetFocus(hWnd); }
             }
-            SetTextColor(hdc, active ? colTextMain : colTextDim);
-            RECT textR = { tabs[i].tabRect.left + 10, tabs[i].tabRect.top, tabs[i].tabRect.right - 30, tabs[i].tabRect.bottom };
-            DrawText(hdc, tabs[i].title.c_str(), -1, &textR, DT_LEFT | DT_VCENTER | DT_SINGLELINE | DT_END_ELLIPSIS);
-            DrawText(hdc, L"✕", -1, &tabs[i].closeRect, DT_CENTER | DT_VCENTER | DT_SINGLELINE);
-            tx += TAB_WIDTH + 4;
+            break;
         }
-        MoveWindow(hNewTabBtn, tx, 69, 28, 28, TRUE);
-        EndPaint(hWnd, &ps);
-    } break;
-    case WM_COMMAND:
         switch (LOWORD(wParam)) {
+        case IDC_ADDRESS_BAR: if (HIWORD(wParam) == EN_CHANGE && GetFocus() == hEdit) UpdateSuggestions(); break;
         case IDC_WIN_CLOSE: PostQuitMessage(0); break;
         case IDC_WIN_MIN: ShowWindow(hWnd, SW_MINIMIZE); break;
         case IDC_WIN_MAX: IsZoomed(hWnd) ? ShowWindow(hWnd, SW_RESTORE) : ShowWindow(hWnd, SW_MAXIMIZE); break;
-        case IDC_SIDEBAR_BTN: isSidebarOpen = !isSidebarOpen; UpdateLayout(hWnd); InvalidateRect(hWnd, NULL, TRUE); break;
+        case IDC_SIDEBAR_BTN: isSidebarOpen = !isSidebarOpen; UpdateLayout(hWnd); RefreshChrome(hWnd); break;
         case IDC_NEW_TAB_BTN: CreateNewTab(hWnd); break;
-        case IDC_SETTINGS_BTN: isSettingsView = !isSettingsView; UpdateLayout(hWnd); InvalidateRect(hWnd, NULL, TRUE); break;
-        case IDC_CLEAR_HISTORY_BTN: historyList.clear(); SaveHistoryToFile(); InvalidateRect(hWnd, NULL, TRUE); break;
+        case IDC_SETTINGS_BTN:
+            isSettingsView = !isSettingsView;
+            if (isSettingsView) SetTimer(hWnd, IDT_SETTINGS_REFRESH, SETTINGS_REFRESH_MS, NULL);
+            else KillTimer(hWnd, IDT_SETTINGS_REFRESH);
+            UpdateLayout(hWnd); RefreshChrome(hWnd); break;
+        case IDC_CLEAR_HISTORY_BTN: ClearHistory(); RefreshChrome(hWnd); break;
         case IDC_OPEN_DATA_BTN: {
             wchar_t path[MAX_PATH]; GetModuleFileName(NULL, path, MAX_PATH);
-            std::wstring p(path); p = p.substr(0, p.find_last_of(L"\\/") + 1) + L"history.dat";
+            std::wstring p(path); p = p.substr(0, p.find_last_of(L"\\/") + 1) + L"history.db";
             std::wstring param = L"/select,\"" + p + L"\"";
             ShellExecute(NULL, L"open", L"explorer.exe", param.c_str(), NULL, SW_SHOW);
         } break;
-        case IDC_EXPAND_SIDEBAR: isExpanded = !isExpanded; currentSidebarWidth = isExpanded ? SIDEBAR_MAX_WIDTH : SIDEBAR_MIN_WIDTH; UpdateLayout(hWnd); InvalidateRect(hWnd, NULL, TRUE); break;
-        case IDM_DUPLICATE_TAB: if (activeTabIndex != -1) { wil::unique_cotaskmem_string url; tabs[activeTabIndex].webview->get_Source(&url); CreateNewTab(hWnd); tabs[activeTabIndex].webview->Navigate(url.get()); } break;
-        case IDM_MUTE_TAB: if (activeTabIndex != -1) { wil::com_ptr<ICoreWebView2_8> wv8; if (tabs[activeTabIndex].webview->QueryInterface(IID_PPV_ARGS(&wv8)) == S_OK) { BOOL muted; wv8->get_IsMuted(&muted); wv8->put_IsMuted(!muted); } } break;
-        case IDM_CLOSE_TAB: CloseTab(activeTabIndex, hWnd); break;
+        case IDC_EXPORT_METRICS_BTN: {
+            if (!ExportMetrics() || !ExportStartupTrace()) { MessageBox(hWnd, L"Could not write metrics.json and startup-trace.json", L"Export Metrics", MB_ICONERROR); break; }
+            std::wstring param = L"/select,\"" + std::filesystem::absolute(METRICS_EXPORT_PATH).wstring() + L"\"";
+            ShellExecute(NULL, L"open", L"explorer.exe", param.c_str(), NULL, SW_SHOW);
+        } break;
+        case IDC_RECORD_REQUESTS_BTN: {
+            if (!requestTrace) {
+                if (StartRequestTrace()) SetWindowText(hBtnRecordRequests, L"Stop Recording");
+                else MessageBox(hWnd, L"Could not create a trace in the traces folder", L"Record Requests", MB_ICONERROR);
+                break;
+            }
+            std::wstring param = L"/select,\"" + std::filesystem::absolute(StopRequestTrace()).wstring() + L"\"";
+            SetWindowText(hBtnRecordRequests, L"Record Requests");
+            ShellExecute(NULL, L"open", L"explorer.exe", param.c_str(), NULL, SW_SHOW);
+        } break;
+        case IDC_PAGE_INDEX_BTN:
+            if (pageIndex) StopPageIndex();
+            else OpenPageIndex();
+            SetWindowText(hBtnPageIndex, pageIndex ? L"Stop Indexing Page Text" : L"Index Page Text");
+            RefreshChrome(hWnd); break;
+        case IDC_EXPAND_SIDEBAR: isExpanded = !isExpanded; currentSidebarWidth = isExpanded ? SIDEBAR_MAX_WIDTH : SIDEBAR_MIN_WIDTH; UpdateLayout(hWnd); RefreshChrome(hWnd); break;
+        case IDM_DUPLICATE_TAB: if (ICoreWebView2* wv = ActiveWebView()) { wil::unique_cotaskmem_string url; wv->get_Source(&url); CreateNewTab(hWnd, url.get()); } break;
+        case IDM_MUTE_TAB: if (ICoreWebView2* wv = ActiveWebView()) { wil::com_ptr<ICoreWebView2_8> wv8; if (wv->QueryInterface(IID_PPV_ARGS(&wv8)) == S_OK) { BOOL muted; wv8->get_IsMuted(&muted); wv8->put_IsMuted(!muted); } } break;
+        case IDM_CLOSE_TAB: CloseTab(activeTab, hWnd); break;
         }
         break;
     case WM_NCHITTEST: {
@@ -464,125 +1269,551 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) {
         if (pt.y < HEADER_TOTAL_HEIGHT) { if (pt.y > 60 || (pt.x > 10 && pt.x < 50)) return HTCLIENT; return HTCAPTION; }
         return DefWindowProc(hWnd, msg, wParam, lParam);
     } break;
+    case WM_TIMER:
+        if (wParam == IDT_TAB_LIFECYCLE) {
+            tabLifecycle->Tick(NowMs());
+            tabPool->Resize(tabLifecycle->LowOnMemory() ? 0 : WARM_TAB_COUNT);
+            RefreshChrome(hWnd); // the settings panel shows the counts
+        }
+        if (wParam == IDT_SESSION_SNAPSHOT && sessionStore->IsDirty()) SaveSession();
+        if (wParam == IDT_SETTINGS_REFRESH) RefreshChrome(hWnd); // request counts move constantly
+        if (wParam == IDT_REQUEST_SCHEDULER) {
+            requestScheduler.Tick(NowMs());
+            CompleteReleasedRequests();
+        }
+        break;
+    case WM_APP_REQUESTS_DECIDED: CompleteDecidedRequests(); break;
+    case WM_APP_RULES_CHANGED: RefreshRequestFilters(); break;
+    case WM_APP_STARTUP_TASKS: startup->RunMainTasks(); break;
+    case WM_APP_OMNIBOX_READY: {
+        std::unique_ptr<OmniboxIndex> built((OmniboxIndex*)lParam);
+        FinishOmniboxBuild(built.get());
+        if (GetFocus() == hEdit && SendMessage(hEdit, EM_GETMODIFY, 0, 0)) UpdateSuggestions(); // typed while building
+    } break;
     case WM_DESTROY: PostQuitMessage(0); break;
     default: return DefWindowProc(hWnd, msg, wParam, lParam);
     }
     return 0;
 }
 
-void CreateNewTab(HWND hWnd) {
+// --- TAB CREATION ---
+// All tabs share one WebView2 environment, created at startup. Controllers come from a warm pool
+// of hidden ones that already have every handler attached, so a new tab is shown and navigated
+// straight to its target.
+
+// `owner` is filled in when a tab claims the view, so handlers reach their tab without searching
+void AttachTabHandlers(HWND hWnd, ICoreWebView2Environment* env, ICoreWebView2Controller* controller, ICoreWebView2* webview,
+    std::shared_ptr<TabHandle> owner) {
+    // The ad blocker, then the request scheduler. Which requests reach them is set per tab by
+    // ApplyRequestFilters once a tab claims the view.
+    webview->add_WebResourceRequested(
+        Callback<ICoreWebView2WebResourceRequestedEventHandler>(
+            [env = wil::com_ptr<ICoreWebView2Environment>(env), owner](ICoreWebView2* sender, ICoreWebView2WebResourceRequestedEventArgs* args) -> HRESULT {
+                wil::com_ptr<ICoreWebView2WebResourceRequest> request;
+                args->get_Request(&request);
+                wil::unique_cotaskmem_string uri;
+                request->get_Uri(&uri);
+                COREWEBVIEW2_WEB_RESOURCE_CONTEXT context;
+                args->get_ResourceContext(&context);
+                wil::unique_cotaskmem_string source;
+                sender->get_Source(&source);
+
+                uint32_t type = FilterTypeFromContext(context);
+                uint64_t id = nextRequestId++;
+                int64_t arrived = requestTrace ? requestTrace->Elapsed() : 0;
+                if ((requestContexts >> context) & 1) {
+                    // Check the request against the loaded filter lists, here if the verdict is cached
+                    int64_t started = MetricsNow();
+                    bool block;
+                    if (!requestService->Submit({ id, owner->Key(), type, uri.get(), source.get() }, block)) {
+                        // Queued. The decision is completed from the message loop, which cannot run
+                        // before this handler returns, so the deferral is always registered in time.
+                        wil::com_ptr<ICoreWebView2Deferral> deferral;
+                        args->GetDeferral(&deferral);
+                        pendingRequests.emplace(id, PendingRequest{ wil::com_ptr<ICoreWebView2WebResourceRequestedEventArgs>(args), std::move(deferral), env, arrived });
+                        return S_OK;
+                    }
+                    RecordDecision(owner->Key(), type, block, (uint64_t)(MetricsNow() - started), arrived, uri.get(), source.get());
+                    if (block) { RespondBlocked(env.get(), args); return S_OK; }
+                }
+                ScheduleRequest(id, owner->Key(), type, uri.get(), PendingRequest{ wil::com_ptr<ICoreWebView2WebResourceRequestedEventArgs>(args), nullptr, env, arrived });
+                return S_OK;
+            }).Get(), nullptr);
+
+    // Frees the request's scheduler slot, if it had one
+    wil::com_ptr<ICoreWebView2_2> webview2;
+    if (webview->QueryInterface(IID_PPV_ARGS(&webview2)) == S_OK) {
+        webview2->add_WebResourceResponseReceived(Callback<ICoreWebView2WebResourceResponseReceivedEventHandler>(
+            [owner](ICoreWebView2* sender, ICoreWebView2WebResourceResponseReceivedEventArgs* args) -> HRESULT {
+                wil::com_ptr<ICoreWebView2WebResourceRequest> request;
+                args->get_Request(&request);
+                wil::unique_cotaskmem_string uri;
+                request->get_Uri(&uri);
+                requestScheduler.Finished(owner->Key(), uri.get(), NowMs());
+                CompleteReleasedRequests();
+                return S_OK;
+            }).Get(), nullptr);
+    }
+
+    controller->add_AcceleratorKeyPressed(Callback<ICoreWebView2AcceleratorKeyPressedEventHandler>(
+        [hWnd](ICoreWebView2Controller* sender, ICoreWebView2AcceleratorKeyPressedEventArgs* args) -> HRESULT {
+            COREWEBVIEW2_KEY_EVENT_KIND kind; args->get_KeyEventKind(&kind);
+            if (kind == COREWEBVIEW2_KEY_EVENT_KIND_KEY_DOWN) {
+                UINT key; args->get_VirtualKey(&key);
+                bool ctrlKey = GetKeyState(VK_CONTROL) & 0x8000;
+                bool altKey = GetKeyState(VK_MENU) & 0x8000;
+                if (ctrlKey) {
+                    if (key == 'T') { CreateNewTab(hWnd); args->put_Handled(TRUE); }
+                    if (key == 'W') { CloseTab(activeTab, hWnd); args->put_Handled(TRUE); }
+                    if (key == 'L') { SetFocus(hEdit); args->put_Handled(TRUE); }
+                    if (key == 'R') { if (ICoreWebView2* wv = ActiveWebView()) wv->Reload(); args->put_Handled(TRUE); }
+                    if (key == 'H') { PostMessage(hWnd, WM_COMMAND, IDC_SIDEBAR_BTN, 0); args->put_Handled(TRUE); }
+                    if (key == VK_TAB) { SwitchToNextTab(hWnd); args->put_Handled(TRUE); }
+                }
+                if (key == VK_F5) { if (ICoreWebView2* wv = ActiveWebView()) wv->Reload(); args->put_Handled(TRUE); }
+                if (altKey && key == VK_LEFT) { if (ICoreWebView2* wv = ActiveWebView()) wv->GoBack(); args->put_Handled(TRUE); }
+                if (altKey && key == VK_RIGHT) { if (ICoreWebView2* wv = ActiveWebView()) wv->GoForward(); args->put_Handled(TRUE); }
+            }
+            return S_OK;
+        }).Get(), nullptr);
+
+    webview->add_SourceChanged(Callback<ICoreWebView2SourceChangedEventHandler>(
+        [hWnd, owner](ICoreWebView2* s, ICoreWebView2SourceChangedEventArgs* a) -> HRESULT {
+            BrowserTab* tab = tabs.Get(*owner);
+            if (!tab) return S_OK; // a preload: history waits until it is shown
+            wil::unique_cotaskmem_string url; s->get_Source(&url);
+            RecordVisit(url.get());
+            if (url) { tab->url = url.get(); MarkSessionDirty(); }
+            SyncAddressBar(); RefreshChrome(hWnd); return S_OK;
+        }).Get(), nullptr);
+
+    webview->add_DocumentTitleChanged(Callback<ICoreWebView2DocumentTitleChangedEventHandler>(
+        [hWnd, owner](ICoreWebView2* s, IUnknown* a) -> HRESULT {
+            BrowserTab* tab = tabs.Get(*owner);
+            if (!tab) return S_OK;
+            wil::unique_cotaskmem_string t; s->get_DocumentTitle(&t);
+            wil::unique_cotaskmem_string url; s->get_Source(&url);
+            RecordTitle(url.get(), t.get());
+            tab->title = t.get(); MarkSessionDirty();
+            RefreshChrome(hWnd); return S_OK;
+        }).Get(), nullptr);
+
+    webview->add_NavigationStarting(Callback<ICoreWebView2NavigationStartingEventHandler>(
+        [owner](ICoreWebView2* s, ICoreWebView2NavigationStartingEventArgs* a) -> HRESULT {
+            if (!tabs.Get(*owner)) return S_OK;
+            MarkFirstNavigation(false);
+            requestMetrics.NavigationStarted(owner->Key(), MetricsNow());
+            return S_OK;
+        }).Get(), nullptr);
+
+    webview->add_NavigationCompleted(Callback<ICoreWebView2NavigationCompletedEventHandler>(
+        [owner](ICoreWebView2* s, ICoreWebView2NavigationCompletedEventArgs* a) -> HRESULT {
+            BOOL success = FALSE; a->get_IsSuccess(&success);
+            if (!success) return S_OK;
+            if (!tabs.Get(*owner)) { PreloadLoaded(s); return S_OK; }
+            MarkFirstNavigation(true);
+            uint64_t key = owner->Key();
+            requestMetrics.NavigationCompleted(key, MetricsNow());
+            IndexPageText(s);
+#if SARF_METRICS
+            s->ExecuteScript(FIRST_PAINT_SCRIPT, Callback<ICoreWebView2ExecuteScriptCompletedHandler>(
+                [key](HRESULT hr, LPCWSTR result) -> HRESULT {
+                    wchar_t* end = nullptr;
+                    double ms = SUCCEEDED(hr) && result ? wcstod(result, &end) : 0;
+                    if (end != result && ms > 0) requestMetrics.FirstPaint(key, (uint64_t)(ms * 1e6));
+                    return S_OK;
+                }).Get());
+#endif
+            return S_OK;
+        }).Get(), nullptr);
+
+    webview->add_ContainsFullScreenElementChanged(
+        Callback<ICoreWebView2ContainsFullScreenElementChangedEventHandler>(
+            [hWnd](ICoreWebView2* sender, IUnknown* args) -> HRESULT {
+                BOOL isFull; sender->get_ContainsFullScreenElement(&isFull);
+                isVideoFullScreen = (isFull == TRUE); UpdateLayout(hWnd); RefreshChrome(hWnd);
+                return S_OK;
+            }).Get(), nullptr);
+}
+
+// --- WEBVIEW ENVIRONMENT ---
+// Requested first thing at startup: starting the browser process behind it is the longest wait
+// before the first navigation, and it needs no window.
+bool webviewEnvRequested = false;
+std::vector<std::function<void(ICoreWebView2Environment*)>> webviewEnvWaiting;
+
+// Calls `use` with the shared environment once it exists, or with null if it could not be
+// created, in which case the next call tries again
+void WithWebViewEnvironment(std::function<void(ICoreWebView2Environment*)> use) {
+    if (webviewEnv) { use(webviewEnv.get()); return; }
+    webviewEnvWaiting.push_back(std::move(use));
+    if (webviewEnvRequested) return;
+    webviewEnvRequested = true;
     CreateCoreWebView2EnvironmentWithOptions(nullptr, nullptr, nullptr,
         Callback<ICoreWebView2CreateCoreWebView2EnvironmentCompletedHandler>(
-            [hWnd](HRESULT res, ICoreWebView2Environment* env) -> HRESULT {
-                env->CreateCoreWebView2Controller(hWnd, Callback<ICoreWebView2CreateCoreWebView2ControllerCompletedHandler>(
-                    [hWnd, env](HRESULT res, ICoreWebView2Controller* ctrl) -> HRESULT {
-                        if (ctrl) {
-                            BrowserTab nt;
-                            nt.controller = ctrl;
-                            nt.controller->get_CoreWebView2(&nt.webview);
-
-                            // --- 1. ENABLE FILTERING ---
-                            // Tells WebView2 to fire the 'WebResourceRequested' event for ALL resources
-                            nt.webview->AddWebResourceRequestedFilter(L"*", COREWEBVIEW2_WEB_RESOURCE_CONTEXT_ALL);
-
-                            // --- 2. ADD REQUEST HANDLER (THE AD BLOCKER) ---
-                            nt.webview->add_WebResourceRequested(
-                                Callback<ICoreWebView2WebResourceRequestedEventHandler>(
-                                    [env](ICoreWebView2* sender, ICoreWebView2WebResourceRequestedEventArgs* args) -> HRESULT {
-                                        wil::com_ptr<ICoreWebView2WebResourceRequest> request;
-                                        args->get_Request(&request);
-                                        wil::unique_cotaskmem_string uri;
-                                        request->get_Uri(&uri);
-                                        std::wstring url(uri.get());
-
-                                        // Check if the URL matches known ad domains
-                                        if (IsAdUrl(url)) {
-                                            // If it is an ad, provide an empty "403 Forbidden" response immediately
-                                            // This prevents the request from going to the network
-                                            wil::com_ptr<ICoreWebView2WebResourceResponse> response;
-                                            wil::com_ptr<IStream> stream; // Empty stream
-                                            env->CreateWebResourceResponse(nullptr, 403, L"Blocked", L"", &response);
-                                            args->put_Response(response.get());
-                                        }
-                                        return S_OK;
-                                    }).Get(), nullptr);
-
-                            nt.controller->add_AcceleratorKeyPressed(Callback<ICoreWebView2AcceleratorKeyPressedEventHandler>(
-                                [hWnd](ICoreWebView2Controller* sender, ICoreWebView2AcceleratorKeyPressedEventArgs* args) -> HRESULT {
-                                    COREWEBVIEW2_KEY_EVENT_KIND kind; args->get_KeyEventKind(&kind);
-                                    if (kind == COREWEBVIEW2_KEY_EVENT_KIND_KEY_DOWN) {
-                                        UINT key; args->get_VirtualKey(&key);
-                                        bool ctrlKey = GetKeyState(VK_CONTROL) & 0x8000;
-                                        bool altKey = GetKeyState(VK_MENU) & 0x8000;
-                                        if (ctrlKey) {
-                                            if (key == 'T') { CreateNewTab(hWnd); args->put_Handled(TRUE); }
-                                            if (key == 'W') { CloseTab(activeTabIndex, hWnd); args->put_Handled(TRUE); }
-                                            if (key == 'L') { SetFocus(hEdit); args->put_Handled(TRUE); }
-                                            if (key == 'R') { if (activeTabIndex != -1) tabs[activeTabIndex].webview->Reload(); args->put_Handled(TRUE); }
-                                            if (key == 'H') { PostMessage(hWnd, WM_COMMAND, IDC_SIDEBAR_BTN, 0); args->put_Handled(TRUE); }
-                                            if (key == VK_TAB) { if (!tabs.empty()) SwitchToTab((activeTabIndex + 1) % tabs.size(), hWnd); args->put_Handled(TRUE); }
-                                        }
-                                        if (key == VK_F5) { if (activeTabIndex != -1) tabs[activeTabIndex].webview->Reload(); args->put_Handled(TRUE); }
-                                        if (altKey && key == VK_LEFT) { if (activeTabIndex != -1) tabs[activeTabIndex].webview->GoBack(); args->put_Handled(TRUE); }
-                                        if (altKey && key == VK_RIGHT) { if (activeTabIndex != -1) tabs[activeTabIndex].webview->GoForward(); args->put_Handled(TRUE); }
-                                    }
-                                    return S_OK;
-                                }).Get(), nullptr);
-
-                            nt.webview->add_SourceChanged(Callback<ICoreWebView2SourceChangedEventHandler>(
-                                [hWnd](ICoreWebView2* s, ICoreWebView2SourceChangedEventArgs* a) -> HRESULT {
-                                    wil::unique_cotaskmem_string url; s->get_Source(&url);
-                                    if (historyList.empty() || historyList[0] != url.get()) {
-                                        historyList.insert(historyList.begin(), url.get());
-                                        if (historyList.size() > 25) historyList.pop_back();
-                                        SaveHistoryToFile();
-                                    }
-                                    SyncAddressBar(); InvalidateRect(hWnd, NULL, TRUE); return S_OK;
-                                }).Get(), nullptr);
-
-                            nt.webview->add_DocumentTitleChanged(Callback<ICoreWebView2DocumentTitleChangedEventHandler>(
-                                [hWnd](ICoreWebView2* s, IUnknown* a) -> HRESULT {
-                                    wil::unique_cotaskmem_string t; s->get_DocumentTitle(&t);
-                                    for (auto& tab : tabs) if (tab.webview.get() == s) tab.title = t.get();
-                                    InvalidateRect(hWnd, NULL, TRUE); return S_OK;
-                                }).Get(), nullptr);
-
-                            nt.webview->add_ContainsFullScreenElementChanged(
-                                Callback<ICoreWebView2ContainsFullScreenElementChangedEventHandler>(
-                                    [hWnd](ICoreWebView2* sender, IUnknown* args) -> HRESULT {
-                                        BOOL isFull; sender->get_ContainsFullScreenElement(&isFull);
-                                        isVideoFullScreen = (isFull == TRUE); UpdateLayout(hWnd); InvalidateRect(hWnd, NULL, TRUE);
-                                        return S_OK;
-                                    }).Get(), nullptr);
-
-                            tabs.push_back(nt);
-                            SwitchToTab((int)tabs.size() - 1, hWnd);
-                            nt.webview->Navigate(L"https://www.google.com/?zx=1766092908811&no_sw_cr=1");
-                        }
-                        return S_OK;
-                    }).Get());
+            [](HRESULT res, ICoreWebView2Environment* created) -> HRESULT {
+                webviewEnv = created;
+                webviewEnvRequested = false;
+                std::vector<std::function<void(ICoreWebView2Environment*)>> waiting = std::move(webviewEnvWaiting);
+                webviewEnvWaiting.clear();
+                for (auto& use : waiting) use(webviewEnv.get());
+                return S_OK;
+            }).Get());
+}
+
+struct WebViewTabHost : TabHost {
+    wil::com_ptr<ICoreWebView2Controller> controller;
+    wil::com_ptr<ICoreWebView2> webview;
+    std::shared_ptr<TabHandle> owner = std::make_shared<TabHandle>();
+    ~WebViewTabHost() override { if (controller) controller->Close(); }
+};
+
+class WebViewTabBackend : public TabHostBackend {
+public:
+    explicit WebViewTabBackend(HWND hWnd) : hWnd(hWnd) {}
+
+    void CreateHost(Created done) override {
+        WithWebViewEnvironment([this, done](ICoreWebView2Environment* env) {
+            if (env) CreateController(env, done);
+            else done(nullptr);
+        });
+    }
+
+private:
+    void CreateController(ICoreWebView2Environment* env, Created done) {
+        wil::com_ptr<ICoreWebView2Environment> e = env;
+        env->CreateCoreWebView2Controller(hWnd, Callback<ICoreWebView2CreateCoreWebView2ControllerCompletedHandler>(
+            [this, e, done](HRESULT res, ICoreWebView2Controller* ctrl) -> HRESULT {
+                if (!ctrl) { done(nullptr); return S_OK; }
+                auto host = std::make_unique<WebViewTabHost>();
+                host->controller = ctrl;
+                host->controller->get_CoreWebView2(&host->webview);
+                host->controller->put_IsVisible(FALSE);
+                AttachTabHandlers(hWnd, e.get(), host->controller.get(), host->webview.get(), host->owner);
+                done(std::move(host));
                 return S_OK;
             }).Get());
+    }
+
+    HWND hWnd;
+};
+
+void CreateTabPool(HWND hWnd) {
+    tabBackend = std::make_unique<WebViewTabBackend>(hWnd);
+    tabPool = std::make_unique<WarmTabPool>(*tabBackend, WARM_TAB_COUNT);
+    tabPool->Fill(); // a view is ready for the first tab as soon as the environment is
 }
 
-void SwitchToTab(int index, HWND hWnd) {
-    if (index < 0 || index >= (int)tabs.size()) return;
-    activeTabIndex = index;
+void CreateNewTab(HWND hWnd, const std::wstring& url) {
+    tabPool->Claim([hWnd, url](std::unique_ptr<TabHost> host) {
+        if (!host) return;
+        WebViewTabHost* view = static_cast<WebViewTabHost*>(host.get());
+        wil::com_ptr<ICoreWebView2> webview = view->webview;
+        BrowserTab nt;
+        nt.url = url;
+        nt.controller = std::move(view->controller);
+        nt.webview = std::move(view->webview);
+        TabHandle handle = tabs.Open(std::move(nt));
+        ApplyRequestFilters(*tabs.Get(handle));
+        tabStrip.SetCount(tabs.Size());
+        *view->owner = handle;
+        tabLifecycle->Add(handle.Key(), NowMs());
+        requestScheduler.Add(handle.Key());
+        MarkSessionDirty();
+        SwitchToTab(handle, hWnd);
+        webview->Navigate(url.c_str());
+    });
+}
+
+void SwitchToTab(TabHandle handle, HWND hWnd) {
+    BrowserTab* tab = tabs.Get(handle);
+    if (!tab) return;
+    // Only the outgoing tab can be visible; pooled and restored views arrive hidden
+    BrowserTab* previous = tabs.Get(activeTab);
+    if (previous && previous != tab && previous->controller) previous->controller->put_IsVisible(FALSE);
+    if (previous && previous != tab) ApplyRequestFilters(*previous, true);
+    activeTab = handle;
+    ApplyRequestFilters(*tab);
+    requestScheduler.Activate(handle.Key(), NowMs());
+    CompleteReleasedRequests();
+    MarkSessionDirty();
+    if (tabLifecycle->Activate(handle.Key(), NowMs()) == TAB_DISCARDED) RestoreTab(hWnd, handle);
     BOOL isFull = FALSE;
-    if (tabs[activeTabIndex].webview) tabs[activeTabIndex].webview->get_ContainsFullScreenElement(&isFull);
+    if (tab->webview) tab->webview->get_ContainsFullScreenElement(&isFull);
     isVideoFullScreen = (isFull == TRUE);
-    for (int i = 0; i < (int)tabs.size(); i++) tabs[i].controller->put_IsVisible(i == activeTabIndex);
-    UpdateLayout(hWnd); SyncAddressBar(); InvalidateRect(hWnd, NULL, TRUE);
-    tabs[activeTabIndex].controller->MoveFocus(COREWEBVIEW2_MOVE_FOCUS_REASON_PROGRAMMATIC);
+    if (tab->controller) tab->controller->put_IsVisible(TRUE);
+    tabStrip.EnsureVisible(tabs.PositionOf(handle));
+    UpdateLayout(hWnd); SyncAddressBar(); UpdateTabStrip(hWnd);
+    if (tab->controller) tab->controller->MoveFocus(COREWEBVIEW2_MOVE_FOCUS_REASON_PROGRAMMATIC);
 }
 
-void CloseTab(int index, HWND hWnd) {
-    if (index < 0 || index >= (int)tabs.size()) return;
-    tabs[index].controller->Close();
-    tabs.erase(tabs.begin() + index);
-    if (tabs.empty()) PostQuitMessage(0);
-    else {
-        if (activeTabIndex >= (int)tabs.size()) activeTabIndex = (int)tabs.size() - 1;
-        SwitchToTab(activeTabIndex, hWnd);
+void SwitchToNextTab(HWND hWnd) {
+    if (tabs.Empty()) return;
+    size_t position = tabs.PositionOf(activeTab);
+    SwitchToTab(tabs.At(position == tabs.npos ? 0 : (position + 1) % tabs.Size()), hWnd);
+}
+
+void CloseTab(TabHandle handle, HWND hWnd) {
+    BrowserTab* tab = tabs.Get(handle);
+    if (!tab) return;
+    size_t position = tabs.PositionOf(handle);
+    tabLifecycle->Remove(handle.Key());
+    requestScheduler.Remove(handle.Key(), NowMs());
+    CompleteReleasedRequests();
+    if (tab->controller) tab->controller->Close();
+    tabs.Close(handle);
+    tabStrip.SetCount(tabs.Size());
+    MarkSessionDirty();
+    if (tabs.Empty()) PostQuitMessage(0);
+    else if (handle == activeTab) SwitchToTab(tabs.At((std::min)(position, tabs.Size() - 1)), hWnd); // the tab that slid into its place
+    else UpdateTabStrip(hWnd);
+}
+
+// --- SPECULATIVE PRELOAD ---
+// As the address bar is typed in, the page it is predicted to open (speculation.h) loads in a
+// hidden view claimed from the warm pool. Enter on that address moves the view into the active
+// tab, whose own view closes; the tab's back history starts over from the preloaded page. A
+// preload records no history, metrics or page text until it is shown.
+std::unique_ptr<SpeculationEngine> speculation;
+
+class WebViewPreload : public Preload {
+public:
+    WebViewPreload(HWND hWnd, std::wstring url) : hWnd(hWnd), url(std::move(url)), self(std::make_shared<WebViewPreload*>(this)) {}
+    ~WebViewPreload() override {
+        self.reset();
+        if (tab.controller) tab.controller->Close();
+    }
+
+    void Start() {
+        std::weak_ptr<WebViewPreload*> alive = self;
+        tabPool->Claim([alive](std::unique_ptr<TabHost> host) {
+            auto preload = alive.lock();
+            if (preload && host) (*preload)->Attach(*static_cast<WebViewTabHost*>(host.get()));
+        }); // cancelled meanwhile: the host closes here
+    }
+
+    BrowserTab tab; // the hidden view, once the pool hands one over
+    std::shared_ptr<TabHandle> owner;
+    bool loaded = false;
+
+private:
+    void Attach(WebViewTabHost& host) {
+        tab.controller = std::move(host.controller);
+        tab.webview = std::move(host.webview);
+        tab.url = url;
+        owner = host.owner;
+        ApplyRequestFilters(tab);
+        tab.controller->put_Bounds(TabViewBounds(hWnd)); // laid out at the size it will be shown
+        tab.webview->Navigate(url.c_str());
     }
-}
\ No newline at end of file
+
+    HWND hWnd;
+    std::wstring url;
+    std::shared_ptr<WebViewPreload*> self; // claims completing after the preload is gone see it expired
+};
+
+class WebViewPreloadBackend : public PreloadBackend {
+public:
+    explicit WebViewPreloadBackend(HWND hWnd) : hWnd(hWnd) {}
+
+    std::unique_ptr<Preload> Start(const std::wstring& url) override {
+        auto preload = std::make_unique<WebViewPreload>(hWnd, url);
+        preload->Start();
+        return preload;
+    }
+
+private:
+    HWND hWnd;
+};
+std::unique_ptr<WebViewPreloadBackend> preloadBackend;
+
+void CreateSpeculation(HWND hWnd) {
+    preloadBackend = std::make_unique<WebViewPreloadBackend>(hWnd);
+    speculation = std::make_unique<SpeculationEngine>(*preloadBackend, SpeculationEngine::Config());
+}
+
+WebViewPreload* CurrentPreload() {
+    return speculation ? static_cast<WebViewPreload*>(speculation->Current()) : nullptr;
+}
+
+void Speculate(const wchar_t* typed) {
+    if (speculation) speculation->Input(typed, suggestions, NowMs());
+}
+
+void CancelSpeculation() {
+    if (speculation) speculation->Cancel();
+}
+
+void ApplyPreloadFilters() {
+    if (WebViewPreload* preload = CurrentPreload()) ApplyRequestFilters(preload->tab);
+}
+
+void PreloadLoaded(ICoreWebView2* webview) {
+    WebViewPreload* preload = CurrentPreload();
+    if (!preload || preload->tab.webview.get() != webview) return;
+    preload->loaded = true;
+    speculation->Loaded(preload, NowMs());
+}
+
+// False when nothing was preloaded for `url`, or its view has not arrived from the pool yet
+bool ShowPreloaded(HWND hWnd, const std::wstring& url) {
+    if (!speculation) return false;
+    std::unique_ptr<Preload> taken = speculation->Take(url, NowMs());
+    WebViewPreload* preload = static_cast<WebViewPreload*>(taken.get());
+    BrowserTab* tab = tabs.Get(activeTab);
+    if (!preload || !preload->tab.webview || !tab || !tab->webview) return false;
+    if (tab->controller) tab->controller->Close();
+    tab->controller = std::move(preload->tab.controller);
+    tab->webview = std::move(preload->tab.webview);
+    tab->requestContexts = preload->tab.requestContexts;
+    *preload->owner = activeTab;
+    ApplyRequestFilters(*tab);
+
+    // What the tab's handlers skipped while it was hidden
+    wil::unique_cotaskmem_string source, title;
+    tab->webview->get_Source(&source);
+    tab->webview->get_DocumentTitle(&title);
+    if (source) {
+        tab->url = source.get();
+        RecordVisit(source.get());
+        if (title && *title.get()) { tab->title = title.get(); RecordTitle(source.get(), title.get()); }
+    }
+    if (preload->loaded) IndexPageText(tab->webview.get());
+    MarkSessionDirty();
+
+    tab->controller->put_IsVisible(TRUE);
+    UpdateLayout(hWnd); SyncAddressBar(); RefreshChrome(hWnd);
+    tab->controller->MoveFocus(COREWEBVIEW2_MOVE_FOCUS_REASON_PROGRAMMATIC);
+    return true;
+}
+
+// --- TAB LIFECYCLE ---
+// Background tabs idle for a while are suspended; when the machine runs low on memory the least
+// recently used ones are discarded, closing their view but keeping URL, title and scroll
+// position. A discarded tab reloads when it is next activated. The policy keys tabs by
+// TabHandle::Key().
+const UINT TAB_LIFECYCLE_TICK_MS = 30 * 1000;
+
+int64_t NowMs() { return (int64_t)GetTickCount64(); }
+
+class WebViewLifecycleBackend : public TabLifecycleBackend {
+public:
+    bool Suspend(uint64_t key) override {
+        BrowserTab* tab = tabs.Get(TabHandle::FromKey(key));
+        wil::com_ptr<ICoreWebView2_3> wv3;
+        if (!tab || !tab->webview || tab->webview->QueryInterface(IID_PPV_ARGS(&wv3)) != S_OK) return false;
+        return wv3->TrySuspend(Callback<ICoreWebView2TrySuspendCompletedHandler>(
+            [key](HRESULT res, BOOL suspended) -> HRESULT {
+                if (!suspended && tabLifecycle) tabLifecycle->SuspendRefused(key, NowMs());
+                return S_OK;
+            }).Get()) == S_OK;
+    }
+
+    void Discard(uint64_t key) override {
+        TabHandle handle = TabHandle::FromKey(key);
+        BrowserTab* tab = tabs.Get(handle);
+        if (!tab || !tab->controller) return;
+        requestScheduler.ViewClosed(key, NowMs());
+        CompleteReleasedRequests();
+        tab->savedScroll = {};
+        // The view leaves the tab now and is closed once its scroll position has been read
+        wil::com_ptr<ICoreWebView2Controller> controller = std::move(tab->controller);
+        wil::com_ptr<ICoreWebView2> webview = std::move(tab->webview);
+        wil::com_ptr<ICoreWebView2_3> wv3;
+        if (webview->QueryInterface(IID_PPV_ARGS(&wv3)) == S_OK) wv3->Resume(); // a suspended page would not answer
+        HRESULT hr = webview->ExecuteScript(L"[Math.round(window.scrollX), Math.round(window.scrollY)]",
+            Callback<ICoreWebView2ExecuteScriptCompletedHandler>(
+                [handle, controller](HRESULT res, LPCWSTR json) -> HRESULT {
+                    BrowserTab* tab = tabs.Get(handle);
+                    LONG x, y;
+                    if (SUCCEEDED(res) && json && tab && !tab->controller && swscanf_s(json, L"[%ld,%ld]", &x, &y) == 2)
+                        tab->savedScroll = { x, y };
+                    controller->Close();
+                    return S_OK;
+                }).Get());
+        if (FAILED(hr)) controller->Close();
+    }
+
+    uint64_t AvailableMemory() override {
+        MEMORYSTATUSEX status = { sizeof(status) };
+        return GlobalMemoryStatusEx(&status) ? status.ullAvailPhys : UINT64_MAX;
+    }
+};
+
+void CreateTabLifecycle(HWND hWnd) {
+    lifecycleBackend = std::make_unique<WebViewLifecycleBackend>();
+    tabLifecycle = std::make_unique<TabLifecyclePolicy>(*lifecycleBackend, TabLifecyclePolicy::Config());
+    SetTimer(hWnd, IDT_TAB_LIFECYCLE, TAB_LIFECYCLE_TICK_MS, NULL);
+}
+
+void RestoreTab(HWND hWnd, TabHandle handle) {
+    tabPool->Claim([hWnd, handle](std::unique_ptr<TabHost> host) {
+        BrowserTab* tab = tabs.Get(handle);
+        if (!host || !tab || tab->controller) return;
+        if (tabLifecycle->State(handle.Key()) == TAB_DISCARDED) return; // left and discarded again before a view came
+        WebViewTabHost* view = static_cast<WebViewTabHost*>(host.get());
+        tab->controller = std::move(view->controller);
+        tab->webview = std::move(view->webview);
+        tab->requestContexts = 0; // a fresh view filters on nothing yet
+        ApplyRequestFilters(*tab, handle != activeTab);
+        *view->owner = handle;
+        POINT scroll = tab->savedScroll;
+        if (scroll.x || scroll.y) {
+            auto token = std::make_shared<EventRegistrationToken>();
+            tab->webview->add_NavigationCompleted(Callback<ICoreWebView2NavigationCompletedEventHandler>(
+                [scroll, token](ICoreWebView2* sender, ICoreWebView2NavigationCompletedEventArgs* args) -> HRESULT {
+                    std::wstring script = L"window.scrollTo(" + std::to_wstring(scroll.x) + L", " + std::to_wstring(scroll.y) + L")";
+                    sender->ExecuteScript(script.c_str(), nullptr);
+                    sender->remove_NavigationCompleted(*token);
+                    return S_OK;
+                }).Get(), token.get());
+        }
+        tab->webview->Navigate(tab->url.empty() ? NEW_TAB_URL : tab->url.c_str());
+        if (handle == activeTab) SwitchToTab(handle, hWnd); // shows, sizes and focuses the new view
+    });
+}
+
+// --- SESSION ---
+// The tab list is snapshotted every few seconds while it is dirty. On startup every saved tab
+// comes back as a discarded placeholder: only the active one loads, the rest when first shown.
+const UINT SESSION_SNAPSHOT_MS = 5 * 1000;
+
+void MarkSessionDirty() {
+    if (sessionStore) sessionStore->MarkDirty();
+}
+
+void SaveSession() {
+    Session session;
+    for (size_t i = 0; i < tabs.Size(); i++) {
+        TabHandle handle = tabs.At(i);
+        const BrowserTab* tab = tabs.Get(handle);
+        session.tabs.push_back({ tab->url, tab->title });
+        if (handle == activeTab) session.active = i;
+    }
+    sessionStore->Save(session);
+}
+
+// Runs on a startup worker; RestoreSession hands the store to the UI thread
+void LoadSession() {
+    loadedSessionStore = std::make_unique<SessionStore>(L"session.dat");
+    if (!loadedSessionStore->Load(loadedSession)) loadedSession = Session();
+}
+
+void RestoreSession(HWND hWnd) {
+    sessionStore = std::move(loadedSessionStore);
+    SetTimer(hWnd, IDT_SESSION_SNAPSHOT, SESSION_SNAPSHOT_MS, NULL);
+    Session session = std::move(loadedSession);
+    if (session.tabs.empty()) { CreateNewTab(hWnd); return; }
+    TabHandle active;
+    for (size_t i = 0; i < session.tabs.size(); i++) {
+        BrowserTab placeholder;
+        placeholder.url = session.tabs[i].url;
+        if (!session.tabs[i].title.empty()) placeholder.title = session.tabs[i].title;
+        TabHandle handle = tabs.Open(std::move(placeholder));
+        tabLifecycle->Add(handle.Key(), NowMs(), TAB_DISCARDED);
+        requestScheduler.Add(handle.Key());
+        if (i == session.active) active = handle;
+    }
+    tabStrip.SetCount(tabs.Size());
+    SwitchToTab(active, hWnd);
+}
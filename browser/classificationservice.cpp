@@ -0,0 +1,100 @@
+#include "classificationservice.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+
+// Requests a worker takes per wake-up: enough to amortize the lock over a page's burst of
+// subresources, few enough that the other workers get a share of it
+static const size_t WORKER_BATCH = 16;
+
+ClassificationService::ClassificationService(RequestClassifier& classifier, unsigned workers, std::function<void()> ready)
+    : classifier(classifier), ready(std::move(ready)) {
+    for (unsigned i = 0; i < (std::max)(1u, workers); i++) this->workers.emplace_back([this] { Run(); });
+}
+
+ClassificationService::~ClassificationService() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& w : workers) w.join();
+}
+
+unsigned ClassificationService::DefaultWorkers() {
+    unsigned cores = std::thread::hardware_concurrency();
+    return (std::max)(1u, (std::min)(4u, cores / 2));
+}
+
+bool ClassificationService::Submit(ClassifyRequest request, bool& blocked) {
+    if (classifier.Cached(request.url, request.source, request.type, blocked)) {
+        decidedInline.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    bool wasEmpty;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        wasEmpty = queue.empty();
+        queue.push_back(std::move(request));
+        stats.deferred++;
+        stats.maxQueued = (std::max)(stats.maxQueued, queue.size());
+    }
+    // A worker that leaves requests behind wakes the next, so only the first of a burst signals
+    if (wasEmpty) wake.notify_one();
+    return false;
+}
+
+size_t ClassificationService::Drain(std::vector<ClassifyResult>& out) {
+    std::lock_guard<std::mutex> guard(lock);
+    size_t n = results.size();
+    if (out.empty()) out.swap(results);
+    else {
+        std::move(results.begin(), results.end(), std::back_inserter(out));
+        results.clear();
+    }
+    notified = false;
+    return n;
+}
+
+ClassificationService::Stats ClassificationService::GetStats() {
+    std::lock_guard<std::mutex> guard(lock);
+    Stats s = stats;
+    s.queued = queue.size();
+    s.decidedInline = decidedInline.load(std::memory_order_relaxed);
+    return s;
+}
+
+void ClassificationService::Run() {
+    std::vector<ClassifyRequest> batch;
+    std::vector<ClassifyResult> decided;
+    std::unique_lock<std::mutex> guard(lock);
+    while (true) {
+        wake.wait(guard, [this] { return stopping || !queue.empty(); });
+        if (stopping) return;
+        size_t take = (std::min)(queue.size(), WORKER_BATCH);
+        batch.assign(std::make_move_iterator(queue.begin()), std::make_move_iterator(queue.begin() + take));
+        queue.erase(queue.begin(), queue.begin() + take);
+        if (!queue.empty()) wake.notify_one();
+        guard.unlock();
+
+        decided.clear();
+        for (ClassifyRequest& request : batch) {
+            auto started = std::chrono::steady_clock::now();
+            bool blocked = classifier.Uncached(request.url, request.source, request.type);
+            uint64_t ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - started).count();
+            decided.push_back({ std::move(request), blocked, ns });
+        }
+
+        guard.lock();
+        std::move(decided.begin(), decided.end(), std::back_inserter(results));
+        stats.completed += decided.size();
+        bool notify = !notified;
+        notified = true;
+        if (notify) {
+            guard.unlock();
+            ready();
+            guard.lock();
+        }
+    }
+}
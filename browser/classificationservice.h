@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "requestclassifier.h"
+
+// A request its event source is holding open (in the browser, a deferred WebResourceRequested
+// event) until the decision comes back
+struct ClassifyRequest {
+    uint64_t id = 0;  // the event source's, to find the held request again
+    uint64_t tab = 0; // TabHandle::Key
+    uint32_t type = 0;
+    std::wstring url;
+    std::wstring source;
+};
+
+struct ClassifyResult {
+    ClassifyRequest request;
+    bool blocked = false;
+    uint64_t classifyNs = 0; // deciding only, not waiting in the queue
+};
+
+// Takes request classification off the thread that receives requests. Submit answers on the
+// spot when the classifier has the verdict cached, and otherwise queues the request for a pool
+// of workers. Decided requests collect until the receiving thread drains them; `ready` is
+// called from a worker once per batch, when results arrive and none were waiting, so in the
+// browser it posts one message rather than one per request.
+// Submit and Drain belong to the receiving thread; GetStats may be called from any.
+class ClassificationService {
+public:
+    ClassificationService(RequestClassifier& classifier, unsigned workers, std::function<void()> ready);
+    ~ClassificationService(); // queued requests are dropped undecided
+
+    ClassificationService(const ClassificationService&) = delete;
+    ClassificationService& operator=(const ClassificationService&) = delete;
+
+    // True if decided inline, with `blocked` set; otherwise the request is queued
+    bool Submit(ClassifyRequest request, bool& blocked);
+    // Appends every decided request to `out`; returns how many
+    size_t Drain(std::vector<ClassifyResult>& out);
+
+    struct Stats {
+        uint64_t decidedInline = 0;
+        uint64_t deferred = 0;
+        uint64_t completed = 0; // deferred requests decided so far
+        size_t queued = 0;      // waiting for a worker now
+        size_t maxQueued = 0;
+    };
+    Stats GetStats();
+
+    // Workers for this machine: enough to keep up with a page load, leaving cores for rendering
+    static unsigned DefaultWorkers();
+
+private:
+    void Run();
+
+    RequestClassifier& classifier;
+    std::function<void()> ready;
+
+    std::mutex lock;
+    std::condition_variable wake;
+    std::deque<ClassifyRequest> queue;
+    std::vector<ClassifyResult> results;
+    bool notified = false; // `ready` was called and Drain has not run since
+    bool stopping = false;
+    Stats stats; // but decidedInline, which Submit counts without the lock
+    std::atomic<uint64_t> decidedInline{ 0 };
+    std::vector<std::thread> workers;
+};
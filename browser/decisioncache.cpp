@@ -0,0 +1,77 @@
+#include "decisioncache.h"
+
+// Entry layout: [tag:40][generation:23][block:1]; 0 means empty.
+static const int GEN_BITS = 23;
+static const uint64_t GEN_MASK = (1ull << GEN_BITS) - 1;
+
+static uint64_t HashKey(std::wstring_view sourceHost, std::wstring_view host, uint32_t type) {
+    uint64_t h = 14695981039346656037ull;
+    auto mix = [&h](uint32_t c) { h ^= c; h *= 1099511628211ull; };
+    for (wchar_t c : sourceHost) mix((c >= L'A' && c <= L'Z') ? c - L'A' + L'a' : (uint32_t)c);
+    mix(0x10000);
+    for (wchar_t c : host) mix((c >= L'A' && c <= L'Z') ? c - L'A' + L'a' : (uint32_t)c);
+    mix(type | 0x20000);
+    return h ^ (h >> 31);
+}
+
+static uint64_t Tag(uint64_t hash) {
+    return (hash >> 24) | 1; // never 0, so a filled entry is never mistaken for an empty one
+}
+
+DecisionCache::DecisionCache(size_t entriesPerShard) {
+    size_t slots = 2;
+    while (slots < entriesPerShard) slots <<= 1;
+    slotMask = slots - 1;
+    for (Shard& s : shards) {
+        s.entries.reset(new std::atomic<uint64_t>[slots]);
+        for (size_t i = 0; i < slots; i++) s.entries[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+DecisionCache::Result DecisionCache::Lookup(std::wstring_view sourceHost, std::wstring_view host, uint32_t type, uint64_t generation) {
+    uint64_t hash = HashKey(sourceHost, host, type);
+    Shard& shard = shards[hash % SHARD_COUNT];
+    uint64_t tag = Tag(hash);
+    size_t slot = (size_t)(hash >> 4) & slotMask;
+    // Two-way set: the slot and its neighbour
+    for (size_t way = 0; way < 2; way++) {
+        uint64_t e = shard.entries[slot ^ way].load(std::memory_order_relaxed);
+        if ((e >> (GEN_BITS + 1)) == (tag & ((1ull << 40) - 1)) && ((e >> 1) & GEN_MASK) == (generation & GEN_MASK)) {
+            ThreadCounters().hits.fetch_add(1, std::memory_order_relaxed);
+            return (e & 1) ? BLOCK : ALLOW;
+        }
+    }
+    ThreadCounters().misses.fetch_add(1, std::memory_order_relaxed);
+    return MISS;
+}
+
+void DecisionCache::Store(std::wstring_view sourceHost, std::wstring_view host, uint32_t type, uint64_t generation, bool block) {
+    uint64_t hash = HashKey(sourceHost, host, type);
+    Shard& shard = shards[hash % SHARD_COUNT];
+    uint64_t entry = ((Tag(hash) & ((1ull << 40) - 1)) << (GEN_BITS + 1)) | ((generation & GEN_MASK) << 1) | (block ? 1 : 0);
+    size_t slot = (size_t)(hash >> 4) & slotMask;
+    // Prefer a way that is empty or from an older ruleset; otherwise pick one by hash.
+    size_t target = slot ^ ((hash >> 63) & 1);
+    for (size_t way = 0; way < 2; way++) {
+        uint64_t e = shard.entries[slot ^ way].load(std::memory_order_relaxed);
+        if (e == 0 || ((e >> 1) & GEN_MASK) != (generation & GEN_MASK)) { target = slot ^ way; break; }
+    }
+    shard.entries[target].store(entry, std::memory_order_relaxed);
+    ThreadCounters().stores.fetch_add(1, std::memory_order_relaxed);
+}
+
+DecisionCache::Counters& DecisionCache::ThreadCounters() {
+    static std::atomic<uint32_t> nextStripe{ 0 };
+    thread_local uint32_t stripe = nextStripe.fetch_add(1, std::memory_order_relaxed) % COUNTER_STRIPES;
+    return counters[stripe];
+}
+
+DecisionCache::Stats DecisionCache::GetStats() const {
+    Stats total;
+    for (const Counters& c : counters) {
+        total.hits += c.hits.load(std::memory_order_relaxed);
+        total.misses += c.misses.load(std::memory_order_relaxed);
+        total.stores += c.stores.load(std::memory_order_relaxed);
+    }
+    return total;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+// Bounded cache of allow/block verdicts keyed on (first-party host, request host, resource type),
+// for verdicts the filter engine reports as host-only. Each entry is one atomic word, so lookups
+// and stores never lock. Entries carry the ruleset generation and go stale when rules change.
+class DecisionCache {
+public:
+    explicit DecisionCache(size_t entriesPerShard = 4096);
+
+    enum Result { MISS = -1, ALLOW = 0, BLOCK = 1 };
+
+    Result Lookup(std::wstring_view sourceHost, std::wstring_view host, uint32_t type, uint64_t generation);
+    void Store(std::wstring_view sourceHost, std::wstring_view host, uint32_t type, uint64_t generation, bool block);
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t stores = 0;
+        double HitRate() const { return (hits + misses) ? (double)hits / (double)(hits + misses) : 0.0; }
+    };
+    Stats GetStats() const;
+
+private:
+    static const int SHARD_COUNT = 16;
+    static const int COUNTER_STRIPES = 16;
+
+    struct alignas(64) Shard {
+        std::unique_ptr<std::atomic<uint64_t>[]> entries;
+    };
+    // Counted per thread rather than per shard: each thread takes a stripe of its own on first
+    // use, so the counters never share a cache line with another thread's or with the entries
+    struct alignas(64) Counters {
+        std::atomic<uint64_t> hits{ 0 };
+        std::atomic<uint64_t> misses{ 0 };
+        std::atomic<uint64_t> stores{ 0 };
+    };
+    Counters& ThreadCounters();
+
+    Shard shards[SHARD_COUNT];
+    Counters counters[COUNTER_STRIPES];
+    size_t slotMask;
+};
@@ -0,0 +1,128 @@
+#include "displaylist.h"
+
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+
+bool DisplayCommand::operator==(const DisplayCommand& other) const {
+    return kind == other.kind && rect == other.rect && bounds == other.bounds && color == other.color &&
+        font == other.font && format == other.format && text == other.text;
+}
+
+void DisplayList::Clear() {
+    commands.clear();
+    clips.clear();
+}
+
+void DisplayList::PushClip(const DisplayRect& clip) {
+    clips.push_back(Clipped(clip));
+}
+
+void DisplayList::PopClip() {
+    if (!clips.empty()) clips.pop_back();
+}
+
+DisplayRect DisplayList::Clipped(const DisplayRect& rect) const {
+    if (clips.empty()) return rect;
+    const DisplayRect& clip = clips.back();
+    return { (std::max)(rect.left, clip.left), (std::max)(rect.top, clip.top),
+             (std::min)(rect.right, clip.right), (std::min)(rect.bottom, clip.bottom) };
+}
+
+void DisplayList::Fill(const DisplayRect& rect, uint32_t color) {
+    DisplayCommand c;
+    c.kind = DisplayCommand::FILL;
+    c.rect = rect;
+    c.bounds = Clipped(rect);
+    c.color = color;
+    if (!c.bounds.Empty()) commands.push_back(std::move(c));
+}
+
+void DisplayList::Text(const DisplayRect& rect, std::wstring text, int font, uint32_t color, uint32_t format) {
+    DisplayCommand c;
+    c.kind = DisplayCommand::TEXT;
+    c.rect = rect;
+    c.bounds = Clipped(rect);
+    c.color = color;
+    c.font = font;
+    c.format = format;
+    c.text = std::move(text);
+    if (!c.bounds.Empty() && !c.text.empty()) commands.push_back(std::move(c));
+}
+
+void DisplayList::Replay(DisplayBackend& backend, const DisplayRect& area) const {
+    for (const DisplayCommand& c : commands) {
+        if (!c.bounds.Intersects(area)) continue;
+        if (c.kind == DisplayCommand::FILL) backend.Fill(c);
+        else backend.Text(c);
+    }
+}
+
+// --- FRAME DIFF ---
+// Commands both frames share, in the same relative order, paint the same pixels wherever no other
+// command reaches. So only the bounds of the rest need repainting. The shared commands are found
+// by trimming the common prefix and suffix, then matching the middle greedily in order; this
+// misses some matches after a reordering, which costs repainting, never a stale pixel.
+namespace {
+size_t Hash(const DisplayCommand& c) {
+    size_t h = std::hash<std::wstring>()(c.text);
+    for (int v : { (int)c.kind, c.rect.left, c.rect.top, c.rect.right, c.rect.bottom, c.bounds.left, c.bounds.top,
+                   c.bounds.right, c.bounds.bottom, (int)c.color, c.font, (int)c.format })
+        h ^= (size_t)(unsigned)v + 0x9e3779b9 + (h << 6) + (h >> 2);
+    return h;
+}
+
+DisplayRect Union(const DisplayRect& a, const DisplayRect& b) {
+    return { (std::min)(a.left, b.left), (std::min)(a.top, b.top), (std::max)(a.right, b.right), (std::max)(a.bottom, b.bottom) };
+}
+
+// Merges until no two overlap
+void MergeRects(std::vector<DisplayRect>& rects) {
+    for (size_t i = 0; i < rects.size();) {
+        bool merged = false;
+        for (size_t j = i + 1; j < rects.size(); j++) {
+            if (!rects[i].Intersects(rects[j])) continue;
+            rects[i] = Union(rects[i], rects[j]);
+            rects.erase(rects.begin() + j);
+            merged = true;
+            break;
+        }
+        if (!merged) i++;
+        else i = 0; // the grown rect may now reach ones already passed
+    }
+}
+}
+
+std::vector<DisplayRect> DiffDisplayLists(const DisplayList& before, const DisplayList& after) {
+    const std::vector<DisplayCommand>& a = before.Commands();
+    const std::vector<DisplayCommand>& b = after.Commands();
+    size_t head = 0;
+    while (head < a.size() && head < b.size() && a[head] == b[head]) head++;
+    size_t aEnd = a.size(), bEnd = b.size();
+    while (aEnd > head && bEnd > head && a[aEnd - 1] == b[bEnd - 1]) { aEnd--; bEnd--; }
+
+    std::unordered_map<size_t, std::vector<size_t>> byHash; // indices into a, ascending
+    for (size_t i = head; i < aEnd; i++) byHash[Hash(a[i])].push_back(i);
+    std::vector<bool> aMatched(aEnd - head, false);
+    std::vector<DisplayRect> dirty;
+    size_t next = head; // matches must keep increasing
+    for (size_t j = head; j < bEnd; j++) {
+        bool matched = false;
+        auto found = byHash.find(Hash(b[j]));
+        if (found != byHash.end()) {
+            const std::vector<size_t>& at = found->second;
+            for (auto it = std::lower_bound(at.begin(), at.end(), next); it != at.end(); ++it) {
+                if (a[*it] != b[j]) continue;
+                aMatched[*it - head] = true;
+                next = *it + 1;
+                matched = true;
+                break;
+            }
+        }
+        if (!matched) dirty.push_back(b[j].bounds);
+    }
+    for (size_t i = head; i < aEnd; i++)
+        if (!aMatched[i - head]) dirty.push_back(a[i].bounds);
+    MergeRects(dirty);
+    return dirty;
+}
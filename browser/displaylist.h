@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Client-area rectangle, right and bottom exclusive, like a Win32 RECT
+struct DisplayRect {
+    int left = 0, top = 0, right = 0, bottom = 0;
+
+    bool Empty() const { return left >= right || top >= bottom; }
+    bool Intersects(const DisplayRect& other) const {
+        return left < other.right && other.left < right && top < other.bottom && other.top < bottom;
+    }
+    bool operator==(const DisplayRect& other) const {
+        return left == other.left && top == other.top && right == other.right && bottom == other.bottom;
+    }
+    bool operator!=(const DisplayRect& other) const { return !(*this == other); }
+};
+
+struct DisplayCommand {
+    enum Kind { FILL, TEXT };
+
+    Kind kind = FILL;
+    DisplayRect rect;   // the area filled, or the box text is laid out in
+    DisplayRect bounds; // `rect` cut to the clip in force: all the command can touch
+    uint32_t color = 0; // COLORREF
+    int font = 0;       // TEXT: which of the caller's fonts
+    uint32_t format = 0; // TEXT: DrawText flags
+    std::wstring text;
+
+    bool operator==(const DisplayCommand& other) const;
+    bool operator!=(const DisplayCommand& other) const { return !(*this == other); }
+};
+
+// Executes commands. The Windows build draws them with GDI; RecordingDisplayBackend keeps them.
+class DisplayBackend {
+public:
+    virtual ~DisplayBackend() = default;
+    virtual void Fill(const DisplayCommand& command) = 0; // fills command.bounds
+    virtual void Text(const DisplayCommand& command) = 0; // lays out in rect, draws only within bounds
+};
+
+// A frame of the browser chrome as a list of fills and text runs, in painting order. The UI
+// builds a fresh one whenever something it shows changes, diffs it against the last one to find
+// what to repaint, and replays it when painting.
+class DisplayList {
+public:
+    void Clear();
+
+    // Clips the commands that follow, on top of any clip already in force
+    void PushClip(const DisplayRect& clip);
+    void PopClip();
+
+    void Fill(const DisplayRect& rect, uint32_t color);
+    void Text(const DisplayRect& rect, std::wstring text, int font, uint32_t color, uint32_t format);
+
+    const std::vector<DisplayCommand>& Commands() const { return commands; }
+    // Runs, in order, every command that can touch `area`
+    void Replay(DisplayBackend& backend, const DisplayRect& area) const;
+
+private:
+    DisplayRect Clipped(const DisplayRect& rect) const;
+
+    std::vector<DisplayCommand> commands;
+    std::vector<DisplayRect> clips;
+};
+
+// Areas where painting `after` could give different pixels from painting `before`: the bounds
+// of every command not common to both, in order. Overlapping areas are merged.
+std::vector<DisplayRect> DiffDisplayLists(const DisplayList& before, const DisplayList& after);
+
+// Keeps what it is asked to draw, for checking frames without a screen
+class RecordingDisplayBackend : public DisplayBackend {
+public:
+    void Fill(const DisplayCommand& command) override { fills++; drawn.push_back(command); }
+    void Text(const DisplayCommand& command) override { texts++; drawn.push_back(command); }
+
+    size_t fills = 0;
+    size_t texts = 0;
+    std::vector<DisplayCommand> drawn;
+};
@@ -0,0 +1,667 @@
+#include "filterlist.h"
+#include "psl.h"
+#include "url.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <queue>
+#include <sstream>
+#include <unordered_map>
+
+// --- CHARACTER HELPERS ---
+static uint32_t Fold(uint32_t c) {
+    return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+}
+
+static bool IsTokenChar(uint32_t c) {
+    c = Fold(c);
+    return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '%';
+}
+
+// '^' in a filter: anything but a letter, digit, or one of _ - . %
+static bool IsSeparator(uint32_t c) {
+    return !(IsTokenChar(c) || c == '_' || c == '-' || c == '.');
+}
+
+static const uint64_t FNV_OFFSET = 14695981039346656037ull;
+static const uint64_t FNV_PRIME = 1099511628211ull;
+
+template <typename CharT>
+static uint64_t HashFolded(std::basic_string_view<CharT> s) {
+    uint64_t h = FNV_OFFSET;
+    for (CharT c : s) { h ^= Fold((uint32_t)(std::make_unsigned_t<CharT>)c); h *= FNV_PRIME; }
+    return h;
+}
+
+// Calls fn(labelHash) for each host label, right to left ("com", "example", "ads").
+template <typename CharT, typename Fn>
+static void ForEachLabelReversed(std::basic_string_view<CharT> host, Fn fn) {
+    size_t end = host.size();
+    while (end > 0) {
+        size_t dot = host.rfind((CharT)'.', end - 1);
+        size_t begin = (dot == std::basic_string_view<CharT>::npos) ? 0 : dot + 1;
+        if (!fn(HashFolded(host.substr(begin, end - begin)))) return;
+        if (begin == 0) return;
+        end = begin - 1;
+    }
+}
+
+// --- PATTERN MATCHING ---
+// Matches a '*'-free segment at url[pos]; '^' may match the end of the address.
+static bool SegmentAt(std::string_view seg, std::wstring_view url, size_t pos, size_t& end) {
+    for (char p : seg) {
+        if (p == '^') {
+            if (pos == url.size()) continue;
+            if (!IsSeparator((uint32_t)url[pos])) return false;
+        }
+        else if (pos >= url.size() || Fold((uint32_t)url[pos]) != (uint32_t)(unsigned char)p) return false;
+        pos++;
+    }
+    end = pos;
+    return true;
+}
+
+static bool MatchFrom(std::string_view pat, std::wstring_view url, size_t pos, bool endAnchor) {
+    size_t star = pat.find('*');
+    size_t end = 0;
+    if (!SegmentAt(pat.substr(0, star), url, pos, end)) return false;
+    if (star == std::string_view::npos) return !endAnchor || end == url.size();
+    pos = end;
+    pat.remove_prefix(star + 1);
+    while (true) {
+        star = pat.find('*');
+        std::string_view seg = pat.substr(0, star);
+        bool last = (star == std::string_view::npos);
+        // Leftmost match is always safe for intermediate segments; an anchored tail must end the URL.
+        bool found = false;
+        for (size_t p = pos; p <= url.size(); p++) {
+            if (SegmentAt(seg, url, p, end) && (!last || !endAnchor || end == url.size())) { found = true; break; }
+        }
+        if (!found) return false;
+        if (last) return true;
+        pos = end;
+        pat.remove_prefix(star + 1);
+    }
+}
+
+static bool MatchPattern(std::string_view pat, uint16_t flags, const FilterRequest& req) {
+    bool endAnchor = (flags & FR_END_ANCHOR) != 0;
+    if (flags & FR_START_ANCHOR) return MatchFrom(pat, req.url, 0, endAnchor);
+    if (flags & FR_HOST_ANCHOR) {
+        size_t hostStart = req.host.data() - req.url.data();
+        if (MatchFrom(pat, req.url, hostStart, endAnchor)) return true;
+        for (size_t i = 0; i < req.host.size(); i++) {
+            if (req.host[i] == L'.' && MatchFrom(pat, req.url, hostStart + i + 1, endAnchor)) return true;
+        }
+        return false;
+    }
+    if (pat.empty()) return true;
+    char first = pat[0];
+    for (size_t p = 0; p < req.url.size(); p++) {
+        if (first != '^' && first != '*' && Fold((uint32_t)req.url[p]) != (uint32_t)(unsigned char)first) continue;
+        if (MatchFrom(pat, req.url, p, endAnchor)) return true;
+    }
+    return false;
+}
+
+// --- FILTER SET ---
+namespace {
+struct MatchContext {
+    const FilterTables& t;
+    const FilterRequest& req;
+    uint64_t sourceSuffixes[16];
+    int sourceSuffixCount = 0;
+
+    MatchContext(const FilterTables& tables, const FilterRequest& r) : t(tables), req(r) {
+        // Hashes of "a.example.com", "example.com", "com" for $domain= checks
+        std::wstring_view h = r.sourceHost;
+        while (!h.empty() && sourceSuffixCount < 16) {
+            sourceSuffixes[sourceSuffixCount++] = HashFolded(h);
+            size_t dot = h.find(L'.');
+            if (dot == std::wstring_view::npos) break;
+            h.remove_prefix(dot + 1);
+        }
+    }
+
+    // Type, party and $domain= conditions
+    bool RuleApplies(const FilterRule& rule) const {
+        if (!(rule.typeMask & req.type)) return false;
+        if ((rule.flags & FR_THIRD_PARTY) && !req.thirdParty) return false;
+        if ((rule.flags & FR_FIRST_PARTY) && req.thirdParty) return false;
+        if (rule.domainCount) {
+            bool hasInclude = false, included = false;
+            for (uint32_t i = 0; i < rule.domainCount; i++) {
+                const FilterDomain& d = t.domains[rule.domainBegin + i];
+                bool hit = std::find(sourceSuffixes, sourceSuffixes + sourceSuffixCount, d.hash) != sourceSuffixes + sourceSuffixCount;
+                if (d.exclude) { if (hit) return false; }
+                else { hasInclude = true; included |= hit; }
+            }
+            if (hasInclude && !included) return false;
+        }
+        return true;
+    }
+
+    bool RuleMatches(uint32_t ruleId) const {
+        const FilterRule& rule = t.rules[ruleId];
+        return RuleApplies(rule) &&
+            MatchPattern(std::string_view(t.strings + rule.patternOffset, rule.patternLength), rule.flags, req);
+    }
+
+    bool AnyRef(uint32_t begin, uint32_t count) const {
+        for (uint32_t i = 0; i < count; i++) if (RuleMatches(t.refs[begin + i])) return true;
+        return false;
+    }
+
+    // hostOnly: the hit came from a rule that only looks at the host.
+    // pathDependent: some applicable rule on the host path looks at more than the host.
+    bool HostRefs(uint32_t begin, uint32_t count, bool& hostOnly, bool& pathDependent) const {
+        for (uint32_t i = 0; i < count; i++) {
+            const FilterRule& rule = t.rules[t.refs[begin + i]];
+            if (!RuleApplies(rule)) continue;
+            // The trie walk already proved the host suffix matches.
+            if (rule.flags & FR_HOST_ONLY) { hostOnly = true; return true; }
+            pathDependent = true;
+            if (MatchPattern(std::string_view(t.strings + rule.patternOffset, rule.patternLength), rule.flags, req)) return true;
+        }
+        return false;
+    }
+
+    // Whether a token/generic rule could apply to some URL of this host, from this source and type
+    bool PathRulesMayApply(const FilterIndex& index) const {
+        if (index.pathTypes & req.type) return true;
+        const FilterSiteTypes* first = t.sites + index.siteBegin;
+        const FilterSiteTypes* last = first + index.siteCount;
+        for (int i = 0; i < sourceSuffixCount; i++) {
+            const FilterSiteTypes* s = std::lower_bound(first, last, sourceSuffixes[i],
+                [](const FilterSiteTypes& a, uint64_t h) { return a.hash < h; });
+            if (s != last && s->hash == sourceSuffixes[i] && (s->typeMask & req.type)) return true;
+        }
+        return false;
+    }
+
+    bool IndexMatches(const FilterIndex& index, bool& hostOnly, bool& pathDependent) const {
+        // 1. Rules anchored on the request host or one of its parent domains
+        bool hit = false;
+        uint32_t node = index.hostRoot;
+        ForEachLabelReversed(req.host, [&](uint64_t label) {
+            const FilterHostNode& n = t.nodes[node];
+            const FilterHostNode* first = t.nodes + n.childBegin;
+            const FilterHostNode* last = first + n.childCount;
+            const FilterHostNode* child = std::lower_bound(first, last, label,
+                [](const FilterHostNode& a, uint64_t h) { return a.labelHash < h; });
+            if (child == last || child->labelHash != label) return false;
+            node = (uint32_t)(child - t.nodes);
+            hit = HostRefs(child->refBegin, child->refCount, hostOnly, pathDependent);
+            return !hit;
+        });
+        if (hit) return true;
+        hostOnly = false;
+        if (!pathDependent && PathRulesMayApply(index)) pathDependent = true;
+
+        // 2. Rules keyed by a token that occurs in the URL
+        if (index.tokenCount) {
+            const FilterTokenBucket* first = t.tokens + index.tokenBegin;
+            const FilterTokenBucket* last = first + index.tokenCount;
+            std::wstring_view url = req.url;
+            size_t i = 0;
+            while (i < url.size()) {
+                if (!IsTokenChar((uint32_t)url[i])) { i++; continue; }
+                size_t start = i;
+                while (i < url.size() && IsTokenChar((uint32_t)url[i])) i++;
+                uint64_t h = HashFolded(url.substr(start, i - start));
+                const FilterTokenBucket* b = std::lower_bound(first, last, h,
+                    [](const FilterTokenBucket& a, uint64_t v) { return a.hash < v; });
+                if (b != last && b->hash == h && AnyRef(b->refBegin, b->refCount)) return true;
+            }
+        }
+
+        // 3. Rules with nothing to index on
+        return AnyRef(index.genericBegin, index.genericCount);
+    }
+};
+}
+
+FilterSet::Decision FilterSet::Classify(const FilterRequest& req) const {
+    if (tables.ruleCount == 0 || req.url.empty()) return { false, false };
+    MatchContext ctx(tables, req);
+    bool blockHostOnly = false, blockPath = false;
+    if (!ctx.IndexMatches(tables.block, blockHostOnly, blockPath)) return { false, false };
+    bool allowHostOnly = false, allowPath = false;
+    if (ctx.IndexMatches(tables.allow, allowHostOnly, allowPath)) return { false, allowHostOnly };
+    // Blocked for every path only if no exception could match some other path.
+    return { true, blockHostOnly && !allowPath };
+}
+
+uint32_t FilterSet::BlockableTypes() const {
+    const FilterTables& t = tables;
+    const FilterIndex& index = t.block;
+    if (t.ruleCount == 0 || t.nodeCount == 0) return 0;
+    uint32_t types = 0;
+    auto addRefs = [&](uint32_t begin, uint32_t count) {
+        for (uint32_t i = 0; i < count; i++) types |= t.rules[t.refs[begin + i]].typeMask;
+    };
+    std::vector<uint32_t> pending = { index.hostRoot };
+    while (!pending.empty()) {
+        const FilterHostNode& n = t.nodes[pending.back()];
+        pending.pop_back();
+        addRefs(n.refBegin, n.refCount);
+        for (uint32_t c = 0; c < n.childCount; c++) pending.push_back(n.childBegin + c);
+    }
+    for (uint32_t i = 0; i < index.tokenCount; i++) addRefs(t.tokens[index.tokenBegin + i].refBegin, t.tokens[index.tokenBegin + i].refCount);
+    addRefs(index.genericBegin, index.genericCount);
+    return types;
+}
+
+// --- SNAPSHOT ---
+namespace {
+const char SNAPSHOT_MAGIC[8] = { 'S', 'A', 'R', 'F', 'F', 'L', 'T', 'R' };
+const uint32_t SNAPSHOT_VERSION = 4;
+
+enum { SEC_RULES, SEC_STRINGS, SEC_DOMAINS, SEC_REFS, SEC_NODES, SEC_TOKENS, SEC_SITES, SEC_COUNT };
+
+struct SnapshotSection {
+    uint64_t offset, count;
+};
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t sourceStamp;
+    uint64_t fileSize;
+    uint64_t checksum; // of everything after the header
+    FilterIndex block, allow;
+    SnapshotSection sections[SEC_COUNT];
+};
+
+const size_t SECTION_ELEMENT_SIZE[SEC_COUNT] = {
+    sizeof(FilterRule), 1, sizeof(FilterDomain), sizeof(uint32_t), sizeof(FilterHostNode), sizeof(FilterTokenBucket),
+    sizeof(FilterSiteTypes)
+};
+
+uint64_t Checksum(const uint8_t* p, size_t n) {
+    uint64_t h = FNV_OFFSET ^ n;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t w;
+        memcpy(&w, p + i, 8);
+        h = (h ^ w) * FNV_PRIME;
+        h ^= h >> 29;
+    }
+    for (; i < n; i++) h = (h ^ p[i]) * FNV_PRIME;
+    return h;
+}
+
+bool IndexInRange(const FilterIndex& index, const FilterTables& t) {
+    return index.hostRoot < t.nodeCount &&
+        (uint64_t)index.tokenBegin + index.tokenCount <= t.tokenCount &&
+        (uint64_t)index.genericBegin + index.genericCount <= t.refCount &&
+        (uint64_t)index.siteBegin + index.siteCount <= t.siteCount;
+}
+}
+
+bool FilterSet::SaveSnapshot(const std::filesystem::path& path, uint64_t sourceStamp) const {
+    const void* data[SEC_COUNT] = { tables.rules, tables.strings, tables.domains, tables.refs, tables.nodes, tables.tokens, tables.sites };
+    uint64_t counts[SEC_COUNT] = { tables.ruleCount, tables.stringBytes, tables.domainCount, tables.refCount, tables.nodeCount,
+                                   tables.tokenCount, tables.siteCount };
+
+    SnapshotHeader header = {};
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.headerSize = sizeof(SnapshotHeader);
+    header.sourceStamp = sourceStamp;
+    header.block = tables.block;
+    header.allow = tables.allow;
+
+    std::vector<uint8_t> image(sizeof(SnapshotHeader));
+    for (int s = 0; s < SEC_COUNT; s++) {
+        image.resize((image.size() + 7) & ~(size_t)7, 0);
+        header.sections[s] = { image.size(), counts[s] };
+        const uint8_t* bytes = (const uint8_t*)data[s];
+        if (counts[s]) image.insert(image.end(), bytes, bytes + counts[s] * SECTION_ELEMENT_SIZE[s]);
+    }
+    header.fileSize = image.size();
+    header.checksum = Checksum(image.data() + sizeof(SnapshotHeader), image.size() - sizeof(SnapshotHeader));
+    memcpy(image.data(), &header, sizeof(header));
+
+    // Write beside the target and rename so a reader never maps a half-written file.
+    std::filesystem::path tmp = path;
+    tmp += L".tmp";
+    {
+        std::ofstream file(tmp, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) return false;
+        file.write((const char*)image.data(), (std::streamsize)image.size());
+        if (!file.good()) return false;
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp, path, ec);
+    return !ec;
+}
+
+bool FilterSet::LoadSnapshot(const std::filesystem::path& path, uint64_t& sourceStamp) {
+    auto file = std::make_unique<MappedFile>();
+    if (!file->Open(path) || file->Size() < sizeof(SnapshotHeader)) return false;
+    const uint8_t* base = file->Data();
+    SnapshotHeader header;
+    memcpy(&header, base, sizeof(header));
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 || header.version != SNAPSHOT_VERSION ||
+        header.headerSize != sizeof(SnapshotHeader) || header.fileSize != file->Size()) return false;
+    for (int s = 0; s < SEC_COUNT; s++) {
+        const SnapshotSection& sec = header.sections[s];
+        if (sec.offset % 8 != 0 || sec.count > UINT32_MAX || sec.offset > file->Size() ||
+            sec.count * SECTION_ELEMENT_SIZE[s] > file->Size() - sec.offset) return false;
+    }
+    if (Checksum(base + sizeof(SnapshotHeader), file->Size() - sizeof(SnapshotHeader)) != header.checksum) return false;
+
+    FilterTables t;
+    t.rules = (const FilterRule*)(base + header.sections[SEC_RULES].offset);
+    t.ruleCount = (uint32_t)header.sections[SEC_RULES].count;
+    t.strings = (const char*)(base + header.sections[SEC_STRINGS].offset);
+    t.stringBytes = (uint32_t)header.sections[SEC_STRINGS].count;
+    t.domains = (const FilterDomain*)(base + header.sections[SEC_DOMAINS].offset);
+    t.domainCount = (uint32_t)header.sections[SEC_DOMAINS].count;
+    t.refs = (const uint32_t*)(base + header.sections[SEC_REFS].offset);
+    t.refCount = (uint32_t)header.sections[SEC_REFS].count;
+    t.nodes = (const FilterHostNode*)(base + header.sections[SEC_NODES].offset);
+    t.nodeCount = (uint32_t)header.sections[SEC_NODES].count;
+    t.tokens = (const FilterTokenBucket*)(base + header.sections[SEC_TOKENS].offset);
+    t.tokenCount = (uint32_t)header.sections[SEC_TOKENS].count;
+    t.sites = (const FilterSiteTypes*)(base + header.sections[SEC_SITES].offset);
+    t.siteCount = (uint32_t)header.sections[SEC_SITES].count;
+    t.block = header.block;
+    t.allow = header.allow;
+    if (!IndexInRange(t.block, t) || !IndexInRange(t.allow, t)) return false;
+
+    *this = FilterSet();
+    tables = t;
+    mapped = std::move(file);
+    sourceStamp = header.sourceStamp;
+    return true;
+}
+
+// --- PARSER ---
+static std::string_view Trim(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t' || s.front() == '\r' || s.front() == '\n')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r' || s.back() == '\n')) s.remove_suffix(1);
+    return s;
+}
+
+static uint32_t TypeFromOption(std::string_view name) {
+    static const std::pair<const char*, uint32_t> names[] = {
+        { "script", FT_SCRIPT }, { "image", FT_IMAGE }, { "background", FT_IMAGE },
+        { "stylesheet", FT_STYLESHEET }, { "css", FT_STYLESHEET },
+        { "xmlhttprequest", FT_XHR }, { "xhr", FT_XHR },
+        { "subdocument", FT_SUBDOCUMENT }, { "frame", FT_SUBDOCUMENT },
+        { "font", FT_FONT }, { "media", FT_MEDIA },
+        { "object", FT_OBJECT }, { "object-subrequest", FT_OBJECT },
+        { "ping", FT_PING }, { "beacon", FT_PING },
+        { "websocket", FT_WEBSOCKET }, { "other", FT_OTHER },
+        { "document", FT_DOCUMENT }, { "doc", FT_DOCUMENT },
+    };
+    for (const auto& n : names) if (name == n.first) return n.second;
+    return 0;
+}
+
+bool FilterListBuilder::ParseLine(std::string_view line, ParsedRule& out) {
+    line = Trim(line);
+    if (line.empty() || line[0] == '!' || line[0] == '[') return false;
+    // Element hiding rules are cosmetic; there is no network request to block
+    if (line.find("##") != std::string_view::npos || line.find("#@#") != std::string_view::npos ||
+        line.find("#?#") != std::string_view::npos || line.find("#$#") != std::string_view::npos) return false;
+
+    if (line.size() >= 2 && line[0] == '@' && line[1] == '@') { out.exception = true; line.remove_prefix(2); }
+
+    uint32_t include = 0, exclude = 0;
+    size_t dollar = line.rfind('$');
+    if (dollar != std::string_view::npos) {
+        std::string_view opts = line.substr(dollar + 1);
+        line = line.substr(0, dollar);
+        while (!opts.empty()) {
+            size_t comma = opts.find(',');
+            std::string opt(Trim(opts.substr(0, comma)));
+            opts = (comma == std::string_view::npos) ? std::string_view() : opts.substr(comma + 1);
+            std::transform(opt.begin(), opt.end(), opt.begin(), [](char c) { return (char)Fold((unsigned char)c); });
+            bool negated = !opt.empty() && opt[0] == '~';
+            std::string_view name = std::string_view(opt).substr(negated ? 1 : 0);
+
+            if (name == "third-party" || name == "3p") out.flags |= negated ? FR_FIRST_PARTY : FR_THIRD_PARTY;
+            else if (name == "first-party" || name == "1p") out.flags |= negated ? FR_THIRD_PARTY : FR_FIRST_PARTY;
+            else if (name == "match-case") {}
+            else if (!negated && name.substr(0, 7) == "domain=") {
+                std::string_view list = name.substr(7);
+                while (!list.empty()) {
+                    size_t bar = list.find('|');
+                    std::string_view d = list.substr(0, bar);
+                    list = (bar == std::string_view::npos) ? std::string_view() : list.substr(bar + 1);
+                    bool ex = !d.empty() && d[0] == '~';
+                    if (ex) d.remove_prefix(1);
+                    if (!d.empty()) out.domains.push_back({ HashFolded(d), ex ? 1u : 0u, 0 });
+                }
+            }
+            else if (uint32_t type = TypeFromOption(name)) (negated ? exclude : include) |= type;
+            else return false; // popup, csp=, redirect=, ... : not something a request filter can honor
+        }
+    }
+
+    if (line.size() >= 2 && line.front() == '/' && line.back() == '/') return false; // regex rules
+
+    if (line.substr(0, 2) == "||") { out.flags |= FR_HOST_ANCHOR; line.remove_prefix(2); }
+    else if (line.substr(0, 1) == "|") { out.flags |= FR_START_ANCHOR; line.remove_prefix(1); }
+    if (!line.empty() && line.back() == '|') { out.flags |= FR_END_ANCHOR; line.remove_suffix(1); }
+
+    std::string& pat = out.pattern;
+    for (char c : line) {
+        if (c == '*' && !pat.empty() && pat.back() == '*') continue;
+        pat.push_back((char)Fold((unsigned char)c));
+    }
+    if (!pat.empty() && pat.front() == '*') { pat.erase(0, 1); out.flags &= ~(FR_HOST_ANCHOR | FR_START_ANCHOR); }
+    if (!pat.empty() && pat.back() == '*') { pat.pop_back(); out.flags &= ~FR_END_ANCHOR; }
+
+    if (out.flags & FR_HOST_ANCHOR) {
+        size_t n = 0;
+        while (n < pat.size() && (IsTokenChar((unsigned char)pat[n]) || pat[n] == '.' || pat[n] == '-' || pat[n] == '_')) n++;
+        // Only a host that ends where the pattern says so names whole labels. "||ads" and "||ads."
+        // also match ads.example.com and adserver.com, so they are matched as patterns.
+        if (n > 0 && n < pat.size() && (pat[n] == '^' || pat[n] == '/' || pat[n] == ':')) out.hostKey = pat.substr(0, n);
+        bool bareHost = n + 1 == pat.size() && pat[n] == '^';
+        if (!out.hostKey.empty() && bareHost && !(out.flags & FR_END_ANCHOR)) out.flags |= FR_HOST_ONLY;
+    }
+
+    out.typeMask = (include ? include : (FT_ALL & ~FT_DOCUMENT)) & ~exclude;
+    return out.typeMask != 0;
+}
+
+size_t FilterListBuilder::AddList(std::string_view text) {
+    size_t added = 0;
+    while (!text.empty()) {
+        size_t nl = text.find('\n');
+        std::string_view line = text.substr(0, nl);
+        text = (nl == std::string_view::npos) ? std::string_view() : text.substr(nl + 1);
+        ParsedRule rule;
+        if (ParseLine(line, rule)) { parsed.push_back(std::move(rule)); added++; }
+    }
+    return added;
+}
+
+size_t FilterListBuilder::AddFile(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file.is_open()) return 0;
+    std::stringstream buf;
+    buf << file.rdbuf();
+    return AddList(buf.str());
+}
+
+// --- BUILD ---
+namespace {
+struct TrieBuildNode {
+    std::map<uint64_t, std::unique_ptr<TrieBuildNode>> children;
+    std::vector<uint32_t> rules;
+};
+
+// Valid index tokens: runs of token chars bounded by non-token chars (or an anchor) on both sides.
+void PatternTokens(std::string_view pat, uint16_t flags, std::vector<uint64_t>& out) {
+    out.clear();
+    size_t i = 0;
+    while (i < pat.size()) {
+        if (!IsTokenChar((unsigned char)pat[i])) { i++; continue; }
+        size_t start = i;
+        while (i < pat.size() && IsTokenChar((unsigned char)pat[i])) i++;
+        bool leftOk = start > 0 ? pat[start - 1] != '*' : (flags & (FR_START_ANCHOR | FR_HOST_ANCHOR)) != 0;
+        bool rightOk = i < pat.size() ? pat[i] != '*' : (flags & FR_END_ANCHOR) != 0;
+        if (leftOk && rightOk && i - start >= 2) out.push_back(HashFolded(pat.substr(start, i - start)));
+    }
+}
+}
+
+FilterSet FilterListBuilder::Build() {
+    FilterSet set;
+    for (const ParsedRule& p : parsed) {
+        FilterRule r = {};
+        r.patternOffset = (uint32_t)set.strings.size();
+        r.patternLength = (uint32_t)p.pattern.size();
+        r.domainBegin = (uint32_t)set.domains.size();
+        r.domainCount = (uint16_t)(std::min<size_t>)(p.domains.size(), 0xFFFF);
+        r.flags = p.flags;
+        r.typeMask = p.typeMask;
+        set.strings.insert(set.strings.end(), p.pattern.begin(), p.pattern.end());
+        set.domains.insert(set.domains.end(), p.domains.begin(), p.domains.begin() + r.domainCount);
+        set.rules.push_back(r);
+    }
+
+    std::vector<uint64_t> tokens;
+    for (int pass = 0; pass < 2; pass++) {
+        bool exception = (pass == 1);
+        FilterIndex& index = exception ? set.tables.allow : set.tables.block;
+
+        TrieBuildNode root;
+        std::vector<uint32_t> generic;
+        std::unordered_map<uint64_t, uint32_t> tokenFreq;
+        std::vector<uint32_t> tokenRules;
+        std::map<uint64_t, uint32_t> siteTypes;
+        for (uint32_t id = 0; id < (uint32_t)parsed.size(); id++) {
+            const ParsedRule& p = parsed[id];
+            if (p.exception != exception) continue;
+            if (!p.hostKey.empty()) {
+                TrieBuildNode* node = &root;
+                ForEachLabelReversed(std::string_view(p.hostKey), [&](uint64_t label) {
+                    auto& child = node->children[label];
+                    if (!child) child = std::make_unique<TrieBuildNode>();
+                    node = child.get();
+                    return true;
+                });
+                node->rules.push_back(id);
+                continue;
+            }
+            PatternTokens(p.pattern, p.flags, tokens);
+            for (uint64_t t : tokens) tokenFreq[t]++;
+            tokenRules.push_back(id);
+            // A rule limited to some sites by $domain= only makes verdicts on their pages path-dependent
+            bool anySite = std::none_of(p.domains.begin(), p.domains.end(), [](const FilterDomain& d) { return !d.exclude; });
+            if (anySite) index.pathTypes |= p.typeMask;
+            else for (const FilterDomain& d : p.domains) if (!d.exclude) siteTypes[d.hash] |= p.typeMask;
+        }
+
+        // Key each rule by its rarest token so buckets stay short.
+        std::map<uint64_t, std::vector<uint32_t>> buckets;
+        for (uint32_t id : tokenRules) {
+            PatternTokens(parsed[id].pattern, parsed[id].flags, tokens);
+            if (tokens.empty()) { generic.push_back(id); continue; }
+            uint64_t best = *std::min_element(tokens.begin(), tokens.end(),
+                [&](uint64_t a, uint64_t b) { return tokenFreq[a] < tokenFreq[b]; });
+            buckets[best].push_back(id);
+        }
+
+        // Flatten the trie breadth-first so each node's children are contiguous.
+        index.hostRoot = (uint32_t)set.nodes.size();
+        set.nodes.push_back({ 0, 0, 0, 0, 0 });
+        std::queue<std::pair<const TrieBuildNode*, uint32_t>> pending;
+        pending.push({ &root, index.hostRoot });
+        while (!pending.empty()) {
+            auto [src, out] = pending.front();
+            pending.pop();
+            set.nodes[out].refBegin = (uint32_t)set.refs.size();
+            set.nodes[out].refCount = (uint32_t)src->rules.size();
+            set.refs.insert(set.refs.end(), src->rules.begin(), src->rules.end());
+            set.nodes[out].childBegin = (uint32_t)set.nodes.size();
+            set.nodes[out].childCount = (uint32_t)src->children.size();
+            for (const auto& [label, child] : src->children) {
+                pending.push({ child.get(), (uint32_t)set.nodes.size() });
+                set.nodes.push_back({ label, 0, 0, 0, 0 });
+            }
+        }
+
+        index.tokenBegin = (uint32_t)set.tokens.size();
+        index.tokenCount = (uint32_t)buckets.size();
+        for (const auto& [hash, ids] : buckets) {
+            set.tokens.push_back({ hash, (uint32_t)set.refs.size(), (uint32_t)ids.size() });
+            set.refs.insert(set.refs.end(), ids.begin(), ids.end());
+        }
+        index.genericBegin = (uint32_t)set.refs.size();
+        index.genericCount = (uint32_t)generic.size();
+        set.refs.insert(set.refs.end(), generic.begin(), generic.end());
+        index.siteBegin = (uint32_t)set.sites.size();
+        index.siteCount = (uint32_t)siteTypes.size();
+        for (const auto& [hash, types] : siteTypes) set.sites.push_back({ hash, types, 0 });
+    }
+    parsed.clear();
+
+    set.tables.rules = set.rules.data();
+    set.tables.ruleCount = (uint32_t)set.rules.size();
+    set.tables.strings = set.strings.data();
+    set.tables.stringBytes = (uint32_t)set.strings.size();
+    set.tables.domains = set.domains.data();
+    set.tables.domainCount = (uint32_t)set.domains.size();
+    set.tables.refs = set.refs.data();
+    set.tables.refCount = (uint32_t)set.refs.size();
+    set.tables.nodes = set.nodes.data();
+    set.tables.nodeCount = (uint32_t)set.nodes.size();
+    set.tables.tokens = set.tokens.data();
+    set.tables.tokenCount = (uint32_t)set.tokens.size();
+    set.tables.sites = set.sites.data();
+    set.tables.siteCount = (uint32_t)set.sites.size();
+    return set;
+}
+
+// --- LIST FILES ---
+std::vector<std::filesystem::path> FilterListFiles(const std::filesystem::path& dir) {
+    std::vector<std::filesystem::path> files;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+        if (entry.is_regular_file(ec) && entry.path().extension() == ".txt") files.push_back(entry.path());
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+uint64_t FilterListStamp(const std::vector<std::filesystem::path>& files) {
+    uint64_t h = FNV_OFFSET ^ SNAPSHOT_VERSION;
+    for (const auto& f : files) {
+        std::error_code ec;
+        uint64_t parts[3] = {
+            HashFolded(std::wstring_view(f.filename().wstring())),
+            (uint64_t)std::filesystem::file_size(f, ec),
+            (uint64_t)std::filesystem::last_write_time(f, ec).time_since_epoch().count(),
+        };
+        h = Checksum((const uint8_t*)parts, sizeof(parts)) ^ (h * FNV_PRIME);
+    }
+    return h;
+}
+
+// --- URL HELPERS ---
+std::wstring_view UrlHost(std::wstring_view url) {
+    Url parsed;
+    return (ParseUrl(url, parsed) && parsed.hasAuthority) ? parsed.host : std::wstring_view();
+}
+
+bool IsThirdPartyHost(std::wstring_view host, std::wstring_view sourceHost) {
+    if (sourceHost.empty()) return false;
+    std::wstring_view a = RegistrableDomain(host), b = RegistrableDomain(sourceHost);
+    if (a.empty()) a = host; // the host is a public suffix itself
+    if (b.empty()) b = sourceHost;
+    if (a.size() != b.size()) return true;
+    for (size_t i = 0; i < a.size(); i++) if (Fold((uint32_t)a[i]) != Fold((uint32_t)b[i])) return true;
+    return false;
+}
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "mappedfile.h"
+
+// Adblock Plus / EasyList network filter engine.
+// Rules are compiled into flat tables: a reversed-label host trie for "||host^" rules and
+// token-hash buckets for everything else, so a request only checks a handful of candidates.
+
+// Resource types, as used by filter options ($script, $image, ...)
+enum FilterType : uint32_t {
+    FT_SCRIPT = 1u << 0,
+    FT_IMAGE = 1u << 1,
+    FT_STYLESHEET = 1u << 2,
+    FT_XHR = 1u << 3,
+    FT_SUBDOCUMENT = 1u << 4,
+    FT_FONT = 1u << 5,
+    FT_MEDIA = 1u << 6,
+    FT_OBJECT = 1u << 7,
+    FT_PING = 1u << 8,
+    FT_WEBSOCKET = 1u << 9,
+    FT_DOCUMENT = 1u << 10,
+    FT_OTHER = 1u << 11,
+    FT_ALL = (1u << 12) - 1,
+};
+
+struct FilterRequest {
+    std::wstring_view url;
+    std::wstring_view host;       // must point into url
+    std::wstring_view sourceHost; // host of the page that issued the request
+    uint32_t type = FT_OTHER;
+    bool thirdParty = false;
+};
+
+// --- COMPILED TABLES (plain data, no pointers) ---
+enum FilterRuleFlags : uint16_t {
+    FR_HOST_ANCHOR = 1 << 0,  // ||
+    FR_START_ANCHOR = 1 << 1, // |
+    FR_END_ANCHOR = 1 << 2,   // trailing |
+    FR_THIRD_PARTY = 1 << 3,
+    FR_FIRST_PARTY = 1 << 4,
+    FR_HOST_ONLY = 1 << 5,    // "||host^": the verdict does not depend on path or query
+};
+
+struct FilterRule {
+    uint32_t patternOffset;
+    uint32_t patternLength;
+    uint32_t domainBegin;
+    uint16_t domainCount;
+    uint16_t flags;
+    uint32_t typeMask;
+};
+
+struct FilterDomain {
+    uint64_t hash;
+    uint32_t exclude;
+    uint32_t reserved;
+};
+
+struct FilterHostNode {
+    uint64_t labelHash;
+    uint32_t childBegin, childCount; // children are contiguous and sorted by labelHash
+    uint32_t refBegin, refCount;     // rules anchored at this host
+};
+
+struct FilterTokenBucket {
+    uint64_t hash;
+    uint32_t refBegin, refCount;
+};
+
+// Types of the token/generic rules that only apply on pages of one $domain= site
+struct FilterSiteTypes {
+    uint64_t hash; // of the site as written in $domain=
+    uint32_t typeMask;
+    uint32_t reserved;
+};
+
+// One index per verdict (block rules, @@ exception rules)
+struct FilterIndex {
+    uint32_t hostRoot;
+    uint32_t tokenBegin, tokenCount;
+    uint32_t genericBegin, genericCount; // rules with no usable token, checked for every request
+    uint32_t pathTypes;                  // type mask of the token/generic rules that apply on any site
+    uint32_t siteBegin, siteCount;       // FilterSiteTypes for the others, sorted by hash
+};
+
+struct FilterTables {
+    const FilterRule* rules = nullptr;
+    uint32_t ruleCount = 0;
+    const char* strings = nullptr;
+    uint32_t stringBytes = 0;
+    const FilterDomain* domains = nullptr;
+    uint32_t domainCount = 0;
+    const uint32_t* refs = nullptr;
+    uint32_t refCount = 0;
+    const FilterHostNode* nodes = nullptr;
+    uint32_t nodeCount = 0;
+    const FilterTokenBucket* tokens = nullptr;
+    uint32_t tokenCount = 0;
+    const FilterSiteTypes* sites = nullptr;
+    uint32_t siteCount = 0;
+    FilterIndex block = {};
+    FilterIndex allow = {};
+};
+
+class FilterSet {
+public:
+    FilterSet() = default;
+    FilterSet(FilterSet&&) = default;
+    FilterSet& operator=(FilterSet&&) = default;
+    FilterSet(const FilterSet&) = delete;
+    FilterSet& operator=(const FilterSet&) = delete;
+
+    struct Decision {
+        bool block;
+        bool hostOnly; // same verdict for any URL with this host, source host and type
+    };
+
+    Decision Classify(const FilterRequest& req) const;
+    bool ShouldBlock(const FilterRequest& req) const { return Classify(req).block; }
+    uint32_t RuleCount() const { return tables.ruleCount; }
+    // Union of the FilterTypes any blocking rule applies to; requests of other types are never
+    // blocked, so they need not be classified at all
+    uint32_t BlockableTypes() const;
+
+    // Snapshot: the tables written as one flat, versioned, checksummed file. Loading maps it
+    // and matches straight out of the mapping. sourceStamp identifies the lists it was built from.
+    bool SaveSnapshot(const std::filesystem::path& path, uint64_t sourceStamp) const;
+    bool LoadSnapshot(const std::filesystem::path& path, uint64_t& sourceStamp);
+
+private:
+    friend class FilterListBuilder;
+
+    FilterTables tables;
+    std::unique_ptr<MappedFile> mapped; // set when the tables live in a snapshot
+    std::vector<FilterRule> rules;
+    std::vector<char> strings;
+    std::vector<FilterDomain> domains;
+    std::vector<uint32_t> refs;
+    std::vector<FilterHostNode> nodes;
+    std::vector<FilterTokenBucket> tokens;
+    std::vector<FilterSiteTypes> sites;
+};
+
+class FilterListBuilder {
+public:
+    // Returns the number of network rules accepted from the list.
+    size_t AddList(std::string_view text);
+    size_t AddFile(const std::filesystem::path& path);
+
+    FilterSet Build();
+
+private:
+    struct ParsedRule {
+        std::string pattern; // lowercased, anchors and options stripped
+        std::string hostKey; // for host-anchored rules with a whole-label host
+        std::vector<FilterDomain> domains;
+        uint16_t flags = 0;
+        uint32_t typeMask = 0;
+        bool exception = false;
+    };
+
+    bool ParseLine(std::string_view line, ParsedRule& out);
+
+    std::vector<ParsedRule> parsed;
+};
+
+// All *.txt lists in a folder, and a stamp that changes when any of them is added, removed or edited.
+std::vector<std::filesystem::path> FilterListFiles(const std::filesystem::path& dir);
+uint64_t FilterListStamp(const std::vector<std::filesystem::path>& files);
+
+// Host part of an absolute URL, as a view into it (empty if there is none).
+std::wstring_view UrlHost(std::wstring_view url);
+// Third-party when the registrable domains (eTLD+1, per the Public Suffix List) differ.
+bool IsThirdPartyHost(std::wstring_view host, std::wstring_view sourceHost);
@@ -0,0 +1,228 @@
+#include "historylog.h"
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+// --- RECORD FORMAT ---
+// [RecordHeader][payload], little-endian, no padding between records. Strings are UTF-16LE.
+// VISIT: url. TITLE: url, U+0000, title. STATE: StateFields, url, U+0000, title.
+namespace {
+const uint32_t RECORD_MAGIC = 0x31524853; // "SHR1"
+
+struct RecordHeader {
+    uint32_t magic;
+    uint32_t kind;
+    uint32_t length; // payload bytes
+    uint32_t checksum;
+    int64_t time;
+};
+
+struct StateFields {
+    uint32_t visitCount;
+    uint32_t reserved;
+    int64_t firstVisit;
+    double frecency;
+};
+
+uint32_t Fnv32(uint32_t h, const void* data, size_t n) {
+    const uint8_t* p = (const uint8_t*)data;
+    for (size_t i = 0; i < n; i++) { h ^= p[i]; h *= 16777619u; }
+    return h;
+}
+
+uint32_t RecordChecksum(const RecordHeader& h, const uint8_t* payload) {
+    uint32_t c = 2166136261u;
+    c = Fnv32(c, &h.kind, sizeof(h.kind));
+    c = Fnv32(c, &h.length, sizeof(h.length));
+    c = Fnv32(c, &h.time, sizeof(h.time));
+    return Fnv32(c, payload, h.length);
+}
+
+void EncodeUtf16(const std::wstring& s, std::string& out) {
+    auto put = [&out](uint32_t u) { out.push_back((char)(u & 0xFF)); out.push_back((char)(u >> 8)); };
+    for (wchar_t wc : s) {
+        uint32_t c = (uint32_t)wc;
+        if (c > 0xFFFF) { c -= 0x10000; put(0xD800 + (c >> 10)); put(0xDC00 + (c & 0x3FF)); }
+        else put(c);
+    }
+}
+
+std::wstring DecodeUtf16(const uint8_t* p, size_t bytes) {
+    std::wstring s;
+    s.reserve(bytes / 2);
+    for (size_t i = 0; i + 1 < bytes; i += 2) {
+        uint32_t c = p[i] | (p[i + 1] << 8);
+        if (sizeof(wchar_t) == 4 && c >= 0xD800 && c < 0xDC00 && i + 3 < bytes) {
+            uint32_t lo = p[i + 2] | (p[i + 3] << 8);
+            if (lo >= 0xDC00 && lo < 0xE000) { c = 0x10000 + ((c - 0xD800) << 10) + (lo - 0xDC00); i += 2; }
+        }
+        s.push_back((wchar_t)c);
+    }
+    return s;
+}
+
+void AppendRecord(std::string& out, const HistoryRecord& r) {
+    size_t start = out.size();
+    out.resize(start + sizeof(RecordHeader));
+    if (r.kind == HistoryRecord::STATE) {
+        StateFields f = { r.visitCount, 0, r.firstVisit, r.frecency };
+        out.append((const char*)&f, sizeof(f));
+    }
+    EncodeUtf16(r.url, out);
+    if (r.kind != HistoryRecord::VISIT) {
+        out.append(2, '\0');
+        EncodeUtf16(r.title, out);
+    }
+    RecordHeader h = { RECORD_MAGIC, (uint32_t)r.kind, (uint32_t)(out.size() - start - sizeof(RecordHeader)), 0, r.time };
+    h.checksum = RecordChecksum(h, (const uint8_t*)out.data() + start + sizeof(RecordHeader));
+    memcpy(&out[start], &h, sizeof(h));
+}
+}
+
+// --- HISTORY LOG ---
+HistoryLog::HistoryLog(std::filesystem::path path, std::chrono::milliseconds flushInterval)
+    : path(std::move(path)), flushInterval(flushInterval) {
+}
+
+HistoryLog::~HistoryLog() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    if (worker.joinable()) worker.join();
+}
+
+int64_t HistoryLog::Now() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+std::vector<HistoryRecord> HistoryLog::Load() {
+    std::vector<HistoryRecord> records;
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file.is_open()) return records;
+    std::stringstream buf;
+    buf << file.rdbuf();
+    file.close();
+    std::string data = buf.str();
+
+    size_t pos = 0;
+    while (data.size() - pos >= sizeof(RecordHeader)) {
+        RecordHeader h;
+        memcpy(&h, data.data() + pos, sizeof(h));
+        const uint8_t* payload = (const uint8_t*)data.data() + pos + sizeof(h);
+        if (h.magic != RECORD_MAGIC || h.length > data.size() - pos - sizeof(h) || RecordChecksum(h, payload) != h.checksum) break;
+        HistoryRecord r;
+        r.kind = (HistoryRecord::Kind)h.kind;
+        r.time = h.time;
+        size_t length = h.length;
+        if (r.kind == HistoryRecord::STATE && length >= sizeof(StateFields)) {
+            StateFields f;
+            memcpy(&f, payload, sizeof(f));
+            r.visitCount = f.visitCount;
+            r.firstVisit = f.firstVisit;
+            r.frecency = f.frecency;
+            payload += sizeof(f);
+            length -= sizeof(f);
+        }
+        std::wstring text = DecodeUtf16(payload, length);
+        size_t nul = (r.kind == HistoryRecord::VISIT) ? std::wstring::npos : text.find(L'\0');
+        r.url = text.substr(0, nul);
+        if (nul != std::wstring::npos) r.title = text.substr(nul + 1);
+        records.push_back(std::move(r));
+        pos += sizeof(h) + h.length;
+    }
+    // Drop a torn tail so later appends follow the last good record.
+    if (pos != data.size()) {
+        std::error_code ec;
+        std::filesystem::resize_file(path, pos, ec);
+    }
+    recordCount = records.size();
+    return records;
+}
+
+void HistoryLog::Start() {
+    worker = std::thread([this]() { Run(); });
+}
+
+void HistoryLog::Append(HistoryRecord record) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (pending.empty() || pending.back().compact) pending.emplace_back();
+    pending.back().records.push_back(std::move(record));
+    queuedSeq++;
+    recordCount++;
+}
+
+void HistoryLog::Compact(std::vector<HistoryRecord> live) {
+    std::lock_guard<std::mutex> guard(lock);
+    recordCount = live.size();
+    Op op;
+    op.compact = true;
+    op.records = std::move(live);
+    pending.push_back(std::move(op));
+    queuedSeq++;
+}
+
+void HistoryLog::Flush() {
+    std::unique_lock<std::mutex> guard(lock);
+    uint64_t target = queuedSeq;
+    flushRequested = true;
+    wake.notify_all();
+    flushed.wait(guard, [this, target]() { return writtenSeq >= target || !worker.joinable(); });
+}
+
+void HistoryLog::Run() {
+    std::unique_lock<std::mutex> guard(lock);
+    while (true) {
+        wake.wait_for(guard, flushInterval, [this]() { return stopping || flushRequested; });
+        flushRequested = false;
+        std::vector<Op> ops;
+        ops.swap(pending);
+        uint64_t seq = queuedSeq;
+        bool stop = stopping;
+        guard.unlock();
+        if (!ops.empty()) WriteBatch(ops);
+        guard.lock();
+        writtenSeq = seq;
+        flushed.notify_all();
+        if (stop && pending.empty()) return;
+    }
+}
+
+void HistoryLog::WriteBatch(std::vector<Op>& ops) {
+    // A compaction supersedes everything queued before it.
+    size_t first = 0;
+    for (size_t i = 0; i < ops.size(); i++) if (ops[i].compact) first = i;
+
+    std::string bytes;
+    if (ops[first].compact) {
+        for (const HistoryRecord& r : ops[first].records) AppendRecord(bytes, r);
+        std::filesystem::path tmp = path;
+        tmp += L".tmp";
+        bool written;
+        {
+            std::ofstream file(tmp, std::ios::out | std::ios::binary | std::ios::trunc);
+            file.write(bytes.data(), (std::streamsize)bytes.size());
+            file.close();
+            written = !file.fail();
+        }
+        std::error_code ec;
+        if (written) std::filesystem::rename(tmp, path, ec);
+        if (written && !ec) {
+            bytesWritten += bytes.size();
+            bytes.clear();
+        }
+        // The old log stays, and the compacted records go on its end with the rest of the batch
+        else std::filesystem::remove(tmp, ec);
+        first++;
+    }
+    for (size_t i = first; i < ops.size(); i++) {
+        for (const HistoryRecord& r : ops[i].records) AppendRecord(bytes, r);
+    }
+    if (bytes.empty()) return;
+    std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::app);
+    file.write(bytes.data(), (std::streamsize)bytes.size());
+    file.close();
+    if (!file.fail()) bytesWritten += bytes.size();
+}
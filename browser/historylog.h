@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Append-only history journal. Appends are queued in memory and written by a background
+// thread in batches, so navigation never waits on disk. Every record carries a checksum;
+// a torn or corrupt tail left by a crash is dropped (and truncated) on load.
+struct HistoryRecord {
+    enum Kind : uint32_t {
+        VISIT = 1, // one more visit at `time`
+        TITLE = 2, // page title changed
+        STATE = 3, // the entry's complete state; replaying it twice is harmless
+        CLEAR = 4, // everything before it is gone, the base file included
+    };
+
+    Kind kind = VISIT;
+    int64_t time = 0; // unix epoch, milliseconds (STATE: last visit)
+    std::wstring url;
+    std::wstring title;     // TITLE, STATE
+    uint32_t visitCount = 0; // STATE
+    int64_t firstVisit = 0;  // STATE
+    double frecency = 0;     // STATE
+};
+
+class HistoryLog {
+public:
+    HistoryLog(std::filesystem::path path, std::chrono::milliseconds flushInterval);
+    ~HistoryLog(); // writes whatever is still queued
+
+    HistoryLog(const HistoryLog&) = delete;
+    HistoryLog& operator=(const HistoryLog&) = delete;
+
+    // Reads every intact record, oldest first. Call before Start().
+    std::vector<HistoryRecord> Load();
+    void Start();
+
+    void Append(HistoryRecord record);
+    // Replaces the whole log with `live` (oldest first) once earlier appends are written. If the
+    // new file cannot be written, `live` is appended to the old log instead.
+    void Compact(std::vector<HistoryRecord> live);
+    void Flush(); // blocks until everything queued so far is on disk
+
+    // Records in the file plus queued ones; compare against the live set to decide on Compact().
+    size_t RecordCount() const { return recordCount; }
+    // To disk since construction, compactions included
+    uint64_t BytesWritten() const { return bytesWritten.load(std::memory_order_relaxed); }
+
+    static int64_t Now();
+
+private:
+    struct Op {
+        bool compact = false;
+        std::vector<HistoryRecord> records;
+    };
+
+    void Run();
+    void WriteBatch(std::vector<Op>& ops);
+
+    std::filesystem::path path;
+    std::chrono::milliseconds flushInterval;
+    size_t recordCount = 0; // UI thread only
+    std::atomic<uint64_t> bytesWritten{ 0 };
+
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable flushed;
+    std::vector<Op> pending;
+    uint64_t queuedSeq = 0, writtenSeq = 0;
+    bool flushRequested = false;
+    bool stopping = false;
+    std::thread worker;
+};
@@ -0,0 +1,548 @@
+#include "historystore.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+
+#include "mappedfile.h"
+
+// --- FRECENCY ---
+static const double FRECENCY_HALF_LIFE_MS = 30.0 * 24 * 60 * 60 * 1000;
+
+double AddVisitToFrecency(double frecency, uint32_t visitCountBefore, int64_t time) {
+    double x = (double)time * (std::log(2.0) / FRECENCY_HALF_LIFE_MS);
+    if (visitCountBefore == 0) return x;
+    // log(e^frecency + e^x) without overflow
+    double hi = (std::max)(frecency, x), lo = (std::min)(frecency, x);
+    return hi + std::log1p(std::exp(lo - hi));
+}
+
+static uint64_t HashUrl(std::wstring_view url) {
+    uint64_t h = 14695981039346656037ull;
+    for (wchar_t c : url) { h ^= (uint32_t)c; h *= 1099511628211ull; }
+    return h;
+}
+
+// --- ON-DISK BASE ---
+// [HistoryDbHeader][HistoryDbRecord x count, frecency descending][uint32 slot x tableSize][UTF-16 string pool]
+// Slots hold record index + 1 (0 = empty), linear probing on urlHash.
+namespace {
+const char HISTORY_DB_MAGIC[8] = { 'S', 'A', 'R', 'F', 'H', 'I', 'S', 'T' };
+const uint32_t HISTORY_DB_VERSION = 1;
+
+struct HistoryDbHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t fileSize;
+    uint32_t recordCount;
+    uint32_t tableSize; // power of two
+    uint64_t recordsOffset;
+    uint64_t tableOffset;
+    uint64_t stringsOffset;
+    uint64_t stringUnits;
+    uint64_t checksum; // of the header fields above
+};
+
+struct HistoryDbRecord {
+    uint64_t urlHash;
+    uint32_t urlOffset, urlLength; // in string units
+    uint32_t titleOffset, titleLength;
+    uint32_t visitCount;
+    uint32_t reserved;
+    int64_t firstVisit;
+    int64_t lastVisit;
+    double frecency;
+};
+
+uint64_t HeaderChecksum(const HistoryDbHeader& h) {
+    const uint8_t* p = (const uint8_t*)&h;
+    uint64_t c = 14695981039346656037ull;
+    for (size_t i = 0; i < offsetof(HistoryDbHeader, checksum); i++) { c ^= p[i]; c *= 1099511628211ull; }
+    return c;
+}
+
+void AppendUnits(std::vector<uint16_t>& pool, std::wstring_view s) {
+    for (wchar_t wc : s) {
+        uint32_t c = (uint32_t)wc;
+        if (c > 0xFFFF) { c -= 0x10000; pool.push_back((uint16_t)(0xD800 + (c >> 10))); pool.push_back((uint16_t)(0xDC00 + (c & 0x3FF))); }
+        else pool.push_back((uint16_t)c);
+    }
+}
+}
+
+class HistoryBase {
+public:
+    static std::shared_ptr<const HistoryBase> Open(const std::filesystem::path& path) {
+        auto base = std::make_shared<HistoryBase>();
+        if (!base->file.Open(path) || base->file.Size() < sizeof(HistoryDbHeader)) return nullptr;
+        const uint8_t* p = base->file.Data();
+        HistoryDbHeader& h = base->header;
+        memcpy(&h, p, sizeof(h));
+        uint64_t size = base->file.Size();
+        if (memcmp(h.magic, HISTORY_DB_MAGIC, sizeof(h.magic)) != 0 || h.version != HISTORY_DB_VERSION ||
+            h.headerSize != sizeof(HistoryDbHeader) || h.fileSize != size || HeaderChecksum(h) != h.checksum) return nullptr;
+        if (h.tableSize == 0 || (h.tableSize & (h.tableSize - 1)) != 0 || h.recordCount >= h.tableSize ||
+            h.recordsOffset + (uint64_t)h.recordCount * sizeof(HistoryDbRecord) > size ||
+            h.tableOffset + (uint64_t)h.tableSize * 4 > size || h.stringsOffset + h.stringUnits * 2 > size ||
+            h.recordsOffset % 8 || h.tableOffset % 4 || h.stringsOffset % 2) return nullptr;
+        base->records = (const HistoryDbRecord*)(p + h.recordsOffset);
+        base->table = (const uint32_t*)(p + h.tableOffset);
+        base->strings = (const uint16_t*)(p + h.stringsOffset);
+        return base;
+    }
+
+    uint32_t Count() const { return header.recordCount; }
+    const HistoryDbRecord& Record(uint32_t i) const { return records[i]; }
+
+    std::wstring Text(uint32_t offset, uint32_t length) const {
+        std::wstring s;
+        if ((uint64_t)offset + length > header.stringUnits) return s;
+        s.reserve(length);
+        for (uint32_t i = 0; i < length; i++) {
+            uint32_t c = strings[offset + i];
+            if (sizeof(wchar_t) == 4 && c >= 0xD800 && c < 0xDC00 && i + 1 < length) {
+                uint32_t lo = strings[offset + i + 1];
+                if (lo >= 0xDC00 && lo < 0xE000) { c = 0x10000 + ((c - 0xD800) << 10) + (lo - 0xDC00); i++; }
+            }
+            s.push_back((wchar_t)c);
+        }
+        return s;
+    }
+
+    HistoryEntry Entry(uint32_t i) const {
+        const HistoryDbRecord& r = records[i];
+        HistoryEntry e;
+        e.url = Text(r.urlOffset, r.urlLength);
+        e.title = Text(r.titleOffset, r.titleLength);
+        e.visitCount = r.visitCount;
+        e.firstVisit = r.firstVisit;
+        e.lastVisit = r.lastVisit;
+        e.frecency = r.frecency;
+        return e;
+    }
+
+    int Find(std::wstring_view url, uint64_t hash) const {
+        uint32_t mask = header.tableSize - 1;
+        for (uint32_t slot = (uint32_t)hash & mask, probes = 0; probes < header.tableSize; slot = (slot + 1) & mask, probes++) {
+            uint32_t ref = table[slot];
+            if (ref == 0) return -1;
+            if (ref > header.recordCount) return -1;
+            const HistoryDbRecord& r = records[ref - 1];
+            if (r.urlHash == hash && Text(r.urlOffset, r.urlLength) == url) return (int)(ref - 1);
+        }
+        return -1;
+    }
+
+    // Entries must be sorted by frecency, highest first.
+    static bool Write(const std::filesystem::path& path, const std::vector<HistoryEntry>& entries) {
+        HistoryDbHeader h = {};
+        memcpy(h.magic, HISTORY_DB_MAGIC, sizeof(h.magic));
+        h.version = HISTORY_DB_VERSION;
+        h.headerSize = sizeof(HistoryDbHeader);
+        h.recordCount = (uint32_t)entries.size();
+        h.tableSize = 16;
+        while (h.tableSize < entries.size() * 2) h.tableSize <<= 1;
+
+        std::vector<HistoryDbRecord> records(entries.size());
+        std::vector<uint32_t> table(h.tableSize, 0);
+        std::vector<uint16_t> pool;
+        for (size_t i = 0; i < entries.size(); i++) {
+            const HistoryEntry& e = entries[i];
+            HistoryDbRecord& r = records[i];
+            r.urlHash = HashUrl(e.url);
+            r.urlOffset = (uint32_t)pool.size();
+            AppendUnits(pool, e.url);
+            r.urlLength = (uint32_t)pool.size() - r.urlOffset;
+            r.titleOffset = (uint32_t)pool.size();
+            AppendUnits(pool, e.title);
+            r.titleLength = (uint32_t)pool.size() - r.titleOffset;
+            r.visitCount = e.visitCount;
+            r.reserved = 0;
+            r.firstVisit = e.firstVisit;
+            r.lastVisit = e.lastVisit;
+            r.frecency = e.frecency;
+            uint32_t slot = (uint32_t)r.urlHash & (h.tableSize - 1);
+            while (table[slot]) slot = (slot + 1) & (h.tableSize - 1);
+            table[slot] = (uint32_t)i + 1;
+        }
+        h.recordsOffset = sizeof(HistoryDbHeader);
+        h.tableOffset = h.recordsOffset + records.size() * sizeof(HistoryDbRecord);
+        h.stringsOffset = h.tableOffset + table.size() * sizeof(uint32_t);
+        h.stringUnits = pool.size();
+        h.fileSize = h.stringsOffset + pool.size() * sizeof(uint16_t);
+        h.checksum = HeaderChecksum(h);
+
+        std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) return false;
+        file.write((const char*)&h, sizeof(h));
+        file.write((const char*)records.data(), (std::streamsize)(records.size() * sizeof(HistoryDbRecord)));
+        file.write((const char*)table.data(), (std::streamsize)(table.size() * sizeof(uint32_t)));
+        file.write((const char*)pool.data(), (std::streamsize)(pool.size() * sizeof(uint16_t)));
+        return file.good();
+    }
+
+private:
+    MappedFile file;
+    HistoryDbHeader header = {};
+    const HistoryDbRecord* records = nullptr;
+    const uint32_t* table = nullptr;
+    const uint16_t* strings = nullptr;
+};
+
+// --- HISTORY STORE ---
+static const size_t CHECKPOINT_OVERLAY_ENTRIES = 4096;
+static const size_t CHECKPOINT_JOURNAL_RECORDS = 16384;
+
+static std::filesystem::path WithSuffix(std::filesystem::path p, const wchar_t* suffix) {
+    p += suffix;
+    return p;
+}
+
+HistoryStore::HistoryStore(std::filesystem::path dbPath, std::filesystem::path logPath)
+    : dbPath(std::move(dbPath)), journal(std::move(logPath), std::chrono::seconds(1)) {
+}
+
+HistoryStore::~HistoryStore() {
+    FinishCheckpoint(true); // swapped in now rather than redone next launch
+}
+
+void HistoryStore::Load() {
+    // A base written by a checkpoint that never got swapped in. It is only completed once the
+    // journal holds the snapshot as STATE records, which replay onto it harmlessly, so a whole
+    // one can be promoted; a torn one is dropped, and the journal still covers the old base.
+    std::filesystem::path next = WithSuffix(dbPath, L".new");
+    std::error_code ec;
+    if (std::filesystem::exists(next, ec)) {
+        if (HistoryBase::Open(next)) std::filesystem::rename(next, dbPath, ec);
+        std::filesystem::remove(next, ec); // gone already if promoted
+    }
+    base = HistoryBase::Open(dbPath);
+    for (const HistoryRecord& r : journal.Load()) {
+        if (r.kind == HistoryRecord::VISIT) ApplyVisit(r.url, r.time);
+        else if (r.kind == HistoryRecord::TITLE) ApplyTitle(r.url, r.title);
+        else if (r.kind == HistoryRecord::STATE) ApplyState(r);
+        else if (r.kind == HistoryRecord::CLEAR) ApplyClear(); // the base may have outlived a crash
+    }
+    journal.Start();
+    MaybeCheckpoint();
+}
+
+int HistoryStore::FindOverlay(std::wstring_view url, uint64_t hash) const {
+    auto range = overlayIndex.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (overlay[it->second].entry.url == url) return (int)it->second;
+    }
+    return -1;
+}
+
+HistoryStore::OverlayEntry& HistoryStore::Touch(std::wstring_view url) {
+    uint64_t hash = HashUrl(url);
+    int id = FindOverlay(url, hash);
+    if (id < 0) {
+        OverlayEntry o;
+        int baseIndex = base ? base->Find(url, hash) : -1;
+        if (baseIndex >= 0) {
+            o.entry = base->Entry((uint32_t)baseIndex);
+            o.inBase = true;
+            shadowedBase.insert(std::lower_bound(shadowedBase.begin(), shadowedBase.end(), (uint32_t)baseIndex), (uint32_t)baseIndex);
+        }
+        else { o.entry.url = url; overlayNew++; }
+        id = (int)overlay.size();
+        overlay.push_back(std::move(o));
+        overlayIndex.emplace(hash, (uint32_t)id);
+        ranking.insert({ overlay[id].entry.frecency, (uint32_t)id });
+        rankedStale = true;
+    }
+    overlay[id].seq = ++seq;
+    return overlay[id];
+}
+
+void HistoryStore::Rank(uint32_t id, double oldKey) {
+    ranking.erase({ oldKey, id });
+    ranking.insert({ overlay[id].entry.frecency, id });
+    rankedStale = true;
+}
+
+void HistoryStore::ApplyVisit(std::wstring_view url, int64_t time) {
+    OverlayEntry& o = Touch(url);
+    HistoryEntry& e = o.entry;
+    double oldKey = e.frecency;
+    e.frecency = AddVisitToFrecency(e.frecency, e.visitCount, time);
+    if (e.visitCount == 0 || time < e.firstVisit) e.firstVisit = time;
+    e.lastVisit = (std::max)(e.lastVisit, time);
+    e.visitCount++;
+    Rank((uint32_t)(&o - overlay.data()), oldKey);
+}
+
+void HistoryStore::ApplyTitle(std::wstring_view url, std::wstring_view title) {
+    Touch(url).entry.title = title;
+}
+
+void HistoryStore::ApplyState(const HistoryRecord& r) {
+    OverlayEntry& o = Touch(r.url);
+    double oldKey = o.entry.frecency;
+    o.entry.title = r.title;
+    o.entry.visitCount = r.visitCount;
+    o.entry.firstVisit = r.firstVisit;
+    o.entry.lastVisit = r.time;
+    o.entry.frecency = r.frecency;
+    Rank((uint32_t)(&o - overlay.data()), oldKey);
+}
+
+void HistoryStore::RecordVisit(std::wstring_view url, int64_t time) {
+    FinishCheckpoint(false);
+    ApplyVisit(url, time);
+    HistoryRecord r;
+    r.kind = HistoryRecord::VISIT;
+    r.time = time;
+    r.url = url;
+    journal.Append(std::move(r));
+    MaybeCheckpoint();
+}
+
+void HistoryStore::SetTitle(std::wstring_view url, std::wstring_view title) {
+    FinishCheckpoint(false);
+    uint64_t hash = HashUrl(url);
+    int id = FindOverlay(url, hash);
+    if (id < 0 && !(base && base->Find(url, hash) >= 0)) return; // only pages that are in history
+    if (id >= 0 && overlay[id].entry.title == title) return;
+    ApplyTitle(url, title);
+    HistoryRecord r;
+    r.kind = HistoryRecord::TITLE;
+    r.url = url;
+    r.title = title;
+    journal.Append(std::move(r));
+}
+
+std::vector<HistoryRecord> ReadLegacyHistory(const std::filesystem::path& path, int64_t now) {
+    std::vector<std::wstring> urls;
+    std::wifstream file(path);
+    std::wstring line;
+    while (std::getline(file, line)) if (!line.empty()) urls.push_back(line);
+    std::vector<HistoryRecord> records(urls.size());
+    for (size_t i = 0; i < urls.size(); i++) {
+        HistoryRecord& r = records[urls.size() - 1 - i];
+        r.url = std::move(urls[i]);
+        r.time = now - (int64_t)i;
+    }
+    return records;
+}
+
+void HistoryStore::Import(const std::vector<HistoryRecord>& records) {
+    for (const HistoryRecord& r : records) RecordVisit(r.url, r.time);
+}
+
+// The clear is on disk before the base goes: a crash in between leaves a journal that deletes
+// the base again on load, where one the other way round would replay the old journal.
+void HistoryStore::Clear() {
+    FinishCheckpoint(true);
+    HistoryRecord r;
+    r.kind = HistoryRecord::CLEAR;
+    r.time = HistoryLog::Now();
+    journal.Compact({ r });
+    journal.Flush();
+    ApplyClear();
+}
+
+// Replayed on load, this also deletes any base written since the clear. Nothing is lost: only a
+// compaction trims the journal, and it drops the CLEAR record too, so while one is there every
+// entry of a later base is also in the journal after it.
+void HistoryStore::ApplyClear() {
+    base.reset();
+    std::error_code ec;
+    std::filesystem::remove(dbPath, ec);
+    std::filesystem::remove(WithSuffix(dbPath, L".new"), ec);
+    overlay.clear();
+    overlayIndex.clear();
+    ranking.clear();
+    rankedStale = true;
+    shadowedBase.clear();
+    overlayNew = 0;
+}
+
+std::vector<HistoryEntry> HistoryStore::Range(size_t first, size_t n) {
+    FinishCheckpoint(false);
+    uint32_t baseCount = base ? base->Count() : 0;
+    // Base records in [from, to) the overlay has not replaced
+    auto live = [&](uint32_t from, uint32_t to) -> size_t {
+        auto lo = std::lower_bound(shadowedBase.begin(), shadowedBase.end(), from);
+        auto hi = std::lower_bound(lo, shadowedBase.end(), to);
+        return (to - from) - (size_t)(hi - lo);
+    };
+    // The overlay's ranking, flattened for binary search; rebuilt only after it changes, so
+    // scrolling through an unchanging history does not walk the tree
+    if (rankedStale) {
+        ranked.assign(ranking.begin(), ranking.end());
+        rankedStale = false;
+    }
+    uint32_t bi = 0;
+    size_t oi = 0; // into `ranked`
+    if (first > 0) {
+        // Overlay entries sort before a base record unless it has the higher frecency, so a live
+        // base record i sits at position live(0, i) + atLeast(its frecency). That only grows with
+        // i (the base is sorted by frecency), which lets the start be found by binary search.
+        auto atLeast = [&](double key) -> size_t {
+            return (size_t)(std::partition_point(ranked.begin(), ranked.end(),
+                [key](const std::pair<double, uint32_t>& r) { return r.first >= key; }) - ranked.begin());
+        };
+        uint32_t lo = 0, hi = baseCount;
+        while (lo < hi) {
+            uint32_t mid = lo + (hi - lo) / 2;
+            if (live(0, mid) + atLeast(base->Record(mid).frecency) < first) lo = mid + 1;
+            else hi = mid;
+        }
+        bi = lo;
+        size_t fromBase = live(0, bi); // entries before `first` that come from the base
+        if (first > fromBase + ranked.size()) return {}; // past the end
+        oi = first - fromBase;
+    }
+
+    std::vector<HistoryEntry> out;
+    auto shadow = std::lower_bound(shadowedBase.begin(), shadowedBase.end(), bi);
+    while (out.size() < n) {
+        while (shadow != shadowedBase.end() && *shadow == bi) { bi++; ++shadow; }
+        bool haveBase = bi < baseCount, haveOverlay = oi < ranked.size();
+        if (!haveBase && !haveOverlay) break;
+        if (haveBase && (!haveOverlay || base->Record(bi).frecency > ranked[oi].first)) out.push_back(base->Entry(bi++));
+        else out.push_back(overlay[ranked[oi++].second].entry);
+    }
+    return out;
+}
+
+bool HistoryStore::Find(std::wstring_view url, HistoryEntry& out) const {
+    uint64_t hash = HashUrl(url);
+    int id = FindOverlay(url, hash);
+    if (id >= 0) { out = overlay[id].entry; return true; }
+    int baseIndex = base ? base->Find(url, hash) : -1;
+    if (baseIndex < 0) return false;
+    out = base->Entry((uint32_t)baseIndex);
+    return true;
+}
+
+size_t HistoryStore::Size() const {
+    return (base ? base->Count() : 0) + overlayNew;
+}
+
+void HistoryStore::ForEach(const std::function<void(const HistoryEntry&)>& fn) {
+    FinishCheckpoint(false);
+    if (base) {
+        for (uint32_t i = 0; i < base->Count(); i++) {
+            const HistoryDbRecord& r = base->Record(i);
+            HistoryEntry e = base->Entry(i);
+            if (FindOverlay(e.url, r.urlHash) < 0) fn(e);
+        }
+    }
+    for (const OverlayEntry& o : overlay) fn(o.entry);
+}
+
+// --- CHECKPOINT ---
+// 1. The journal is rewritten to the overlay's current state (STATE records are idempotent,
+//    so they stay correct whether or not the new base makes it to disk).
+// 2. A background thread waits for that journal to reach disk, then merges base and overlay
+//    into history.db.new.
+// 3. Back on the UI thread the new base replaces the old one, overlay entries it now contains
+//    are dropped, and the journal is compacted again to what is left, so the next launch
+//    replays only changes made since.
+static HistoryRecord StateRecord(const HistoryEntry& e) {
+    HistoryRecord r;
+    r.kind = HistoryRecord::STATE;
+    r.time = e.lastVisit;
+    r.url = e.url;
+    r.title = e.title;
+    r.visitCount = e.visitCount;
+    r.firstVisit = e.firstVisit;
+    r.frecency = e.frecency;
+    return r;
+}
+
+void HistoryStore::MaybeCheckpoint() {
+    if (checkpoint.joinable()) return;
+    if (overlay.size() < CHECKPOINT_OVERLAY_ENTRIES && journal.RecordCount() < CHECKPOINT_JOURNAL_RECORDS) return;
+
+    std::vector<HistoryEntry> snapshot;
+    std::vector<HistoryRecord> state;
+    snapshot.reserve(overlay.size());
+    state.reserve(overlay.size());
+    for (const OverlayEntry& o : overlay) {
+        snapshot.push_back(o.entry);
+        state.push_back(StateRecord(o.entry));
+    }
+    journal.Compact(std::move(state));
+    checkpointSeq = seq;
+    checkpointDone = false;
+
+    std::shared_ptr<const HistoryBase> oldBase = base;
+    std::filesystem::path target = WithSuffix(dbPath, L".new");
+    checkpoint = std::thread([this, oldBase, snapshot = std::move(snapshot), target]() mutable {
+        std::unordered_multimap<uint64_t, size_t> replaced;
+        for (size_t i = 0; i < snapshot.size(); i++) replaced.emplace(HashUrl(snapshot[i].url), i);
+        std::vector<HistoryEntry> merged;
+        merged.reserve((oldBase ? oldBase->Count() : 0) + snapshot.size());
+        if (oldBase) {
+            for (uint32_t i = 0; i < oldBase->Count(); i++) {
+                HistoryEntry e = oldBase->Entry(i);
+                auto range = replaced.equal_range(oldBase->Record(i).urlHash);
+                bool shadowed = false;
+                for (auto it = range.first; it != range.second && !shadowed; ++it) shadowed = snapshot[it->second].url == e.url;
+                if (!shadowed) merged.push_back(std::move(e));
+            }
+        }
+        for (HistoryEntry& e : snapshot) merged.push_back(std::move(e));
+        std::stable_sort(merged.begin(), merged.end(),
+            [](const HistoryEntry& a, const HistoryEntry& b) { return a.frecency > b.frecency; });
+        oldBase.reset();
+        journal.Flush(); // Load promotes a whole history.db.new only over a STATE journal
+        checkpointOk = HistoryBase::Write(target, merged);
+        // Freed here rather than in the UI thread's join
+        std::vector<HistoryEntry>().swap(merged);
+        std::vector<HistoryEntry>().swap(snapshot);
+        replaced = {};
+        checkpointDone = true;
+    });
+}
+
+void HistoryStore::FinishCheckpoint(bool wait) {
+    if (!checkpoint.joinable() || (!wait && !checkpointDone)) return;
+    checkpoint.join();
+    std::filesystem::path next = WithSuffix(dbPath, L".new");
+    if (!checkpointOk) return;
+
+    base.reset(); // unmap, so the file can be replaced
+    std::error_code ec;
+    uintmax_t written = std::filesystem::file_size(next, ec);
+    if (!ec) baseBytesWritten += written;
+    std::filesystem::rename(next, dbPath, ec);
+    base = HistoryBase::Open(dbPath);
+    if (ec) return;
+
+    // Keep only overlay entries changed after the snapshot, and only they stay in the journal
+    std::vector<OverlayEntry> kept;
+    std::vector<HistoryRecord> state;
+    for (OverlayEntry& o : overlay) {
+        if (o.seq > checkpointSeq) {
+            o.inBase = true;
+            state.push_back(StateRecord(o.entry));
+            kept.push_back(std::move(o));
+        }
+    }
+    journal.Compact(std::move(state));
+    overlay.swap(kept);
+    overlayIndex.clear();
+    ranking.clear();
+    rankedStale = true;
+    shadowedBase.clear();
+    overlayNew = 0;
+    for (uint32_t id = 0; id < overlay.size(); id++) {
+        uint64_t hash = HashUrl(overlay[id].entry.url);
+        overlayIndex.emplace(hash, id);
+        ranking.insert({ overlay[id].entry.frecency, id });
+        // Entries first seen after the snapshot are not in the new base either
+        int baseIndex = base ? base->Find(overlay[id].entry.url, hash) : -1;
+        if (baseIndex >= 0) shadowedBase.push_back((uint32_t)baseIndex);
+        else { overlay[id].inBase = false; overlayNew++; }
+    }
+    std::sort(shadowedBase.begin(), shadowedBase.end());
+}
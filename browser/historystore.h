@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <set>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "historylog.h"
+
+struct HistoryEntry {
+    std::wstring url;
+    std::wstring title;
+    uint32_t visitCount = 0;
+    int64_t firstVisit = 0;
+    int64_t lastVisit = 0;
+    double frecency = 0; // see AddVisitToFrecency; only the ordering is meaningful
+};
+
+// Frecency is the sum over visits of 2^(-age / 30 days). Stored as log(sum of e^(k * visitTime)),
+// which orders entries exactly like the decayed sum at any "now" and so never needs re-scoring:
+// a visit updates one entry's key and nothing else moves.
+double AddVisitToFrecency(double frecency, uint32_t visitCountBefore, int64_t time);
+
+class HistoryBase;
+
+// The pre-journal history.dat: one URL per line, newest first, no timestamps. Returns visits
+// oldest first for HistoryStore::Import, spaced a millisecond apart ending at `now` so the
+// file's order survives; empty if there is no such file.
+std::vector<HistoryRecord> ReadLegacyHistory(const std::filesystem::path& path, int64_t now);
+
+// URL history with per-URL visit metadata and frecency ranking.
+//  - history.db: immutable base, memory-mapped on load (records sorted by frecency, an on-disk hash
+//    index and a string pool), so startup does not read the history it does not show.
+//  - overlay: entries changed since the base was written, held in memory.
+//  - history.log: journal of changes since the base; replayed into the overlay on load.
+// When the overlay grows, a checkpoint merges it into a new base on a background thread.
+// All methods are for one thread: the browser loads the store on a startup worker and then hands
+// it to the UI thread.
+class HistoryStore {
+public:
+    HistoryStore(std::filesystem::path dbPath, std::filesystem::path logPath);
+    ~HistoryStore();
+
+    HistoryStore(const HistoryStore&) = delete;
+    HistoryStore& operator=(const HistoryStore&) = delete;
+
+    void Load();
+    void RecordVisit(std::wstring_view url, int64_t time);
+    void SetTitle(std::wstring_view url, std::wstring_view title);
+    void Clear();
+    void Flush() { journal.Flush(); } // blocks until the journal is on disk
+
+    bool Find(std::wstring_view url, HistoryEntry& out) const;
+    std::vector<HistoryEntry> Top(size_t n) { return Range(0, n); }
+    // Entries [first, first + n) in Top() order. Skipping the first ones costs O(log n) per overlay
+    // entry rather than a walk, so any point of a long history can be shown.
+    std::vector<HistoryEntry> Range(size_t first, size_t n);
+    size_t Size() const;
+    void ForEach(const std::function<void(const HistoryEntry&)>& fn);
+
+    // Legacy import: adds entries (oldest first) as visits.
+    void Import(const std::vector<HistoryRecord>& records);
+
+    // Journal and checkpointed bases, since construction
+    uint64_t BytesWritten() const { return journal.BytesWritten() + baseBytesWritten; }
+
+private:
+    struct OverlayEntry {
+        HistoryEntry entry;
+        uint64_t seq = 0;     // change sequence, compared against a checkpoint's snapshot
+        bool inBase = false;  // shadows a base record
+    };
+
+    int FindOverlay(std::wstring_view url, uint64_t hash) const;
+    OverlayEntry& Touch(std::wstring_view url); // overlay entry for url, copied from the base if needed
+    void Rank(uint32_t id, double oldKey);
+    void ApplyVisit(std::wstring_view url, int64_t time);
+    void ApplyTitle(std::wstring_view url, std::wstring_view title);
+    void ApplyState(const HistoryRecord& r);
+    void ApplyClear(); // drops the overlay and deletes the base
+
+    void MaybeCheckpoint();
+    void FinishCheckpoint(bool wait);
+
+    std::filesystem::path dbPath;
+    HistoryLog journal;
+    std::shared_ptr<const HistoryBase> base;
+
+    std::vector<OverlayEntry> overlay;
+    std::unordered_multimap<uint64_t, uint32_t> overlayIndex; // url hash -> overlay id
+    std::set<std::pair<double, uint32_t>, std::greater<std::pair<double, uint32_t>>> ranking;
+    std::vector<uint32_t> shadowedBase; // base records the overlay replaces, ascending
+    std::vector<std::pair<double, uint32_t>> ranked; // `ranking` as an array, for Range
+    bool rankedStale = true;
+    size_t overlayNew = 0;
+    uint64_t seq = 0;
+
+    std::thread checkpoint;
+    std::atomic<bool> checkpointDone{ false };
+    bool checkpointOk = false;
+    uint64_t checkpointSeq = 0;
+    uint64_t baseBytesWritten = 0;
+};
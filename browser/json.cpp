@@ -0,0 +1,55 @@
+#include "json.h"
+
+#include <cstdint>
+#include <cstdio>
+
+namespace {
+void AppendEscape(std::string& out, uint32_t unit) {
+    char esc[8];
+    snprintf(esc, sizeof(esc), "\\u%04x", (unsigned)unit);
+    out += esc;
+}
+
+void AppendCodePoint(std::string& out, uint32_t c) {
+    if (c == '"' || c == '\\') { out += '\\'; out += (char)c; }
+    else if (c >= 0x20 && c < 0x7F) out += (char)c;
+    else if (c < 0x10000) AppendEscape(out, c);
+    else {
+        c -= 0x10000;
+        AppendEscape(out, 0xD800 + (c >> 10));
+        AppendEscape(out, 0xDC00 + (c & 0x3FF));
+    }
+}
+}
+
+void AppendJsonString(std::string& out, std::wstring_view s) {
+    out += '"';
+    for (wchar_t c : s) {
+        // A UTF-16 surrogate is escaped as it stands, so pairs come out as pairs
+        uint32_t u = (uint32_t)c;
+        AppendCodePoint(out, u <= 0x10FFFF ? u : 0xFFFD);
+    }
+    out += '"';
+}
+
+void AppendJsonString(std::string& out, std::string_view utf8) {
+    out += '"';
+    for (size_t i = 0; i < utf8.size();) {
+        uint32_t c = (unsigned char)utf8[i];
+        size_t length = c < 0x80 ? 1 : c >= 0xC2 && c < 0xE0 ? 2 : c >= 0xE0 && c < 0xF0 ? 3 : c >= 0xF0 && c < 0xF5 ? 4 : 0;
+        if (length == 0 || i + length > utf8.size()) { AppendCodePoint(out, 0xFFFD); i++; continue; }
+        if (length > 1) c &= 0x3F >> (length - 1);
+        bool ok = true;
+        for (size_t k = 1; k < length; k++) {
+            uint32_t b = (unsigned char)utf8[i + k];
+            if ((b & 0xC0) != 0x80) { ok = false; break; }
+            c = (c << 6) | (b & 0x3F);
+        }
+        // Overlong forms, surrogates and values past U+10FFFF are not UTF-8
+        static const uint32_t MIN[5] = { 0, 0, 0x80, 0x800, 0x10000 };
+        if (!ok || c < MIN[length] || (c >= 0xD800 && c < 0xE000) || c > 0x10FFFF) { AppendCodePoint(out, 0xFFFD); i++; continue; }
+        AppendCodePoint(out, c);
+        i += length;
+    }
+    out += '"';
+}
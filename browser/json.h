@@ -0,0 +1,11 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+// Appends `s` as a quoted JSON string literal. Anything outside printable ASCII is written as a
+// \u escape, characters past the BMP as a surrogate pair, so the output is plain ASCII. Wide
+// strings are UTF-16 on Windows and UTF-32 elsewhere; narrow ones are UTF-8, with malformed
+// bytes written as U+FFFD.
+void AppendJsonString(std::string& out, std::wstring_view s);
+void AppendJsonString(std::string& out, std::string_view utf8);
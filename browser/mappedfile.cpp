@@ -0,0 +1,56 @@
+#include "mappedfile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+bool MappedFile::Open(const std::filesystem::path& path) {
+    Close();
+    HANDLE h = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (h == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER len;
+    if (!GetFileSizeEx(h, &len) || len.QuadPart == 0) { CloseHandle(h); return false; }
+    HANDLE m = CreateFileMappingW(h, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!m) { CloseHandle(h); return false; }
+    void* view = MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0);
+    if (!view) { CloseHandle(m); CloseHandle(h); return false; }
+    file = h;
+    mapping = m;
+    data = (const uint8_t*)view;
+    size = (size_t)len.QuadPart;
+    return true;
+}
+
+void MappedFile::Close() {
+    if (data) UnmapViewOfFile(data);
+    if (mapping) CloseHandle(mapping);
+    if (file) CloseHandle(file);
+    data = nullptr; size = 0; mapping = nullptr; file = nullptr;
+}
+#else
+bool MappedFile::Open(const std::filesystem::path& path) {
+    Close();
+    int f = open(path.c_str(), O_RDONLY);
+    if (f < 0) return false;
+    struct stat st;
+    if (fstat(f, &st) != 0 || st.st_size == 0) { close(f); return false; }
+    void* view = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, f, 0);
+    if (view == MAP_FAILED) { close(f); return false; }
+    fd = f;
+    data = (const uint8_t*)view;
+    size = (size_t)st.st_size;
+    return true;
+}
+
+void MappedFile::Close() {
+    if (data) munmap((void*)data, size);
+    if (fd >= 0) close(fd);
+    data = nullptr; size = 0; fd = -1;
+}
+#endif
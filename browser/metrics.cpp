@@ -0,0 +1,321 @@
+#include "metrics.h"
+
+#include "json.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// --- HISTOGRAM ---
+static int HighestBit(uint64_t v) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, v);
+    return (int)index;
+#else
+    return 63 - __builtin_clzll(v);
+#endif
+}
+
+int LatencyHistogram::Bucket(uint64_t value) {
+    if (value < (1u << SUB_BITS)) return (int)value;
+    int shift = HighestBit(value) - SUB_BITS;
+    return ((shift + 1) << SUB_BITS) + (int)((value >> shift) & ((1u << SUB_BITS) - 1));
+}
+
+uint64_t LatencyHistogram::BucketLow(int bucket) {
+    if (bucket < (1 << SUB_BITS)) return (uint64_t)bucket;
+    int shift = (bucket >> SUB_BITS) - 1;
+    return ((uint64_t)(1u << SUB_BITS) | (uint64_t)(bucket & ((1 << SUB_BITS) - 1))) << shift;
+}
+
+void LatencyHistogram::Add(uint64_t value) {
+    counts[Bucket(value)]++;
+    total++;
+    sum += value;
+    max = (std::max)(max, value);
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+    for (int i = 0; i < BUCKETS; i++) counts[i] += other.counts[i];
+    total += other.total;
+    sum += other.sum;
+    max = (std::max)(max, other.max);
+}
+
+uint64_t LatencyHistogram::Percentile(double p) const {
+    if (total == 0) return 0;
+    uint64_t rank = (uint64_t)(p * (double)total);
+    if (rank >= total) rank = total - 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS; i++) {
+        seen += counts[i];
+        if (seen > rank) return BucketLow(i);
+    }
+    return max;
+}
+
+// --- JSON EXPORT ---
+namespace {
+void AppendHistogram(std::string& out, const char* name, const LatencyHistogram& h) {
+    char buf[256];
+    snprintf(buf, sizeof(buf), "\"%s\":{\"count\":%llu,\"mean\":%llu,\"p50\":%llu,\"p90\":%llu,\"p99\":%llu,\"max\":%llu}",
+        name, (unsigned long long)h.total, (unsigned long long)h.Mean(), (unsigned long long)h.Percentile(0.5),
+        (unsigned long long)h.Percentile(0.9), (unsigned long long)h.Percentile(0.99), (unsigned long long)h.max);
+    out += buf;
+}
+}
+
+std::string MetricsSnapshot::ToJson() const {
+    std::string out;
+    char buf[256];
+    snprintf(buf, sizeof(buf), "{\"requests\":%llu,\"blocked\":%llu,", (unsigned long long)requests, (unsigned long long)blocked);
+    out += buf;
+    AppendHistogram(out, "classifyNs", classify);
+    out += ',';
+    AppendHistogram(out, "loadNs", load);
+    out += ',';
+    AppendHistogram(out, "firstPaintNs", firstPaint);
+    out += ",\"tabs\":[";
+    for (size_t i = 0; i < tabs.size(); i++) {
+        const Tab& t = tabs[i];
+        snprintf(buf, sizeof(buf), "%s{\"tab\":%llu,\"requests\":%llu,\"blocked\":%llu,\"loadNs\":%llu,\"firstPaintNs\":%llu}",
+            i ? "," : "", (unsigned long long)t.key, (unsigned long long)t.requests, (unsigned long long)t.blocked,
+            (unsigned long long)t.loadNs, (unsigned long long)t.firstPaintNs);
+        out += buf;
+    }
+    out += "],\"hosts\":[";
+    for (size_t i = 0; i < hosts.size(); i++) {
+        const Host& h = hosts[i];
+        if (i) out += ',';
+        out += "{\"host\":";
+        AppendJsonString(out, h.host);
+        snprintf(buf, sizeof(buf), ",\"requests\":%llu,\"blocked\":%llu}", (unsigned long long)h.requests, (unsigned long long)h.blocked);
+        out += buf;
+    }
+    out += "]}\n";
+    return out;
+}
+
+#if SARF_METRICS
+// --- SHARDS ---
+// A shard is written only by its own thread, so a counter is bumped with a relaxed load and
+// store rather than an atomic add; other threads only read it, for snapshots.
+namespace {
+const uint64_t OVERFLOW_KEY = ~0ull;
+
+void Bump(std::atomic<uint64_t>& counter, uint64_t by = 1) {
+    counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+}
+
+struct AtomicHistogram {
+    std::atomic<uint64_t> counts[LatencyHistogram::BUCKETS] = {};
+    std::atomic<uint64_t> total{ 0 };
+    std::atomic<uint64_t> sum{ 0 };
+    std::atomic<uint64_t> max{ 0 };
+
+    void Add(uint64_t value) {
+        Bump(counts[LatencyHistogram::Bucket(value)]);
+        Bump(total);
+        Bump(sum, value);
+        if (value > max.load(std::memory_order_relaxed)) max.store(value, std::memory_order_relaxed);
+    }
+
+    void AddTo(LatencyHistogram& out) const {
+        LatencyHistogram h;
+        for (int i = 0; i < LatencyHistogram::BUCKETS; i++) h.counts[i] = counts[i].load(std::memory_order_relaxed);
+        h.total = total.load(std::memory_order_relaxed);
+        h.sum = sum.load(std::memory_order_relaxed);
+        h.max = max.load(std::memory_order_relaxed);
+        out.Merge(h);
+    }
+};
+
+// Open addressing on a nonzero 64-bit key. Only the owning thread inserts; a slot's key is
+// published after it is claimed, so readers never see counters under the wrong key.
+template <int FIELDS, size_t SLOTS>
+struct CounterTable {
+    struct Slot {
+        std::atomic<uint64_t> key{ 0 };
+        std::atomic<uint64_t> values[FIELDS] = {};
+    };
+
+    Slot slots[SLOTS];
+    size_t used = 0;
+
+    Slot& Find(uint64_t key, bool* inserted = nullptr) {
+        if (key == 0) key = 1;
+        for (;;) {
+            for (size_t i = (size_t)(key ^ (key >> 29)) & (SLOTS - 1);; i = (i + 1) & (SLOTS - 1)) {
+                uint64_t k = slots[i].key.load(std::memory_order_relaxed);
+                if (k == key) return slots[i];
+                if (k != 0) continue;
+                // Keep a quarter free so probes stay short and the overflow slot always fits
+                if (used >= SLOTS * 3 / 4 && key != OVERFLOW_KEY) break;
+                used++;
+                slots[i].key.store(key, std::memory_order_release);
+                if (inserted) *inserted = true;
+                return slots[i];
+            }
+            key = OVERFLOW_KEY;
+        }
+    }
+};
+
+enum TabField { TAB_REQUESTS, TAB_BLOCKED, TAB_NAV_START, TAB_LOAD, TAB_FIRST_PAINT, TAB_FIELDS };
+enum HostField { HOST_REQUESTS, HOST_BLOCKED, HOST_FIELDS };
+
+std::atomic<uint64_t> nextMetricsId{ 1 };
+}
+
+// Sixteen bytes a step in two independent lanes, the tail as an overlapping load of the last
+// sixteen, mixed once at the end: a chained per-character hash was most of the cost of an event
+uint64_t RequestMetrics::HostKey(std::wstring_view host) {
+    const char* p = (const char*)host.data();
+    size_t n = host.size() * sizeof(wchar_t);
+    uint64_t a = n, b = 0x9e3779b97f4a7c15ull;
+    uint64_t w[2] = {};
+    if (n < 16) {
+        memcpy(w, p, n);
+    } else {
+        for (; n > 16; p += 16, n -= 16) {
+            memcpy(w, p, 16);
+            a = (a + w[0]) * 0xff51afd7ed558ccdull;
+            b = (b + w[1]) * 0xc4ceb9fe1a85ec53ull;
+        }
+        memcpy(w, p + n - 16, 16);
+    }
+    a = (a + w[0]) * 0xff51afd7ed558ccdull;
+    b = (b + w[1]) * 0xc4ceb9fe1a85ec53ull;
+    uint64_t h = (a ^ (a >> 31)) + (b ^ (b >> 29));
+    h *= 0x94d049bb133111ebull;
+    return h ^ (h >> 32);
+}
+
+struct RequestMetrics::Shard {
+    std::atomic<uint64_t> requests{ 0 };
+    std::atomic<uint64_t> blocked{ 0 };
+    AtomicHistogram classify;
+    AtomicHistogram load;
+    AtomicHistogram firstPaint;
+    CounterTable<TAB_FIELDS, 256> tabs;
+    CounterTable<HOST_FIELDS, 1024> hosts;
+
+    mutable std::mutex namesLock; // taken when a host is first seen, and by snapshots
+    std::vector<std::pair<uint64_t, std::wstring>> hostNames;
+};
+
+RequestMetrics::RequestMetrics()
+    : id(nextMetricsId.fetch_add(1)) {
+}
+
+RequestMetrics::~RequestMetrics() = default;
+
+RequestMetrics::Shard& RequestMetrics::LocalShard() {
+    thread_local uint64_t lastId = 0;
+    thread_local Shard* last = nullptr;
+    if (lastId == id) return *last;
+    thread_local std::vector<std::pair<uint64_t, Shard*>> mine; // one per instance this thread has used
+    for (const auto& entry : mine) {
+        if (entry.first == id) { lastId = id; last = entry.second; return *last; }
+    }
+    auto shard = std::make_unique<Shard>();
+    last = shard.get();
+    lastId = id;
+    mine.push_back({ id, last });
+    std::lock_guard<std::mutex> g(lock);
+    shards.push_back(std::move(shard));
+    return *last;
+}
+
+void RequestMetrics::RequestClassified(uint64_t tab, uint64_t hostKey, std::wstring_view host, bool blocked, uint64_t ns) {
+    Shard& s = LocalShard();
+    Bump(s.requests);
+    s.classify.Add(ns);
+    auto& t = s.tabs.Find(tab);
+    Bump(t.values[TAB_REQUESTS]);
+    bool inserted = false;
+    auto& h = s.hosts.Find(hostKey, &inserted);
+    if (inserted && h.key.load(std::memory_order_relaxed) != OVERFLOW_KEY) {
+        std::lock_guard<std::mutex> g(s.namesLock);
+        s.hostNames.push_back({ h.key.load(std::memory_order_relaxed), std::wstring(host) });
+    }
+    Bump(h.values[HOST_REQUESTS]);
+    if (blocked) {
+        Bump(s.blocked);
+        Bump(t.values[TAB_BLOCKED]);
+        Bump(h.values[HOST_BLOCKED]);
+    }
+}
+
+void RequestMetrics::NavigationStarted(uint64_t tab, int64_t now) {
+    LocalShard().tabs.Find(tab).values[TAB_NAV_START].store((uint64_t)now, std::memory_order_relaxed);
+}
+
+void RequestMetrics::NavigationCompleted(uint64_t tab, int64_t now) {
+    Shard& s = LocalShard();
+    auto& t = s.tabs.Find(tab);
+    uint64_t start = t.values[TAB_NAV_START].load(std::memory_order_relaxed);
+    if (start == 0 || (uint64_t)now < start) return;
+    t.values[TAB_NAV_START].store(0, std::memory_order_relaxed); // redirects complete once
+    t.values[TAB_LOAD].store((uint64_t)now - start, std::memory_order_relaxed);
+    s.load.Add((uint64_t)now - start);
+}
+
+void RequestMetrics::FirstPaint(uint64_t tab, uint64_t ns) {
+    Shard& s = LocalShard();
+    s.tabs.Find(tab).values[TAB_FIRST_PAINT].store(ns, std::memory_order_relaxed);
+    s.firstPaint.Add(ns);
+}
+
+MetricsSnapshot RequestMetrics::Snapshot() const {
+    MetricsSnapshot out;
+    std::unordered_map<uint64_t, MetricsSnapshot::Tab> tabs;
+    std::unordered_map<uint64_t, MetricsSnapshot::Host> hosts;
+    std::lock_guard<std::mutex> g(lock);
+    for (const auto& shard : shards) {
+        const Shard& s = *shard;
+        out.requests += s.requests.load(std::memory_order_relaxed);
+        out.blocked += s.blocked.load(std::memory_order_relaxed);
+        s.classify.AddTo(out.classify);
+        s.load.AddTo(out.load);
+        s.firstPaint.AddTo(out.firstPaint);
+        for (const auto& slot : s.tabs.slots) {
+            uint64_t key = slot.key.load(std::memory_order_acquire);
+            if (key == 0) continue;
+            MetricsSnapshot::Tab& t = tabs[key];
+            t.key = key;
+            t.requests += slot.values[TAB_REQUESTS].load(std::memory_order_relaxed);
+            t.blocked += slot.values[TAB_BLOCKED].load(std::memory_order_relaxed);
+            t.loadNs = (std::max)(t.loadNs, slot.values[TAB_LOAD].load(std::memory_order_relaxed));
+            t.firstPaintNs = (std::max)(t.firstPaintNs, slot.values[TAB_FIRST_PAINT].load(std::memory_order_relaxed));
+        }
+        std::unordered_map<uint64_t, const std::wstring*> names;
+        std::lock_guard<std::mutex> ng(s.namesLock);
+        for (const auto& name : s.hostNames) names[name.first] = &name.second;
+        for (const auto& slot : s.hosts.slots) {
+            uint64_t key = slot.key.load(std::memory_order_acquire);
+            if (key == 0) continue;
+            MetricsSnapshot::Host& h = hosts[key];
+            if (h.host.empty()) {
+                auto name = names.find(key);
+                h.host = key == OVERFLOW_KEY ? L"(other)" : name != names.end() ? *name->second : L"";
+            }
+            h.requests += slot.values[HOST_REQUESTS].load(std::memory_order_relaxed);
+            h.blocked += slot.values[HOST_BLOCKED].load(std::memory_order_relaxed);
+        }
+    }
+    for (auto& t : tabs) out.tabs.push_back(t.second);
+    std::sort(out.tabs.begin(), out.tabs.end(), [](const MetricsSnapshot::Tab& a, const MetricsSnapshot::Tab& b) { return a.key < b.key; });
+    for (auto& h : hosts) out.hosts.push_back(std::move(h.second));
+    std::sort(out.hosts.begin(), out.hosts.end(),
+        [](const MetricsSnapshot::Host& a, const MetricsSnapshot::Host& b) { return a.requests != b.requests ? a.requests > b.requests : a.host < b.host; });
+    return out;
+}
+#endif
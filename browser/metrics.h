@@ -0,0 +1,119 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Build with SARF_METRICS=0 to compile the request metrics out: recording becomes empty inline
+// calls, timestamps are constant and snapshots come back empty.
+#ifndef SARF_METRICS
+#define SARF_METRICS 1
+#endif
+
+// Log-linear histogram in the style of HdrHistogram. Values below 8 get a bucket each and every
+// power of two above that is split into 8, so a value is known to within 12.5% anywhere from
+// nanoseconds to hours, in a fixed 4 KB.
+struct LatencyHistogram {
+    static const int SUB_BITS = 3;
+    static const int BUCKETS = (64 - SUB_BITS + 1) << SUB_BITS;
+
+    static int Bucket(uint64_t value);
+    static uint64_t BucketLow(int bucket); // the smallest value that lands in `bucket`
+
+    uint64_t counts[BUCKETS] = {};
+    uint64_t total = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+
+    void Add(uint64_t value);
+    void Merge(const LatencyHistogram& other);
+    uint64_t Percentile(double p) const; // low bound of the bucket holding it; 0 when empty
+    uint64_t Mean() const { return total ? sum / total : 0; }
+};
+
+struct MetricsSnapshot {
+    struct Tab {
+        uint64_t key = 0;
+        uint64_t requests = 0;
+        uint64_t blocked = 0;
+        uint64_t loadNs = 0;       // of the last completed navigation
+        uint64_t firstPaintNs = 0; // of the last navigation that reported one
+    };
+    struct Host {
+        std::wstring host;
+        uint64_t requests = 0;
+        uint64_t blocked = 0;
+    };
+
+    uint64_t requests = 0;
+    uint64_t blocked = 0;
+    LatencyHistogram classify;   // time spent deciding whether to block a request
+    LatencyHistogram load;       // navigation start to complete
+    LatencyHistogram firstPaint; // navigation start to first paint
+    std::vector<Tab> tabs;       // by key
+    std::vector<Host> hosts;     // most requests first
+
+    std::string ToJson() const;
+};
+
+inline int64_t MetricsNow() {
+#if SARF_METRICS
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#else
+    return 0;
+#endif
+}
+
+#if SARF_METRICS
+// Counters and latency histograms for the request pipeline. Each thread records into a shard of
+// its own with plain relaxed stores, so recording never locks or contends; Snapshot sums the
+// shards. Tabs and hosts are counted in fixed tables per shard; past their capacity, new ones
+// are counted together under a key of ~0.
+class RequestMetrics {
+public:
+    RequestMetrics();
+    ~RequestMetrics();
+
+    RequestMetrics(const RequestMetrics&) = delete;
+    RequestMetrics& operator=(const RequestMetrics&) = delete;
+
+    // Any thread. Hashing the host is about half the cost of an event; a caller that records
+    // many events for a host it already knows can hash it once with HostKey and pass the key.
+    void RequestClassified(uint64_t tab, std::wstring_view host, bool blocked, uint64_t ns) {
+        RequestClassified(tab, HostKey(host), host, blocked, ns);
+    }
+    void RequestClassified(uint64_t tab, uint64_t hostKey, std::wstring_view host, bool blocked, uint64_t ns);
+    static uint64_t HostKey(std::wstring_view host);
+
+    // Navigation events for a tab must come from one thread, as WebView2's do
+    void NavigationStarted(uint64_t tab, int64_t now);
+    void NavigationCompleted(uint64_t tab, int64_t now);
+    void FirstPaint(uint64_t tab, uint64_t ns); // after navigation start, as the page reports it
+
+    MetricsSnapshot Snapshot() const;
+
+private:
+    struct Shard;
+    Shard& LocalShard();
+
+    const uint64_t id; // tells this instance's shards apart in each thread's cache
+    mutable std::mutex lock;
+    std::vector<std::unique_ptr<Shard>> shards;
+};
+#else
+class RequestMetrics {
+public:
+    void RequestClassified(uint64_t, std::wstring_view, bool, uint64_t) {}
+    void RequestClassified(uint64_t, uint64_t, std::wstring_view, bool, uint64_t) {}
+    static uint64_t HostKey(std::wstring_view) { return 0; }
+    void NavigationStarted(uint64_t, int64_t) {}
+    void NavigationCompleted(uint64_t, int64_t) {}
+    void FirstPaint(uint64_t, uint64_t) {}
+    MetricsSnapshot Snapshot() const { return {}; }
+};
+#endif
@@ -0,0 +1,364 @@
+#include "omnibox.h"
+#include "psl.h"
+#include "url.h"
+
+#include <algorithm>
+#include <cmath>
+
+static wchar_t Fold(wchar_t c) {
+    return (c >= L'A' && c <= L'Z') ? (wchar_t)(c - L'A' + L'a') : c;
+}
+
+static std::wstring_view StripPrefix(std::wstring_view s, std::wstring_view prefix) {
+    if (s.size() >= prefix.size()) {
+        for (size_t i = 0; i < prefix.size(); i++) if (Fold(s[i]) != prefix[i]) return s;
+        s.remove_prefix(prefix.size());
+    }
+    return s;
+}
+
+// What the user would type: no scheme, no "www."
+static std::wstring_view TypedForm(std::wstring_view s) {
+    s = StripPrefix(s, L"https://");
+    s = StripPrefix(s, L"http://");
+    return StripPrefix(s, L"www.");
+}
+
+// The same for a stored URL, which also loses any userinfo
+static std::wstring_view TypedFormOfUrl(std::wstring_view url) {
+    Url parsed;
+    if (!ParseUrl(url, parsed) || !parsed.hasAuthority) return url;
+    return StripPrefix(url.substr((size_t)(parsed.host.data() - url.data())), L"www.");
+}
+
+static uint64_t Trigram(const wchar_t* p) {
+    return ((uint64_t)(uint16_t)p[0] << 32) | ((uint64_t)(uint16_t)p[1] << 16) | (uint16_t)p[2];
+}
+
+// Keeps the ids of `a` that are also in `b`, both ascending. Galloping through `b` makes a
+// short list against a long one cost little more than the short one.
+static void IntersectSorted(std::vector<uint32_t>& a, const std::vector<uint32_t>& b) {
+    size_t kept = 0, j = 0;
+    for (size_t i = 0; i < a.size() && j < b.size(); i++) {
+        size_t step = 1;
+        while (j + step < b.size() && b[j + step] < a[i]) { j += step; step <<= 1; }
+        j = (size_t)(std::lower_bound(b.begin() + j, b.begin() + (std::min)(j + step + 1, b.size()), a[i]) - b.begin());
+        if (j < b.size() && b[j] == a[i]) a[kept++] = a[i];
+    }
+    a.resize(kept);
+}
+
+static std::vector<uint64_t> Trigrams(const std::wstring& s) {
+    std::vector<uint64_t> grams;
+    for (size_t i = 0; i + 3 <= s.size(); i++) grams.push_back(Trigram(s.data() + i));
+    std::sort(grams.begin(), grams.end());
+    grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+    return grams;
+}
+
+static bool IsHostChar(wchar_t c) {
+    return (c >= L'a' && c <= L'z') || (c >= L'A' && c <= L'Z') || (c >= L'0' && c <= L'9') || c == L'-' || c == L'.' || c == L'_';
+}
+
+bool ClassifyOmniboxInput(std::wstring_view text, std::wstring& url) {
+    while (!text.empty() && text.front() == L' ') text.remove_prefix(1);
+    while (!text.empty() && text.back() == L' ') text.remove_suffix(1);
+    if (text.empty()) return false;
+
+    // "localhost:8080" and "example.com:443" parse with the host as the scheme, so only
+    // authority URLs and the schemes that have none count as already complete.
+    Url parsed;
+    if (ParseUrl(text, parsed)) {
+        std::wstring_view s = parsed.scheme;
+        bool opaque = false;
+        for (std::wstring_view known : { L"about", L"data", L"mailto", L"javascript", L"file" }) {
+            if (s.size() == known.size() && std::equal(s.begin(), s.end(), known.begin(), [](wchar_t a, wchar_t b) { return Fold(a) == b; })) opaque = true;
+        }
+        if (parsed.hasAuthority || opaque) { url = text; return true; }
+    }
+    if (text.find(L' ') != std::wstring_view::npos) return false;
+
+    std::wstring_view hostPort = text.substr(0, ScanForAny(text.data(), text.size(), L'/', L'?', L'#'));
+    std::wstring_view host = hostPort;
+    bool hasPort = false;
+    size_t colon = hostPort.rfind(L':');
+    if (colon != std::wstring_view::npos && (hostPort[0] != L'[' || hostPort[colon - 1] == L']')) {
+        std::wstring_view port = hostPort.substr(colon + 1);
+        if (port.empty() || port.size() > 5) return false;
+        for (wchar_t c : port) if (c < L'0' || c > L'9') return false;
+        host = hostPort.substr(0, colon);
+        hasPort = true;
+    }
+    if (host.empty()) return false;
+
+    bool local = IsIpLiteral(host);
+    if (!local) {
+        for (wchar_t c : host) if (!IsHostChar(c)) return false;
+        if (host.front() == L'.' || host.find(L"..") != std::wstring_view::npos) return false;
+        local = host.size() == 9 && std::equal(host.begin(), host.end(), L"localhost", [](wchar_t a, wchar_t b) { return Fold(a) == b; });
+        bool listed = false;
+        PublicSuffixLength(host, &listed);
+        bool known = listed && !RegistrableDomain(host).empty();
+        if (!local && !known && !hasPort) return false;
+    }
+    url = (local || hasPort ? L"http://" : L"https://") + std::wstring(text);
+    return true;
+}
+
+static const wchar_t SEARCH_URL[] = L"https://www.google.com/search?q=";
+
+// application/x-www-form-urlencoded: unreserved characters as they are, space as '+',
+// everything else as percent-escaped UTF-8
+static void AppendQueryByte(std::wstring& out, uint32_t b) {
+    static const wchar_t hex[] = L"0123456789ABCDEF";
+    bool unreserved = (b >= 'a' && b <= 'z') || (b >= 'A' && b <= 'Z') || (b >= '0' && b <= '9') || b == '-' || b == '.' || b == '_' || b == '~';
+    if (unreserved) out += (wchar_t)b;
+    else if (b == ' ') out += L'+';
+    else { out += L'%'; out += hex[b >> 4]; out += hex[b & 15]; }
+}
+
+std::wstring OmniboxNavigationUrl(std::wstring_view text) {
+    std::wstring url;
+    if (ClassifyOmniboxInput(text, url)) return url;
+    while (!text.empty() && text.front() == L' ') text.remove_prefix(1);
+    while (!text.empty() && text.back() == L' ') text.remove_suffix(1);
+    url = SEARCH_URL;
+    for (size_t i = 0; i < text.size(); i++) {
+        uint32_t c = (uint32_t)text[i];
+        if (sizeof(wchar_t) == 2 && c >= 0xD800 && c < 0xDC00 && i + 1 < text.size() && text[i + 1] >= 0xDC00 && text[i + 1] < 0xE000)
+            c = 0x10000 + ((c - 0xD800) << 10) + ((uint32_t)text[++i] - 0xDC00);
+        else if (c >= 0xD800 && c < 0xE000) c = 0xFFFD; // lone surrogate
+        if (c < 0x80) AppendQueryByte(url, c);
+        else if (c < 0x800) { AppendQueryByte(url, 0xC0 | c >> 6); AppendQueryByte(url, 0x80 | (c & 0x3F)); }
+        else if (c < 0x10000) {
+            AppendQueryByte(url, 0xE0 | c >> 12); AppendQueryByte(url, 0x80 | ((c >> 6) & 0x3F));
+            AppendQueryByte(url, 0x80 | (c & 0x3F));
+        }
+        else {
+            AppendQueryByte(url, 0xF0 | c >> 18); AppendQueryByte(url, 0x80 | ((c >> 12) & 0x3F));
+            AppendQueryByte(url, 0x80 | ((c >> 6) & 0x3F)); AppendQueryByte(url, 0x80 | (c & 0x3F));
+        }
+    }
+    return url;
+}
+
+void OmniboxIndex::Update(std::wstring_view url, std::wstring_view title, double frecency) {
+    std::wstring folded;
+    folded.reserve(url.size() + title.size() + 3);
+    for (wchar_t c : TypedFormOfUrl(url)) folded += Fold(c);
+    folded += L'\n'; // terms never contain it, so no match spans URL and title
+    for (wchar_t c : title) folded += Fold(c);
+    folded += L"\n\n"; // every real character starts a trigram
+
+    lastValid = false;
+    auto it = byUrl.find(std::wstring(url));
+    if (it == byUrl.end()) {
+        uint32_t id = (uint32_t)entries.size();
+        byUrl.emplace(std::wstring(url), id);
+        entries.push_back({ std::wstring(url), std::wstring(title), std::move(folded), frecency });
+        ranking.insert({ frecency, id });
+        IndexText(id, std::wstring());
+        return;
+    }
+
+    uint32_t id = it->second;
+    Entry& e = entries[id];
+    if (e.frecency != frecency) {
+        ranking.erase({ e.frecency, id });
+        ranking.insert({ frecency, id });
+        e.frecency = frecency;
+    }
+    if (e.folded != folded) {
+        std::wstring oldFolded = std::move(e.folded);
+        e.title = title;
+        e.folded = std::move(folded);
+        IndexText(id, oldFolded);
+    }
+}
+
+void OmniboxIndex::IndexText(uint32_t id, const std::wstring& oldFolded) {
+    // Only trigrams the old text lacked; postings for trigrams the entry lost stay behind and are
+    // filtered out when queries verify candidates.
+    std::vector<uint64_t> old = Trigrams(oldFolded);
+    for (uint64_t g : Trigrams(entries[id].folded)) {
+        if (std::binary_search(old.begin(), old.end(), g)) continue;
+        std::vector<uint32_t>& list = postings[g];
+        if (list.empty()) {
+            byPair[(uint32_t)(g >> 16)].push_back(g);
+            byFirst[(wchar_t)(g >> 32)].push_back(g);
+        }
+        // New entries take the next id, so this is an append unless a title changed
+        if (list.empty() || list.back() < id) { list.push_back(id); continue; }
+        auto at = std::lower_bound(list.begin(), list.end(), id);
+        if (*at != id) list.insert(at, id);
+    }
+}
+
+OmniboxIndex::Candidates OmniboxIndex::TermCandidates(const std::wstring& term, size_t intersectLimit) const {
+    Candidates c;
+    auto add = [this, &c](uint64_t g) {
+        const std::vector<uint32_t>& list = postings.at(g);
+        c.lists.push_back(&list);
+        c.size += list.size();
+    };
+    if (term.size() >= 3) {
+        std::vector<const std::vector<uint32_t>*> lists;
+        if (!TrigramLists(term, lists)) return Candidates();
+        if (lists.size() == 1 || lists[0]->size() > intersectLimit) {
+            c.lists.push_back(lists[0]);
+            c.size = lists[0]->size();
+            return c;
+        }
+        c.ids = *lists[0];
+        Intersect(c.ids, lists, 1);
+        c.size = c.ids.size();
+    }
+    else if (term.size() == 2) {
+        auto it = byPair.find(((uint32_t)(uint16_t)term[0] << 16) | (uint16_t)term[1]);
+        if (it != byPair.end()) for (uint64_t g : it->second) add(g);
+    }
+    else {
+        auto it = byFirst.find(term[0]);
+        if (it != byFirst.end()) for (uint64_t g : it->second) add(g);
+    }
+    return c;
+}
+
+void OmniboxIndex::Clear() {
+    entries.clear();
+    byUrl.clear();
+    postings.clear();
+    byPair.clear();
+    byFirst.clear();
+    ranking.clear();
+    lastValid = false;
+    lastCandidates.clear();
+}
+
+bool OmniboxIndex::MatchesAll(uint32_t id, const std::vector<std::wstring>& terms) const {
+    const std::wstring& text = entries[id].folded;
+    for (const std::wstring& t : terms) if (text.find(t) == std::wstring::npos) return false;
+    return true;
+}
+
+std::vector<uint32_t> OmniboxIndex::Flatten(Candidates&& candidates) const {
+    std::vector<uint32_t> ids = std::move(candidates.ids);
+    for (const std::vector<uint32_t>* list : candidates.lists) ids.insert(ids.end(), list->begin(), list->end());
+    if (candidates.lists.size() > 1) {
+        // The lists of a short term's trigrams overlap
+        std::sort(ids.begin(), ids.end());
+        ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    }
+    return ids;
+}
+
+bool OmniboxIndex::TrigramLists(const std::wstring& term, std::vector<const std::vector<uint32_t>*>& lists) const {
+    for (size_t i = 0; i + 3 <= term.size(); i++) {
+        auto it = postings.find(Trigram(term.data() + i));
+        if (it == postings.end()) return false;
+        lists.push_back(&it->second);
+    }
+    std::sort(lists.begin(), lists.end(),
+        [](const std::vector<uint32_t>* a, const std::vector<uint32_t>* b) { return a->size() < b->size(); });
+    return true;
+}
+
+void OmniboxIndex::Intersect(std::vector<uint32_t>& ids, const std::vector<const std::vector<uint32_t>*>& lists, size_t from) const {
+    // Shortest first, so the ids thin out before they meet the long lists. A trigram most entries
+    // have would drop few ids for a cache miss apiece; verification catches those instead.
+    for (size_t i = from; i < lists.size() && !ids.empty() && lists[i]->size() <= entries.size() / 2; i++) IntersectSorted(ids, *lists[i]);
+}
+
+void OmniboxIndex::Narrow(std::vector<uint32_t>& ids, const std::vector<std::wstring>& terms, size_t skip) const {
+    std::vector<const std::vector<uint32_t>*> lists;
+    for (size_t t = 0; t < terms.size(); t++) {
+        if (t != skip && !TrigramLists(terms[t], lists)) { ids.clear(); return; }
+    }
+    std::sort(lists.begin(), lists.end(),
+        [](const std::vector<uint32_t>* a, const std::vector<uint32_t>* b) { return a->size() < b->size(); });
+    Intersect(ids, lists, 0);
+}
+
+std::vector<uint32_t> OmniboxIndex::Best(const std::vector<uint32_t>& ids, const std::vector<std::wstring>& terms, size_t limit) const {
+    // Verifying an entry costs a look at its text, ordering it only at its frecency; candidates
+    // are mostly matches by now, so verifying best first stops after about `limit` of them
+    std::vector<std::pair<double, uint32_t>> ordered;
+    ordered.reserve(ids.size());
+    for (uint32_t id : ids) ordered.push_back({ entries[id].frecency, id });
+    std::sort(ordered.begin(), ordered.end(), std::greater<std::pair<double, uint32_t>>());
+    std::vector<uint32_t> best;
+    for (size_t i = 0; i < ordered.size() && best.size() < limit; i++) {
+        if (MatchesAll(ordered[i].second, terms)) best.push_back(ordered[i].second);
+    }
+    return best;
+}
+
+static const size_t INTERSECT_FACTOR = 16;
+static const size_t WALK_SLACK = 4;
+
+std::vector<OmniboxMatch> OmniboxIndex::Query(std::wstring_view text, size_t limit) {
+    std::wstring query;
+    for (wchar_t c : TypedForm(text)) query += Fold(c);
+
+    std::vector<std::wstring> terms;
+    for (size_t i = 0; i < query.size();) {
+        size_t end = query.find(L' ', i);
+        if (end == std::wstring::npos) end = query.size();
+        if (end > i) terms.emplace_back(query, i, end - i);
+        i = end + 1;
+    }
+    std::vector<OmniboxMatch> results;
+    if (terms.empty() || limit == 0) return results;
+
+    // Past this many candidates, walking in frecency order beats verifying the posting list:
+    // with density p = size / N the walk expects limit / p steps.
+    size_t threshold = (size_t)std::sqrt((double)entries.size() * (double)limit) + limit;
+    // A term's postings are intersected up front when its rarest is no longer than this, which
+    // costs less than a walk that the rarest alone would mistake for a dense one
+    size_t intersectLimit = threshold * INTERSECT_FACTOR;
+
+    std::vector<uint32_t> candidates; // ascending; every match is among them
+    std::vector<uint32_t> matches;    // the best `limit`, in frecency order
+    bool walked = false;              // matches came from the walk; there are no candidates
+
+    if (lastValid && query.compare(0, lastQuery.size(), lastQuery) == 0) {
+        // Extending the last query can only narrow its candidates
+        candidates = lastCandidates;
+        Narrow(candidates, terms, terms.size());
+    }
+    else {
+        Candidates best;
+        size_t bestTerm = 0;
+        for (size_t i = 0; i < terms.size(); i++) {
+            Candidates c = TermCandidates(terms[i], intersectLimit);
+            if (i == 0 || c.size < best.size) { best = std::move(c); bestTerm = i; }
+        }
+        if (best.size > threshold) {
+            // Dense: the best matches turn up early in frecency order. If the candidates were all
+            // matches the walk would take limit / p steps; give up after a few times that, as
+            // they are then mostly not, and intersect and verify them instead.
+            size_t walkLimit = (std::min)(best.size, limit * WALK_SLACK * entries.size() / best.size + limit);
+            size_t steps = 0;
+            auto it = ranking.begin();
+            for (; it != ranking.end() && matches.size() < limit && steps < walkLimit; ++it, ++steps) {
+                if (MatchesAll(it->second, terms)) matches.push_back(it->second);
+            }
+            walked = matches.size() >= limit || it == ranking.end();
+        }
+        if (!walked) {
+            if (best.ids.empty() && best.lists.size() == 1 && terms[bestTerm].size() >= 3)
+                best = TermCandidates(terms[bestTerm], entries.size()); // its rarest list stood in
+            candidates = Flatten(std::move(best));
+            Narrow(candidates, terms, bestTerm);
+        }
+    }
+
+    lastValid = !walked && candidates.size() <= threshold;
+    if (lastValid) {
+        lastQuery = query;
+        lastCandidates = candidates;
+    }
+    if (!walked) matches = Best(candidates, terms, limit);
+    for (uint32_t id : matches) results.push_back({ entries[id].url, entries[id].title, entries[id].frecency });
+    return results;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+struct OmniboxMatch {
+    std::wstring url;
+    std::wstring title;
+    double frecency = 0;
+};
+
+// Whether typed text is an address rather than a search, without asking the network: URLs with
+// a scheme, "localhost", IP literals, anything with a port, and host names whose suffix is on the
+// Public Suffix List ("github.com", not "node.js"). On true, `url` is what to load.
+bool ClassifyOmniboxInput(std::wstring_view text, std::wstring& url);
+
+// What to load for typed text: the address when ClassifyOmniboxInput takes it as one, otherwise
+// a web search for it, with the query form-encoded as UTF-8.
+std::wstring OmniboxNavigationUrl(std::wstring_view text);
+
+// As-you-type suggestions over history URLs and titles. Every entry's text (URL without scheme
+// and "www.", then title, case-folded) is indexed by trigram. A query is split into terms, and an
+// entry matches when every term is a substring of its text; results come back by frecency.
+// Each term names a candidate set: the intersection of its trigrams' posting lists (kept sorted
+// by id), or for a one- or two-character term the postings of every trigram it begins.
+//  - if the smallest candidate set is small, it is narrowed by every term's trigrams and
+//    verified best first, until the limit is met;
+//  - otherwise matches are dense, so entries are walked in frecency order until the limit is met,
+//    for about as many steps as that density predicts; past that the candidates are narrowed and
+//    verified after all. A term whose trigrams are all common is not intersected until then.
+// The last query's candidates are kept, so typing one more character only narrows them.
+// Updates are incremental. Not thread-safe; the UI thread owns it.
+class OmniboxIndex {
+public:
+    void Update(std::wstring_view url, std::wstring_view title, double frecency); // add or replace
+    void Clear();
+    size_t Size() const { return entries.size(); }
+
+    std::vector<OmniboxMatch> Query(std::wstring_view text, size_t limit = 8);
+
+private:
+    struct Entry {
+        std::wstring url;
+        std::wstring title;
+        std::wstring folded; // searchable text
+        double frecency = 0;
+    };
+
+    struct Candidates {
+        std::vector<const std::vector<uint32_t>*> lists;
+        std::vector<uint32_t> ids; // intersected trigram postings, in place of lists
+        size_t size = 0; // total ids over lists, duplicates included
+    };
+
+    void IndexText(uint32_t id, const std::wstring& oldFolded);
+    // Postings longer than intersectLimit are not intersected; the rarest stands for the term
+    Candidates TermCandidates(const std::wstring& term, size_t intersectLimit) const;
+    std::vector<uint32_t> Flatten(Candidates&& candidates) const; // ascending, each id once
+    // The postings of every trigram of `term`, shortest first; false if one has none
+    bool TrigramLists(const std::wstring& term, std::vector<const std::vector<uint32_t>*>& lists) const;
+    void Intersect(std::vector<uint32_t>& ids, const std::vector<const std::vector<uint32_t>*>& lists, size_t from) const;
+    // Drops ids missing a trigram of any term but terms[skip]
+    void Narrow(std::vector<uint32_t>& ids, const std::vector<std::wstring>& terms, size_t skip) const;
+    bool MatchesAll(uint32_t id, const std::vector<std::wstring>& terms) const;
+    std::vector<uint32_t> Best(const std::vector<uint32_t>& ids, const std::vector<std::wstring>& terms, size_t limit) const;
+
+    std::vector<Entry> entries;
+    std::unordered_map<std::wstring, uint32_t> byUrl;
+    std::unordered_map<uint64_t, std::vector<uint32_t>> postings; // trigram -> ids; may hold stale ids
+    std::unordered_map<uint32_t, std::vector<uint64_t>> byPair;    // first two characters -> trigrams
+    std::unordered_map<wchar_t, std::vector<uint64_t>> byFirst;    // first character -> trigrams
+    std::set<std::pair<double, uint32_t>, std::greater<std::pair<double, uint32_t>>> ranking;
+
+    // Refinement: candidate set of the last query, valid until the next update
+    std::wstring lastQuery;
+    std::vector<uint32_t> lastCandidates;
+    bool lastValid = false;
+};
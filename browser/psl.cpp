@@ -0,0 +1,87 @@
+#include "psl.h"
+#include "url.h"
+
+#include <cstdint>
+
+namespace {
+struct PslNode {
+    uint32_t firstEdge;
+    uint8_t edgeCount;
+    uint8_t flags;
+};
+
+struct PslEdge {
+    uint32_t text;   // offset into PSL_TEXT; the label characters in reverse
+    uint8_t length;
+    uint32_t target;
+};
+
+enum : uint8_t {
+    PSL_RULE = 1,      // the name is a public suffix
+    PSL_WILDCARD = 2,  // every child label of the name is one
+    PSL_EXCEPTION = 4, // the name is not one, despite a wildcard above it
+};
+
+#include "psl.inc"
+}
+
+static wchar_t Fold(wchar_t c) {
+    return (c >= L'A' && c <= L'Z') ? (wchar_t)(c - L'A' + L'a') : c;
+}
+
+static std::wstring_view TrimDot(std::wstring_view host) {
+    while (!host.empty() && host.back() == L'.') host.remove_suffix(1);
+    return host;
+}
+
+size_t PublicSuffixLength(std::wstring_view host, bool* listed) {
+    host = TrimDot(host);
+    size_t n = host.size();
+    size_t lastDot = host.rfind(L'.');
+    size_t suffix = (lastDot == std::wstring_view::npos) ? n : n - lastDot - 1; // implicit "*"
+    bool found = false;
+
+    // Walk the DAFSA from the last character; at every label boundary the node's flags say which
+    // rules end there. Deeper matches have more labels and so take precedence.
+    const PslNode* node = &PSL_NODES[0];
+    size_t pos = n; // host[pos, n) is matched
+    while (pos > 0) {
+        wchar_t c = Fold(host[pos - 1]);
+        const PslEdge* edge = nullptr;
+        for (uint32_t e = node->firstEdge; e < node->firstEdge + node->edgeCount; e++) {
+            if ((wchar_t)(unsigned char)PSL_TEXT[PSL_EDGES[e].text] == c) { edge = &PSL_EDGES[e]; break; }
+        }
+        if (!edge || edge->length > pos) break;
+        size_t k = 1;
+        while (k < edge->length && (wchar_t)(unsigned char)PSL_TEXT[edge->text + k] == Fold(host[pos - 1 - k])) k++;
+        if (k < edge->length) break;
+        pos -= edge->length;
+        node = &PSL_NODES[edge->target];
+        if (pos > 0 && host[pos - 1] != L'.') continue;
+
+        if (node->flags & PSL_EXCEPTION) {
+            // The prevailing rule whatever else matched: the suffix is the name minus its first label
+            size_t dot = host.find(L'.', pos);
+            if (listed) *listed = true;
+            return dot == std::wstring_view::npos ? 0 : n - dot - 1;
+        }
+        if (node->flags & PSL_RULE) { suffix = n - pos; found = true; }
+        if ((node->flags & PSL_WILDCARD) && pos >= 2) {
+            size_t start = host.rfind(L'.', pos - 2);
+            suffix = n - (start == std::wstring_view::npos ? 0 : start + 1);
+            found = true;
+        }
+    }
+    if (listed) *listed = found;
+    return suffix;
+}
+
+std::wstring_view RegistrableDomain(std::wstring_view host) {
+    host = TrimDot(host);
+    if (IsIpLiteral(host)) return host;
+    size_t n = host.size();
+    size_t suffix = PublicSuffixLength(host);
+    if (suffix + 2 > n) return {}; // needs a label and a dot in front of the suffix
+    size_t dot = host.rfind(L'.', n - suffix - 2);
+    return host.substr(dot == std::wstring_view::npos ? 0 : dot + 1);
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+// Public Suffix List lookups. The list is compiled into psl.inc by tools/make_psl_dafsa.py.
+// Host names are expected in ASCII (punycode) form; case and a trailing dot are ignored.
+
+// Length of the host's public suffix ("co.uk" for "news.bbc.co.uk"). `listed` is set to false when
+// no rule matched and the implicit "*" rule gave the last label.
+size_t PublicSuffixLength(std::wstring_view host, bool* listed = nullptr);
+
+// eTLD+1 ("bbc.co.uk" for "news.bbc.co.uk"). IP literals are returned whole; a host that is
+// itself a public suffix has none, and gets an empty view.
+std::wstring_view RegistrableDomain(std::wstring_view host);
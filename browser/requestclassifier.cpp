@@ -0,0 +1,72 @@
+#include "requestclassifier.h"
+#include "admatcher.h"
+#include "url.h"
+
+// List of common ad server keywords, compiled once into a case-insensitive automaton
+static const AdMatcher adMatcher = {
+    L"doubleclick.net",
+    L"googlesyndication.com",
+    L"googleadservices.com",
+    L"adnxs.com",
+    L"criteo.com",
+    L"pubmatic.com",
+    L"rubiconproject.com",
+    L"adsystem",
+    L"/ads/",
+    L"pagead2",
+    L"amazon-adsystem",
+    L"ads.twitter.com",
+    L"facebook.com/tr/", // Pixel trackers
+    L"moatads.com"
+};
+
+// Only host and path are matched, so "/ads/" in a query string or fragment does not count
+bool IsAdUrl(std::wstring_view url) {
+    Url parsed;
+    return adMatcher.Matches(ParseUrl(url, parsed) ? parsed.HostToPath() : url);
+}
+
+RequestClassifier::RequestClassifier(const RulesetStore& rules)
+    : rules(rules) {
+}
+
+// Both halves in one, reading the ruleset and parsing the hosts once for the lookup and the engine
+bool RequestClassifier::ShouldBlock(std::wstring_view url, std::wstring_view sourceUrl, uint32_t type) {
+    RulesetStore::Reader ruleset(rules);
+    if (!ruleset.Get() || ruleset->filters.RuleCount() == 0) return IsAdUrl(url);
+    std::wstring_view host = UrlHost(url), sourceHost = UrlHost(sourceUrl);
+    DecisionCache::Result cached = decisions.Lookup(sourceHost, host, type, ruleset->generation);
+    if (cached != DecisionCache::MISS) return cached == DecisionCache::BLOCK;
+    return Classify(*ruleset.Get(), url, host, sourceHost, type);
+}
+
+bool RequestClassifier::Cached(std::wstring_view url, std::wstring_view sourceUrl, uint32_t type, bool& block) {
+    RulesetStore::Reader ruleset(rules);
+    if (!ruleset.Get() || ruleset->filters.RuleCount() == 0) {
+        block = IsAdUrl(url); // as cheap as a lookup, so never worth a trip to a worker
+        return true;
+    }
+    DecisionCache::Result cached = decisions.Lookup(UrlHost(sourceUrl), UrlHost(url), type, ruleset->generation);
+    if (cached == DecisionCache::MISS) return false;
+    block = cached == DecisionCache::BLOCK;
+    return true;
+}
+
+bool RequestClassifier::Uncached(std::wstring_view url, std::wstring_view sourceUrl, uint32_t type) {
+    RulesetStore::Reader ruleset(rules);
+    if (!ruleset.Get() || ruleset->filters.RuleCount() == 0) return IsAdUrl(url);
+    return Classify(*ruleset.Get(), url, UrlHost(url), UrlHost(sourceUrl), type);
+}
+
+bool RequestClassifier::Classify(const Ruleset& ruleset, std::wstring_view url, std::wstring_view host,
+    std::wstring_view sourceHost, uint32_t type) {
+    FilterRequest req;
+    req.url = url;
+    req.host = host;
+    req.sourceHost = sourceHost;
+    req.type = type;
+    req.thirdParty = IsThirdPartyHost(req.host, req.sourceHost);
+    FilterSet::Decision decision = ruleset.filters.Classify(req);
+    if (decision.hostOnly) decisions.Store(req.sourceHost, req.host, req.type, ruleset.generation, decision.block);
+    return decision.block;
+}
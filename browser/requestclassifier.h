@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "decisioncache.h"
+#include "ruleset.h"
+
+// Built-in keyword list matched against host and path; the fallback while no filter list
+// rules are published
+bool IsAdUrl(std::wstring_view url);
+
+// Whether to block one request: by the published filter lists when they hold any rules, by
+// IsAdUrl otherwise. Host-only verdicts are cached per ruleset generation. The browser's request
+// handler and the trace replay tool both decide through this, so a replay reproduces the
+// browser's decisions exactly. Safe to call from any thread.
+class RequestClassifier {
+public:
+    explicit RequestClassifier(const RulesetStore& rules);
+
+    RequestClassifier(const RequestClassifier&) = delete;
+    RequestClassifier& operator=(const RequestClassifier&) = delete;
+
+    bool ShouldBlock(std::wstring_view url, std::wstring_view sourceUrl, uint32_t type);
+
+    // ShouldBlock in two halves, for callers that answer from the cache on one thread and run
+    // the filter engine on another. Cached is false when there is no cached verdict; without
+    // filter list rules it always decides, by IsAdUrl.
+    bool Cached(std::wstring_view url, std::wstring_view sourceUrl, uint32_t type, bool& block);
+    bool Uncached(std::wstring_view url, std::wstring_view sourceUrl, uint32_t type);
+
+    DecisionCache::Stats CacheStats() const { return decisions.GetStats(); }
+
+private:
+    bool Classify(const Ruleset& ruleset, std::wstring_view url, std::wstring_view host, std::wstring_view sourceHost, uint32_t type);
+
+    const RulesetStore& rules;
+    DecisionCache decisions;
+};
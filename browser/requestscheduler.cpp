@@ -0,0 +1,144 @@
+#include "requestscheduler.h"
+
+#include <algorithm>
+
+RequestScheduler::RequestScheduler(Config config) : config(config) {}
+
+void RequestScheduler::Add(uint64_t tab) {
+    tabs[tab];
+}
+
+void RequestScheduler::Remove(uint64_t tab, int64_t now) {
+    auto it = tabs.find(tab);
+    if (it == tabs.end()) return;
+    ReleaseAll(it->second, now);
+    FreeSlots(it->second);
+    tabs.erase(it);
+    if (hasForeground && foreground == tab) hasForeground = false;
+    Dispatch(now);
+}
+
+void RequestScheduler::Activate(uint64_t tab, int64_t now) {
+    foreground = tab;
+    hasForeground = true;
+    Tab& t = tabs[tab];
+    ReleaseAll(t, now);
+    FreeSlots(t); // the foreground's requests are not counted
+    Dispatch(now);
+}
+
+void RequestScheduler::ViewClosed(uint64_t tab, int64_t now) {
+    auto it = tabs.find(tab);
+    if (it == tabs.end()) return;
+    ReleaseAll(it->second, now);
+    FreeSlots(it->second);
+    Dispatch(now);
+}
+
+RequestSchedule RequestScheduler::Submit(const ScheduledRequest& request, int64_t now) {
+    if (hasForeground && request.tab == foreground) return REQUEST_SEND;
+    auto it = tabs.find(request.tab);
+    if (it == tabs.end()) return REQUEST_SEND;
+    Tab& t = it->second;
+    if (request.type & config.deferredTypes) {
+        if (request.type & config.coalescedTypes) {
+            for (const Waiting& w : t.deferred) {
+                if (w.request.url == request.url) { stats.coalesced++; return REQUEST_COALESCED; }
+            }
+        }
+        t.deferred.push_back({ request, now });
+    }
+    else if (t.ready.empty() && t.inFlight.size() < config.tabSlots && backgroundInFlight < config.backgroundSlots) {
+        t.inFlight.push_back({ request.url, now });
+        backgroundInFlight++;
+        stats.sent++;
+        return REQUEST_SEND;
+    }
+    else t.ready.push_back({ request, now });
+    stats.held++;
+    stats.holding++;
+    return REQUEST_HOLD;
+}
+
+void RequestScheduler::Finished(uint64_t tab, std::wstring_view url, int64_t now) {
+    auto it = tabs.find(tab);
+    if (it == tabs.end()) return;
+    std::vector<InFlight>& inFlight = it->second.inFlight;
+    auto slot = std::find_if(inFlight.begin(), inFlight.end(), [url](const InFlight& f) { return f.url == url; });
+    if (slot == inFlight.end()) return; // not one it counted, or its slot already timed out
+    inFlight.erase(slot);
+    backgroundInFlight--;
+    Dispatch(now);
+}
+
+void RequestScheduler::Tick(int64_t now) {
+    for (auto& [id, t] : tabs) {
+        if (hasForeground && id == foreground) continue;
+        size_t before = t.inFlight.size();
+        t.inFlight.erase(std::remove_if(t.inFlight.begin(), t.inFlight.end(),
+            [&](const InFlight& f) { return now - f.since >= config.slotTimeoutMs; }), t.inFlight.end());
+        stats.timedOut += before - t.inFlight.size();
+        backgroundInFlight -= before - t.inFlight.size();
+
+        // Both queues are in arrival order, so whatever has waited too long is at the front. It
+        // goes past the slot limits, but still takes a slot.
+        for (std::deque<Waiting>* queue : { &t.ready, &t.deferred }) {
+            while (!queue->empty() && now - queue->front().since >= config.maxHoldMs) {
+                t.inFlight.push_back({ queue->front().request.url, now });
+                backgroundInFlight++;
+                stats.aged++;
+                Release(queue->front(), now);
+                queue->pop_front();
+            }
+        }
+    }
+    Dispatch(now);
+}
+
+size_t RequestScheduler::Drain(std::vector<ScheduledRequest>& out) {
+    size_t n = released.size();
+    for (ScheduledRequest& r : released) out.push_back(std::move(r));
+    released.clear();
+    return n;
+}
+
+void RequestScheduler::Release(Waiting& waiting, int64_t now) {
+    stats.maxWaitMs = (std::max)(stats.maxWaitMs, now - waiting.since);
+    stats.released++;
+    stats.holding--;
+    released.push_back(std::move(waiting.request));
+}
+
+void RequestScheduler::ReleaseAll(Tab& tab, int64_t now) {
+    for (Waiting& w : tab.ready) Release(w, now);
+    for (Waiting& w : tab.deferred) Release(w, now);
+    tab.ready.clear();
+    tab.deferred.clear();
+}
+
+void RequestScheduler::FreeSlots(Tab& tab) {
+    backgroundInFlight -= tab.inFlight.size();
+    tab.inFlight.clear();
+}
+
+// Free background slots go round robin, one request per tab per pass, resuming after the tab
+// served last so that a busy tab early in the order cannot take them all
+void RequestScheduler::Dispatch(int64_t now) {
+    bool progress = true;
+    while (progress && backgroundInFlight < config.backgroundSlots) {
+        progress = false;
+        auto next = tabs.upper_bound(lastServed);
+        for (size_t n = tabs.size(); n > 0 && backgroundInFlight < config.backgroundSlots; n--) {
+            if (next == tabs.end()) next = tabs.begin();
+            auto it = next++;
+            Tab& t = it->second;
+            if (t.ready.empty() || t.inFlight.size() >= config.tabSlots) continue;
+            t.inFlight.push_back({ t.ready.front().request.url, now });
+            backgroundInFlight++;
+            Release(t.ready.front(), now);
+            t.ready.pop_front();
+            lastServed = it->first;
+            progress = true;
+        }
+    }
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "filterlist.h"
+
+// A request held open by its event source (in the browser, a deferred WebResourceRequested
+// event) until the scheduler lets it go
+struct ScheduledRequest {
+    uint64_t id = 0;  // the event source's, to find the held request again
+    uint64_t tab = 0; // TabHandle::Key
+    uint32_t type = FT_OTHER;
+    std::wstring url;
+};
+
+enum RequestSchedule {
+    REQUEST_SEND,      // let it through now
+    REQUEST_HOLD,      // keep it held; it comes back out of Drain
+    REQUEST_COALESCED, // the same request is already held; answer this one without sending it
+};
+
+// Keeps background tabs from competing with the one being looked at. The foreground tab's
+// requests, and those of tabs never added (a preload), always go at once. A background tab gets
+// a few requests in flight at a time, out of a budget shared by all background tabs, which are
+// served round robin. Low-priority types (images, media, pings) from a background tab are held
+// until it is shown, and a ping identical to one already held is coalesced into it.
+// Nothing starves: a request held for maxHoldMs is sent regardless, and a slot whose request is
+// never seen finishing (a long poll, a cancelled load) is given back after slotTimeoutMs.
+// Requests let go later collect until Drain. Single-threaded: the UI thread owns it.
+class RequestScheduler {
+public:
+    struct Config {
+        uint32_t tabSlots = 2;        // in flight per background tab
+        uint32_t backgroundSlots = 6; // in flight across all background tabs
+        uint32_t deferredTypes = FT_IMAGE | FT_MEDIA | FT_PING; // held until the tab is shown
+        uint32_t coalescedTypes = FT_PING;
+        int64_t maxHoldMs = 30 * 1000;
+        int64_t slotTimeoutMs = 20 * 1000;
+    };
+
+    struct Stats {
+        uint64_t sent = 0;      // background requests let through at once
+        uint64_t held = 0;
+        uint64_t released = 0; // held ones let go since
+        uint64_t aged = 0;     // of those, for having waited maxHoldMs
+        uint64_t coalesced = 0;
+        uint64_t timedOut = 0; // slots given back for want of a finish
+        size_t holding = 0;    // held now
+        int64_t maxWaitMs = 0;
+    };
+
+    explicit RequestScheduler(Config config);
+
+    RequestScheduler(const RequestScheduler&) = delete;
+    RequestScheduler& operator=(const RequestScheduler&) = delete;
+
+    // Tabs start out in the background
+    void Add(uint64_t tab);
+    // Everything the tab was holding is let go
+    void Remove(uint64_t tab, int64_t now);
+    // The tab is now in front: what it was holding is let go, and the one before goes to the back
+    void Activate(uint64_t tab, int64_t now);
+    // The tab's view closed (discarded): what it held is let go and its slots are free
+    void ViewClosed(uint64_t tab, int64_t now);
+
+    RequestSchedule Submit(const ScheduledRequest& request, int64_t now);
+    // A response for `url` arrived in `tab`, freeing the slot of the oldest request for it
+    void Finished(uint64_t tab, std::wstring_view url, int64_t now);
+    void Tick(int64_t now); // call periodically
+
+    // Appends every request let go since the last call to `out`; returns how many
+    size_t Drain(std::vector<ScheduledRequest>& out);
+
+    Stats GetStats() const { return stats; }
+
+private:
+    struct Waiting {
+        ScheduledRequest request;
+        int64_t since = 0;
+    };
+    struct InFlight {
+        std::wstring url;
+        int64_t since = 0;
+    };
+    struct Tab {
+        std::deque<Waiting> ready;    // waiting for a slot, in arrival order
+        std::deque<Waiting> deferred; // low priority, waiting to be shown
+        std::vector<InFlight> inFlight;
+    };
+
+    void Release(Waiting& waiting, int64_t now);
+    void ReleaseAll(Tab& tab, int64_t now);
+    void FreeSlots(Tab& tab);
+    void Dispatch(int64_t now);
+
+    Config config;
+    std::map<uint64_t, Tab> tabs; // ordered, for round robin
+    uint64_t foreground = 0;
+    bool hasForeground = false;
+    uint64_t lastServed = 0; // the round robin resumes after this tab
+    size_t backgroundInFlight = 0;
+    std::vector<ScheduledRequest> released;
+    Stats stats;
+};
@@ -0,0 +1,252 @@
+#include "requesttrace.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#include "mappedfile.h"
+
+// --- FILE FORMAT ---
+// [TraceHeader] then blocks of [TraceBlockHeader][records], little-endian. A record is
+//   varint time since the block's base, varint tab, varint type, byte flags,
+//   varint url bytes, url, and unless TRACE_SAME_SOURCE, varint source bytes, source
+// with strings in UTF-8. Records lean only on earlier ones in the same block, and each block
+// carries a checksum, so a torn or corrupt block ends the trace without taking others with it.
+namespace {
+const char TRACE_MAGIC[8] = { 'S', 'A', 'R', 'F', 'T', 'R', 'C', 'E' };
+const uint32_t TRACE_VERSION = 1;
+const size_t TRACE_BLOCK_RECORDS = 4096;
+
+enum TraceFlags : uint8_t {
+    TRACE_BLOCKED = 1 << 0,
+    TRACE_SAME_SOURCE = 1 << 1, // source as in the previous record of the block
+};
+
+struct TraceHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+};
+
+struct TraceBlockHeader {
+    uint32_t payloadBytes;
+    uint32_t recordCount;
+    int64_t baseTime;
+    uint64_t checksum; // of the fields above and the payload
+};
+
+uint64_t Fnv64(const uint8_t* p, size_t n, uint64_t h = 14695981039346656037ull) {
+    for (size_t i = 0; i < n; i++) { h ^= p[i]; h *= 1099511628211ull; }
+    return h;
+}
+
+uint64_t BlockChecksum(const uint8_t* block, size_t size) {
+    uint64_t c = Fnv64(block, offsetof(TraceBlockHeader, checksum));
+    return Fnv64(block + sizeof(TraceBlockHeader), size - sizeof(TraceBlockHeader), c);
+}
+
+void PutVarint(std::string& out, uint64_t v) {
+    while (v >= 0x80) { out.push_back((char)(v | 0x80)); v >>= 7; }
+    out.push_back((char)v);
+}
+
+bool GetVarint(const uint8_t*& p, const uint8_t* end, uint64_t& v) {
+    v = 0;
+    for (int shift = 0; shift < 64 && p < end; shift += 7) {
+        uint8_t b = *p++;
+        v |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+void PutUtf8(std::string& out, const std::wstring& s) {
+    std::string bytes;
+    bytes.reserve(s.size());
+    for (size_t i = 0; i < s.size(); i++) {
+        uint32_t c = (uint32_t)s[i];
+        if (sizeof(wchar_t) == 2 && c >= 0xD800 && c < 0xDC00 && i + 1 < s.size() && s[i + 1] >= 0xDC00 && s[i + 1] < 0xE000)
+            c = 0x10000 + ((c - 0xD800) << 10) + ((uint32_t)s[++i] - 0xDC00);
+        if (c < 0x80) bytes.push_back((char)c);
+        else if (c < 0x800) { bytes.push_back((char)(0xC0 | c >> 6)); bytes.push_back((char)(0x80 | (c & 0x3F))); }
+        else if (c < 0x10000) {
+            bytes.push_back((char)(0xE0 | c >> 12)); bytes.push_back((char)(0x80 | ((c >> 6) & 0x3F)));
+            bytes.push_back((char)(0x80 | (c & 0x3F)));
+        }
+        else {
+            bytes.push_back((char)(0xF0 | c >> 18)); bytes.push_back((char)(0x80 | ((c >> 12) & 0x3F)));
+            bytes.push_back((char)(0x80 | ((c >> 6) & 0x3F))); bytes.push_back((char)(0x80 | (c & 0x3F)));
+        }
+    }
+    PutVarint(out, bytes.size());
+    out += bytes;
+}
+
+bool GetUtf8(const uint8_t*& p, const uint8_t* end, std::wstring& s) {
+    uint64_t n;
+    if (!GetVarint(p, end, n) || (uint64_t)(end - p) < n) return false;
+    const uint8_t* stop = p + n;
+    s.clear();
+    s.reserve((size_t)n);
+    while (p < stop) {
+        uint32_t c = *p++;
+        int more = c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : c >= 0xC0 ? 1 : 0;
+        if (more) c &= 0x3F >> more;
+        for (; more && p < stop; more--) c = (c << 6) | (*p++ & 0x3F);
+        if (sizeof(wchar_t) == 2 && c >= 0x10000) {
+            c -= 0x10000;
+            s.push_back((wchar_t)(0xD800 + (c >> 10)));
+            s.push_back((wchar_t)(0xDC00 + (c & 0x3FF)));
+        }
+        else s.push_back((wchar_t)c);
+    }
+    return true;
+}
+
+void AppendBlock(std::string& out, const RequestTraceRecord* records, size_t count) {
+    size_t start = out.size();
+    out.resize(start + sizeof(TraceBlockHeader));
+    int64_t base = records[0].time;
+    for (size_t i = 0; i < count; i++) {
+        const RequestTraceRecord& r = records[i];
+        PutVarint(out, (uint64_t)(r.time - base));
+        PutVarint(out, r.tab);
+        PutVarint(out, r.type);
+        bool sameSource = i > 0 && r.source == records[i - 1].source;
+        out.push_back((char)((r.blocked ? TRACE_BLOCKED : 0) | (sameSource ? TRACE_SAME_SOURCE : 0)));
+        PutUtf8(out, r.url);
+        if (!sameSource) PutUtf8(out, r.source);
+    }
+    TraceBlockHeader h = {};
+    h.payloadBytes = (uint32_t)(out.size() - start - sizeof(h));
+    h.recordCount = (uint32_t)count;
+    h.baseTime = base;
+    memcpy(&out[start], &h, sizeof(h));
+    h.checksum = BlockChecksum((const uint8_t*)out.data() + start, out.size() - start);
+    memcpy(&out[start], &h, sizeof(h));
+}
+
+bool DecodeBlock(const uint8_t* block, size_t size, std::vector<RequestTraceRecord>& out) {
+    TraceBlockHeader h;
+    memcpy(&h, block, sizeof(h));
+    if (BlockChecksum(block, size) != h.checksum) return false;
+    const uint8_t* p = block + sizeof(h);
+    const uint8_t* end = block + size;
+    size_t first = out.size();
+    for (uint32_t i = 0; i < h.recordCount; i++) {
+        RequestTraceRecord r;
+        uint64_t delta, tab, type;
+        if (!GetVarint(p, end, delta) || !GetVarint(p, end, tab) || !GetVarint(p, end, type) || p >= end) return false;
+        uint8_t flags = *p++;
+        r.time = h.baseTime + (int64_t)delta;
+        r.tab = tab;
+        r.type = (uint32_t)type;
+        r.blocked = (flags & TRACE_BLOCKED) != 0;
+        if (!GetUtf8(p, end, r.url)) return false;
+        if (!(flags & TRACE_SAME_SOURCE)) { if (!GetUtf8(p, end, r.source)) return false; }
+        else if (out.size() > first) r.source = out.back().source;
+        out.push_back(std::move(r));
+    }
+    return p == end;
+}
+}
+
+bool ReadRequestTrace(const std::filesystem::path& path, std::vector<RequestTraceRecord>& out, bool* complete) {
+    MappedFile file;
+    if (!file.Open(path)) return false;
+    const uint8_t* p = file.Data();
+    const uint8_t* end = p + file.Size();
+    TraceHeader th;
+    if (file.Size() < sizeof(th)) return false;
+    memcpy(&th, p, sizeof(th));
+    if (memcmp(th.magic, TRACE_MAGIC, sizeof(th.magic)) != 0 || th.version != TRACE_VERSION) return false;
+    p += sizeof(th);
+    bool intact = true;
+    while (p < end) {
+        TraceBlockHeader h;
+        if ((size_t)(end - p) < sizeof(h)) { intact = false; break; }
+        memcpy(&h, p, sizeof(h));
+        size_t size = sizeof(h) + h.payloadBytes;
+        size_t before = out.size();
+        if ((size_t)(end - p) < size || !DecodeBlock(p, size, out)) { out.resize(before); intact = false; break; }
+        p += size;
+    }
+    if (complete) *complete = intact;
+    return true;
+}
+
+// --- WRITER ---
+RequestTraceWriter::RequestTraceWriter(std::filesystem::path path, std::chrono::milliseconds flushInterval)
+    : path(std::move(path)), flushInterval(flushInterval), started(std::chrono::steady_clock::now()) {
+    file.open(this->path, std::ios::out | std::ios::binary | std::ios::trunc);
+    TraceHeader h = {};
+    memcpy(h.magic, TRACE_MAGIC, sizeof(h.magic));
+    h.version = TRACE_VERSION;
+    file.write((const char*)&h, sizeof(h));
+    file.flush();
+    open = (bool)file;
+    if (open) worker = std::thread([this] { Run(); });
+}
+
+RequestTraceWriter::~RequestTraceWriter() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    if (worker.joinable()) worker.join();
+}
+
+int64_t RequestTraceWriter::Elapsed() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - started).count();
+}
+
+void RequestTraceWriter::Append(RequestTraceRecord record) {
+    if (!open) return;
+    std::lock_guard<std::mutex> guard(lock);
+    pending.push_back(std::move(record));
+    queuedSeq++;
+}
+
+void RequestTraceWriter::Flush() {
+    std::unique_lock<std::mutex> guard(lock);
+    uint64_t target = queuedSeq;
+    flushRequested = true;
+    wake.notify_all();
+    flushed.wait(guard, [this, target]() { return writtenSeq >= target || !worker.joinable(); });
+}
+
+RequestTraceWriter::Stats RequestTraceWriter::GetStats() {
+    std::lock_guard<std::mutex> guard(lock);
+    return stats;
+}
+
+void RequestTraceWriter::Run() {
+    std::unique_lock<std::mutex> guard(lock);
+    std::vector<RequestTraceRecord> records;
+    std::string bytes;
+    while (true) {
+        wake.wait_for(guard, flushInterval, [this]() { return stopping || flushRequested; });
+        flushRequested = false;
+        records.clear();
+        records.swap(pending);
+        uint64_t seq = queuedSeq;
+        bool stop = stopping;
+        guard.unlock();
+        bytes.clear();
+        for (size_t i = 0; i < records.size(); i += TRACE_BLOCK_RECORDS)
+            AppendBlock(bytes, records.data() + i, (std::min)(TRACE_BLOCK_RECORDS, records.size() - i));
+        bool ok = true;
+        if (!bytes.empty()) {
+            file.write(bytes.data(), (std::streamsize)bytes.size());
+            file.flush();
+            ok = (bool)file;
+        }
+        guard.lock();
+        if (ok) { stats.records += records.size(); stats.bytes += bytes.size(); }
+        else stats.failures++;
+        writtenSeq = seq;
+        flushed.notify_all();
+        if (stop && pending.empty()) return;
+    }
+}
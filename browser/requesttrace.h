@@ -0,0 +1,69 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One request as the browser's request handler saw it
+struct RequestTraceRecord {
+    int64_t time = 0;     // nanoseconds since the capture began
+    uint64_t tab = 0;     // TabHandle::Key of the tab that issued it
+    uint32_t type = 0;    // FilterType its resource context maps to
+    bool blocked = false; // the decision at capture time
+    std::wstring url;
+    std::wstring source;  // the page that issued it
+};
+
+// Reads every intact record, oldest first. False if the file is missing or not a trace; a torn
+// or corrupt block (a capture cut short) ends the trace there and clears *complete.
+bool ReadRequestTrace(const std::filesystem::path& path, std::vector<RequestTraceRecord>& out, bool* complete = nullptr);
+
+// Captures requests to a compact binary trace. Appends are queued in memory and encoded and
+// written by a background thread in blocks, so the request handler never waits on disk.
+class RequestTraceWriter {
+public:
+    explicit RequestTraceWriter(std::filesystem::path path, std::chrono::milliseconds flushInterval = std::chrono::seconds(1));
+    ~RequestTraceWriter(); // writes whatever is still queued
+
+    RequestTraceWriter(const RequestTraceWriter&) = delete;
+    RequestTraceWriter& operator=(const RequestTraceWriter&) = delete;
+
+    bool IsOpen() const { return open; }
+    const std::filesystem::path& Path() const { return path; }
+    int64_t Elapsed() const; // nanoseconds since the capture began, for RequestTraceRecord::time
+
+    void Append(RequestTraceRecord record);
+    void Flush(); // blocks until everything queued so far is on disk
+
+    struct Stats {
+        uint64_t records = 0; // written
+        uint64_t bytes = 0;
+        uint64_t failures = 0;
+    };
+    Stats GetStats();
+
+private:
+    void Run();
+
+    std::filesystem::path path;
+    std::chrono::milliseconds flushInterval;
+    std::chrono::steady_clock::time_point started;
+    std::ofstream file; // worker thread only, once started
+    bool open = false;
+
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable flushed;
+    std::vector<RequestTraceRecord> pending;
+    uint64_t queuedSeq = 0, writtenSeq = 0;
+    bool flushRequested = false;
+    bool stopping = false;
+    Stats stats;
+    std::thread worker;
+};
@@ -0,0 +1,165 @@
+#include "ruleset.h"
+
+#include <algorithm>
+
+// --- EPOCH-BASED RECLAMATION ---
+// Process-wide reader slots. A thread claims one slot on its first read and keeps it for life;
+// while reading, the slot holds the epoch the thread entered at (0 = not reading).
+namespace {
+const int READER_SLOTS = 128;
+
+struct alignas(64) ReaderSlot {
+    std::atomic<uint64_t> epoch{ 0 };
+    std::atomic<bool> claimed{ false };
+};
+
+ReaderSlot readerSlots[READER_SLOTS];
+std::atomic<uint64_t> globalEpoch{ 1 };
+
+struct ThreadSlot {
+    ReaderSlot* slot = nullptr;
+    int depth = 0;
+
+    ~ThreadSlot() {
+        if (slot) slot->claimed.store(false, std::memory_order_release);
+    }
+
+    ReaderSlot* Claim() {
+        while (!slot) {
+            for (ReaderSlot& s : readerSlots) {
+                bool expected = false;
+                if (!s.claimed.load(std::memory_order_relaxed) && s.claimed.compare_exchange_strong(expected, true)) { slot = &s; break; }
+            }
+            if (!slot) std::this_thread::yield(); // more live reader threads than slots
+        }
+        return slot;
+    }
+};
+
+thread_local ThreadSlot threadSlot;
+
+void PinEpoch() {
+    if (threadSlot.depth++ > 0) return;
+    threadSlot.Claim()->epoch.store(globalEpoch.load());
+}
+
+void UnpinEpoch() {
+    if (--threadSlot.depth > 0) return;
+    threadSlot.slot->epoch.store(0, std::memory_order_release);
+}
+
+// Oldest epoch any reader is still pinned at (UINT64_MAX if none).
+uint64_t OldestPinnedEpoch() {
+    uint64_t oldest = UINT64_MAX;
+    for (ReaderSlot& s : readerSlots) {
+        uint64_t e = s.epoch.load();
+        if (e != 0 && e < oldest) oldest = e;
+    }
+    return oldest;
+}
+}
+
+// --- RULESET STORE ---
+RulesetStore::Reader::Reader(const RulesetStore& store) {
+    PinEpoch();
+    ruleset = store.current.load();
+}
+
+RulesetStore::Reader::~Reader() {
+    UnpinEpoch();
+}
+
+RulesetStore::~RulesetStore() {
+    delete current.load();
+    for (auto& r : retired) delete r.second;
+}
+
+void RulesetStore::Publish(std::unique_ptr<Ruleset> next) {
+    {
+        std::lock_guard<std::mutex> guard(writerLock);
+        next->generation = generation.load() + 1;
+        Ruleset* old = current.exchange(next.release());
+        generation.fetch_add(1, std::memory_order_release);
+        // Readers that pinned at or before this epoch may still hold `old`.
+        uint64_t epoch = globalEpoch.fetch_add(1);
+        if (old) retired.push_back({ epoch, old });
+    }
+    Reclaim();
+}
+
+void RulesetStore::Reclaim() {
+    std::lock_guard<std::mutex> guard(writerLock);
+    uint64_t oldest = OldestPinnedEpoch();
+    auto done = std::partition(retired.begin(), retired.end(),
+        [oldest](const std::pair<uint64_t, Ruleset*>& r) { return r.first >= oldest; });
+    for (auto it = done; it != retired.end(); ++it) delete it->second;
+    retired.erase(done, retired.end());
+}
+
+size_t RulesetStore::RetiredCount() {
+    std::lock_guard<std::mutex> guard(writerLock);
+    return retired.size();
+}
+
+// --- RELOADER ---
+RulesetReloader::RulesetReloader(RulesetStore& store, std::filesystem::path listDir, std::filesystem::path snapshotPath,
+    std::chrono::milliseconds interval)
+    : store(store), listDir(std::move(listDir)), snapshotPath(std::move(snapshotPath)), interval(interval) {
+}
+
+RulesetReloader::~RulesetReloader() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    if (worker.joinable()) worker.join();
+}
+
+void RulesetReloader::Start(uint64_t currentStamp) {
+    worker = std::thread([this, currentStamp]() { Run(currentStamp); });
+}
+
+void RulesetReloader::CheckNow() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        checkRequested = true;
+    }
+    wake.notify_all();
+}
+
+void RulesetReloader::Run(uint64_t stamp) {
+    while (true) {
+        std::vector<std::filesystem::path> lists = FilterListFiles(listDir);
+        uint64_t latest = lists.empty() ? 0 : FilterListStamp(lists);
+        if (latest != stamp) {
+            auto next = std::make_unique<Ruleset>();
+            next->sourceStamp = latest;
+            FilterListBuilder builder;
+            bool cancelled = false;
+            for (const auto& list : lists) {
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    if (stopping) { cancelled = true; break; }
+                }
+                builder.AddFile(list);
+            }
+            if (cancelled) return;
+            next->filters = builder.Build();
+            store.Publish(std::move(next));
+            if (onPublish) onPublish();
+            // The old ruleset may be the mapped snapshot; it is usually reclaimed by now,
+            // otherwise the file stays stale until the next launch rebuilds it.
+            if (!lists.empty()) {
+                RulesetStore::Reader reader(store);
+                reader->filters.SaveSnapshot(snapshotPath, latest);
+            }
+            stamp = latest;
+        }
+
+        std::unique_lock<std::mutex> guard(lock);
+        wake.wait_for(guard, interval, [this]() { return stopping || checkRequested; });
+        if (stopping) return;
+        checkRequested = false;
+    }
+}
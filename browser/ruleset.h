@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "filterlist.h"
+
+// Immutable set of blocking rules. Once published it is never modified, only replaced.
+struct Ruleset {
+    FilterSet filters;
+    uint64_t sourceStamp = 0;
+    uint64_t generation = 0; // assigned by RulesetStore::Publish
+};
+
+// Holds the current Ruleset behind an atomic pointer (RCU style).
+// Readers never lock: they pin the current epoch, load the pointer and unpin.
+// Replaced rulesets are freed once no thread is still pinned at an older epoch.
+class RulesetStore {
+public:
+    RulesetStore() = default;
+    ~RulesetStore();
+    RulesetStore(const RulesetStore&) = delete;
+    RulesetStore& operator=(const RulesetStore&) = delete;
+
+    class Reader {
+    public:
+        explicit Reader(const RulesetStore& store);
+        ~Reader();
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+
+        const Ruleset* Get() const { return ruleset; } // may be null before the first Publish
+        const Ruleset* operator->() const { return ruleset; }
+
+    private:
+        const Ruleset* ruleset;
+    };
+
+    void Publish(std::unique_ptr<Ruleset> next);
+    void Reclaim(); // frees retired rulesets that no reader can still see
+    uint64_t Generation() const { return generation.load(std::memory_order_acquire); }
+    size_t RetiredCount(); // replaced but not yet freed
+
+private:
+    std::atomic<Ruleset*> current{ nullptr };
+    std::atomic<uint64_t> generation{ 0 };
+    std::mutex writerLock; // publishers only; readers never touch it
+    std::vector<std::pair<uint64_t, Ruleset*>> retired; // (epoch at retirement, ruleset)
+};
+
+// Background thread that watches the filter list folder and publishes a rebuilt Ruleset
+// (and refreshed snapshot) whenever the lists change.
+class RulesetReloader {
+public:
+    RulesetReloader(RulesetStore& store, std::filesystem::path listDir, std::filesystem::path snapshotPath,
+        std::chrono::milliseconds interval);
+    ~RulesetReloader();
+
+    // Called on the reloader's thread after each ruleset it publishes; set before Start.
+    void OnPublish(std::function<void()> published) { onPublish = std::move(published); }
+    // currentStamp: stamp of whatever is already published (0 if nothing).
+    void Start(uint64_t currentStamp);
+    void CheckNow();
+
+private:
+    void Run(uint64_t stamp);
+
+    RulesetStore& store;
+    std::filesystem::path listDir;
+    std::filesystem::path snapshotPath;
+    std::chrono::milliseconds interval;
+    std::function<void()> onPublish;
+    std::mutex lock;
+    std::condition_variable wake;
+    bool stopping = false;
+    bool checkRequested = false;
+    std::thread worker;
+};
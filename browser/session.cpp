@@ -0,0 +1,247 @@
+#include "session.h"
+
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// --- FILE FORMAT ---
+// [SessionHeader][per tab: uint32 url units, uint32 title units, url, title], little-endian,
+// strings in UTF-16LE. The checksum covers everything before and after it, so a torn or
+// foreign file is rejected.
+namespace {
+const char SESSION_MAGIC[8] = { 'S', 'A', 'R', 'F', 'S', 'E', 'S', 'S' };
+const uint32_t SESSION_VERSION = 1;
+
+struct SessionHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t tabCount;
+    uint32_t active;
+    uint32_t reserved;
+    uint64_t payloadBytes;
+    uint64_t checksum;
+};
+
+uint64_t Fnv64(const uint8_t* p, size_t n, uint64_t h = 14695981039346656037ull) {
+    for (size_t i = 0; i < n; i++) { h ^= p[i]; h *= 1099511628211ull; }
+    return h;
+}
+
+// Everything but the checksum field itself
+uint64_t SessionChecksum(const uint8_t* data, size_t size) {
+    uint64_t c = Fnv64(data, offsetof(SessionHeader, checksum));
+    return Fnv64(data + sizeof(SessionHeader), size - sizeof(SessionHeader), c);
+}
+
+void PutU32(std::string& out, uint32_t v) {
+    for (int i = 0; i < 4; i++) out.push_back((char)(v >> (8 * i)));
+}
+
+uint32_t GetU32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+std::u16string ToUtf16(const std::wstring& s) {
+    std::u16string out;
+    out.reserve(s.size());
+    for (wchar_t wc : s) {
+        uint32_t c = (uint32_t)wc;
+        if (c > 0xFFFF) { c -= 0x10000; out.push_back((char16_t)(0xD800 + (c >> 10))); out.push_back((char16_t)(0xDC00 + (c & 0x3FF))); }
+        else out.push_back((char16_t)c);
+    }
+    return out;
+}
+
+std::wstring FromUtf16(const uint8_t* p, size_t units) {
+    std::wstring s;
+    s.reserve(units);
+    for (size_t i = 0; i < units; i++) {
+        uint32_t c = p[2 * i] | (p[2 * i + 1] << 8);
+        if (sizeof(wchar_t) == 4 && c >= 0xD800 && c < 0xDC00 && i + 1 < units) {
+            uint32_t lo = p[2 * i + 2] | (p[2 * i + 3] << 8);
+            if (lo >= 0xDC00 && lo < 0xE000) { c = 0x10000 + ((c - 0xD800) << 10) + (lo - 0xDC00); i++; }
+        }
+        s.push_back((wchar_t)c);
+    }
+    return s;
+}
+
+void PutUtf16(std::string& out, const std::u16string& s) {
+    for (char16_t c : s) { out.push_back((char)(c & 0xFF)); out.push_back((char)(c >> 8)); }
+}
+
+std::filesystem::path WithSuffix(const std::filesystem::path& path, const wchar_t* suffix) {
+    std::filesystem::path p = path;
+    p += suffix;
+    return p;
+}
+
+// Writes `bytes` to path.tmp and flushes it to the disk, then moves `path` to path.old and
+// path.tmp to `path`. A crash between the two moves leaves no `path`, and Load takes path.old.
+bool ReplaceFileDurably(const std::filesystem::path& path, const std::string& bytes) {
+    std::filesystem::path tmp = WithSuffix(path, L".tmp"), old = WithSuffix(path, L".old");
+#ifdef _WIN32
+    HANDLE h = CreateFileW(tmp.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (h == INVALID_HANDLE_VALUE) return false;
+    DWORD done = 0;
+    bool ok = WriteFile(h, bytes.data(), (DWORD)bytes.size(), &done, NULL) && done == bytes.size() && FlushFileBuffers(h);
+    CloseHandle(h);
+    if (!ok) return false;
+    MoveFileExW(path.c_str(), old.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH); // none before the first
+    return MoveFileExW(tmp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+    int f = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (f < 0) return false;
+    size_t done = 0;
+    while (done < bytes.size()) {
+        ssize_t n = write(f, bytes.data() + done, bytes.size() - done);
+        if (n <= 0) break;
+        done += (size_t)n;
+    }
+    bool ok = done == bytes.size() && fsync(f) == 0;
+    close(f);
+    if (!ok) return false;
+    rename(path.c_str(), old.c_str()); // none before the first
+    if (rename(tmp.c_str(), path.c_str()) != 0) return false;
+    // The rename itself lives in the directory
+    int dir = open(path.has_parent_path() ? path.parent_path().c_str() : ".", O_RDONLY);
+    if (dir >= 0) { fsync(dir); close(dir); }
+    return true;
+#endif
+}
+}
+
+std::string EncodeSession(const Session& session) {
+    std::string out(sizeof(SessionHeader), '\0');
+    for (const SessionTab& tab : session.tabs) {
+        std::u16string url = ToUtf16(tab.url), title = ToUtf16(tab.title);
+        PutU32(out, (uint32_t)url.size());
+        PutU32(out, (uint32_t)title.size());
+        PutUtf16(out, url);
+        PutUtf16(out, title);
+    }
+    SessionHeader h = {};
+    memcpy(h.magic, SESSION_MAGIC, sizeof(h.magic));
+    h.version = SESSION_VERSION;
+    h.tabCount = (uint32_t)session.tabs.size();
+    h.active = (uint32_t)session.active;
+    h.payloadBytes = out.size() - sizeof(SessionHeader);
+    memcpy(&out[0], &h, sizeof(h));
+    h.checksum = SessionChecksum((const uint8_t*)out.data(), out.size());
+    memcpy(&out[0], &h, sizeof(h));
+    return out;
+}
+
+bool DecodeSession(const uint8_t* data, size_t size, Session& out) {
+    SessionHeader h;
+    if (size < sizeof(h)) return false;
+    memcpy(&h, data, sizeof(h));
+    if (memcmp(h.magic, SESSION_MAGIC, sizeof(h.magic)) != 0 || h.version != SESSION_VERSION) return false;
+    if (h.payloadBytes != size - sizeof(h)) return false;
+    const uint8_t* p = data + sizeof(h);
+    const uint8_t* end = data + size;
+    if (SessionChecksum(data, size) != h.checksum) return false;
+
+    Session session;
+    for (uint32_t i = 0; i < h.tabCount; i++) {
+        if (end - p < 8) return false;
+        size_t urlUnits = GetU32(p), titleUnits = GetU32(p + 4);
+        p += 8;
+        if ((size_t)(end - p) / 2 < urlUnits + titleUnits) return false;
+        SessionTab tab;
+        tab.url = FromUtf16(p, urlUnits);
+        p += 2 * urlUnits;
+        tab.title = FromUtf16(p, titleUnits);
+        p += 2 * titleUnits;
+        session.tabs.push_back(std::move(tab));
+    }
+    if (p != end) return false;
+    session.active = h.active < session.tabs.size() ? h.active : 0;
+    out = std::move(session);
+    return true;
+}
+
+// --- SESSION STORE ---
+SessionStore::SessionStore(std::filesystem::path path)
+    : path(std::move(path)) {
+    worker = std::thread([this] { Run(); });
+}
+
+SessionStore::~SessionStore() {
+    {
+        std::lock_guard<std::mutex> g(lock);
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+static bool ReadSession(const std::filesystem::path& path, std::string& bytes, Session& out) {
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file.is_open()) return false;
+    bytes.assign((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    return DecodeSession((const uint8_t*)bytes.data(), bytes.size(), out);
+}
+
+bool SessionStore::Load(Session& out) {
+    std::string bytes;
+    if (!ReadSession(path, bytes, out)) return ReadSession(WithSuffix(path, L".old"), bytes, out);
+    // What is on disk is what the first save would otherwise rewrite
+    std::lock_guard<std::mutex> g(lock);
+    lastChecksum = Fnv64((const uint8_t*)bytes.data(), bytes.size());
+    queuedAny = true;
+    return true;
+}
+
+void SessionStore::Save(const Session& session) {
+    dirty = false;
+    std::string bytes = EncodeSession(session);
+    uint64_t checksum = Fnv64((const uint8_t*)bytes.data(), bytes.size());
+    std::lock_guard<std::mutex> g(lock);
+    stats.saves++;
+    if (queuedAny && checksum == lastChecksum) { stats.unchanged++; return; }
+    lastChecksum = checksum;
+    queuedAny = true;
+    pending = std::move(bytes); // replaces a snapshot not yet written; only the newest matters
+    hasPending = true;
+    wake.notify_one();
+}
+
+void SessionStore::Flush() {
+    std::unique_lock<std::mutex> g(lock);
+    written.wait(g, [this] { return !hasPending && !writing; });
+}
+
+SessionStore::Stats SessionStore::GetStats() {
+    std::lock_guard<std::mutex> g(lock);
+    return stats;
+}
+
+void SessionStore::Run() {
+    std::unique_lock<std::mutex> g(lock);
+    for (;;) {
+        wake.wait(g, [this] { return hasPending || stopping; });
+        if (!hasPending) break;
+        std::string bytes = std::move(pending);
+        hasPending = false;
+        writing = true;
+        g.unlock();
+        bool ok = ReplaceFileDurably(path, bytes);
+        g.lock();
+        writing = false;
+        if (ok) stats.writes++;
+        else {
+            stats.failures++;
+            queuedAny = false; // retry on the next save even if nothing changed
+        }
+        written.notify_all();
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct SessionTab {
+    std::wstring url;
+    std::wstring title;
+};
+
+// The open tabs, left to right, and which one was in front
+struct Session {
+    std::vector<SessionTab> tabs;
+    size_t active = 0;
+};
+
+std::string EncodeSession(const Session& session);
+bool DecodeSession(const uint8_t* data, size_t size, Session& out); // false if torn, corrupt or foreign
+
+// Periodic snapshots of the tab list. Each one replaces the file atomically: it is written to a
+// temporary file, flushed to disk and renamed over the old one, so a crash at any point leaves
+// either the previous snapshot or the new one. The one before is kept as path.old, and Load
+// falls back to it when the file is missing, torn or corrupt. Snapshots are encoded on the
+// caller's thread and written by a background thread; one that encodes to the bytes last written
+// is dropped.
+class SessionStore {
+public:
+    explicit SessionStore(std::filesystem::path path);
+    ~SessionStore(); // writes whatever is still queued
+
+    SessionStore(const SessionStore&) = delete;
+    SessionStore& operator=(const SessionStore&) = delete;
+
+    bool Load(Session& out);
+
+    // Callers mark the session dirty as tabs change, and snapshot on a timer only when it is
+    void MarkDirty() { dirty = true; }
+    bool IsDirty() const { return dirty; }
+    void Save(const Session& session); // clears the dirty flag
+    void Flush(); // blocks until everything queued so far is on disk
+
+    struct Stats {
+        uint64_t saves = 0;
+        uint64_t unchanged = 0; // saves dropped because nothing had changed
+        uint64_t writes = 0;    // snapshots that reached disk; coalesced ones are not counted
+        uint64_t failures = 0;
+    };
+    Stats GetStats();
+
+private:
+    void Run();
+
+    std::filesystem::path path;
+    bool dirty = false; // caller's thread only
+
+    std::mutex lock;
+    uint64_t lastChecksum = 0; // of the last bytes queued, or loaded
+    bool queuedAny = false;
+    std::condition_variable wake;
+    std::condition_variable written;
+    std::string pending;
+    bool hasPending = false;
+    bool writing = false;
+    bool stopping = false;
+    Stats stats;
+    std::thread worker;
+};
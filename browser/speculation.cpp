@@ -0,0 +1,173 @@
+#include "speculation.h"
+
+#include <algorithm>
+
+#include "url.h"
+
+// --- PREDICTION ---
+namespace {
+const double ADDRESS_PREFIX_WEIGHT = 4;
+const double ELSEWHERE_CONFIDENCE = 0.5; // the most a match not on an address prefix can reach
+
+wchar_t FoldChar(wchar_t c) { return c >= L'A' && c <= L'Z' ? c + 32 : c; }
+
+std::wstring_view StripPrefix(std::wstring_view s, std::wstring_view prefix) {
+    if (s.size() < prefix.size()) return s;
+    for (size_t i = 0; i < prefix.size(); i++) if (FoldChar(s[i]) != prefix[i]) return s;
+    return s.substr(prefix.size());
+}
+
+// What people type for an address: no scheme, no "www."
+std::wstring_view TypedAddress(std::wstring_view s) {
+    std::wstring_view rest = StripPrefix(s, L"https://");
+    if (rest.size() == s.size()) rest = StripPrefix(s, L"http://");
+    return StripPrefix(rest, L"www.");
+}
+
+bool StartsWithFolded(std::wstring_view s, std::wstring_view prefix) {
+    if (s.size() < prefix.size()) return false;
+    for (size_t i = 0; i < prefix.size(); i++) if (FoldChar(s[i]) != FoldChar(prefix[i])) return false;
+    return true;
+}
+}
+
+OmniboxPrediction PredictOmniboxTarget(std::wstring_view typed, const std::vector<OmniboxMatch>& matches) {
+    OmniboxPrediction p;
+    while (!typed.empty() && typed.front() == L' ') typed.remove_prefix(1);
+    while (!typed.empty() && typed.back() == L' ') typed.remove_suffix(1);
+    typed = TypedAddress(typed);
+    if (typed.empty() || matches.empty()) return p;
+    double total = 0, best = -1;
+    bool bestOnAddress = false;
+    for (const OmniboxMatch& m : matches) {
+        bool onAddress = StartsWithFolded(TypedAddress(m.url), typed);
+        double weight = ((std::max)(m.frecency, 0.0) + 1) * (onAddress ? ADDRESS_PREFIX_WEIGHT : 1);
+        total += weight;
+        if (weight > best) {
+            best = weight;
+            p.url = m.url;
+            bestOnAddress = onAddress;
+        }
+    }
+    p.confidence = best / total;
+    if (!bestOnAddress) p.confidence = (std::min)(p.confidence, ELSEWHERE_CONFIDENCE);
+    return p;
+}
+
+// --- SPECULATION ENGINE ---
+// Learned outcomes are kept for the session. The table starts over when full, which loses a
+// little history and keeps memory flat.
+static const size_t LEARNED_CANDIDATES = 3; // suggestions per typed text, from the top
+static const uint32_t LEARNED_EVIDENCE = 2; // outcomes before a pair's hit rate is trusted
+static const size_t LEARNED_LIMIT = 16384;
+static const size_t SHOWN_LIMIT = 64;
+
+namespace {
+std::wstring FoldedInput(std::wstring_view typed) {
+    while (!typed.empty() && typed.front() == L' ') typed.remove_prefix(1);
+    while (!typed.empty() && typed.back() == L' ') typed.remove_suffix(1);
+    std::wstring folded(typed);
+    for (wchar_t& c : folded) c = FoldChar(c);
+    return folded;
+}
+
+std::wstring LearnedKey(const std::wstring& typed, std::wstring_view url) {
+    std::wstring key = typed;
+    key += L'\n';
+    key += url;
+    return key;
+}
+}
+
+SpeculationEngine::SpeculationEngine(PreloadBackend& backend, Config config) : backend(backend), config(config) {}
+
+bool SpeculationEngine::Exhausted() const {
+    uint64_t wasted = stats.started - stats.hits - (current ? 1 : 0);
+    if (wasted >= config.sessionWaste) return true;
+    return stats.started >= config.probation && stats.hits < config.minHitRate * stats.started;
+}
+
+OmniboxPrediction SpeculationEngine::Predict(std::wstring_view typed, const std::vector<OmniboxMatch>& matches) const {
+    OmniboxPrediction estimate = PredictOmniboxTarget(typed, matches);
+    OmniboxPrediction best;
+    std::wstring folded = FoldedInput(typed);
+    for (size_t i = 0; i < matches.size(); i++) {
+        double confidence = matches[i].url == estimate.url ? estimate.confidence : 0;
+        if (i < LEARNED_CANDIDATES) {
+            auto it = learned.find(LearnedKey(folded, matches[i].url));
+            if (it != learned.end() && it->second.hits + it->second.misses >= LEARNED_EVIDENCE)
+                confidence = (double)it->second.hits / (it->second.hits + it->second.misses);
+        }
+        if (confidence > best.confidence) best = { matches[i].url, confidence };
+    }
+    return best;
+}
+
+void SpeculationEngine::Input(std::wstring_view typed, const std::vector<OmniboxMatch>& matches, int64_t nowMs) {
+    if (shown.size() < SHOWN_LIMIT && !matches.empty()) {
+        Shown s;
+        s.typed = FoldedInput(typed);
+        for (size_t i = 0; i < matches.size() && i < LEARNED_CANDIDATES; i++) s.urls.push_back(matches[i].url);
+        shown.push_back(std::move(s));
+    }
+    OmniboxPrediction p;
+    if (typed.size() >= config.minTypedChars) p = Predict(typed, matches);
+    // Keep a preload while its target stays on top, even if one more character left it less sure
+    if (current && p.url == target) return;
+    if (p.confidence < config.threshold) p.url.clear();
+    Stop();
+    if (p.url.empty()) return;
+    if (Exhausted()) {
+        if (p.url != deniedTarget) stats.denied++;
+        deniedTarget = p.url;
+        return;
+    }
+    current = backend.Start(p.url);
+    if (!current) return;
+    target = std::move(p.url);
+    startedAt = nowMs;
+    loadedAt = -1;
+    stats.started++;
+}
+
+std::unique_ptr<Preload> SpeculationEngine::Take(std::wstring_view url, int64_t nowMs) {
+    Learn(url);
+    if (!current) return nullptr;
+    std::unique_ptr<Preload> taken = std::move(current);
+    bool same = CanonicalUrl(url) == CanonicalUrl(target);
+    target.clear();
+    if (!same) { stats.misses++; return nullptr; }
+    if (nowMs - startedAt > config.maxAgeMs) { stats.stale++; return nullptr; }
+    stats.hits++;
+    stats.savedMs += (loadedAt >= 0 ? loadedAt : nowMs) - startedAt;
+    return taken;
+}
+
+void SpeculationEngine::Learn(std::wstring_view opened) {
+    std::wstring canonical = CanonicalUrl(opened);
+    if (learned.size() + shown.size() * LEARNED_CANDIDATES > LEARNED_LIMIT) learned.clear();
+    for (const Shown& s : shown) {
+        for (const std::wstring& url : s.urls) {
+            Outcomes& o = learned[LearnedKey(s.typed, url)];
+            if (CanonicalUrl(url) == canonical) o.hits++;
+            else o.misses++;
+        }
+    }
+    shown.clear();
+}
+
+void SpeculationEngine::Cancel() {
+    Stop();
+    shown.clear(); // abandoned typing says nothing about where it was going
+}
+
+void SpeculationEngine::Stop() {
+    if (!current) return;
+    stats.cancelled++;
+    current.reset();
+    target.clear();
+}
+
+void SpeculationEngine::Loaded(const Preload* preload, int64_t nowMs) {
+    if (preload && preload == current.get() && loadedAt < 0) loadedAt = nowMs;
+}
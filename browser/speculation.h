@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "omnibox.h"
+
+// A page loading out of sight ahead of the Enter that would open it. The WebView2 backend wraps
+// a hidden controller; benchmarks use a fake. Destroying one cancels the load and closes the
+// view, unless a tab has taken it over.
+class Preload {
+public:
+    virtual ~Preload() = default;
+};
+
+class PreloadBackend {
+public:
+    virtual ~PreloadBackend() = default;
+    // Starts loading `url` in a hidden view; null if it cannot
+    virtual std::unique_ptr<Preload> Start(const std::wstring& url) = 0;
+};
+
+struct OmniboxPrediction {
+    std::wstring url; // empty when nothing matches
+    double confidence = 0; // 0..1
+};
+
+// Where typing in the address bar is most likely heading: the suggestion with the largest share
+// of the suggestions' frecency, with those whose address the typed text begins weighted up,
+// since a prefix of an address is how people type one they know. A suggestion matched only on
+// its title or further along its URL is at most a coin toss.
+OmniboxPrediction PredictOmniboxTarget(std::wstring_view typed, const std::vector<OmniboxMatch>& matches);
+
+// Watches address-bar input and keeps at most one preload, of the predicted target while its
+// confidence passes the threshold. A change of prediction cancels it. On Enter, Take hands the
+// preload over if it is of the address being opened, so the tab shows a page that has been
+// loading since the prediction rather than starting one.
+// Predictions learn from Enter: for each text typed and the first few suggestions shown for it,
+// how often that suggestion was the one opened. Once a pair has been seen a few times its hit
+// rate is its confidence, in place of the frecency estimate.
+// A preload that is not opened loaded a page for nothing, so a session gets a budget of those,
+// and speculation stops early if, once past probation, too few preloads turn out to be hits.
+// Single-threaded: the UI thread owns it.
+class SpeculationEngine {
+public:
+    struct Config {
+        double threshold = 0.6;
+        size_t minTypedChars = 1;
+        uint32_t sessionWaste = 32;    // preloads per session that go unopened, at most
+        uint32_t probation = 8;        // preloads before the hit rate is judged
+        double minHitRate = 0.25;
+        int64_t maxAgeMs = 60 * 1000;  // older preloads are thrown away rather than shown stale
+    };
+
+    struct Stats {
+        uint64_t started = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;    // Enter opened something else
+        uint64_t cancelled = 0; // the prediction changed, or typing was abandoned
+        uint64_t stale = 0;
+        uint64_t denied = 0;    // predictions not preloaded for want of budget
+        int64_t savedMs = 0;    // loading the hits had done by the time Enter was pressed
+    };
+
+    SpeculationEngine(PreloadBackend& backend, Config config);
+
+    SpeculationEngine(const SpeculationEngine&) = delete;
+    SpeculationEngine& operator=(const SpeculationEngine&) = delete;
+
+    // The address bar's text and suggestions, after every edit
+    void Input(std::wstring_view typed, const std::vector<OmniboxMatch>& matches, int64_t nowMs);
+    // Enter, about to navigate to `url`: the preload if it is of `url`, else null, and whatever
+    // was preloading is cancelled
+    std::unique_ptr<Preload> Take(std::wstring_view url, int64_t nowMs);
+    // Typing abandoned: focus left the address bar, or Escape
+    void Cancel();
+    // The hidden view finished loading; ignored unless `preload` is the current one
+    void Loaded(const Preload* preload, int64_t nowMs);
+
+    Preload* Current() { return current.get(); }
+    const Preload* Current() const { return current.get(); }
+    const std::wstring& Target() const { return target; }
+    bool Exhausted() const;
+    Stats GetStats() const { return stats; }
+
+private:
+    struct Outcomes {
+        uint32_t hits = 0;
+        uint32_t misses = 0;
+    };
+    struct Shown {
+        std::wstring typed; // folded
+        std::vector<std::wstring> urls;
+    };
+
+    OmniboxPrediction Predict(std::wstring_view typed, const std::vector<OmniboxMatch>& matches) const;
+    void Learn(std::wstring_view opened);
+    void Stop();
+
+    PreloadBackend& backend;
+    Config config;
+    std::unique_ptr<Preload> current;
+    std::wstring target;        // what `current` loads
+    std::wstring deniedTarget;  // counted once, not on every keystroke
+    int64_t startedAt = 0;
+    int64_t loadedAt = -1;
+    std::vector<Shown> shown;                          // since the last Enter
+    std::unordered_map<std::wstring, Outcomes> learned; // by typed text, '\n', suggestion URL
+    Stats stats;
+};
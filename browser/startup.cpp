@@ -0,0 +1,220 @@
+#include "startup.h"
+
+#include "json.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+
+// --- STARTUP TRACE ---
+StartupTrace::StartupTrace() : start(Clock::now()) {}
+
+uint32_t StartupTrace::ThreadId() {
+    static std::atomic<uint32_t> next{ 1 };
+    thread_local uint32_t id = next.fetch_add(1, std::memory_order_relaxed);
+    return id;
+}
+
+void StartupTrace::NameThread(std::string name) {
+    Event e;
+    e.name = std::move(name);
+    e.phase = 'M';
+    e.thread = ThreadId();
+    std::lock_guard<std::mutex> guard(lock);
+    events.push_back(std::move(e));
+}
+
+void StartupTrace::Phase(std::string name, Clock::time_point begin, Clock::time_point end, uint32_t thread) {
+    Event e;
+    e.name = std::move(name);
+    e.thread = thread;
+    e.beginUs = SinceStartUs(begin);
+    e.durationUs = (std::max)((int64_t)0, SinceStartUs(end) - e.beginUs);
+    std::lock_guard<std::mutex> guard(lock);
+    events.push_back(std::move(e));
+}
+
+void StartupTrace::Mark(std::string name) {
+    Event e;
+    e.name = std::move(name);
+    e.phase = 'i';
+    e.thread = ThreadId();
+    e.beginUs = SinceStartUs(Clock::now());
+    std::lock_guard<std::mutex> guard(lock);
+    events.push_back(std::move(e));
+}
+
+int64_t StartupTrace::SinceStartUs(Clock::time_point t) const {
+    return std::chrono::duration_cast<std::chrono::microseconds>(t - start).count();
+}
+
+std::vector<StartupTrace::Event> StartupTrace::Events() {
+    std::lock_guard<std::mutex> guard(lock);
+    return events;
+}
+
+// One process; thread names as metadata events, phases as complete events, marks as instants
+std::string StartupTrace::ToJson() {
+    std::vector<Event> all = Events();
+    std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    char buf[160];
+    for (size_t i = 0; i < all.size(); i++) {
+        const Event& e = all[i];
+        if (i) out += ',';
+        out += "\n{\"name\":";
+        if (e.phase == 'M') {
+            snprintf(buf, sizeof(buf), "\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", e.thread);
+            out += buf;
+            AppendJsonString(out, e.name);
+            out += "}}";
+            continue;
+        }
+        AppendJsonString(out, e.name);
+        if (e.phase == 'i') snprintf(buf, sizeof(buf), ",\"cat\":\"startup\",\"ph\":\"i\",\"s\":\"p\",\"pid\":1,\"tid\":%u,\"ts\":%lld}", e.thread, (long long)e.beginUs);
+        else snprintf(buf, sizeof(buf), ",\"cat\":\"startup\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%lld,\"dur\":%lld}", e.thread, (long long)e.beginUs, (long long)e.durationUs);
+        out += buf;
+    }
+    out += "\n]}\n";
+    return out;
+}
+
+// --- STARTUP GRAPH ---
+StartupGraph::StartupGraph(StartupTrace& trace, unsigned workers, std::function<void()> mainReady)
+    : trace(trace), workerCount((std::max)(1u, workers)), mainReady(std::move(mainReady)) {}
+
+StartupGraph::~StartupGraph() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& w : workers) w.join();
+}
+
+StartupGraph::Task StartupGraph::Add(std::string name, StartupThread thread, std::vector<Task> after, std::function<void()> run) {
+    return AddNode(std::move(name), thread, std::move(after), [run = std::move(run)](Done done) {
+        run();
+        done();
+    });
+}
+
+StartupGraph::Task StartupGraph::AddAsync(std::string name, StartupThread thread, std::vector<Task> after, std::function<void(Done)> start) {
+    return AddNode(std::move(name), thread, std::move(after), std::move(start));
+}
+
+StartupGraph::Task StartupGraph::AddNode(std::string name, StartupThread thread, std::vector<Task> after, std::function<void(Done)> start) {
+    Task task = nodes.size();
+    Node node;
+    node.name = std::move(name);
+    node.thread = thread;
+    node.start = std::move(start);
+    for (Task before : after) {
+        if (before >= task) continue; // not added yet: would allow a cycle
+        nodes[before].next.push_back(task);
+        node.waitingOn++;
+    }
+    nodes.push_back(std::move(node));
+    remaining++;
+    return task;
+}
+
+void StartupGraph::Start() {
+    size_t workerTasks = 0;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        mainThread = std::this_thread::get_id();
+        for (Task task = 0; task < nodes.size(); task++) {
+            if (nodes[task].thread == StartupThread::Worker) workerTasks++;
+            if (nodes[task].waitingOn == 0) Release(task);
+        }
+    }
+    for (size_t i = 0; i < (std::min)((size_t)workerCount, workerTasks); i++) workers.emplace_back([this] { WorkerLoop(); });
+    RunMainTasks();
+}
+
+size_t StartupGraph::RunMainTasks() {
+    size_t ran = 0;
+    std::unique_lock<std::mutex> guard(lock);
+    notified = false;
+    runningMain = true;
+    while (!mainQueue.empty() && !stopping) {
+        Task task = mainQueue.front();
+        mainQueue.pop_front();
+        guard.unlock();
+        Run(task);
+        ran++;
+        guard.lock();
+    }
+    runningMain = false;
+    return ran;
+}
+
+void StartupGraph::Wait() {
+    while (true) {
+        RunMainTasks();
+        std::unique_lock<std::mutex> guard(lock);
+        mainWake.wait(guard, [this] { return remaining == 0 || !mainQueue.empty(); });
+        if (remaining == 0 && mainQueue.empty()) return;
+    }
+}
+
+bool StartupGraph::Finished() {
+    std::lock_guard<std::mutex> guard(lock);
+    return remaining == 0;
+}
+
+void StartupGraph::Release(Task task) {
+    if (nodes[task].thread == StartupThread::Worker) {
+        workerQueue.push_back(task);
+        wake.notify_one();
+    }
+    else {
+        mainQueue.push_back(task);
+        mainWake.notify_all();
+    }
+}
+
+void StartupGraph::Run(Task task) {
+    StartupTrace::Clock::time_point began = StartupTrace::Clock::now();
+    uint32_t thread = StartupTrace::ThreadId();
+    nodes[task].start([this, task, began, thread] { Finish(task, began, thread); });
+}
+
+void StartupGraph::Finish(Task task, StartupTrace::Clock::time_point began, uint32_t thread) {
+    StartupTrace::Clock::time_point ended = StartupTrace::Clock::now();
+    bool notify = false;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        Node& node = nodes[task];
+        if (node.finished) return;
+        node.finished = true;
+        // Before anything it releases can run, so the trace is whole once Wait returns
+        trace.Phase(node.name, began, ended, thread);
+        remaining--;
+        size_t waiting = mainQueue.size();
+        for (Task next : node.next) {
+            if (--nodes[next].waitingOn == 0) Release(next);
+        }
+        // RunMainTasks picks up what a main-thread task releases; anything else needs a wake-up
+        bool picked = runningMain && std::this_thread::get_id() == mainThread;
+        if (mainQueue.size() > waiting && !picked && !notified) notify = notified = true;
+        if (remaining == 0) {
+            wake.notify_all();
+            mainWake.notify_all();
+        }
+    }
+    if (notify && mainReady) mainReady();
+}
+
+void StartupGraph::WorkerLoop() {
+    std::unique_lock<std::mutex> guard(lock);
+    while (true) {
+        wake.wait(guard, [this] { return stopping || remaining == 0 || !workerQueue.empty(); });
+        if (stopping || workerQueue.empty()) return;
+        Task task = workerQueue.front();
+        workerQueue.pop_front();
+        guard.unlock();
+        Run(task);
+        guard.lock();
+    }
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Timestamps of startup phases, recorded from any thread and exported in the Chrome trace-event
+// format (chrome://tracing, Perfetto). Times are relative to the trace's construction, so a
+// trace constructed during static initialization starts about when the process does.
+class StartupTrace {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    StartupTrace();
+
+    StartupTrace(const StartupTrace&) = delete;
+    StartupTrace& operator=(const StartupTrace&) = delete;
+
+    struct Event {
+        std::string name;
+        char phase = 'X';  // 'X' a phase with a duration, 'i' an instant, 'M' a thread name
+        uint32_t thread = 0;
+        int64_t beginUs = 0;
+        int64_t durationUs = 0;
+    };
+
+    // Names the calling thread in the exported trace
+    void NameThread(std::string name);
+    void Phase(std::string name, Clock::time_point begin, Clock::time_point end, uint32_t thread = ThreadId());
+    void Mark(std::string name);
+
+    int64_t SinceStartUs(Clock::time_point t) const;
+    std::vector<Event> Events();
+    std::string ToJson();
+
+    // A small per-thread number, the same for a thread across traces
+    static uint32_t ThreadId();
+
+private:
+    Clock::time_point start;
+    std::mutex lock;
+    std::vector<Event> events;
+};
+
+// Where a startup task runs: on a worker thread, or on the thread that owns the UI and calls
+// RunMainTasks
+enum class StartupThread { Main, Worker };
+
+// Runs startup as a graph of tasks, each started once the tasks it comes after have finished.
+// Worker tasks run on a small pool that exits when the graph is done. Main-thread tasks run
+// inside Start and RunMainTasks. When one becomes runnable anywhere else (on a worker, or in a
+// callback finishing an async task) and none was waiting, `mainReady` is called, so in the
+// browser one message is posted to the UI thread rather than one per task. Each task is recorded
+// in the trace as a phase from its start to its finish; an async task finishes when it calls
+// `done`, from any thread.
+// Add, Start, RunMainTasks and Wait belong to the main thread; Finished may be called from any.
+class StartupGraph {
+public:
+    using Task = size_t;
+    using Done = std::function<void()>;
+
+    StartupGraph(StartupTrace& trace, unsigned workers, std::function<void()> mainReady);
+    ~StartupGraph(); // waits for running worker tasks; those not started yet never run
+
+    StartupGraph(const StartupGraph&) = delete;
+    StartupGraph& operator=(const StartupGraph&) = delete;
+
+    // `after` holds tasks added earlier, so the graph cannot have cycles. Before Start only.
+    Task Add(std::string name, StartupThread thread, std::vector<Task> after, std::function<void()> run);
+    // The graph must outlive the call to `done`
+    Task AddAsync(std::string name, StartupThread thread, std::vector<Task> after, std::function<void(Done)> start);
+
+    // Starts the tasks that come after nothing, running main-thread ones before returning
+    void Start();
+    // Runs main-thread tasks until none is runnable, including those that become so meanwhile;
+    // returns how many ran
+    size_t RunMainTasks();
+    // Runs main-thread tasks as they become runnable until the whole graph has finished
+    void Wait();
+    bool Finished();
+
+private:
+    struct Node {
+        std::string name;
+        StartupThread thread = StartupThread::Main;
+        std::function<void(Done)> start;
+        std::vector<Task> next;  // tasks that come after this one
+        size_t waitingOn = 0;    // unfinished tasks this one comes after
+        bool finished = false;
+    };
+
+    Task AddNode(std::string name, StartupThread thread, std::vector<Task> after, std::function<void(Done)> start);
+    void Release(Task task); // caller holds `lock`
+    void Run(Task task);
+    void Finish(Task task, StartupTrace::Clock::time_point began, uint32_t thread);
+    void WorkerLoop();
+
+    StartupTrace& trace;
+    unsigned workerCount;
+    std::function<void()> mainReady;
+
+    std::mutex lock;
+    std::condition_variable wake;     // workers: a worker task is runnable, or the graph is done
+    std::condition_variable mainWake; // Wait: a main-thread task is runnable, or the graph is done
+    std::vector<Node> nodes;
+    std::deque<Task> workerQueue;
+    std::deque<Task> mainQueue;
+    size_t remaining = 0;
+    bool notified = false;    // `mainReady` was called and RunMainTasks has not run since
+    bool runningMain = false; // the main thread is inside RunMainTasks
+    std::thread::id mainThread;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+};
@@ -0,0 +1,80 @@
+#include "tablifecycle.h"
+
+TabLifecyclePolicy::TabLifecyclePolicy(TabLifecycleBackend& backend, Config config)
+    : backend(backend), config(config) {
+}
+
+void TabLifecyclePolicy::Add(uint64_t tab, int64_t now, TabLifecycleState state) {
+    Record& r = tabs[tab];
+    r.state = state;
+    r.lastActive = now;
+}
+
+void TabLifecyclePolicy::Remove(uint64_t tab) {
+    tabs.erase(tab);
+    if (hasActive && activeTab == tab) hasActive = false;
+}
+
+TabLifecycleState TabLifecyclePolicy::Activate(uint64_t tab, int64_t now) {
+    if (hasActive) {
+        auto previous = tabs.find(activeTab);
+        if (previous != tabs.end()) previous->second.lastActive = now; // idle time counts from leaving it
+    }
+    activeTab = tab;
+    hasActive = true;
+    Record& r = tabs[tab];
+    TabLifecycleState before = r.state;
+    if (before == TAB_DISCARDED) stats.restores++;
+    r.state = TAB_LIVE;
+    r.lastActive = now;
+    return before;
+}
+
+TabLifecycleState TabLifecyclePolicy::State(uint64_t tab) const {
+    auto it = tabs.find(tab);
+    return it == tabs.end() ? TAB_LIVE : it->second.state;
+}
+
+void TabLifecyclePolicy::SuspendRefused(uint64_t tab, int64_t now) {
+    auto it = tabs.find(tab);
+    if (it == tabs.end() || it->second.state != TAB_SUSPENDED) return;
+    it->second.state = TAB_LIVE;
+    it->second.lastActive = now; // e.g. playing audio; ask again after another idle period
+    stats.suspendRefusals++;
+}
+
+void TabLifecyclePolicy::Tick(int64_t now) {
+    uint64_t available = backend.AvailableMemory();
+    if (measuring) {
+        if (available > availableBefore) stats.reclaimedBytes += available - availableBefore;
+        measuring = false;
+    }
+
+    for (auto& [id, r] : tabs) {
+        if (r.state != TAB_LIVE || (hasActive && id == activeTab)) continue;
+        if (now - r.lastActive < config.suspendAfterMs) continue;
+        if (backend.Suspend(id)) {
+            r.state = TAB_SUSPENDED;
+            stats.suspends++;
+        }
+        else {
+            r.lastActive = now;
+            stats.suspendRefusals++;
+        }
+    }
+
+    lowMemory = available < config.lowMemoryBytes;
+    if (!lowMemory) return;
+    uint64_t victim = 0;
+    const Record* oldest = nullptr;
+    for (const auto& [id, r] : tabs) {
+        if (r.state == TAB_DISCARDED || (hasActive && id == activeTab)) continue;
+        if (!oldest || r.lastActive < oldest->lastActive) { oldest = &r; victim = id; }
+    }
+    if (!oldest) return;
+    backend.Discard(victim);
+    tabs[victim].state = TAB_DISCARDED;
+    stats.discards++;
+    measuring = true;
+    availableBefore = available;
+}
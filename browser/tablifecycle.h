@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+// What the lifecycle policy does to tabs; WebView2 in the browser, a fake in tests.
+class TabLifecycleBackend {
+public:
+    virtual ~TabLifecycleBackend() = default;
+    // Freeze a hidden tab's page. False if it refused outright; a refusal that comes back later
+    // is reported through TabLifecyclePolicy::SuspendRefused.
+    virtual bool Suspend(uint64_t tab) = 0;
+    virtual void Discard(uint64_t tab) = 0; // close the view, keeping what is needed to reload it
+    virtual uint64_t AvailableMemory() = 0; // bytes of physical memory available
+};
+
+enum TabLifecycleState {
+    TAB_LIVE,
+    TAB_SUSPENDED, // renderer frozen; resumes by itself when shown
+    TAB_DISCARDED, // no view; reloaded when activated
+};
+
+// Decides when background tabs are suspended or discarded. Tabs idle in the background for a
+// while are suspended; while available memory is below the low-water mark the least recently
+// used tab is discarded, one per tick so memory can settle in between. The active tab is never
+// touched. Memory reclaimed by discards is measured as the rise in available memory by the next
+// tick. Single-threaded: the UI thread owns it.
+class TabLifecyclePolicy {
+public:
+    struct Config {
+        int64_t suspendAfterMs = 5 * 60 * 1000;
+        uint64_t lowMemoryBytes = 512ull << 20;
+    };
+
+    struct Stats {
+        uint64_t suspends = 0; // accepted by the backend
+        uint64_t suspendRefusals = 0;
+        uint64_t discards = 0;
+        uint64_t restores = 0;
+        uint64_t reclaimedBytes = 0;
+    };
+
+    TabLifecyclePolicy(TabLifecycleBackend& backend, Config config);
+
+    // Tabs restored from a saved session start out TAB_DISCARDED, to be loaded when first activated
+    void Add(uint64_t tab, int64_t now, TabLifecycleState state = TAB_LIVE);
+    void Remove(uint64_t tab);
+    // The tab is now in front. Returns its state before, so a discarded tab can be reloaded.
+    TabLifecycleState Activate(uint64_t tab, int64_t now);
+    TabLifecycleState State(uint64_t tab) const;
+    void SuspendRefused(uint64_t tab, int64_t now);
+
+    void Tick(int64_t now); // call periodically
+
+    bool LowOnMemory() const { return lowMemory; } // as of the last tick
+    Stats GetStats() const { return stats; }
+
+private:
+    struct Record {
+        TabLifecycleState state = TAB_LIVE;
+        int64_t lastActive = 0;
+    };
+
+    TabLifecycleBackend& backend;
+    Config config;
+    std::unordered_map<uint64_t, Record> tabs;
+    uint64_t activeTab = 0;
+    bool hasActive = false;
+    bool measuring = false; // a discard happened last tick
+    bool lowMemory = false;
+    uint64_t availableBefore = 0;
+    Stats stats;
+};
@@ -0,0 +1,65 @@
+#include "tabpool.h"
+
+WarmTabPool::WarmTabPool(TabHostBackend& backend, size_t size)
+    : backend(backend), size(size), self(std::make_shared<WarmTabPool*>(this)) {
+}
+
+WarmTabPool::~WarmTabPool() {
+    self.reset();
+}
+
+void WarmTabPool::Fill() {
+    // One creation per waiting claim, plus enough to leave `size` warm
+    while (warm.size() + inFlight < size + waiting.size()) {
+        inFlight++;
+        std::weak_ptr<WarmTabPool*> pool = self;
+        backend.CreateHost([pool](std::unique_ptr<TabHost> host) {
+            if (auto p = pool.lock()) (*p)->OnCreated(std::move(host));
+        });
+    }
+}
+
+void WarmTabPool::Resize(size_t newSize) {
+    size = newSize;
+    while (warm.size() > size) {
+        warm.pop_back();
+        stats.trimmed++;
+    }
+    Fill();
+}
+
+void WarmTabPool::Claim(TabHostBackend::Created ready) {
+    stats.claims++;
+    if (warm.empty()) {
+        waiting.push_back(std::move(ready));
+        Fill();
+        return;
+    }
+    stats.warmHits++;
+    std::unique_ptr<TabHost> host = std::move(warm.front());
+    warm.pop_front();
+    ready(std::move(host));
+    Fill();
+}
+
+void WarmTabPool::OnCreated(std::unique_ptr<TabHost> host) {
+    inFlight--;
+    if (!host) {
+        // Report the failure to the oldest claim rather than retrying in a loop
+        stats.failures++;
+        if (!waiting.empty()) {
+            TabHostBackend::Created ready = std::move(waiting.front());
+            waiting.pop_front();
+            ready(nullptr);
+        }
+        return;
+    }
+    if (!waiting.empty()) {
+        TabHostBackend::Created ready = std::move(waiting.front());
+        waiting.pop_front();
+        ready(std::move(host));
+    }
+    else if (warm.size() < size) warm.push_back(std::move(host));
+    else stats.trimmed++; // the pool shrank while it was being created
+    Fill();
+}
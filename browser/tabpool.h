@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+
+// A web view as the tab pool sees it. The WebView2 backend wraps a controller; tests use a fake.
+class TabHost {
+public:
+    virtual ~TabHost() = default; // closes the view unless a tab has taken it over
+};
+
+// Creates hidden hosts, with the browser's event handlers already attached, and reports back
+// asynchronously on the owning thread. A null host means creation failed.
+class TabHostBackend {
+public:
+    using Created = std::function<void(std::unique_ptr<TabHost>)>;
+
+    virtual ~TabHostBackend() = default;
+    virtual void CreateHost(Created done) = 0;
+};
+
+// Keeps `size` hidden hosts ready, so opening a tab only claims one and navigates it. Claims
+// that find the pool empty are served first-come first-served as creations complete, and the
+// pool refills behind every claim. Resize trims it, e.g. to nothing under memory pressure, where
+// a warm host costs as much as a background tab. Single-threaded: the UI thread owns it.
+class WarmTabPool {
+public:
+    WarmTabPool(TabHostBackend& backend, size_t size);
+    ~WarmTabPool();
+
+    WarmTabPool(const WarmTabPool&) = delete;
+    WarmTabPool& operator=(const WarmTabPool&) = delete;
+
+    void Fill();
+    // Closes warm hosts beyond the new size, or creates more up to it
+    void Resize(size_t size);
+    // `ready` runs right away when a host is warm, otherwise once one has been created.
+    void Claim(TabHostBackend::Created ready);
+
+    size_t WarmCount() const { return warm.size(); }
+    size_t InFlight() const { return inFlight; }
+
+    struct Stats {
+        uint64_t claims = 0;
+        uint64_t warmHits = 0; // claims served without waiting
+        uint64_t failures = 0;
+        uint64_t trimmed = 0; // warm hosts closed unclaimed
+    };
+    Stats GetStats() const { return stats; }
+
+private:
+    void OnCreated(std::unique_ptr<TabHost> host);
+
+    TabHostBackend& backend;
+    size_t size;
+    size_t inFlight = 0;
+    std::deque<std::unique_ptr<TabHost>> warm;
+    std::deque<TabHostBackend::Created> waiting;
+    Stats stats;
+    std::shared_ptr<WarmTabPool*> self; // creations still in flight after the pool is gone see it expired
+};
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// Names a tab for as long as it is open. Slots are reused after a close, but under a new
+// generation, so a handle kept past its tab's close resolves to nothing rather than to a stranger.
+struct TabHandle {
+    uint32_t slot = 0;
+    uint32_t generation = 0; // never issued, so a default handle is null
+
+    explicit operator bool() const { return generation != 0; }
+    bool operator==(const TabHandle& other) const { return slot == other.slot && generation == other.generation; }
+    bool operator!=(const TabHandle& other) const { return !(*this == other); }
+
+    // For code that keys tabs by integer, like the lifecycle policy
+    uint64_t Key() const { return (uint64_t)generation << 32 | slot; }
+    static TabHandle FromKey(uint64_t key) { return { (uint32_t)key, (uint32_t)(key >> 32) }; }
+};
+
+// Generational slot map: insert, remove and lookup are O(1), and freed slots are reused.
+// Pointers returned by Get stay valid until the next Insert.
+template <typename T>
+class SlotMap {
+public:
+    TabHandle Insert(T value) {
+        uint32_t slot;
+        if (!freeSlots.empty()) { slot = freeSlots.back(); freeSlots.pop_back(); }
+        else { slot = (uint32_t)slots.size(); slots.emplace_back(); }
+        slots[slot].value.emplace(std::move(value));
+        count++;
+        return { slot, slots[slot].generation };
+    }
+
+    bool Remove(TabHandle handle) {
+        if (!Get(handle)) return false;
+        Slot& s = slots[handle.slot];
+        s.value.reset();
+        if (++s.generation == 0) s.generation = 1;
+        freeSlots.push_back(handle.slot);
+        count--;
+        return true;
+    }
+
+    T* Get(TabHandle handle) {
+        if (handle.slot >= slots.size()) return nullptr;
+        Slot& s = slots[handle.slot];
+        return s.generation == handle.generation && s.value ? &*s.value : nullptr;
+    }
+    const T* Get(TabHandle handle) const { return const_cast<SlotMap*>(this)->Get(handle); }
+
+    size_t Size() const { return count; }
+
+private:
+    struct Slot {
+        std::optional<T> value;
+        uint32_t generation = 1;
+    };
+
+    std::vector<Slot> slots;
+    std::vector<uint32_t> freeSlots;
+    size_t count = 0;
+};
+
+// Open tabs by handle, plus their left-to-right order as a separate list of handles. Reordering
+// and closing shift only that list; handles held elsewhere stay valid.
+template <typename T>
+class TabRegistry {
+public:
+    static constexpr size_t npos = (size_t)-1;
+
+    TabHandle Open(T tab, size_t position = npos) {
+        TabHandle handle = map.Insert(std::move(tab));
+        if (position >= order.size()) order.push_back(handle);
+        else order.insert(order.begin() + position, handle);
+        return handle;
+    }
+
+    bool Close(TabHandle handle) {
+        if (!map.Remove(handle)) return false;
+        order.erase(std::find(order.begin(), order.end(), handle));
+        return true;
+    }
+
+    T* Get(TabHandle handle) { return map.Get(handle); }
+    const T* Get(TabHandle handle) const { return map.Get(handle); }
+
+    size_t Size() const { return order.size(); }
+    bool Empty() const { return order.empty(); }
+
+    const std::vector<TabHandle>& Order() const { return order; }
+    TabHandle At(size_t position) const { return position < order.size() ? order[position] : TabHandle(); }
+    // Linear, but over a packed array of handles
+    size_t PositionOf(TabHandle handle) const {
+        auto it = std::find(order.begin(), order.end(), handle);
+        return it == order.end() ? npos : (size_t)(it - order.begin());
+    }
+
+private:
+    SlotMap<T> map;
+    std::vector<TabHandle> order;
+};
@@ -0,0 +1,83 @@
+#include "tabstrip.h"
+
+#include <algorithm>
+
+TabStripLayout::TabStripLayout()
+    : TabStripLayout(Metrics()) {
+}
+
+TabStripLayout::TabStripLayout(Metrics metrics)
+    : metrics(metrics) {
+    Relayout();
+}
+
+void TabStripLayout::Relayout() {
+    int available = (std::max)(0, clientWidth - metrics.left - metrics.rightMargin - metrics.gap - metrics.buttonSize);
+    int width = metrics.maxTabWidth;
+    if (count > 0) width = (int)((available + metrics.gap) / (long long)count) - metrics.gap;
+    tabWidth = (std::max)(metrics.minTabWidth, (std::min)(metrics.maxTabWidth, width));
+    long long content = count ? (long long)count * Pitch() - metrics.gap : 0;
+    viewWidth = (int)(std::min)(content, (long long)available);
+    scroll = (int)(std::max)(0LL, (std::min)((long long)scroll, content - viewWidth));
+}
+
+void TabStripLayout::SetWidth(int width) {
+    if (width == clientWidth) return;
+    clientWidth = width;
+    Relayout();
+}
+
+void TabStripLayout::SetCount(size_t tabCount) {
+    count = tabCount;
+    Relayout();
+}
+
+void TabStripLayout::ScrollBy(int dx) {
+    scroll += dx;
+    Relayout();
+}
+
+void TabStripLayout::EnsureVisible(size_t position) {
+    if (position >= count) return;
+    int left = (int)(position * Pitch());
+    if (left < scroll) ScrollBy(left - scroll);
+    else if (left + tabWidth > scroll + viewWidth) ScrollBy(left + tabWidth - viewWidth - scroll);
+}
+
+StripRect TabStripLayout::TabRect(size_t position) const {
+    int x = metrics.left + (int)(position * Pitch()) - scroll;
+    return { x, metrics.top, x + tabWidth, metrics.top + metrics.height };
+}
+
+StripRect TabStripLayout::CloseRect(size_t position) const {
+    StripRect tab = TabRect(position);
+    int top = metrics.top + (metrics.height - metrics.closeSize) / 2;
+    return { tab.right - metrics.closeInset - metrics.closeSize, top, tab.right - metrics.closeInset, top + metrics.closeSize };
+}
+
+StripRect TabStripLayout::ButtonRect() const {
+    int x = metrics.left + viewWidth + (count ? metrics.gap : 0);
+    int top = metrics.top + (metrics.height - metrics.buttonSize) / 2;
+    return { x, top, x + metrics.buttonSize, top + metrics.buttonSize };
+}
+
+StripRect TabStripLayout::ViewRect() const {
+    return { metrics.left, metrics.top, metrics.left + viewWidth, metrics.top + metrics.height };
+}
+
+void TabStripLayout::VisibleRange(size_t& first, size_t& end) const {
+    if (count == 0 || viewWidth <= 0) { first = end = 0; return; }
+    first = (size_t)(scroll / Pitch()) + (scroll % Pitch() >= tabWidth ? 1 : 0); // scrolled into the gap after a tab
+    end = (std::min)(count, (size_t)((scroll + viewWidth - 1) / Pitch()) + 1);
+}
+
+TabStripLayout::Part TabStripLayout::HitTest(int x, int y, size_t& position) const {
+    if (y < metrics.top || y >= metrics.top + metrics.height) return NOTHING;
+    if (x < metrics.left || x >= metrics.left + viewWidth) return NOTHING;
+    int offset = x - metrics.left + scroll;
+    position = (size_t)(offset / Pitch());
+    if (position >= count || offset % Pitch() >= tabWidth) return NOTHING; // in a gap
+    StripRect close = CloseRect(position);
+    if (x >= close.left && x < close.right && y >= close.top && y < close.bottom) return CLOSE_BUTTON;
+    return TAB;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+
+// Client-area rectangle, right and bottom exclusive, like a Win32 RECT
+struct StripRect {
+    int left = 0, top = 0, right = 0, bottom = 0;
+};
+
+// Geometry of the tab strip, kept apart from painting. All tabs share one width: the preferred
+// width while they fit, shrinking to a minimum, after which the strip scrolls. Positions and hit
+// tests are arithmetic on that width, so they cost the same for 10 tabs or 1,000.
+class TabStripLayout {
+public:
+    struct Metrics {
+        int left = 10; // where the strip starts, in client coordinates
+        int top = 66;
+        int height = 34;
+        int rightMargin = 10;
+        int maxTabWidth = 200;
+        int minTabWidth = 72;
+        int gap = 4;
+        int closeSize = 24; // square, centred vertically, inset from the tab's right edge
+        int closeInset = 4;
+        int buttonSize = 28; // the new-tab button, right after the last visible tab
+    };
+
+    enum Part { NOTHING, TAB, CLOSE_BUTTON };
+
+    TabStripLayout();
+    explicit TabStripLayout(Metrics metrics);
+
+    void SetWidth(int clientWidth);
+    void SetCount(size_t count);
+    void ScrollBy(int dx);
+    void EnsureVisible(size_t position);
+
+    size_t Count() const { return count; }
+    int TabWidth() const { return tabWidth; }
+    int ScrollOffset() const { return scroll; }
+
+    StripRect TabRect(size_t position) const; // may lie partly or wholly outside ViewRect()
+    StripRect CloseRect(size_t position) const;
+    StripRect ButtonRect() const;
+    StripRect ViewRect() const; // the visible stretch of strip; tabs are clipped to it
+    // Tabs [first, end) intersect the view
+    void VisibleRange(size_t& first, size_t& end) const;
+    Part HitTest(int x, int y, size_t& position) const;
+
+private:
+    int Pitch() const { return tabWidth + metrics.gap; }
+    void Relayout();
+
+    Metrics metrics;
+    int clientWidth = 0;
+    size_t count = 0;
+    int tabWidth = 0;
+    int viewWidth = 0; // visible tab area; the content is wider when scrolling
+    int scroll = 0;
+};
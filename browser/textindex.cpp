@@ -0,0 +1,919 @@
+#include "textindex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <queue>
+
+#include "mappedfile.h"
+
+// --- TOKENIZER ---
+namespace {
+const size_t MAX_WORD_CHARS = 40;
+
+enum CharClass { SEPARATOR, WORD, SINGLE };
+
+CharClass Classify(uint32_t c) {
+    if (c < 0x80) return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ? WORD : SEPARATOR;
+    if (c < 0xC0) return c == 0xAA || c == 0xB5 || c == 0xBA ? WORD : SEPARATOR; // Latin-1 punctuation and symbols
+    if (c == 0xD7 || c == 0xF7) return SEPARATOR;
+    if (c >= 0x2000 && c <= 0x2BFF) return SEPARATOR; // punctuation, symbols, arrows, box drawing
+    if (c >= 0x3000 && c <= 0x303F) return SEPARATOR; // CJK punctuation
+    if ((c >= 0x3040 && c <= 0x30FF) || (c >= 0x3400 && c <= 0x9FFF) || (c >= 0xAC00 && c <= 0xD7AF) || (c >= 0xF900 && c <= 0xFAFF)) return SINGLE;
+    if (c >= 0xD800 && c <= 0xDFFF) return SEPARATOR; // unpaired surrogate
+    if ((c >= 0xFE30 && c <= 0xFE4F) || (c >= 0xFF00 && c <= 0xFF0F) || (c >= 0xFF1A && c <= 0xFF20) ||
+        (c >= 0xFF3B && c <= 0xFF40) || (c >= 0xFF5B && c <= 0xFF65)) return SEPARATOR; // full-width punctuation
+    if (c >= 0x1F000 && c <= 0x1FAFF) return SEPARATOR; // emoji and pictographs
+    return WORD;
+}
+
+// Latin, Greek and Cyrillic; other scripts are left as they are
+uint32_t Lower(uint32_t c) {
+    if (c >= 'A' && c <= 'Z') return c + 32;
+    if (c < 0xC0) return c;
+    if (c <= 0xDE) return c + 32; // 0xD7 is a separator
+    if (c >= 0x100 && c <= 0x17F) {
+        bool upperOdd = (c >= 0x139 && c <= 0x148) || (c >= 0x179 && c <= 0x17E);
+        if (c == 0x130 || c == 0x138 || c == 0x149 || c == 0x17F) return c;
+        return ((c & 1) != 0) == upperOdd ? c + 1 : c;
+    }
+    if (c >= 0x391 && c <= 0x3A9 && c != 0x3A2) return c + 32;
+    if (c >= 0x410 && c <= 0x42F) return c + 32;
+    if (c >= 0x400 && c <= 0x40F) return c + 80;
+    return c;
+}
+
+void AppendUtf8(std::string& out, uint32_t c) {
+    if (c < 0x80) out += (char)c;
+    else if (c < 0x800) { out += (char)(0xC0 | (c >> 6)); out += (char)(0x80 | (c & 0x3F)); }
+    else if (c < 0x10000) { out += (char)(0xE0 | (c >> 12)); out += (char)(0x80 | ((c >> 6) & 0x3F)); out += (char)(0x80 | (c & 0x3F)); }
+    else {
+        out += (char)(0xF0 | (c >> 18)); out += (char)(0x80 | ((c >> 12) & 0x3F));
+        out += (char)(0x80 | ((c >> 6) & 0x3F)); out += (char)(0x80 | (c & 0x3F));
+    }
+}
+}
+
+void TokenizeText(std::wstring_view text, std::vector<std::string>& out) {
+    std::string word;
+    size_t chars = 0;
+    auto end = [&] {
+        if (!word.empty() && chars <= MAX_WORD_CHARS) out.push_back(word);
+        word.clear();
+        chars = 0;
+    };
+    for (size_t i = 0; i < text.size(); i++) {
+        uint32_t c = (uint32_t)text[i];
+        if (sizeof(wchar_t) == 2 && c >= 0xD800 && c < 0xDC00 && i + 1 < text.size()) {
+            uint32_t lo = (uint32_t)text[i + 1];
+            if (lo >= 0xDC00 && lo < 0xE000) { c = 0x10000 + ((c - 0xD800) << 10) + (lo - 0xDC00); i++; }
+        }
+        switch (Classify(c)) {
+        case SEPARATOR: end(); break;
+        case SINGLE: end(); AppendUtf8(word, c); chars = 1; end(); break;
+        case WORD: AppendUtf8(word, Lower(c)); chars++; break;
+        }
+    }
+    end();
+}
+
+std::wstring JsonStringValue(std::wstring_view json) {
+    std::wstring out;
+    if (json.size() < 2 || json.front() != L'"' || json.back() != L'"') return out;
+    auto hex = [&json](size_t at, uint32_t& value) {
+        if (at + 4 > json.size() - 1) return false;
+        value = 0;
+        for (size_t i = at; i < at + 4; i++) {
+            wchar_t c = json[i];
+            uint32_t d = c >= L'0' && c <= L'9' ? c - L'0' : c >= L'a' && c <= L'f' ? c - L'a' + 10 : c >= L'A' && c <= L'F' ? c - L'A' + 10 : 16;
+            if (d == 16) return false;
+            value = value * 16 + d;
+        }
+        return true;
+    };
+    out.reserve(json.size() - 2);
+    for (size_t i = 1; i + 1 < json.size(); i++) {
+        wchar_t c = json[i];
+        if (c != L'\\') { out.push_back(c); continue; }
+        if (++i + 1 >= json.size()) break;
+        switch (json[i]) {
+        case L'n': out.push_back(L'\n'); break;
+        case L't': out.push_back(L'\t'); break;
+        case L'r': out.push_back(L'\r'); break;
+        case L'b': out.push_back(L'\b'); break;
+        case L'f': out.push_back(L'\f'); break;
+        case L'u': {
+            uint32_t u;
+            if (!hex(i + 1, u)) return out;
+            i += 4;
+            uint32_t lo;
+            if (sizeof(wchar_t) == 4 && u >= 0xD800 && u < 0xDC00 && i + 2 < json.size() && json[i + 1] == L'\\' && json[i + 2] == L'u' &&
+                hex(i + 3, lo) && lo >= 0xDC00 && lo < 0xE000) {
+                u = 0x10000 + ((u - 0xD800) << 10) + (lo - 0xDC00);
+                i += 6;
+            }
+            out.push_back((wchar_t)u);
+        } break;
+        default: out.push_back(json[i]); break; // \" \\ \/
+        }
+    }
+    return out;
+}
+
+// --- SEGMENT FILES ---
+// [TextSegmentHeader][UTF-16 string pool][TextDocRecord x docCount, by id][postings]
+// [TextTermRecord x termCount, by term bytes][term bytes]
+// A term's postings are varint pairs: document (as an index into the segment's records, minus
+// the previous one) and term frequency.
+namespace {
+const char TEXT_SEGMENT_MAGIC[8] = { 'S', 'A', 'R', 'F', 'T', 'E', 'X', 'T' };
+const uint32_t TEXT_SEGMENT_VERSION = 1;
+
+struct TextSegmentHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t fileSize;
+    uint32_t docCount;
+    uint32_t termCount;
+    uint64_t totalLength; // words over all documents
+    uint64_t stringsOffset;
+    uint64_t stringUnits;
+    uint64_t docsOffset;
+    uint64_t postingsOffset;
+    uint64_t postingsSize;
+    uint64_t termsOffset;
+    uint64_t termBytesOffset;
+    uint64_t termBytesSize;
+    uint64_t checksum; // of the header fields above
+};
+
+struct TextDocRecord {
+    uint64_t urlHash;
+    uint32_t id;
+    uint32_t length; // words, title words weighted
+    uint32_t urlOffset, urlLength; // in string units
+    uint32_t titleOffset, titleLength;
+};
+
+struct TextTermRecord {
+    uint32_t termOffset;
+    uint16_t termLength;
+    uint16_t reserved;
+    uint32_t docFreq;
+    uint32_t postingsLength;
+    uint64_t postingsOffset;
+};
+
+uint64_t HeaderChecksum(const TextSegmentHeader& h) {
+    const uint8_t* p = (const uint8_t*)&h;
+    uint64_t c = 14695981039346656037ull;
+    for (size_t i = 0; i < offsetof(TextSegmentHeader, checksum); i++) { c ^= p[i]; c *= 1099511628211ull; }
+    return c;
+}
+
+uint64_t HashUrl(std::wstring_view url) {
+    uint64_t h = 14695981039346656037ull;
+    for (wchar_t c : url) { h ^= (uint32_t)c; h *= 1099511628211ull; }
+    return h;
+}
+
+void PutVarint(std::string& out, uint32_t v) {
+    while (v >= 0x80) { out += (char)(v | 0x80); v >>= 7; }
+    out += (char)v;
+}
+
+bool GetVarint(const uint8_t*& p, const uint8_t* end, uint32_t& v) {
+    v = 0;
+    for (int shift = 0; shift < 35 && p < end; shift += 7) {
+        uint8_t b = *p++;
+        v |= (uint32_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+// Calls fn(doc, tf) for each posting; stops at the first malformed one
+template <class F> void ForEachPosting(std::string_view postings, uint32_t docCount, F fn) {
+    const uint8_t* p = (const uint8_t*)postings.data();
+    const uint8_t* end = p + postings.size();
+    uint32_t doc = 0, delta, tf;
+    while (p < end && GetVarint(p, end, delta) && GetVarint(p, end, tf)) {
+        doc += delta;
+        if (doc >= docCount) return;
+        fn(doc, tf);
+    }
+}
+
+void AppendUnits(std::vector<uint16_t>& pool, std::wstring_view s) {
+    for (wchar_t wc : s) {
+        uint32_t c = (uint32_t)wc;
+        if (c > 0xFFFF) { c -= 0x10000; pool.push_back((uint16_t)(0xD800 + (c >> 10))); pool.push_back((uint16_t)(0xDC00 + (c & 0x3FF))); }
+        else pool.push_back((uint16_t)c);
+    }
+}
+
+std::filesystem::path SegmentPath(const std::filesystem::path& dir, uint32_t firstId, uint32_t lastId) {
+    char name[32];
+    snprintf(name, sizeof(name), "%08x-%08x.seg", firstId, lastId);
+    return dir / name;
+}
+
+// Streams a segment to path.tmp and renames it into place. Strings go out as documents are
+// added and postings as terms are, so only the records and the dictionary are held in memory.
+// Documents come first, by id; then terms, in byte order.
+class SegmentWriter {
+public:
+    explicit SegmentWriter(std::filesystem::path path) : path(std::move(path)) {
+        tmp = this->path;
+        tmp += L".tmp";
+        file.open(tmp, std::ios::out | std::ios::binary | std::ios::trunc);
+        memset(&h, 0, sizeof(h));
+        Write(&h, sizeof(h)); // rewritten by Finish
+        h.stringsOffset = pos;
+    }
+
+    void AddDoc(uint64_t urlHash, uint32_t id, uint32_t length, std::wstring_view url, std::wstring_view title) {
+        TextDocRecord r = {};
+        r.urlHash = urlHash;
+        r.id = id;
+        r.length = length;
+        units.clear();
+        r.urlOffset = (uint32_t)h.stringUnits;
+        AppendUnits(units, url);
+        r.urlLength = (uint32_t)units.size();
+        r.titleOffset = r.urlOffset + r.urlLength;
+        AppendUnits(units, title);
+        r.titleLength = (uint32_t)units.size() - r.urlLength;
+        Write(units.data(), units.size() * sizeof(uint16_t));
+        h.stringUnits += units.size();
+        h.totalLength += length;
+        docs.push_back(r);
+    }
+
+    void AddTerm(std::string_view term, uint32_t docFreq, std::string_view postings) {
+        if (!inPostings) BeginPostings();
+        TextTermRecord t = {};
+        t.termOffset = (uint32_t)termBytes.size();
+        t.termLength = (uint16_t)term.size();
+        t.docFreq = docFreq;
+        t.postingsLength = (uint32_t)postings.size();
+        t.postingsOffset = h.postingsSize;
+        terms.push_back(t);
+        termBytes.append(term);
+        Write(postings.data(), postings.size());
+        h.postingsSize += postings.size();
+    }
+
+    bool Finish() {
+        if (!inPostings) BeginPostings();
+        Pad();
+        h.termsOffset = pos;
+        Write(terms.data(), terms.size() * sizeof(TextTermRecord));
+        h.termBytesOffset = pos;
+        h.termBytesSize = termBytes.size();
+        Write(termBytes.data(), termBytes.size());
+        memcpy(h.magic, TEXT_SEGMENT_MAGIC, sizeof(h.magic));
+        h.version = TEXT_SEGMENT_VERSION;
+        h.headerSize = sizeof(TextSegmentHeader);
+        h.fileSize = pos;
+        h.docCount = (uint32_t)docs.size();
+        h.termCount = (uint32_t)terms.size();
+        h.checksum = HeaderChecksum(h);
+        file.seekp(0);
+        file.write((const char*)&h, sizeof(h));
+        file.close();
+        std::error_code ec;
+        if (!file.good()) { std::filesystem::remove(tmp, ec); return false; }
+        std::filesystem::rename(tmp, path, ec);
+        return !ec;
+    }
+
+private:
+    void BeginPostings() {
+        Pad();
+        h.docsOffset = pos;
+        Write(docs.data(), docs.size() * sizeof(TextDocRecord));
+        h.postingsOffset = pos;
+        inPostings = true;
+    }
+
+    void Write(const void* data, size_t size) {
+        file.write((const char*)data, (std::streamsize)size);
+        pos += size;
+    }
+
+    void Pad() {
+        static const char zeros[8] = {};
+        if (pos % 8) Write(zeros, 8 - pos % 8);
+    }
+
+    std::filesystem::path path, tmp;
+    std::ofstream file;
+    TextSegmentHeader h;
+    uint64_t pos = 0;
+    bool inPostings = false;
+    std::vector<uint16_t> units;
+    std::vector<TextDocRecord> docs;
+    std::vector<TextTermRecord> terms;
+    std::string termBytes;
+};
+}
+
+class TextSegment {
+public:
+    static std::shared_ptr<TextSegment> Open(const std::filesystem::path& path) {
+        auto s = std::make_shared<TextSegment>();
+        s->path = path;
+        if (!s->file.Open(path) || s->file.Size() < sizeof(TextSegmentHeader)) return nullptr;
+        const uint8_t* p = s->file.Data();
+        TextSegmentHeader& h = s->header;
+        memcpy(&h, p, sizeof(h));
+        uint64_t size = s->file.Size();
+        if (memcmp(h.magic, TEXT_SEGMENT_MAGIC, sizeof(h.magic)) != 0 || h.version != TEXT_SEGMENT_VERSION ||
+            h.headerSize != sizeof(TextSegmentHeader) || h.fileSize != size || HeaderChecksum(h) != h.checksum) return nullptr;
+        if (h.docCount == 0 || h.stringsOffset + h.stringUnits * 2 > h.docsOffset || h.docsOffset % 8 ||
+            h.docsOffset + (uint64_t)h.docCount * sizeof(TextDocRecord) > h.postingsOffset ||
+            h.postingsOffset + h.postingsSize > h.termsOffset || h.termsOffset % 8 ||
+            h.termsOffset + (uint64_t)h.termCount * sizeof(TextTermRecord) > h.termBytesOffset ||
+            h.termBytesOffset + h.termBytesSize > size) return nullptr;
+        s->strings = (const uint16_t*)(p + h.stringsOffset);
+        s->docs = (const TextDocRecord*)(p + h.docsOffset);
+        s->postings = (const char*)(p + h.postingsOffset);
+        s->terms = (const TextTermRecord*)(p + h.termsOffset);
+        s->termBytes = (const char*)(p + h.termBytesOffset);
+        s->deleted.reset(new std::atomic<uint64_t>[(h.docCount + 63) / 64]());
+        return s;
+    }
+
+    ~TextSegment() {
+        file.Close();
+        std::error_code ec;
+        if (removeOnClose) std::filesystem::remove(path, ec);
+    }
+
+    uint32_t DocCount() const { return header.docCount; }
+    uint32_t TermCount() const { return header.termCount; }
+    uint64_t TotalLength() const { return header.totalLength; }
+    uint64_t FileSize() const { return header.fileSize; }
+    uint32_t FirstId() const { return docs[0].id; }
+    uint32_t LastId() const { return docs[header.docCount - 1].id; }
+    const TextDocRecord& Doc(uint32_t i) const { return docs[i]; }
+
+    std::wstring Text(uint32_t offset, uint32_t length) const {
+        std::wstring s;
+        if ((uint64_t)offset + length > header.stringUnits) return s;
+        s.reserve(length);
+        for (uint32_t i = 0; i < length; i++) {
+            uint32_t c = strings[offset + i];
+            if (sizeof(wchar_t) == 4 && c >= 0xD800 && c < 0xDC00 && i + 1 < length) {
+                uint32_t lo = strings[offset + i + 1];
+                if (lo >= 0xDC00 && lo < 0xE000) { c = 0x10000 + ((c - 0xD800) << 10) + (lo - 0xDC00); i++; }
+            }
+            s.push_back((wchar_t)c);
+        }
+        return s;
+    }
+
+    // The record index of document `id`, or -1
+    int64_t Local(uint32_t id) const {
+        const TextDocRecord* end = docs + header.docCount;
+        const TextDocRecord* it = std::lower_bound(docs, end, id, [](const TextDocRecord& r, uint32_t v) { return r.id < v; });
+        return it != end && it->id == id ? it - docs : -1;
+    }
+
+    bool Deleted(uint32_t i) const { return (deleted[i >> 6].load(std::memory_order_relaxed) >> (i & 63)) & 1; }
+    // True if it was not deleted already
+    bool Delete(uint32_t i) {
+        uint64_t bit = 1ull << (i & 63);
+        return !(deleted[i >> 6].fetch_or(bit, std::memory_order_relaxed) & bit);
+    }
+
+    std::string_view Term(uint32_t t) const {
+        const TextTermRecord& r = terms[t];
+        if ((uint64_t)r.termOffset + r.termLength > header.termBytesSize) return {};
+        return { termBytes + r.termOffset, r.termLength };
+    }
+
+    uint32_t DocFreq(uint32_t t) const { return terms[t].docFreq; }
+
+    std::string_view Postings(uint32_t t) const {
+        const TextTermRecord& r = terms[t];
+        if (r.postingsOffset + r.postingsLength > header.postingsSize) return {};
+        return { postings + r.postingsOffset, r.postingsLength };
+    }
+
+    // The first term not less than `term`
+    uint32_t LowerBound(std::string_view term) const {
+        uint32_t lo = 0, hi = header.termCount;
+        while (lo < hi) {
+            uint32_t mid = lo + (hi - lo) / 2;
+            if (Term(mid) < term) lo = mid + 1;
+            else hi = mid;
+        }
+        return lo;
+    }
+
+    std::filesystem::path path;
+    std::atomic<bool> removeOnClose{ false }; // merged away or cleared; deleted once unmapped
+
+private:
+    MappedFile file;
+    TextSegmentHeader header = {};
+    const uint16_t* strings = nullptr;
+    const TextDocRecord* docs = nullptr;
+    const char* postings = nullptr;
+    const TextTermRecord* terms = nullptr;
+    const char* termBytes = nullptr;
+    std::unique_ptr<std::atomic<uint64_t>[]> deleted; // pages visited again since
+};
+
+// --- TEXT INDEX ---
+// Title words count this many times over, so a page titled with the query ranks above one that
+// mentions it in passing
+static const uint32_t TITLE_WEIGHT = 3;
+// Terms a prefix expands to, per segment, in dictionary order
+static const uint32_t PREFIX_TERMS = 64;
+static const double BM25_K1 = 1.2, BM25_B = 0.75;
+
+TextIndex::TextIndex(std::filesystem::path dir, Config config)
+    : dir(std::move(dir)), config(config), current(std::make_shared<Snapshot>()) {
+    worker = std::thread([this] { Run(); });
+}
+
+TextIndex::~TextIndex() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+void TextIndex::Add(std::wstring url, std::wstring title, std::wstring text) {
+    if (text.size() > config.maxTextChars) text.resize(config.maxTextChars);
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stats.added++;
+        if (queue.size() >= config.queuedPages) {
+            queue.pop_front();
+            stats.dropped++;
+        }
+        queue.push_back({ std::move(url), std::move(title), std::move(text) });
+    }
+    wake.notify_one();
+}
+
+void TextIndex::Clear() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        queue.clear();
+        for (const auto& s : current->segments) s->removeOnClose = true;
+        current = std::make_shared<Snapshot>();
+        clearWanted++;
+    }
+    wake.notify_one();
+}
+
+void TextIndex::Flush() {
+    std::unique_lock<std::mutex> guard(lock);
+    uint64_t ticket = ++flushWanted;
+    wake.notify_one();
+    flushed.wait(guard, [this, ticket] { return flushDone >= ticket; });
+}
+
+TextIndex::Stats TextIndex::GetStats() const {
+    std::lock_guard<std::mutex> guard(lock);
+    Stats s = stats;
+    s.segments = current->segments.size();
+    for (const auto& segment : current->segments) s.diskBytes += segment->FileSize();
+    s.pages = clearWanted == clearDone ? livePages.load(std::memory_order_relaxed) : 0;
+    return s;
+}
+
+std::shared_ptr<const TextIndex::Snapshot> TextIndex::Current() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return current;
+}
+
+void TextIndex::Run() {
+    OpenSegments();
+    std::unique_lock<std::mutex> guard(lock);
+    auto ready = [this] { return stopping || !queue.empty() || clearWanted != clearDone || flushWanted != flushDone; };
+    while (true) {
+        if (bufferDocs.empty()) wake.wait(guard, ready);
+        else if (!wake.wait_for(guard, config.idleFlush, ready)) {
+            guard.unlock();
+            WriteBuffer(); // idle: make what was indexed searchable
+            MaybeMerge();
+            guard.lock();
+            continue;
+        }
+        if (clearWanted != clearDone) {
+            uint64_t wanted = clearWanted;
+            guard.unlock();
+            DropAll();
+            guard.lock();
+            clearDone = wanted;
+            continue;
+        }
+        if (!queue.empty()) {
+            Page page = std::move(queue.front());
+            queue.pop_front();
+            guard.unlock();
+            IndexPage(page);
+            if (bufferDocs.size() >= config.bufferPages || bufferSize >= config.bufferBytes) {
+                WriteBuffer();
+                MaybeMerge();
+            }
+            guard.lock();
+            continue;
+        }
+        if (flushWanted != flushDone || stopping) {
+            uint64_t wanted = flushWanted;
+            guard.unlock();
+            WriteBuffer();
+            if (!stopping) MaybeMerge();
+            guard.lock();
+            flushDone = wanted;
+            flushed.notify_all();
+            if (stopping) return;
+        }
+    }
+}
+
+// Segments left by a merge that finished writing but not deleting its inputs are covered by
+// the merged one, and removed
+void TextIndex::OpenSegments() {
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    std::vector<std::shared_ptr<TextSegment>> found;
+    for (const auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+        std::filesystem::path p = entry.path();
+        std::error_code removed;
+        if (p.extension() == ".tmp") std::filesystem::remove(p, removed);
+        if (p.extension() != ".seg") continue;
+        if (std::shared_ptr<TextSegment> s = TextSegment::Open(p)) found.push_back(std::move(s));
+        else std::filesystem::remove(p, removed);
+    }
+    std::sort(found.begin(), found.end(), [](const auto& a, const auto& b) {
+        return a->FirstId() != b->FirstId() ? a->FirstId() < b->FirstId() : a->LastId() > b->LastId();
+    });
+    auto snapshot = std::make_shared<Snapshot>();
+    for (auto& s : found) {
+        if (!snapshot->segments.empty() && s->FirstId() <= snapshot->segments.back()->LastId()) { s->removeOnClose = true; continue; }
+        snapshot->documents += s->DocCount();
+        snapshot->totalLength += s->TotalLength();
+        snapshot->segments.push_back(std::move(s));
+    }
+    found.clear();
+
+    // Older documents of a URL indexed again are marked deleted until a merge drops them
+    uint64_t live = 0;
+    for (const auto& s : snapshot->segments) {
+        for (uint32_t i = 0; i < s->DocCount(); i++) {
+            const TextDocRecord& d = s->Doc(i);
+            auto inserted = latest.try_emplace(d.urlHash, d.id);
+            live++;
+            if (inserted.second) continue;
+            for (const auto& older : snapshot->segments) {
+                int64_t local = older->Local(inserted.first->second);
+                if (local >= 0 && older->Delete((uint32_t)local)) live--;
+            }
+            inserted.first->second = d.id;
+        }
+    }
+    nextId = snapshot->segments.empty() ? 0 : snapshot->segments.back()->LastId() + 1;
+    livePages = live;
+    std::lock_guard<std::mutex> guard(lock);
+    current = std::move(snapshot);
+}
+
+void TextIndex::IndexPage(Page& page) {
+    uint64_t hash = HashUrl(page.url);
+    auto previous = latest.find(hash);
+    if (previous != latest.end()) {
+        uint32_t id = previous->second;
+        if (!bufferDocs.empty() && id >= bufferDocs.front().id) WriteBuffer(); // so it can be marked
+        std::shared_ptr<const Snapshot> snapshot = Current();
+        auto it = std::upper_bound(snapshot->segments.begin(), snapshot->segments.end(), id,
+            [](uint32_t v, const std::shared_ptr<TextSegment>& s) { return v < s->FirstId(); });
+        if (it != snapshot->segments.begin()) {
+            TextSegment& s = **--it;
+            int64_t local = s.Local(id);
+            if (local >= 0 && s.Delete((uint32_t)local)) livePages--;
+        }
+    }
+
+    words.clear();
+    TokenizeText(page.title, words);
+    size_t titleWords = words.size();
+    TokenizeText(page.text, words);
+    counts.clear();
+    for (size_t i = 0; i < words.size(); i++) counts[words[i]] += i < titleWords ? TITLE_WEIGHT : 1;
+
+    uint32_t local = (uint32_t)bufferDocs.size();
+    for (const auto& [word, tf] : counts) {
+        BufferTerm& term = bufferTerms[std::string(word)];
+        size_t before = term.postings.size();
+        if (term.docFreq == 0) bufferSize += word.size() + sizeof(BufferTerm) + 32;
+        PutVarint(term.postings, local - term.lastDoc);
+        PutVarint(term.postings, tf);
+        term.lastDoc = local;
+        term.docFreq++;
+        bufferSize += term.postings.size() - before;
+    }
+    BufferDoc doc;
+    doc.urlHash = hash;
+    doc.id = nextId++;
+    doc.length = (uint32_t)(words.size() + titleWords * (TITLE_WEIGHT - 1));
+    doc.url = std::move(page.url);
+    doc.title = std::move(page.title);
+    bufferSize += sizeof(BufferDoc) + (doc.url.size() + doc.title.size()) * sizeof(wchar_t);
+    latest[hash] = doc.id;
+    livePages++;
+    bufferDocs.push_back(std::move(doc));
+}
+
+bool TextIndex::WriteBuffer() {
+    if (bufferDocs.empty()) return true;
+    std::filesystem::path path = SegmentPath(dir, bufferDocs.front().id, bufferDocs.back().id);
+    std::vector<const std::pair<const std::string, BufferTerm>*> sorted;
+    sorted.reserve(bufferTerms.size());
+    for (const auto& t : bufferTerms) sorted.push_back(&t);
+    std::sort(sorted.begin(), sorted.end(), [](const auto* a, const auto* b) { return a->first < b->first; });
+
+    SegmentWriter writer(path);
+    for (const BufferDoc& d : bufferDocs) writer.AddDoc(d.urlHash, d.id, d.length, d.url, d.title);
+    for (const auto* t : sorted) writer.AddTerm(t->first, t->second.docFreq, t->second.postings);
+    bool ok = writer.Finish();
+    // Dropped even if the write failed, to keep memory bounded
+    bufferDocs.clear();
+    bufferTerms.clear();
+    bufferSize = 0;
+    std::shared_ptr<TextSegment> segment = ok ? TextSegment::Open(path) : nullptr;
+    if (!segment) return false;
+    Replace(Current()->segments.size(), 0, std::move(segment));
+    return true;
+}
+
+// Logarithmic merging: segments are levelled by size, and once `mergeFactor` of the newest share
+// a level they become one segment of the next. Each page is rewritten O(log pages) times.
+void TextIndex::MaybeMerge() {
+    auto level = [this](uint32_t docs) {
+        int l = 0;
+        for (uint64_t size = config.bufferPages; docs > size; size *= config.mergeFactor) l++;
+        return l;
+    };
+    size_t factor = (std::max)((size_t)2, config.mergeFactor);
+    while (true) {
+        std::shared_ptr<const Snapshot> snapshot = Current();
+        const auto& segments = snapshot->segments;
+        size_t n = segments.size();
+        if (n < factor) return;
+        int l = level(segments[n - 1]->DocCount());
+        for (size_t i = n - factor; i < n - 1; i++) {
+            if (level(segments[i]->DocCount()) != l) return;
+        }
+        if (!Merge(n - factor, factor)) return;
+    }
+}
+
+bool TextIndex::Merge(size_t first, size_t count) {
+    std::shared_ptr<const Snapshot> snapshot = Current();
+    std::vector<std::shared_ptr<TextSegment>> inputs(snapshot->segments.begin() + first, snapshot->segments.begin() + first + count);
+    snapshot.reset();
+
+    // New record index of each live document, -1 for deleted ones
+    std::vector<std::vector<int64_t>> remap(count);
+    int64_t live = 0;
+    for (size_t i = 0; i < count; i++) {
+        remap[i].resize(inputs[i]->DocCount());
+        for (uint32_t d = 0; d < inputs[i]->DocCount(); d++) remap[i][d] = inputs[i]->Deleted(d) ? -1 : live++;
+    }
+    if (live == 0) {
+        Replace(first, count, nullptr);
+        return true;
+    }
+
+    std::filesystem::path path = SegmentPath(dir, inputs.front()->FirstId(), inputs.back()->LastId());
+    SegmentWriter writer(path);
+    for (size_t i = 0; i < count; i++) {
+        const TextSegment& s = *inputs[i];
+        for (uint32_t d = 0; d < s.DocCount(); d++) {
+            if (remap[i][d] < 0) continue;
+            const TextDocRecord& r = s.Doc(d);
+            writer.AddDoc(r.urlHash, r.id, r.length, s.Text(r.urlOffset, r.urlLength), s.Text(r.titleOffset, r.titleLength));
+        }
+    }
+
+    // The dictionaries, merged in byte order; a term's postings are concatenated input by input,
+    // which keeps them in document order
+    struct Cursor {
+        std::string_view term;
+        size_t input;
+        uint32_t index;
+    };
+    auto later = [](const Cursor& a, const Cursor& b) { return a.term != b.term ? a.term > b.term : a.input > b.input; };
+    std::priority_queue<Cursor, std::vector<Cursor>, decltype(later)> heap(later);
+    for (size_t i = 0; i < count; i++) if (inputs[i]->TermCount()) heap.push({ inputs[i]->Term(0), i, 0 });
+    std::string postings;
+    while (!heap.empty()) {
+        std::string_view term = heap.top().term;
+        postings.clear();
+        uint32_t docFreq = 0;
+        int64_t last = 0;
+        while (!heap.empty() && heap.top().term == term) {
+            Cursor c = heap.top();
+            heap.pop();
+            const TextSegment& s = *inputs[c.input];
+            const std::vector<int64_t>& map = remap[c.input];
+            ForEachPosting(s.Postings(c.index), s.DocCount(), [&](uint32_t doc, uint32_t tf) {
+                if (map[doc] < 0) return;
+                PutVarint(postings, (uint32_t)(map[doc] - last));
+                PutVarint(postings, tf);
+                last = map[doc];
+                docFreq++;
+            });
+            if (c.index + 1 < s.TermCount()) heap.push({ s.Term(c.index + 1), c.input, c.index + 1 });
+        }
+        if (docFreq) writer.AddTerm(term, docFreq, postings);
+    }
+    if (!writer.Finish()) return false;
+    std::shared_ptr<TextSegment> merged = TextSegment::Open(path);
+    if (!merged) return false;
+    Replace(first, count, std::move(merged));
+    std::lock_guard<std::mutex> guard(lock);
+    stats.merges++;
+    return true;
+}
+
+// Publishes a snapshot with segments [first, first + count) replaced by `with` (if any). The
+// replaced files are deleted once the last search using them lets go.
+void TextIndex::Replace(size_t first, size_t count, std::shared_ptr<TextSegment> with) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (clearWanted != clearDone) { // everything is going
+        if (with) with->removeOnClose = true;
+        return;
+    }
+    auto next = std::make_shared<Snapshot>(*current);
+    for (size_t i = first; i < first + count; i++) next->segments[i]->removeOnClose = true;
+    next->segments.erase(next->segments.begin() + first, next->segments.begin() + first + count);
+    if (with) next->segments.insert(next->segments.begin() + first, std::move(with));
+    next->documents = 0;
+    next->totalLength = 0;
+    for (const auto& s : next->segments) {
+        next->documents += s->DocCount();
+        next->totalLength += s->TotalLength();
+    }
+    current = std::move(next);
+}
+
+// Clear has already unpublished and flagged every segment
+void TextIndex::DropAll() {
+    bufferDocs.clear();
+    bufferTerms.clear();
+    bufferSize = 0;
+    latest.clear();
+    livePages = 0;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+        std::error_code removed;
+        std::filesystem::remove(entry.path(), removed); // mapped ones go when unmapped
+    }
+}
+
+// --- SEARCH ---
+std::vector<TextSearchResult> TextIndex::Search(std::wstring_view query, size_t limit) const {
+    std::vector<TextSearchResult> results;
+    std::vector<std::string> words;
+    TokenizeText(query, words);
+    if (words.empty() || limit == 0) return results;
+    struct QueryTerm {
+        std::string text;
+        bool prefix = false;
+        double idf = 0;
+    };
+    std::vector<QueryTerm> terms;
+    bool prefix = query.back() != L' ';
+    for (size_t i = 0; i < words.size(); i++) {
+        bool isPrefix = prefix && i + 1 == words.size();
+        bool dup = false;
+        for (QueryTerm& t : terms) {
+            if (t.text != words[i]) continue;
+            dup = true;
+            t.prefix = t.prefix && isPrefix;
+        }
+        if (!dup) terms.push_back({ words[i], isPrefix, 0 });
+    }
+
+    std::shared_ptr<const Snapshot> snapshot = Current();
+    if (snapshot->segments.empty()) return results;
+    double pages = (double)(std::max)((uint64_t)1, livePages.load(std::memory_order_relaxed));
+    double avgLength = (double)snapshot->totalLength / (std::max)((uint64_t)1, snapshot->documents);
+    if (avgLength <= 0) avgLength = 1;
+
+    // The dictionary entries each term matches in each segment
+    const auto& segments = snapshot->segments;
+    std::vector<std::vector<std::vector<uint32_t>>> matches(segments.size(), std::vector<std::vector<uint32_t>>(terms.size()));
+    for (size_t t = 0; t < terms.size(); t++) {
+        uint64_t docFreq = 0;
+        for (size_t s = 0; s < segments.size(); s++) {
+            const TextSegment& segment = *segments[s];
+            for (uint32_t i = segment.LowerBound(terms[t].text); i < segment.TermCount() && matches[s][t].size() < PREFIX_TERMS; i++) {
+                std::string_view term = segment.Term(i);
+                bool match = terms[t].prefix ? term.substr(0, terms[t].text.size()) == terms[t].text : term == terms[t].text;
+                if (!match) break;
+                matches[s][t].push_back(i);
+                docFreq += segment.DocFreq(i);
+                if (!terms[t].prefix) break;
+            }
+        }
+        double df = (std::min)((double)docFreq, pages);
+        terms[t].idf = std::log(1 + (pages - df + 0.5) / (df + 0.5));
+    }
+
+    struct Hit {
+        double score;
+        size_t segment;
+        uint32_t doc;
+        bool operator>(const Hit& o) const { return score > o.score; }
+    };
+    std::priority_queue<Hit, std::vector<Hit>, std::greater<Hit>> best; // worst on top
+    struct Posting {
+        uint32_t doc;
+        uint32_t tf;
+    };
+    std::vector<std::vector<Posting>> lists(terms.size());
+    std::vector<Posting> candidates;
+    std::vector<double> scores;
+    for (size_t s = 0; s < segments.size(); s++) {
+        const TextSegment& segment = *segments[s];
+        bool empty = false;
+        for (size_t t = 0; t < terms.size() && !empty; t++) {
+            std::vector<Posting>& list = lists[t];
+            list.clear();
+            for (uint32_t i : matches[s][t]) {
+                ForEachPosting(segment.Postings(i), segment.DocCount(), [&list](uint32_t doc, uint32_t tf) { list.push_back({ doc, tf }); });
+            }
+            if (matches[s][t].size() > 1) { // a prefix: one posting per document, frequencies summed
+                std::sort(list.begin(), list.end(), [](const Posting& a, const Posting& b) { return a.doc < b.doc; });
+                size_t out = 0;
+                for (size_t i = 0; i < list.size(); i++) {
+                    if (out && list[out - 1].doc == list[i].doc) list[out - 1].tf += list[i].tf;
+                    else list[out++] = list[i];
+                }
+                list.resize(out);
+            }
+            empty = list.empty();
+        }
+        if (empty) continue;
+
+        // Intersect, shortest list first
+        std::vector<size_t> order(terms.size());
+        for (size_t t = 0; t < order.size(); t++) order[t] = t;
+        std::sort(order.begin(), order.end(), [&lists](size_t a, size_t b) { return lists[a].size() < lists[b].size(); });
+        candidates.clear();
+        scores.clear();
+        auto weigh = [&](size_t t, const Posting& p) {
+            double length = segment.Doc(p.doc).length;
+            double tf = p.tf;
+            return terms[t].idf * tf * (BM25_K1 + 1) / (tf + BM25_K1 * (1 - BM25_B + BM25_B * length / avgLength));
+        };
+        for (const Posting& p : lists[order[0]]) {
+            if (segment.Deleted(p.doc)) continue;
+            candidates.push_back(p);
+            scores.push_back(weigh(order[0], p));
+        }
+        for (size_t k = 1; k < order.size() && !candidates.empty(); k++) {
+            const std::vector<Posting>& list = lists[order[k]];
+            size_t out = 0, j = 0;
+            for (size_t i = 0; i < candidates.size(); i++) {
+                while (j < list.size() && list[j].doc < candidates[i].doc) j++;
+                if (j == list.size()) break;
+                if (list[j].doc != candidates[i].doc) continue;
+                scores[out] = scores[i] + weigh(order[k], list[j]);
+                candidates[out++] = candidates[i];
+            }
+            candidates.resize(out);
+            scores.resize(out);
+        }
+        for (size_t i = 0; i < candidates.size(); i++) {
+            if (best.size() < limit) best.push({ scores[i], s, candidates[i].doc });
+            else if (scores[i] > best.top().score) { best.pop(); best.push({ scores[i], s, candidates[i].doc }); }
+        }
+    }
+
+    results.resize(best.size());
+    for (size_t i = results.size(); i-- > 0; best.pop()) {
+        const Hit& hit = best.top();
+        const TextSegment& segment = *segments[hit.segment];
+        const TextDocRecord& r = segment.Doc(hit.doc);
+        results[i].url = segment.Text(r.urlOffset, r.urlLength);
+        results[i].title = segment.Text(r.titleOffset, r.titleLength);
+        results[i].score = hit.score;
+    }
+    return results;
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Appends the words of `text` as the index keys them: runs of letters and digits, lowercased,
+// in UTF-8. Han, kana and Hangul have no spaces between words, so each of their characters is
+// a word of its own; words longer than 40 characters are dropped.
+void TokenizeText(std::wstring_view text, std::vector<std::string>& out);
+
+// The string ExecuteScript returns as JSON (a quoted literal); empty for anything else
+std::wstring JsonStringValue(std::wstring_view json);
+
+struct TextSearchResult {
+    std::wstring url;
+    std::wstring title;
+    double score = 0; // BM25; only the ordering is meaningful
+};
+
+class TextSegment;
+
+// Full-text index of page text, kept in a folder of its own. Pages are indexed by a background
+// thread into an in-memory buffer, which is written out as an immutable, memory-mapped segment:
+// a sorted term dictionary over posting lists of (document delta, term frequency) varints.
+// Segments of a size are merged into one as they accumulate, dropping pages visited again since,
+// so memory holds only the buffer, the dictionaries the system keeps paged in, and a few bytes
+// per page. A page becomes searchable once its segment is written, which happens when the
+// buffer fills or indexing has been idle for a moment.
+// Add, Search, Clear and GetStats may be called from any thread; none waits for indexing.
+class TextIndex {
+public:
+    struct Config {
+        size_t bufferPages = 256;          // pages held in memory before a segment is written
+        size_t bufferBytes = 8 << 20;      // or postings and strings, whichever fills first
+        size_t queuedPages = 64;           // waiting to be indexed; beyond, the oldest are dropped
+        size_t maxTextChars = 64 * 1024;   // of a page's text; the rest is not indexed
+        size_t mergeFactor = 4;            // segments of one size merged at a time
+        std::chrono::milliseconds idleFlush{ 2000 };
+    };
+
+    TextIndex(std::filesystem::path dir, Config config);
+    ~TextIndex(); // indexes and writes what is queued
+
+    TextIndex(const TextIndex&) = delete;
+    TextIndex& operator=(const TextIndex&) = delete;
+
+    // Replaces what was indexed for `url` before
+    void Add(std::wstring url, std::wstring title, std::wstring text);
+    // Pages holding every word of `query`, the last one as a prefix unless the query ends in a
+    // space, best first
+    std::vector<TextSearchResult> Search(std::wstring_view query, size_t limit) const;
+    // Forgets every page, on disk too, including those still queued
+    void Clear();
+    // Blocks until every page added so far is searchable
+    void Flush();
+
+    struct Stats {
+        uint64_t added = 0;
+        uint64_t dropped = 0;  // fell off a full queue
+        uint64_t merges = 0;
+        size_t segments = 0;
+        uint64_t pages = 0;    // searchable, each URL once
+        uint64_t diskBytes = 0;
+    };
+    Stats GetStats() const;
+
+private:
+    struct Page {
+        std::wstring url;
+        std::wstring title;
+        std::wstring text;
+    };
+    struct Snapshot {
+        std::vector<std::shared_ptr<TextSegment>> segments; // by document id
+        uint64_t documents = 0;                             // including replaced ones
+        uint64_t totalLength = 0;                           // words over all documents
+    };
+    struct BufferDoc {
+        uint64_t urlHash = 0;
+        uint32_t id = 0;
+        uint32_t length = 0;
+        std::wstring url;
+        std::wstring title;
+    };
+    struct BufferTerm {
+        std::string postings;
+        uint32_t lastDoc = 0;
+        uint32_t docFreq = 0;
+    };
+
+    void Run();
+    void OpenSegments();
+    void IndexPage(Page& page);
+    bool WriteBuffer();
+    void MaybeMerge();
+    bool Merge(size_t first, size_t count);
+    void Replace(size_t first, size_t count, std::shared_ptr<TextSegment> with);
+    void DropAll();
+    std::shared_ptr<const Snapshot> Current() const;
+
+    std::filesystem::path dir;
+    Config config;
+
+    // Worker only
+    std::unordered_map<uint64_t, uint32_t> latest; // URL hash -> id of its newest document
+    uint32_t nextId = 0;
+    std::vector<BufferDoc> bufferDocs;
+    std::unordered_map<std::string, BufferTerm> bufferTerms;
+    size_t bufferSize = 0;
+    std::vector<std::string> words;
+    std::unordered_map<std::string_view, uint32_t> counts;
+
+    mutable std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable flushed;
+    std::deque<Page> queue;
+    std::shared_ptr<const Snapshot> current;
+    std::atomic<uint64_t> livePages{ 0 };
+    uint64_t flushWanted = 0, flushDone = 0;
+    uint64_t clearWanted = 0, clearDone = 0;
+    bool stopping = false;
+    Stats stats;
+    std::thread worker;
+};
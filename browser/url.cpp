@@ -0,0 +1,236 @@
+#include "url.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define URL_SSE2 1
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#ifdef URL_SSE2
+static int LowestBit(int mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, (unsigned long)mask);
+    return (int)index;
+#else
+    return __builtin_ctz((unsigned)mask);
+#endif
+}
+#endif
+
+size_t ScanForAny(const wchar_t* p, size_t n, wchar_t a, wchar_t b, wchar_t c) {
+    size_t i = 0;
+#ifdef URL_SSE2
+    // wchar_t is 16 bits on Windows and 32 elsewhere
+    if constexpr (sizeof(wchar_t) == 2) {
+        const __m128i va = _mm_set1_epi16((short)a), vb = _mm_set1_epi16((short)b), vc = _mm_set1_epi16((short)c);
+        for (; i + 8 <= n; i += 8) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(p + i));
+            __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi16(v, va), _mm_cmpeq_epi16(v, vb)), _mm_cmpeq_epi16(v, vc));
+            int mask = _mm_movemask_epi8(hit);
+            if (mask) return i + (size_t)(LowestBit(mask) >> 1);
+        }
+    }
+    else {
+        const __m128i va = _mm_set1_epi32((int)a), vb = _mm_set1_epi32((int)b), vc = _mm_set1_epi32((int)c);
+        for (; i + 4 <= n; i += 4) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(p + i));
+            __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi32(v, va), _mm_cmpeq_epi32(v, vb)), _mm_cmpeq_epi32(v, vc));
+            int mask = _mm_movemask_epi8(hit);
+            if (mask) return i + (size_t)(LowestBit(mask) >> 2);
+        }
+    }
+#endif
+    for (; i < n; i++) {
+        if (p[i] == a || p[i] == b || p[i] == c) return i;
+    }
+    return n;
+}
+
+static bool IsAlpha(wchar_t c) { return (c >= L'a' && c <= L'z') || (c >= L'A' && c <= L'Z'); }
+static bool IsDigit(wchar_t c) { return c >= L'0' && c <= L'9'; }
+static wchar_t Lower(wchar_t c) { return (c >= L'A' && c <= L'Z') ? (wchar_t)(c - L'A' + L'a') : c; }
+static wchar_t Upper(wchar_t c) { return (c >= L'a' && c <= L'z') ? (wchar_t)(c - L'a' + L'A') : c; }
+
+static int HexValue(wchar_t c) {
+    if (c >= L'0' && c <= L'9') return c - L'0';
+    if (c >= L'a' && c <= L'f') return c - L'a' + 10;
+    if (c >= L'A' && c <= L'F') return c - L'A' + 10;
+    return -1;
+}
+
+static bool EqualsLower(std::wstring_view s, std::wstring_view lower) {
+    if (s.size() != lower.size()) return false;
+    for (size_t i = 0; i < s.size(); i++) if (Lower(s[i]) != lower[i]) return false;
+    return true;
+}
+
+static int DefaultPort(std::wstring_view scheme) {
+    if (EqualsLower(scheme, L"http") || EqualsLower(scheme, L"ws")) return 80;
+    if (EqualsLower(scheme, L"https") || EqualsLower(scheme, L"wss")) return 443;
+    if (EqualsLower(scheme, L"ftp")) return 21;
+    return -1;
+}
+
+bool ParseUrl(std::wstring_view text, Url& url) {
+    url = Url();
+    size_t n = text.size(), i = 0;
+    if (n == 0 || !IsAlpha(text[0])) return false;
+    while (i < n && (IsAlpha(text[i]) || IsDigit(text[i]) || text[i] == L'+' || text[i] == L'-' || text[i] == L'.')) i++;
+    if (i == n || text[i] != L':') return false;
+    url.scheme = text.substr(0, i++);
+
+    if (n - i >= 2 && text[i] == L'/' && text[i + 1] == L'/') {
+        url.hasAuthority = true;
+        size_t begin = i + 2;
+        size_t end = begin + ScanForAny(text.data() + begin, n - begin, L'/', L'?', L'#');
+        std::wstring_view auth = text.substr(begin, end - begin);
+        size_t at = auth.rfind(L'@');
+        if (at != std::wstring_view::npos) {
+            url.userinfo = auth.substr(0, at);
+            auth.remove_prefix(at + 1);
+        }
+        if (!auth.empty() && auth[0] == L'[') {
+            size_t close = auth.find(L']');
+            if (close == std::wstring_view::npos) return false;
+            url.host = auth.substr(0, close + 1);
+            auth.remove_prefix(close + 1);
+            if (!auth.empty() && auth[0] != L':') return false;
+        }
+        else {
+            size_t colon = auth.find(L':');
+            url.host = auth.substr(0, colon);
+            auth.remove_prefix(colon == std::wstring_view::npos ? auth.size() : colon);
+        }
+        if (!auth.empty()) {
+            url.port = auth.substr(1);
+            for (wchar_t c : url.port) if (!IsDigit(c)) return false;
+        }
+        i = end;
+    }
+
+    size_t pathEnd = i + ScanForAny(text.data() + i, n - i, L'?', L'#', L'#');
+    url.path = text.substr(i, pathEnd - i);
+    i = pathEnd;
+    if (i < n && text[i] == L'?') {
+        size_t queryEnd = i + 1 + ScanForAny(text.data() + i + 1, n - i - 1, L'#', L'#', L'#');
+        url.hasQuery = true;
+        url.query = text.substr(i + 1, queryEnd - i - 1);
+        i = queryEnd;
+    }
+    if (i < n) {
+        url.hasFragment = true;
+        url.fragment = text.substr(i + 1);
+    }
+    return true;
+}
+
+bool IsIpLiteral(std::wstring_view host) {
+    if (host.size() >= 2 && host.front() == L'[' && host.back() == L']') {
+        int colons = 0;
+        for (wchar_t c : host.substr(1, host.size() - 2)) {
+            if (c == L':') colons++;
+            else if (!(IsDigit(c) || HexValue(c) >= 0 || c == L'.')) return false;
+        }
+        return colons >= 2;
+    }
+    int parts = 0, digits = 0, value = 0;
+    for (size_t i = 0; i <= host.size(); i++) {
+        if (i == host.size() || host[i] == L'.') {
+            if (digits == 0 || value > 255) return false;
+            parts++;
+            digits = value = 0;
+        }
+        else if (IsDigit(host[i]) && digits < 3) {
+            value = value * 10 + (host[i] - L'0');
+            digits++;
+        }
+        else return false;
+    }
+    return parts == 4;
+}
+
+int Url::Port() const {
+    if (port.empty()) return DefaultPort(scheme);
+    int value = 0;
+    for (wchar_t c : port) {
+        value = value * 10 + (c - L'0');
+        if (value > 65535) return -1;
+    }
+    return value;
+}
+
+bool Url::IsDefaultPort() const {
+    if (port.empty()) return true;
+    int def = DefaultPort(scheme);
+    return def != -1 && Port() == def;
+}
+
+std::wstring_view Url::HostToPath() const {
+    if (!hasAuthority) return path;
+    return std::wstring_view(host.data(), (size_t)(path.data() + path.size() - host.data()));
+}
+
+namespace {
+struct Writer {
+    wchar_t* out;
+    size_t capacity;
+    size_t length = 0;
+
+    void Put(wchar_t c) {
+        if (length < capacity) out[length] = c;
+        length++;
+    }
+    void Put(std::wstring_view s) { for (wchar_t c : s) Put(c); }
+    void PutLower(std::wstring_view s) { for (wchar_t c : s) Put(Lower(c)); }
+
+    // Percent-escapes: unreserved characters are decoded, the rest get upper-case hex
+    void PutEscaped(std::wstring_view s) {
+        for (size_t i = 0; i < s.size(); i++) {
+            int hi, lo;
+            if (s[i] == L'%' && i + 2 < s.size() && (hi = HexValue(s[i + 1])) >= 0 && (lo = HexValue(s[i + 2])) >= 0) {
+                wchar_t c = (wchar_t)(hi * 16 + lo);
+                if (IsAlpha(c) || IsDigit(c) || c == L'-' || c == L'.' || c == L'_' || c == L'~') Put(c);
+                else { Put(L'%'); Put(Upper(s[i + 1])); Put(Upper(s[i + 2])); }
+                i += 2;
+            }
+            else Put(s[i]);
+        }
+    }
+};
+}
+
+size_t CanonicalizeUrl(const Url& url, wchar_t* out, size_t capacity) {
+    Writer w{ out, capacity };
+    w.PutLower(url.scheme);
+    w.Put(L':');
+    if (url.hasAuthority) {
+        w.Put(L"//");
+        if (!url.userinfo.empty()) { w.Put(url.userinfo); w.Put(L'@'); }
+        w.PutLower(url.host);
+        if (!url.IsDefaultPort()) {
+            w.Put(L':');
+            std::wstring_view digits = url.port;
+            while (digits.size() > 1 && digits[0] == L'0') digits.remove_prefix(1);
+            w.Put(digits);
+        }
+        if (url.path.empty()) w.Put(L'/');
+    }
+    w.PutEscaped(url.path);
+    if (url.hasQuery) { w.Put(L'?'); w.PutEscaped(url.query); }
+    if (url.hasFragment) { w.Put(L'#'); w.PutEscaped(url.fragment); }
+    return w.length;
+}
+
+std::wstring CanonicalUrl(std::wstring_view text) {
+    Url url;
+    if (!ParseUrl(text, url)) return std::wstring(text);
+    wchar_t buffer[512];
+    size_t length = CanonicalizeUrl(url, buffer, 512);
+    if (length <= 512) return std::wstring(buffer, length);
+    std::wstring result(length, L'\0');
+    CanonicalizeUrl(url, result.data(), length);
+    return result;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// An absolute URL split into views over the caller's buffer. Parsing never allocates; the
+// views stay valid as long as the parsed text does.
+struct Url {
+    std::wstring_view scheme;   // without ':'
+    std::wstring_view userinfo; // without '@'
+    std::wstring_view host;     // IPv6 literals keep their brackets
+    std::wstring_view port;     // digits only; empty when absent
+    std::wstring_view path;
+    std::wstring_view query;    // without '?'
+    std::wstring_view fragment; // without '#'
+    bool hasAuthority = false;  // "scheme://..."
+    bool hasQuery = false;      // a '?' was present, even if the query is empty
+    bool hasFragment = false;
+
+    int Port() const; // explicit port, else the scheme's default; -1 if neither
+    bool IsDefaultPort() const;
+    // Host through end of path ("host:port/path"), without userinfo, query or fragment
+    std::wstring_view HostToPath() const;
+};
+
+bool ParseUrl(std::wstring_view text, Url& url);
+
+// Canonical form: scheme and host lower-cased, default port dropped, empty path of an
+// authority URL becomes "/", percent-escapes upper-cased and unreserved ones decoded.
+// Writes up to `capacity` characters and returns the full length, so a short buffer can be retried.
+size_t CanonicalizeUrl(const Url& url, wchar_t* out, size_t capacity);
+// Convenience for callers that keep the result; text that does not parse is returned as is.
+std::wstring CanonicalUrl(std::wstring_view text);
+
+// Dotted-quad IPv4 ("10.0.0.1") or bracketed IPv6 ("[::1]"), as hosts appear in URLs
+bool IsIpLiteral(std::wstring_view host);
+
+// Index of the first of a, b or c in [p, p + n), or n. Vectorized with SSE2 where available.
+size_t ScanForAny(const wchar_t* p, size_t n, wchar_t a, wchar_t b, wchar_t c);
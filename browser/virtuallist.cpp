@@ -0,0 +1,53 @@
+#include "virtuallist.h"
+
+#include <algorithm>
+
+VirtualListLayout::VirtualListLayout()
+    : VirtualListLayout(Metrics()) {
+}
+
+VirtualListLayout::VirtualListLayout(Metrics metrics)
+    : metrics(metrics) {
+}
+
+void VirtualListLayout::Clamp() {
+    int64_t content = count ? (int64_t)count * metrics.rowPitch - (metrics.rowPitch - metrics.rowHeight) : 0;
+    int64_t height = (std::max)(0, view.bottom - view.top);
+    scroll = (std::max)((int64_t)0, (std::min)(scroll, content - height));
+}
+
+void VirtualListLayout::SetViewport(const DisplayRect& rect) {
+    view = rect;
+    Clamp();
+}
+
+void VirtualListLayout::SetCount(size_t rows) {
+    count = rows;
+    Clamp();
+}
+
+void VirtualListLayout::ScrollBy(int64_t dy) {
+    scroll += dy;
+    Clamp();
+}
+
+DisplayRect VirtualListLayout::RowRect(size_t row) const {
+    int top = (int)(view.top + (int64_t)row * metrics.rowPitch - scroll);
+    return { view.left, top, view.right, top + metrics.rowHeight };
+}
+
+void VirtualListLayout::VisibleRange(size_t& first, size_t& end) const {
+    if (count == 0 || view.Empty()) { first = end = 0; return; }
+    int pitch = metrics.rowPitch;
+    first = (size_t)(scroll / pitch) + (scroll % pitch >= metrics.rowHeight ? 1 : 0); // scrolled into the gap after a row
+    end = (std::min)(count, (size_t)((scroll + (view.bottom - view.top) - 1) / pitch) + 1);
+    first = (std::min)(first, end);
+}
+
+size_t VirtualListLayout::HitTest(int x, int y) const {
+    if (x < view.left || x >= view.right || y < view.top || y >= view.bottom) return npos;
+    int64_t offset = y - view.top + scroll;
+    size_t row = (size_t)(offset / metrics.rowPitch);
+    if (row >= count || offset % metrics.rowPitch >= metrics.rowHeight) return npos;
+    return row;
+}
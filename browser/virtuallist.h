@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "displaylist.h"
+
+// Geometry of a vertically scrolling list of equal rows, like the history sidebar. Rows are never
+// laid out one by one: the visible range, hit tests and scrolling are arithmetic on the row
+// pitch and the scroll offset, so they cost the same for 25 rows or 500,000.
+class VirtualListLayout {
+public:
+    static constexpr size_t npos = (size_t)-1;
+
+    struct Metrics {
+        int rowHeight = 25; // the part of a row that is drawn and hit
+        int rowPitch = 30;  // from one row's top to the next
+    };
+
+    VirtualListLayout();
+    explicit VirtualListLayout(Metrics metrics);
+
+    void SetViewport(const DisplayRect& view); // where rows show; they are clipped to it
+    void SetCount(size_t count);
+    void ScrollBy(int64_t dy); // in pixels, kept within the content
+
+    size_t Count() const { return count; }
+    int RowPitch() const { return metrics.rowPitch; }
+    int64_t ScrollOffset() const { return scroll; }
+    const DisplayRect& ViewRect() const { return view; }
+
+    DisplayRect RowRect(size_t row) const; // may lie partly or wholly outside ViewRect()
+    // Rows [first, end) intersect the view
+    void VisibleRange(size_t& first, size_t& end) const;
+    size_t HitTest(int x, int y) const; // npos between rows and outside the view
+
+private:
+    void Clamp();
+
+    Metrics metrics;
+    DisplayRect view;
+    size_t count = 0;
+    int64_t scroll = 0; // pixels of content above the view
+};
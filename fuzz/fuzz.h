@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+// Shared by the fuzz targets. Built with Clang, each target is a libFuzzer binary; elsewhere it
+// links replay_main.cpp and runs the inputs it is given, which is how a crash found on one
+// machine is reproduced on another.
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+// A broken invariant is a crash, so the fuzzer keeps the input that caused it
+#define FUZZ_CHECK(cond)                                                          \
+    do {                                                                          \
+        if (!(cond)) {                                                            \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            abort();                                                              \
+        }                                                                         \
+    } while (0)
+
+namespace fuzz {
+// The browser's strings are UTF-16: the input read as little-endian code units
+inline std::wstring Utf16(const uint8_t* data, size_t size) {
+    std::wstring s;
+    s.reserve(size / 2);
+    for (size_t i = 0; i + 1 < size; i += 2) s.push_back((wchar_t)(data[i] | (data[i + 1] << 8)));
+    return s;
+}
+}
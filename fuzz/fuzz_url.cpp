@@ -0,0 +1,39 @@
+// URL parsing and canonicalization, and the public suffix lookups on the parsed host
+
+#include "fuzz.h"
+
+#include "psl.h"
+#include "url.h"
+
+namespace {
+bool Within(std::wstring_view part, std::wstring_view whole) {
+    return part.empty() || (part.data() >= whole.data() && part.data() + part.size() <= whole.data() + whole.size());
+}
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    std::wstring text = fuzz::Utf16(data, size);
+    Url url;
+    if (!ParseUrl(text, url)) {
+        FUZZ_CHECK(CanonicalUrl(text) == text);
+        return 0;
+    }
+    for (std::wstring_view part : { url.scheme, url.userinfo, url.host, url.port, url.path, url.query, url.fragment, url.HostToPath() })
+        FUZZ_CHECK(Within(part, text));
+    url.Port();
+    IsIpLiteral(url.host);
+
+    // The reported length is exact: too short a buffer truncates, a long enough one fits
+    wchar_t small[8];
+    size_t length = CanonicalizeUrl(url, small, 8);
+    std::wstring canonical(length, L'\0');
+    FUZZ_CHECK(CanonicalizeUrl(url, canonical.data(), canonical.size()) == length);
+    FUZZ_CHECK(CanonicalUrl(text) == canonical);
+
+    bool listed;
+    size_t suffix = PublicSuffixLength(url.host, &listed);
+    FUZZ_CHECK(suffix <= url.host.size());
+    std::wstring_view domain = RegistrableDomain(url.host);
+    FUZZ_CHECK(Within(domain, url.host));
+    return 0;
+}
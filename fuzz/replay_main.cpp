@@ -0,0 +1,39 @@
+// Stand-in for libFuzzer's main where it is not available: runs each file, or each file in each
+// folder, given on the command line through the target once. Flags (-runs=0 and the like) are
+// accepted and ignored, so the same command line works for both.
+
+#include "fuzz.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+int main(int argc, char** argv) {
+    std::vector<std::filesystem::path> inputs;
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] == '-') continue;
+        std::filesystem::path path = argv[i];
+        if (std::filesystem::is_directory(path)) {
+            std::vector<std::filesystem::path> files;
+            for (const auto& entry : std::filesystem::directory_iterator(path)) {
+                if (entry.is_regular_file()) files.push_back(entry.path());
+            }
+            std::sort(files.begin(), files.end());
+            inputs.insert(inputs.end(), files.begin(), files.end());
+        }
+        else inputs.push_back(path);
+    }
+    for (const std::filesystem::path& path : inputs) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            fprintf(stderr, "cannot read %s\n", path.string().c_str());
+            return 1;
+        }
+        std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        LLVMFuzzerTestOneInput(data.data(), data.size());
+    }
+    printf("%zu inputs\n", inputs.size());
+    return 0;
+}
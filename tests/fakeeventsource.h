@@ -0,0 +1,52 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+// Stands in for WebView2 and the UI thread's message queue in front of a ClassificationService:
+// each submitted request is held open, like a deferred WebResourceRequested event, until its
+// result is drained, and the service's ready callback posts a wake-up as PostMessage would.
+// Tests can also hold the worker that posts, to queue requests behind it.
+class FakeEventSource {
+public:
+    void Post() {
+        std::unique_lock<std::mutex> guard(lock);
+        posted = true;
+        posts++;
+        wake.notify_all();
+        wake.wait(guard, [this] { return !holding; });
+    }
+
+    void WaitForPost() {
+        std::unique_lock<std::mutex> guard(lock);
+        wake.wait(guard, [this] { return posted; });
+        posted = false;
+    }
+
+    size_t Posts() {
+        std::lock_guard<std::mutex> guard(lock);
+        return posts;
+    }
+
+    // While held, a worker that posts waits in Post until Release
+    void Hold() {
+        std::lock_guard<std::mutex> guard(lock);
+        holding = true;
+    }
+
+    void Release() {
+        std::lock_guard<std::mutex> guard(lock);
+        holding = false;
+        wake.notify_all();
+    }
+
+    size_t open = 0; // requests held for a decision
+
+private:
+    std::mutex lock;
+    std::condition_variable wake;
+    bool posted = false;
+    bool holding = false;
+    size_t posts = 0;
+};
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// A small unit test harness with the GoogleTest interface, so the tests build anywhere the core
+// does without another dependency, as sarf_bench does for benchmarks.
+//
+//   TEST(Url, LowercasesHost) {
+//       Url u;
+//       ASSERT_TRUE(ParseUrl(L"http://EXAMPLE.com/", u));
+//       EXPECT_EQ(u.host, L"example.com");
+//   }
+//
+// EXPECT_* records a failure and carries on; ASSERT_* also returns from the test. sarf_tests
+// runs every test, or those whose "Suite.Name" contains the first argument, and exits non-zero
+// if any failed.
+namespace test {
+
+void RegisterTest(const char* suite, const char* name, void (*fn)());
+void Fail(const char* file, int line, const std::string& message);
+
+// A fresh, empty directory for one test's files, under the system temp directory
+std::filesystem::path TempDir(const std::string& name);
+
+inline std::string Describe(const std::string& s) { return "\"" + s + "\""; }
+inline std::string Describe(std::string_view s) { return Describe(std::string(s)); }
+inline std::string Describe(const char* s) { return s ? Describe(std::string(s)) : "null"; }
+inline std::string Describe(std::wstring_view s) {
+    std::string out = "L\"";
+    for (wchar_t c : s) out += c >= 0x20 && c < 0x7f ? (char)c : '?';
+    return out + "\"";
+}
+inline std::string Describe(const std::wstring& s) { return Describe(std::wstring_view(s)); }
+inline std::string Describe(const wchar_t* s) { return s ? Describe(std::wstring_view(s)) : "null"; }
+inline std::string Describe(bool b) { return b ? "true" : "false"; }
+template <class T> std::string Describe(const T& value) {
+    if constexpr (std::is_enum_v<T>) return std::to_string((int64_t)value);
+    else if constexpr (std::is_arithmetic_v<T>) return std::to_string(value);
+    else if constexpr (std::is_pointer_v<T>) return value ? "pointer" : "null";
+    else return "(value)";
+}
+
+template <class A, class B>
+bool Compare(bool ok, const A& a, const B& b, const char* op, const char* textA, const char* textB, const char* file, int line) {
+    if (!ok) Fail(file, line, std::string(textA) + " " + op + " " + textB + ": " + Describe(a) + " vs " + Describe(b));
+    return ok;
+}
+
+}
+
+#define TEST_CONCAT2(a, b) a##b
+#define TEST_CONCAT(a, b) TEST_CONCAT2(a, b)
+#define TEST(suite, name)                                                                              \
+    static void TEST_CONCAT(suite##_##name, _Test)();                                                  \
+    static const bool TEST_CONCAT(suite##_##name, _Registered) [[maybe_unused]] =                      \
+        (::test::RegisterTest(#suite, #name, TEST_CONCAT(suite##_##name, _Test)), true);               \
+    static void TEST_CONCAT(suite##_##name, _Test)()
+
+#define TEST_CHECK_(cond, text, onFail) \
+    do { if (!(cond)) { ::test::Fail(__FILE__, __LINE__, text); onFail; } } while (0)
+#define TEST_COMPARE_(a, b, op, onFail)                                                                \
+    do {                                                                                               \
+        const auto& testA_ = (a);                                                                      \
+        const auto& testB_ = (b);                                                                      \
+        if (!::test::Compare(testA_ op testB_, testA_, testB_, #op, #a, #b, __FILE__, __LINE__)) { onFail; } \
+    } while (0)
+
+#define EXPECT_TRUE(cond) TEST_CHECK_(cond, "expected true: " #cond, (void)0)
+#define EXPECT_FALSE(cond) TEST_CHECK_(!(cond), "expected false: " #cond, (void)0)
+#define EXPECT_EQ(a, b) TEST_COMPARE_(a, b, ==, (void)0)
+#define EXPECT_NE(a, b) TEST_COMPARE_(a, b, !=, (void)0)
+#define EXPECT_LT(a, b) TEST_COMPARE_(a, b, <, (void)0)
+#define EXPECT_LE(a, b) TEST_COMPARE_(a, b, <=, (void)0)
+#define EXPECT_GT(a, b) TEST_COMPARE_(a, b, >, (void)0)
+#define EXPECT_GE(a, b) TEST_COMPARE_(a, b, >=, (void)0)
+#define ASSERT_TRUE(cond) TEST_CHECK_(cond, "expected true: " #cond, return)
+#define ASSERT_FALSE(cond) TEST_CHECK_(!(cond), "expected false: " #cond, return)
+#define ASSERT_EQ(a, b) TEST_COMPARE_(a, b, ==, return)
+#define ASSERT_NE(a, b) TEST_COMPARE_(a, b, !=, return)
+#define ASSERT_LT(a, b) TEST_COMPARE_(a, b, <, return)
+#define ASSERT_GT(a, b) TEST_COMPARE_(a, b, >, return)
+#define ASSERT_GE(a, b) TEST_COMPARE_(a, b, >=, return)
@@ -0,0 +1,44 @@
+#include "test.h"
+
+#include "admatcher.h"
+#include "requestclassifier.h"
+
+TEST(AdMatcher, FoldsAsciiCase) {
+    AdMatcher matcher = { L"DoubleClick.net", L"pagead2" };
+    EXPECT_TRUE(matcher.Matches(L"doubleclick.net"));
+    EXPECT_TRUE(matcher.Matches(L"DOUBLECLICK.NET"));
+    EXPECT_TRUE(matcher.Matches(L"x.PageAd2.example"));
+    EXPECT_FALSE(matcher.Matches(L"double-click.net"));
+    EXPECT_FALSE(matcher.Matches(L"dÓubleclick.net")); // non-ASCII letters never fold
+}
+
+TEST(AdMatcher, MatchesAtEveryBoundary) {
+    AdMatcher matcher = { L"/ads/", L"moatads.com" };
+    EXPECT_TRUE(matcher.Matches(L"/ads/"));             // the whole text
+    EXPECT_TRUE(matcher.Matches(L"/ads/banner.png"));   // at the start
+    EXPECT_TRUE(matcher.Matches(L"example.com/ads/"));  // at the end
+    EXPECT_FALSE(matcher.Matches(L"/ads"));             // one short
+    EXPECT_FALSE(matcher.Matches(L"ads/"));
+    EXPECT_FALSE(matcher.Matches(L""));
+    EXPECT_TRUE(matcher.Matches(L"moatmoatads.com"));   // restarts inside a failed match
+    EXPECT_TRUE(matcher.Matches(L"//ads/"));
+}
+
+TEST(AdMatcher, FindsKeywordsInsideOthers) {
+    AdMatcher matcher = { L"amazon-adsystem", L"adsystem", L"sys" };
+    EXPECT_TRUE(matcher.Matches(L"amazon-adsys"));  // "sys", reached through the longer keyword
+    EXPECT_TRUE(matcher.Matches(L"amazon-adsystem"));
+    EXPECT_TRUE(matcher.Matches(L"xadsystemx"));
+    EXPECT_FALSE(matcher.Matches(L"amazon-ad-sy"));
+}
+
+TEST(IsAdUrl, MatchesHostAndPathOnly) {
+    EXPECT_TRUE(IsAdUrl(L"https://securepubads.g.DoubleClick.net/tag/js/gpt.js"));
+    EXPECT_TRUE(IsAdUrl(L"HTTPS://WWW.EXAMPLE.COM/ADS/banner.png"));
+    EXPECT_TRUE(IsAdUrl(L"https://www.facebook.com/tr/?id=1"));
+    EXPECT_FALSE(IsAdUrl(L"https://www.example.com/news/?from=/ads/"));
+    EXPECT_FALSE(IsAdUrl(L"https://www.example.com/story#/ads/"));
+    EXPECT_FALSE(IsAdUrl(L"https://www.example.com/uploads/photo.jpg"));
+    EXPECT_TRUE(IsAdUrl(L"https://doubleclick.network.example/"));   // substrings, not whole labels
+    EXPECT_TRUE(IsAdUrl(L"not a url with pagead2 in it"));            // unparsed, matched whole
+}
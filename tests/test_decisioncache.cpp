@@ -0,0 +1,56 @@
+#include "test.h"
+
+#include "decisioncache.h"
+
+#include <thread>
+#include <vector>
+
+TEST(DecisionCache, HitsWithinAGeneration) {
+    DecisionCache cache(64);
+    EXPECT_EQ(cache.Lookup(L"news.example", L"ads.example", 1, 5), DecisionCache::MISS);
+    cache.Store(L"news.example", L"ads.example", 1, 5, true);
+    cache.Store(L"news.example", L"cdn.example", 1, 5, false);
+    EXPECT_EQ(cache.Lookup(L"news.example", L"ads.example", 1, 5), DecisionCache::BLOCK);
+    EXPECT_EQ(cache.Lookup(L"NEWS.example", L"Ads.Example", 1, 5), DecisionCache::BLOCK); // hosts fold case
+    EXPECT_EQ(cache.Lookup(L"news.example", L"cdn.example", 1, 5), DecisionCache::ALLOW);
+    EXPECT_EQ(cache.Lookup(L"news.example", L"ads.example", 2, 5), DecisionCache::MISS); // other type
+    EXPECT_EQ(cache.Lookup(L"blog.example", L"ads.example", 1, 5), DecisionCache::MISS); // other page
+}
+
+TEST(DecisionCache, NewGenerationInvalidates) {
+    DecisionCache cache(64);
+    cache.Store(L"news.example", L"ads.example", 1, 5, true);
+    EXPECT_EQ(cache.Lookup(L"news.example", L"ads.example", 1, 6), DecisionCache::MISS);
+    cache.Store(L"news.example", L"ads.example", 1, 6, false);
+    EXPECT_EQ(cache.Lookup(L"news.example", L"ads.example", 1, 6), DecisionCache::ALLOW);
+    EXPECT_EQ(cache.Lookup(L"news.example", L"ads.example", 1, 5), DecisionCache::MISS);
+}
+
+TEST(DecisionCache, CountsHitsAndMisses) {
+    DecisionCache cache(64);
+    cache.Store(L"a", L"b", 1, 1, true);
+    for (int i = 0; i < 10; i++) cache.Lookup(L"a", L"b", 1, 1);
+    for (int i = 0; i < 5; i++) cache.Lookup(L"a", L"c", 1, 1);
+    DecisionCache::Stats stats = cache.GetStats();
+    EXPECT_EQ(stats.hits, 10u);
+    EXPECT_EQ(stats.misses, 5u);
+    EXPECT_EQ(stats.stores, 1u);
+}
+
+TEST(DecisionCache, CountsAcrossThreads) {
+    DecisionCache cache(64);
+    cache.Store(L"a", L"b", 1, 1, true);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 20; t++) { // more threads than counter stripes
+        threads.emplace_back([&cache] {
+            for (int i = 0; i < 1000; i++) {
+                cache.Lookup(L"a", L"b", 1, 1);
+                cache.Lookup(L"a", L"c", 1, 1);
+            }
+        });
+    }
+    for (std::thread& t : threads) t.join();
+    DecisionCache::Stats stats = cache.GetStats();
+    EXPECT_EQ(stats.hits, 20000u);
+    EXPECT_EQ(stats.misses, 20000u);
+}
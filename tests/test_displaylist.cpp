@@ -0,0 +1,196 @@
+#include "test.h"
+
+#include "displaylist.h"
+
+#include <algorithm>
+#include <random>
+
+namespace {
+const uint32_t BACKGROUND = 0x101010, TAB = 0x202020, TEXT = 0xF0F0F0;
+
+// A strip of tabs on a background, as the chrome draws one
+void Strip(DisplayList& frame, const std::vector<std::wstring>& titles) {
+    frame.Clear();
+    frame.Fill({ 0, 0, 400, 40 }, BACKGROUND);
+    for (size_t i = 0; i < titles.size(); i++) {
+        int left = 10 + (int)i * 100;
+        frame.Fill({ left, 5, left + 90, 35 }, TAB);
+        frame.Text({ left + 5, 5, left + 85, 35 }, titles[i], 0, TEXT, 0);
+    }
+}
+
+void Repaint(const DisplayList& frame, const std::vector<DisplayRect>& dirty, RecordingDisplayBackend& backend) {
+    for (const DisplayRect& r : dirty) frame.Replay(backend, r);
+}
+
+// Pixels, for checking that a repaint of the dirty areas gives the frame a full paint would
+class RasterBackend : public DisplayBackend {
+public:
+    static const int W = 48, H = 24;
+
+    void Fill(const DisplayCommand& c) override { Paint(c, c.color); }
+    void Text(const DisplayCommand& c) override {
+        // Stands in for glyphs: depends on everything that decides how the text looks
+        uint32_t ink = (uint32_t)std::hash<std::wstring>()(c.text) ^ c.color ^ (uint32_t)c.font * 31 ^ c.format * 131 ^
+            (uint32_t)(c.rect.left * 7 + c.rect.top * 11 + c.rect.right * 13 + c.rect.bottom * 17);
+        Paint(c, ink);
+    }
+    void Paint(const DisplayCommand& c, uint32_t value) {
+        int top = (std::max)({ c.bounds.top, clip.top, 0 }), bottom = (std::min)({ c.bounds.bottom, clip.bottom, H });
+        int left = (std::max)({ c.bounds.left, clip.left, 0 }), right = (std::min)({ c.bounds.right, clip.right, W });
+        for (int y = top; y < bottom; y++)
+            for (int x = left; x < right; x++)
+                pixels[y * W + x] = value;
+    }
+
+    DisplayRect clip = { 0, 0, W, H }; // the update region, which GDI clips to
+    std::vector<uint32_t> pixels = std::vector<uint32_t>(W * H, 0);
+};
+
+void RandomFrame(DisplayList& frame, std::mt19937& rng, size_t commands) {
+    static const wchar_t* texts[] = { L"a", L"b", L"tab" };
+    frame.Clear();
+    frame.Fill({ 0, 0, RasterBackend::W, RasterBackend::H }, 1);
+    for (size_t i = 0; i < commands; i++) {
+        int left = (int)(rng() % 40), top = (int)(rng() % 20);
+        DisplayRect r = { left, top, left + 1 + (int)(rng() % 12), top + 1 + (int)(rng() % 6) };
+        if (rng() % 5 == 0) frame.PushClip({ left + 1, top, left + 6, top + 4 });
+        if (rng() % 2) frame.Fill(r, rng() % 3);
+        else frame.Text(r, texts[rng() % 3], (int)(rng() % 2), rng() % 2, 0);
+        if (rng() % 4 == 0) frame.PopClip();
+    }
+}
+}
+
+TEST(DisplayList, RecordsClippedCommands) {
+    DisplayList frame;
+    frame.Fill({ 0, 0, 100, 50 }, BACKGROUND);
+    frame.PushClip({ 10, 10, 60, 40 });
+    frame.Fill({ 0, 0, 30, 30 }, TAB);
+    frame.PushClip({ 50, 0, 200, 200 }); // inside the clip already in force
+    frame.Text({ 40, 20, 90, 30 }, L"title", 1, TEXT, 7);
+    frame.Fill({ 0, 0, 20, 20 }, TAB);  // clipped away entirely
+    frame.PopClip();
+    frame.Text({ 12, 12, 20, 20 }, L"", 0, TEXT, 0); // nothing to draw
+    frame.PopClip();
+    frame.Fill({ 90, 40, 100, 50 }, TEXT);
+    const std::vector<DisplayCommand>& c = frame.Commands();
+    ASSERT_EQ(c.size(), (size_t)4);
+    EXPECT_TRUE(c[0].bounds == (DisplayRect{ 0, 0, 100, 50 }));
+    EXPECT_TRUE(c[1].bounds == (DisplayRect{ 10, 10, 30, 30 }));
+    EXPECT_TRUE(c[1].rect == (DisplayRect{ 0, 0, 30, 30 }));
+    EXPECT_EQ(c[2].kind, DisplayCommand::TEXT);
+    EXPECT_TRUE(c[2].bounds == (DisplayRect{ 50, 20, 60, 30 }));
+    EXPECT_TRUE(c[2].rect == (DisplayRect{ 40, 20, 90, 30 })); // laid out in the full box
+    EXPECT_EQ(c[2].font, 1);
+    EXPECT_EQ(c[2].format, 7u);
+    EXPECT_TRUE(c[3].bounds == (DisplayRect{ 90, 40, 100, 50 })); // the clip is gone
+}
+
+TEST(DisplayList, ReplaysOnlyWhatTouchesTheArea) {
+    DisplayList frame;
+    Strip(frame, { L"One", L"Two", L"Three" });
+    RecordingDisplayBackend backend;
+    frame.Replay(backend, { 120, 10, 130, 20 }); // inside the second tab
+    ASSERT_EQ(backend.drawn.size(), (size_t)3);
+    EXPECT_TRUE(backend.drawn[0] == frame.Commands()[0]); // background, tab, title, in order
+    EXPECT_TRUE(backend.drawn[1] == frame.Commands()[3]);
+    EXPECT_TRUE(backend.drawn[2] == frame.Commands()[4]);
+    EXPECT_EQ(backend.fills, (size_t)2);
+    EXPECT_EQ(backend.texts, (size_t)1);
+}
+
+TEST(DisplayList, IdenticalFramesNeedNoRepaint) {
+    DisplayList a, b;
+    Strip(a, { L"One", L"Two" });
+    Strip(b, { L"One", L"Two" });
+    EXPECT_TRUE(DiffDisplayLists(a, b).empty());
+    DisplayList empty;
+    EXPECT_TRUE(DiffDisplayLists(empty, empty).empty());
+}
+
+TEST(DisplayList, ChangedTitleRepaintsOnlyItsText) {
+    DisplayList before, after;
+    Strip(before, { L"One", L"Two", L"Three" });
+    Strip(after, { L"One", L"Loading", L"Three" });
+    std::vector<DisplayRect> dirty = DiffDisplayLists(before, after);
+    ASSERT_EQ(dirty.size(), (size_t)1);
+    EXPECT_TRUE(dirty[0] == (DisplayRect{ 115, 5, 195, 35 }));
+    RecordingDisplayBackend backend;
+    Repaint(after, dirty, backend);
+    ASSERT_EQ(backend.drawn.size(), (size_t)3); // what lies under the title, then the new title
+    EXPECT_EQ(backend.drawn[0].color, BACKGROUND);
+    EXPECT_EQ(backend.drawn[1].color, TAB);
+    EXPECT_EQ(backend.drawn[2].text, std::wstring(L"Loading"));
+}
+
+TEST(DisplayList, ClosedTabRepaintsWhereItWasAndWhatMoved) {
+    DisplayList before, after;
+    Strip(before, { L"One", L"Two", L"Three" });
+    Strip(after, { L"One", L"Three" });
+    std::vector<DisplayRect> dirty = DiffDisplayLists(before, after);
+    // Tab two's title gives way to tab three's, and tab three's old place is background now
+    ASSERT_EQ(dirty.size(), (size_t)2);
+    EXPECT_TRUE(dirty[0] == (DisplayRect{ 115, 5, 195, 35 }));
+    EXPECT_TRUE(dirty[1] == (DisplayRect{ 210, 5, 300, 35 }));
+    RecordingDisplayBackend backend;
+    after.Replay(backend, dirty[0]);
+    EXPECT_EQ(backend.texts, (size_t)1);
+    EXPECT_EQ(backend.drawn.back().text, std::wstring(L"Three"));
+    RecordingDisplayBackend vacated;
+    after.Replay(vacated, dirty[1]);
+    ASSERT_EQ(vacated.drawn.size(), (size_t)1);
+    EXPECT_EQ(vacated.drawn[0].color, BACKGROUND);
+}
+
+TEST(DisplayList, OnlyDisjointAreasStaySeparate) {
+    DisplayList before, after;
+    Strip(before, { L"A", L"B", L"C", L"D" });
+    Strip(after, { L"x", L"B", L"C", L"y" });
+    std::vector<DisplayRect> dirty = DiffDisplayLists(before, after);
+    ASSERT_EQ(dirty.size(), (size_t)2);
+    EXPECT_FALSE(dirty[0].Intersects(dirty[1]));
+}
+
+// Whatever changes, painting the old frame and then repainting the dirty areas of the new one
+// gives the same pixels as painting the new one from scratch
+TEST(DisplayList, RepaintingTheDiffMatchesAFullPaint) {
+    std::mt19937 rng(3);
+    for (int round = 0; round < 300; round++) {
+        DisplayList before, after;
+        std::mt19937 shared(rng());
+        RandomFrame(before, shared, 12);
+        // Mostly the same commands, some changed, added or dropped
+        std::mt19937 again(shared);
+        after = before;
+        if (round % 3) {
+            DisplayList extra;
+            RandomFrame(extra, again, 1 + rng() % 4);
+            DisplayList mixed;
+            for (const DisplayCommand& c : before.Commands()) {
+                if (&c != &before.Commands()[0] && rng() % 6 == 0) continue; // the background covers everything
+                mixed.PushClip(c.bounds);
+                if (c.kind == DisplayCommand::FILL) mixed.Fill(c.rect, c.color);
+                else mixed.Text(c.rect, c.text, c.font, c.color, c.format);
+                mixed.PopClip();
+                if (rng() % 8 == 0) {
+                    const DisplayCommand& e = extra.Commands()[rng() % extra.Commands().size()];
+                    mixed.PushClip(e.bounds);
+                    mixed.Fill(e.rect, e.color);
+                    mixed.PopClip();
+                }
+            }
+            after = mixed;
+        }
+        else RandomFrame(after, again, 12);
+
+        RasterBackend full, patched;
+        after.Replay(full, { 0, 0, RasterBackend::W, RasterBackend::H });
+        before.Replay(patched, { 0, 0, RasterBackend::W, RasterBackend::H });
+        for (const DisplayRect& r : DiffDisplayLists(before, after)) {
+            patched.clip = r;
+            after.Replay(patched, r);
+        }
+        ASSERT_TRUE(full.pixels == patched.pixels);
+    }
+}
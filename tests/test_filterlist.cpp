@@ -0,0 +1,266 @@
+#include "test.h"
+
+#include "filterlist.h"
+
+#include <fstream>
+
+namespace {
+FilterSet Build(std::string_view list, size_t* accepted = nullptr) {
+    FilterListBuilder builder;
+    size_t n = builder.AddList(list);
+    if (accepted) *accepted = n;
+    return builder.Build();
+}
+
+bool Blocks(const FilterSet& set, std::wstring_view url, std::wstring_view source, uint32_t type = FT_SCRIPT) {
+    FilterRequest req;
+    req.url = url;
+    req.host = UrlHost(url);
+    req.sourceHost = UrlHost(source);
+    req.type = type;
+    req.thirdParty = IsThirdPartyHost(req.host, req.sourceHost);
+    return set.ShouldBlock(req);
+}
+
+const wchar_t* PAGE = L"https://news.example.org/story";
+}
+
+TEST(FilterList, SkipsCommentsCosmeticAndUnsupported) {
+    size_t accepted;
+    FilterSet set = Build(
+        "[Adblock Plus 2.0]\n"
+        "! a comment\n"
+        "example.com##.banner\n"
+        "example.com#@#.ad\n"
+        "/^https?:\\/\\/ads\\./\n" // regex
+        "||popup.example^$popup\n"
+        "||ads.example.com^\n"
+        "\n", &accepted);
+    EXPECT_EQ(accepted, (size_t)1);
+    EXPECT_EQ(set.RuleCount(), 1u);
+}
+
+TEST(FilterList, HostAnchorMatchesSubdomainsOnly) {
+    FilterSet set = Build("||ads.example.com^\n");
+    EXPECT_TRUE(Blocks(set, L"https://ads.example.com/x.js", PAGE));
+    EXPECT_TRUE(Blocks(set, L"https://cdn.ads.example.com/x.js", PAGE));
+    EXPECT_TRUE(Blocks(set, L"https://ADS.Example.COM/x.js", PAGE));
+    EXPECT_FALSE(Blocks(set, L"https://badads.example.com/x.js", PAGE));
+    EXPECT_FALSE(Blocks(set, L"https://ads.example.com.evil.net/x.js", PAGE));
+    EXPECT_FALSE(Blocks(set, L"https://example.com/ads.example.com", PAGE));
+}
+
+// A host anchor that does not end at a separator matches any host starting there
+TEST(FilterList, HostAnchorPrefixes) {
+    FilterSet ads = Build("||ads\n");
+    EXPECT_TRUE(Blocks(ads, L"https://ads.foo.com/x.js", PAGE));
+    EXPECT_TRUE(Blocks(ads, L"https://cdn.adserver.com/x.js", PAGE));
+    EXPECT_FALSE(Blocks(ads, L"https://badads.com/x.js", PAGE));
+    FilterSet dot = Build("||ads.\n");
+    EXPECT_TRUE(Blocks(dot, L"https://ads.foo.com/x.js", PAGE));
+    EXPECT_TRUE(Blocks(dot, L"https://img.ads.foo.com/x.js", PAGE));
+    EXPECT_FALSE(Blocks(dot, L"https://adserver.com/x.js", PAGE));
+    FilterSet serv = Build("||adserv\n@@||adserver.example/allowed/\n");
+    EXPECT_TRUE(Blocks(serv, L"https://adserver.com/x.js", PAGE));
+    EXPECT_TRUE(Blocks(serv, L"https://adservice.example/x.js", PAGE));
+    EXPECT_FALSE(Blocks(serv, L"https://ad.server.com/x.js", PAGE));
+    EXPECT_FALSE(Blocks(serv, L"https://adserver.example/allowed/x.js", PAGE));
+    // None of them holds for every path of the host, so none is cached per host
+    FilterRequest req;
+    std::wstring url = L"https://ads.foo.com/x.js";
+    req.url = url;
+    req.host = UrlHost(url);
+    req.type = FT_SCRIPT;
+    FilterSet::Decision d = ads.Classify(req);
+    EXPECT_TRUE(d.block);
+    EXPECT_FALSE(d.hostOnly);
+}
+
+TEST(FilterList, AnchorsAndSeparators) {
+    FilterSet set = Build("|https://start.example/\n/banner/*\nswf|\n||sep.example^path\n");
+    EXPECT_TRUE(Blocks(set, L"https://start.example/a", PAGE));
+    EXPECT_FALSE(Blocks(set, L"https://other.example/?u=https://start.example/", PAGE));
+    EXPECT_TRUE(Blocks(set, L"https://cdn.example/img/banner/1.png", PAGE));
+    EXPECT_TRUE(Blocks(set, L"https://cdn.example/movie.swf", PAGE));
+    EXPECT_FALSE(Blocks(set, L"https://cdn.example/movie.swf?x=1", PAGE));
+    EXPECT_TRUE(Blocks(set, L"https://sep.example/path", PAGE));
+    EXPECT_FALSE(Blocks(set, L"https://sep.example.path/", PAGE));
+}
+
+TEST(FilterList, TypeOptions) {
+    FilterSet set = Build("||img.example^$image\n||noscript.example^$~script\n");
+    EXPECT_TRUE(Blocks(set, L"https://img.example/a.png", PAGE, FT_IMAGE));
+    EXPECT_FALSE(Blocks(set, L"https://img.example/a.js", PAGE, FT_SCRIPT));
+    EXPECT_FALSE(Blocks(set, L"https://noscript.example/a.js", PAGE, FT_SCRIPT));
+    EXPECT_TRUE(Blocks(set, L"https://noscript.example/a.png", PAGE, FT_IMAGE));
+    // Without a type option, rules do not apply to top-level documents
+    FilterSet plain = Build("||plain.example^\n");
+    EXPECT_FALSE(Blocks(plain, L"https://plain.example/", PAGE, FT_DOCUMENT));
+    EXPECT_TRUE(plain.BlockableTypes() & FT_SCRIPT);
+    FilterSet images = Build("||img.example^$image\n");
+    EXPECT_EQ(images.BlockableTypes(), (uint32_t)FT_IMAGE);
+}
+
+TEST(FilterList, PartyOptions) {
+    FilterSet set = Build("||tracker.example^$third-party\n||self.example^$~third-party\n");
+    EXPECT_TRUE(Blocks(set, L"https://tracker.example/t.js", PAGE));
+    EXPECT_FALSE(Blocks(set, L"https://cdn.tracker.example/t.js", L"https://www.tracker.example/"));
+    EXPECT_TRUE(Blocks(set, L"https://self.example/a.js", L"https://www.self.example/"));
+    EXPECT_FALSE(Blocks(set, L"https://self.example/a.js", PAGE));
+}
+
+TEST(FilterList, DomainOption) {
+    FilterSet set = Build("/promo/*$domain=example.org|~safe.example.org\n");
+    EXPECT_TRUE(Blocks(set, L"https://cdn.example/promo/1.js", PAGE)); // news.example.org
+    EXPECT_FALSE(Blocks(set, L"https://cdn.example/promo/1.js", L"https://safe.example.org/"));
+    EXPECT_FALSE(Blocks(set, L"https://cdn.example/promo/1.js", L"https://other.net/"));
+}
+
+TEST(FilterList, ExceptionsOverrideBlocks) {
+    FilterSet set = Build("||ads.example^\n@@||ads.example/allowed/*\n");
+    EXPECT_TRUE(Blocks(set, L"https://ads.example/serve.js", PAGE));
+    EXPECT_FALSE(Blocks(set, L"https://ads.example/allowed/ok.js", PAGE));
+}
+
+TEST(FilterList, HostOnlyVerdicts) {
+    FilterSet set = Build("||ads.example^\n||path.example/ads/\n");
+    FilterRequest req;
+    std::wstring url = L"https://ads.example/x";
+    req.url = url;
+    req.host = UrlHost(url);
+    req.sourceHost = L"news.example.org";
+    req.type = FT_SCRIPT;
+    req.thirdParty = true;
+    FilterSet::Decision d = set.Classify(req);
+    EXPECT_TRUE(d.block);
+    EXPECT_TRUE(d.hostOnly);
+    url = L"https://path.example/ads/x";
+    req.url = url;
+    req.host = UrlHost(url);
+    EXPECT_FALSE(set.Classify(req).hostOnly);
+}
+
+namespace {
+FilterSet::Decision Decide(const FilterSet& set, const std::wstring& url, std::wstring_view source, uint32_t type = FT_SCRIPT) {
+    FilterRequest req;
+    req.url = url;
+    req.host = UrlHost(url);
+    req.sourceHost = UrlHost(source);
+    req.type = type;
+    req.thirdParty = IsThirdPartyHost(req.host, req.sourceHost);
+    return set.Classify(req);
+}
+}
+
+// A path exception limited by $domain= only keeps verdicts on its own sites' pages from being
+// cached per host
+TEST(FilterList, SiteExceptionsOnlyUncacheTheirSites) {
+    FilterSet scoped = Build("||ads.example^\n@@/banner/*$image,domain=fixed.org\n");
+    const std::wstring url = L"https://ads.example/banner/1.png";
+    FilterSet::Decision d = Decide(scoped, url, L"https://news.example.org/", FT_IMAGE);
+    EXPECT_TRUE(d.block);
+    EXPECT_TRUE(d.hostOnly);
+    d = Decide(scoped, url, L"https://www.fixed.org/", FT_IMAGE);
+    EXPECT_FALSE(d.block);
+    d = Decide(scoped, L"https://ads.example/x.png", L"https://www.fixed.org/", FT_IMAGE);
+    EXPECT_TRUE(d.block);
+    EXPECT_FALSE(d.hostOnly); // another path of the host is allowed on this site
+    d = Decide(scoped, L"https://ads.example/x.js", L"https://www.fixed.org/", FT_SCRIPT);
+    EXPECT_TRUE(d.hostOnly); // the exception is for images only
+    // Excluding a site does not limit where a rule applies
+    FilterSet broad = Build("||ads.example^\n@@/slot/*$domain=~fixed.org\n");
+    EXPECT_FALSE(Decide(broad, L"https://ads.example/x.js", L"https://news.example.org/").hostOnly);
+
+    std::filesystem::path path = test::TempDir("filter-snapshot-sites") / "filters.bin";
+    ASSERT_TRUE(scoped.SaveSnapshot(path, 1));
+    FilterSet loaded;
+    uint64_t stamp = 0;
+    ASSERT_TRUE(loaded.LoadSnapshot(path, stamp));
+    EXPECT_TRUE(Decide(loaded, L"https://ads.example/x.png", L"https://news.example.org/", FT_IMAGE).hostOnly);
+    EXPECT_FALSE(Decide(loaded, L"https://ads.example/x.png", L"https://www.fixed.org/", FT_IMAGE).hostOnly);
+}
+
+TEST(FilterList, SnapshotRoundTrip) {
+    std::string list = "||ads.example^\n||img.example^$image,third-party\n/banner/*$domain=example.org\n@@||ads.example/allowed/*\n";
+    FilterSet built = Build(list);
+    std::filesystem::path path = test::TempDir("filter-snapshot") / "filters.bin";
+    ASSERT_TRUE(built.SaveSnapshot(path, 42));
+    FilterSet loaded;
+    uint64_t stamp = 0;
+    ASSERT_TRUE(loaded.LoadSnapshot(path, stamp));
+    EXPECT_EQ(stamp, 42u);
+    EXPECT_EQ(loaded.RuleCount(), built.RuleCount());
+    EXPECT_EQ(loaded.BlockableTypes(), built.BlockableTypes());
+    const std::pair<const wchar_t*, uint32_t> requests[] = {
+        { L"https://ads.example/a.js", FT_SCRIPT }, { L"https://ads.example/allowed/a.js", FT_SCRIPT },
+        { L"https://img.example/a.png", FT_IMAGE }, { L"https://img.example/a.js", FT_SCRIPT },
+        { L"https://cdn.example/banner/1.png", FT_IMAGE }, { L"https://cdn.example/story.png", FT_IMAGE },
+    };
+    for (const auto& [url, type] : requests) EXPECT_EQ(Blocks(loaded, url, PAGE, type), Blocks(built, url, PAGE, type));
+}
+
+TEST(FilterList, SnapshotRejectsCorruption) {
+    FilterSet built = Build("||ads.example^\n/banner/*\n");
+    std::filesystem::path path = test::TempDir("filter-snapshot-corrupt") / "filters.bin";
+    ASSERT_TRUE(built.SaveSnapshot(path, 7));
+    std::string bytes;
+    {
+        std::ifstream in(path, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    ASSERT_GT(bytes.size(), (size_t)64);
+    std::string flipped = bytes;
+    flipped[bytes.size() - 3] ^= 0x40; // inside the tables, past the header
+    std::ofstream(path, std::ios::binary | std::ios::trunc).write(flipped.data(), (std::streamsize)flipped.size());
+    FilterSet loaded;
+    uint64_t stamp = 0;
+    EXPECT_FALSE(loaded.LoadSnapshot(path, stamp));
+    EXPECT_FALSE(loaded.LoadSnapshot(path.parent_path() / "missing.bin", stamp));
+}
+
+TEST(FilterList, SnapshotRejectsTruncation) {
+    FilterSet built = Build("||ads.example^\n||img.example^$image,third-party\n/banner/*$domain=example.org\n");
+    std::filesystem::path dir = test::TempDir("filter-snapshot-truncated");
+    ASSERT_TRUE(built.SaveSnapshot(dir / "filters.bin", 7));
+    uintmax_t size = std::filesystem::file_size(dir / "filters.bin");
+    for (uintmax_t cut = 0; cut < size; cut++) {
+        std::filesystem::copy_file(dir / "filters.bin", dir / "cut.bin", std::filesystem::copy_options::overwrite_existing);
+        std::filesystem::resize_file(dir / "cut.bin", cut);
+        FilterSet loaded;
+        uint64_t stamp = 0;
+        EXPECT_FALSE(loaded.LoadSnapshot(dir / "cut.bin", stamp));
+    }
+}
+
+// The checksum covers the tables; a flip in the header may still load, but must not crash
+TEST(FilterList, SnapshotSurvivesAnyFlippedByte) {
+    FilterSet built = Build("||ads.example^\n||img.example^$image,third-party\n/banner/*$domain=example.org\n@@||ads.example/allowed/*\n");
+    std::filesystem::path dir = test::TempDir("filter-snapshot-flipped");
+    ASSERT_TRUE(built.SaveSnapshot(dir / "filters.bin", 7));
+    std::string bytes;
+    {
+        std::ifstream in(dir / "filters.bin", std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    size_t loads = 0;
+    for (size_t at = 0; at < bytes.size(); at++) {
+        std::string flipped = bytes;
+        flipped[at] ^= 0x5A;
+        std::ofstream(dir / "flipped.bin", std::ios::binary | std::ios::trunc).write(flipped.data(), (std::streamsize)flipped.size());
+        FilterSet loaded;
+        uint64_t stamp = 0;
+        if (!loaded.LoadSnapshot(dir / "flipped.bin", stamp)) continue;
+        loads++;
+        Blocks(loaded, L"https://ads.example/a.js", PAGE);
+        Blocks(loaded, L"https://cdn.example/banner/1.png", PAGE, FT_IMAGE);
+    }
+    EXPECT_LT(loads, bytes.size() / 2);
+}
+
+TEST(FilterList, UrlHostAndParty) {
+    EXPECT_EQ(UrlHost(L"https://user@Host.example:8080/p?q"), std::wstring_view(L"Host.example"));
+    EXPECT_EQ(UrlHost(L"not a url"), std::wstring_view());
+    EXPECT_FALSE(IsThirdPartyHost(L"cdn.example.co.uk", L"www.example.co.uk"));
+    EXPECT_TRUE(IsThirdPartyHost(L"a.co.uk", L"b.co.uk"));
+    EXPECT_TRUE(IsThirdPartyHost(L"tracker.net", L"example.com"));
+}
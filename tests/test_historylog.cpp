@@ -0,0 +1,147 @@
+#include "test.h"
+
+#include "historylog.h"
+
+#include <fstream>
+
+namespace {
+HistoryRecord Visit(const wchar_t* url, int64_t time) {
+    HistoryRecord r;
+    r.kind = HistoryRecord::VISIT;
+    r.url = url;
+    r.time = time;
+    return r;
+}
+
+HistoryRecord State(const wchar_t* url, const wchar_t* title, uint32_t visits) {
+    HistoryRecord r;
+    r.kind = HistoryRecord::STATE;
+    r.url = url;
+    r.title = title;
+    r.time = 2000;
+    r.visitCount = visits;
+    r.firstVisit = 1000;
+    r.frecency = 12.5;
+    return r;
+}
+
+void Write(const std::filesystem::path& path, std::vector<HistoryRecord> records) {
+    HistoryLog log(path, std::chrono::milliseconds(10));
+    log.Load();
+    log.Start();
+    for (HistoryRecord& r : records) log.Append(std::move(r));
+    log.Flush();
+}
+}
+
+TEST(HistoryLog, RoundTripsEveryKind) {
+    std::filesystem::path path = test::TempDir("historylog-roundtrip") / "history.log";
+    HistoryRecord title;
+    title.kind = HistoryRecord::TITLE;
+    title.url = L"https://example.com/";
+    title.title = L"Café \U0001F600";
+    title.time = 1500;
+    Write(path, { Visit(L"https://example.com/", 1000), title, State(L"https://example.org/", L"Org", 3) });
+
+    HistoryLog log(path, std::chrono::milliseconds(10));
+    std::vector<HistoryRecord> records = log.Load();
+    ASSERT_EQ(records.size(), (size_t)3);
+    EXPECT_EQ(log.RecordCount(), (size_t)3);
+    EXPECT_EQ(records[0].kind, HistoryRecord::VISIT);
+    EXPECT_EQ(records[0].url, std::wstring(L"https://example.com/"));
+    EXPECT_EQ(records[0].time, (int64_t)1000);
+    EXPECT_EQ(records[1].kind, HistoryRecord::TITLE);
+    EXPECT_EQ(records[1].title, title.title);
+    EXPECT_EQ(records[2].kind, HistoryRecord::STATE);
+    EXPECT_EQ(records[2].visitCount, 3u);
+    EXPECT_EQ(records[2].firstVisit, (int64_t)1000);
+    EXPECT_EQ(records[2].frecency, 12.5);
+    EXPECT_EQ(records[2].title, std::wstring(L"Org"));
+}
+
+TEST(HistoryLog, DropsATornTail) {
+    std::filesystem::path path = test::TempDir("historylog-torn") / "history.log";
+    Write(path, { Visit(L"https://a.example/", 1), Visit(L"https://b.example/", 2), Visit(L"https://c.example/", 3) });
+    uintmax_t full = std::filesystem::file_size(path);
+    // Every cut inside the last record loses it, and only it
+    Write(path.parent_path() / "two.log", { Visit(L"https://a.example/", 1), Visit(L"https://b.example/", 2) });
+    uintmax_t lastStart = std::filesystem::file_size(path.parent_path() / "two.log");
+    for (uintmax_t cut = lastStart + 1; cut < full; cut += 7) {
+        std::filesystem::path torn = path.parent_path() / "torn.log";
+        std::filesystem::copy_file(path, torn, std::filesystem::copy_options::overwrite_existing);
+        std::filesystem::resize_file(torn, cut);
+        HistoryLog log(torn, std::chrono::milliseconds(10));
+        std::vector<HistoryRecord> records = log.Load();
+        ASSERT_EQ(records.size(), (size_t)2);
+        EXPECT_EQ(records[1].url, std::wstring(L"https://b.example/"));
+        EXPECT_EQ(std::filesystem::file_size(torn), lastStart); // truncated back to the last good record
+    }
+}
+
+TEST(HistoryLog, AppendsAfterARecoveredTail) {
+    std::filesystem::path path = test::TempDir("historylog-garbage") / "history.log";
+    Write(path, { Visit(L"https://a.example/", 1) });
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::app);
+        out << "SHR1 half a record";
+    }
+    {
+        HistoryLog log(path, std::chrono::milliseconds(10));
+        ASSERT_EQ(log.Load().size(), (size_t)1);
+        log.Start();
+        log.Append(Visit(L"https://b.example/", 2));
+        log.Flush();
+    }
+    HistoryLog log(path, std::chrono::milliseconds(10));
+    std::vector<HistoryRecord> records = log.Load();
+    ASSERT_EQ(records.size(), (size_t)2);
+    EXPECT_EQ(records[1].url, std::wstring(L"https://b.example/"));
+}
+
+TEST(HistoryLog, CompactReplacesTheLog) {
+    std::filesystem::path path = test::TempDir("historylog-compact") / "history.log";
+    {
+        HistoryLog log(path, std::chrono::milliseconds(10));
+        log.Load();
+        log.Start();
+        for (int i = 0; i < 50; i++) log.Append(Visit(L"https://a.example/", i));
+        log.Compact({ State(L"https://a.example/", L"A", 50) });
+        log.Append(Visit(L"https://a.example/", 51));
+        EXPECT_EQ(log.RecordCount(), (size_t)2);
+        log.Flush();
+    }
+    HistoryLog log(path, std::chrono::milliseconds(10));
+    std::vector<HistoryRecord> records = log.Load();
+    ASSERT_EQ(records.size(), (size_t)2);
+    EXPECT_EQ(records[0].kind, HistoryRecord::STATE);
+    EXPECT_EQ(records[0].visitCount, 50u);
+    EXPECT_EQ(records[1].time, (int64_t)51);
+}
+
+TEST(HistoryLog, FailedCompactKeepsTheOldLog) {
+    std::filesystem::path path = test::TempDir("historylog-compact-fails") / "history.log";
+    Write(path, { Visit(L"https://a.example/", 1), Visit(L"https://b.example/", 2) });
+    // Nothing can be written where the rewritten log would go
+    std::filesystem::path tmp = path;
+    tmp += L".tmp";
+    std::filesystem::create_directories(tmp / "blocked");
+    uintmax_t before = std::filesystem::file_size(path);
+    {
+        HistoryLog log(path, std::chrono::milliseconds(10));
+        ASSERT_EQ(log.Load().size(), (size_t)2);
+        log.Start();
+        log.Append(Visit(L"https://c.example/", 3));
+        log.Compact({ State(L"https://a.example/", L"A", 1) });
+        log.Append(Visit(L"https://d.example/", 4));
+        log.Flush();
+        EXPECT_EQ(log.BytesWritten(), std::filesystem::file_size(path) - before);
+    }
+    HistoryLog log(path, std::chrono::milliseconds(10));
+    std::vector<HistoryRecord> records = log.Load();
+    ASSERT_EQ(records.size(), (size_t)4); // the old records, then the compacted state and what followed
+    EXPECT_EQ(records[0].url, std::wstring(L"https://a.example/"));
+    EXPECT_EQ(records[1].url, std::wstring(L"https://b.example/"));
+    EXPECT_EQ(records[2].kind, HistoryRecord::STATE);
+    EXPECT_EQ(records[3].url, std::wstring(L"https://d.example/"));
+    EXPECT_TRUE(std::filesystem::exists(tmp / "blocked"));
+}
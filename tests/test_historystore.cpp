@@ -0,0 +1,167 @@
+#include "test.h"
+
+#include "historystore.h"
+
+namespace {
+const size_t CHECKPOINT_OVERLAY = 4096; // overlay entries that start a checkpoint
+const size_t ENOUGH_TO_CHECKPOINT = 5000;
+
+struct Files {
+    std::filesystem::path db, log;
+    explicit Files(const char* name) {
+        std::filesystem::path dir = test::TempDir(name);
+        db = dir / "history.db";
+        log = dir / "history.log";
+    }
+};
+
+std::wstring Page(size_t i) { return L"https://site" + std::to_wstring(i % 97) + L".example/page/" + std::to_wstring(i); }
+
+uint32_t Visits(HistoryStore& store, const std::wstring& url) {
+    HistoryEntry e;
+    return store.Find(url, e) ? e.visitCount : 0;
+}
+}
+
+TEST(HistoryStore, RecordsAndRanks) {
+    Files files("historystore-rank");
+    HistoryStore store(files.db, files.log);
+    store.Load();
+    store.RecordVisit(L"https://a.example/", 1000);
+    store.RecordVisit(L"https://b.example/", 1000);
+    store.RecordVisit(L"https://b.example/", 2000);
+    store.SetTitle(L"https://b.example/", L"B");
+    store.SetTitle(L"https://never.example/", L"ignored"); // not in history
+    EXPECT_EQ(store.Size(), (size_t)2);
+    std::vector<HistoryEntry> top = store.Top(10);
+    ASSERT_EQ(top.size(), (size_t)2);
+    EXPECT_EQ(top[0].url, std::wstring(L"https://b.example/"));
+    EXPECT_EQ(top[0].title, std::wstring(L"B"));
+    EXPECT_EQ(top[0].visitCount, 2u);
+    EXPECT_EQ(top[0].firstVisit, (int64_t)1000);
+    EXPECT_EQ(top[0].lastVisit, (int64_t)2000);
+    EXPECT_EQ(store.Range(1, 10).size(), (size_t)1);
+    EXPECT_TRUE(store.Range(5, 10).empty());
+}
+
+TEST(HistoryStore, CheckpointAndReload) {
+    Files files("historystore-checkpoint");
+    {
+        HistoryStore store(files.db, files.log);
+        store.Load();
+        for (size_t i = 0; i < ENOUGH_TO_CHECKPOINT; i++) store.RecordVisit(Page(i), 1000 + (int64_t)i);
+        // Revisits after the checkpoint has started must not be counted twice on reload
+        for (size_t i = 0; i < 100; i++) store.RecordVisit(Page(i), 100000 + (int64_t)i);
+        store.SetTitle(Page(1), L"One");
+        EXPECT_EQ(store.Size(), ENOUGH_TO_CHECKPOINT);
+    }
+    EXPECT_TRUE(std::filesystem::exists(files.db));
+    EXPECT_FALSE(std::filesystem::exists(std::filesystem::path(files.db).concat(".new")));
+    // The journal was trimmed to what the new base lacks, not the whole history
+    {
+        HistoryLog journal(files.log, std::chrono::milliseconds(10));
+        EXPECT_LT(journal.Load().size(), CHECKPOINT_OVERLAY);
+    }
+
+    for (int launch = 0; launch < 2; launch++) {
+        HistoryStore store(files.db, files.log);
+        store.Load();
+        EXPECT_EQ(store.Size(), ENOUGH_TO_CHECKPOINT);
+        EXPECT_EQ(Visits(store, Page(0)), 2u);
+        EXPECT_EQ(Visits(store, Page(99)), 2u);
+        EXPECT_EQ(Visits(store, Page(100)), 1u);
+        EXPECT_EQ(Visits(store, Page(ENOUGH_TO_CHECKPOINT - 1)), 1u);
+        HistoryEntry e;
+        ASSERT_TRUE(store.Find(Page(1), e));
+        EXPECT_EQ(e.title, std::wstring(L"One"));
+        std::vector<HistoryEntry> all = store.Range(0, ENOUGH_TO_CHECKPOINT + 10);
+        ASSERT_EQ(all.size(), ENOUGH_TO_CHECKPOINT);
+        for (size_t i = 1; i < all.size(); i++) EXPECT_GE(all[i - 1].frecency, all[i].frecency);
+    }
+}
+
+TEST(HistoryStore, PromotesAWholeNewBase) {
+    Files files("historystore-promote");
+    {
+        HistoryStore store(files.db, files.log);
+        store.Load();
+        for (size_t i = 0; i < ENOUGH_TO_CHECKPOINT; i++) store.RecordVisit(Page(i), 1000 + (int64_t)i);
+    }
+    // As a crash leaves it between writing history.db.new and renaming it
+    std::filesystem::path next = std::filesystem::path(files.db).concat(".new");
+    std::filesystem::rename(files.db, next);
+    HistoryStore store(files.db, files.log);
+    store.Load();
+    EXPECT_FALSE(std::filesystem::exists(next));
+    EXPECT_EQ(store.Size(), ENOUGH_TO_CHECKPOINT);
+    EXPECT_EQ(Visits(store, Page(42)), 1u);
+}
+
+TEST(HistoryStore, DropsATornNewBase) {
+    Files files("historystore-torn");
+    {
+        HistoryStore store(files.db, files.log);
+        store.Load();
+        for (size_t i = 0; i < ENOUGH_TO_CHECKPOINT; i++) store.RecordVisit(Page(i), 1000 + (int64_t)i);
+    }
+    std::filesystem::path next = std::filesystem::path(files.db).concat(".new");
+    std::filesystem::copy_file(files.db, next);
+    std::filesystem::resize_file(next, std::filesystem::file_size(next) / 2);
+    HistoryStore store(files.db, files.log);
+    store.Load();
+    EXPECT_FALSE(std::filesystem::exists(next));
+    EXPECT_EQ(store.Size(), ENOUGH_TO_CHECKPOINT);
+}
+
+TEST(HistoryStore, ClearForgetsEverything) {
+    Files files("historystore-clear");
+    {
+        HistoryStore store(files.db, files.log);
+        store.Load();
+        for (size_t i = 0; i < ENOUGH_TO_CHECKPOINT; i++) store.RecordVisit(Page(i), 1000 + (int64_t)i);
+        store.Clear();
+        EXPECT_EQ(store.Size(), (size_t)0);
+        store.RecordVisit(L"https://after.example/", 5);
+    }
+    HistoryStore store(files.db, files.log);
+    store.Load();
+    EXPECT_EQ(store.Size(), (size_t)1);
+    EXPECT_EQ(Visits(store, Page(0)), 0u);
+}
+
+TEST(HistoryStore, ClearIsOnDiskBeforeTheBaseGoes) {
+    Files files("historystore-clear-crash"), crashed("historystore-clear-crashed");
+    {
+        HistoryStore store(files.db, files.log);
+        store.Load();
+        for (size_t i = 0; i < ENOUGH_TO_CHECKPOINT; i++) store.RecordVisit(Page(i), 1000 + (int64_t)i);
+    }
+    ASSERT_TRUE(std::filesystem::exists(files.db));
+    HistoryStore store(files.db, files.log);
+    store.Load();
+    std::filesystem::path oldBase = std::filesystem::path(crashed.db).concat(".old");
+    std::filesystem::copy_file(files.db, oldBase); // the base as Clear finds it
+    std::filesystem::copy_file(oldBase, crashed.db);
+    store.Clear();
+    EXPECT_FALSE(std::filesystem::exists(files.db));
+
+    // As a crash between writing the journal and deleting the base would leave them
+    std::filesystem::copy_file(files.log, crashed.log);
+    {
+        HistoryStore reopened(crashed.db, crashed.log);
+        reopened.Load();
+        EXPECT_EQ(reopened.Size(), (size_t)0);
+        EXPECT_FALSE(std::filesystem::exists(crashed.db));
+    }
+
+    // Visits after the clear replay onto nothing, whatever base is found
+    store.RecordVisit(L"https://after.example/", 5);
+    store.Flush();
+    std::filesystem::copy_file(files.log, crashed.log, std::filesystem::copy_options::overwrite_existing);
+    std::filesystem::copy_file(oldBase, crashed.db, std::filesystem::copy_options::overwrite_existing);
+    HistoryStore reopened(crashed.db, crashed.log);
+    reopened.Load();
+    EXPECT_EQ(reopened.Size(), (size_t)1);
+    EXPECT_EQ(Visits(reopened, L"https://after.example/"), 1u);
+    EXPECT_EQ(Visits(reopened, Page(0)), 0u);
+}
@@ -0,0 +1,39 @@
+#include "test.h"
+
+#include "json.h"
+
+namespace {
+std::string Quote(std::wstring_view s) {
+    std::string out;
+    AppendJsonString(out, s);
+    return out;
+}
+
+std::string Quote(std::string_view s) {
+    std::string out;
+    AppendJsonString(out, s);
+    return out;
+}
+}
+
+TEST(Json, EscapesQuotesAndControls) {
+    EXPECT_EQ(Quote(L"a\"b\\c"), std::string("\"a\\\"b\\\\c\""));
+    EXPECT_EQ(Quote(L"tab\there\n"), std::string("\"tab\\u0009here\\u000a\""));
+    EXPECT_EQ(Quote(std::string_view("x\x01y\x7f")), std::string("\"x\\u0001y\\u007f\""));
+    EXPECT_EQ(Quote(L""), std::string("\"\""));
+}
+
+TEST(Json, WideAndUtf8AgreeOnEveryPlane) {
+    // é, 中 and 😀: one, two and four bytes in UTF-8; the last is a surrogate pair in JSON
+    std::string expected = "\"\\u00e9\\u4e2d\\ud83d\\ude00\"";
+    EXPECT_EQ(Quote(L"é中\U0001F600"), expected);
+    EXPECT_EQ(Quote(std::string_view("\xc3\xa9\xe4\xb8\xad\xf0\x9f\x98\x80")), expected);
+    EXPECT_EQ(Quote(L"\U0010FFFF"), std::string("\"\\udbff\\udfff\""));
+}
+
+TEST(Json, MalformedUtf8BecomesReplacementCharacters) {
+    EXPECT_EQ(Quote(std::string_view("a\xff" "b")), std::string("\"a\\ufffdb\""));
+    EXPECT_EQ(Quote(std::string_view("\xc0\xaf")), std::string("\"\\ufffd\\ufffd\"")); // overlong '/'
+    EXPECT_EQ(Quote(std::string_view("\xed\xa0\x80")), std::string("\"\\ufffd\\ufffd\\ufffd\"")); // a surrogate
+    EXPECT_EQ(Quote(std::string_view("\xe4\xb8")), std::string("\"\\ufffd\\ufffd\"")); // cut short
+}
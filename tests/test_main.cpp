@@ -0,0 +1,62 @@
+#include "test.h"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace test {
+
+namespace {
+struct Registered {
+    std::string name; // "Suite.Name"
+    void (*fn)();
+};
+
+std::vector<Registered>& Registry() {
+    static std::vector<Registered> tests;
+    return tests;
+}
+
+size_t failures = 0; // in the running test
+}
+
+void RegisterTest(const char* suite, const char* name, void (*fn)()) {
+    Registry().push_back({ std::string(suite) + "." + name, fn });
+}
+
+void Fail(const char* file, int line, const std::string& message) {
+    printf("  %s:%d: %s\n", file, line, message.c_str());
+    failures++;
+}
+
+std::filesystem::path TempDir(const std::string& name) {
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "sarf_tests" / name;
+    std::error_code ec;
+    std::filesystem::remove_all(dir, ec);
+    std::filesystem::create_directories(dir);
+    return dir;
+}
+
+}
+
+int main(int argc, char** argv) {
+    std::string filter = argc > 1 ? argv[1] : "";
+    size_t run = 0;
+    std::vector<std::string> failed;
+    for (const test::Registered& t : test::Registry()) {
+        if (t.name.find(filter) == std::string::npos) continue;
+        printf("[ RUN      ] %s\n", t.name.c_str());
+        test::failures = 0;
+        auto start = std::chrono::steady_clock::now();
+        t.fn();
+        long long ms = (long long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        printf("[ %s ] %s (%lld ms)\n", test::failures ? " FAILED " : "      OK", t.name.c_str(), ms);
+        if (test::failures) failed.push_back(t.name);
+        run++;
+    }
+    printf("%zu tests, %zu failed\n", run, failed.size());
+    for (const std::string& name : failed) printf("  FAILED %s\n", name.c_str());
+    return failed.empty() && run ? 0 : 1;
+}
@@ -0,0 +1,165 @@
+#include "test.h"
+
+#include "metrics.h"
+
+#include <thread>
+
+TEST(LatencyHistogram, BucketsAreExactBelowEightThenWithinAnEighth) {
+    for (uint64_t v = 0; v < 8; v++) {
+        EXPECT_EQ(LatencyHistogram::Bucket(v), (int)v);
+        EXPECT_EQ(LatencyHistogram::BucketLow((int)v), v);
+    }
+    EXPECT_EQ(LatencyHistogram::Bucket(8), 8);
+    EXPECT_EQ(LatencyHistogram::Bucket(15), 15);
+    EXPECT_EQ(LatencyHistogram::Bucket(16), 16);
+    EXPECT_EQ(LatencyHistogram::Bucket(17), 16);
+    EXPECT_EQ(LatencyHistogram::Bucket(18), 17);
+    EXPECT_EQ(LatencyHistogram::Bucket(~0ull), LatencyHistogram::BUCKETS - 1);
+    EXPECT_EQ(LatencyHistogram::BucketLow(LatencyHistogram::BUCKETS - 1), 15ull << 60);
+
+    // Every bucket starts where the one before ends, and holds values within 12.5% of its low
+    for (int b = 0; b < LatencyHistogram::BUCKETS; b++) {
+        uint64_t low = LatencyHistogram::BucketLow(b);
+        EXPECT_EQ(LatencyHistogram::Bucket(low), b);
+        if (b > 0) EXPECT_EQ(LatencyHistogram::Bucket(low - 1), b - 1);
+        if (b + 1 < LatencyHistogram::BUCKETS) {
+            uint64_t high = LatencyHistogram::BucketLow(b + 1) - 1;
+            EXPECT_EQ(LatencyHistogram::Bucket(high), b);
+            EXPECT_LE(high - low, low / 8);
+        }
+    }
+}
+
+TEST(LatencyHistogram, Percentiles) {
+    LatencyHistogram h;
+    EXPECT_EQ(h.Percentile(0.5), 0u);
+    EXPECT_EQ(h.Mean(), 0u);
+
+    h.Add(1000);
+    EXPECT_EQ(h.Percentile(0), LatencyHistogram::BucketLow(LatencyHistogram::Bucket(1000)));
+    EXPECT_EQ(h.Percentile(1), h.Percentile(0));
+    EXPECT_LE(h.Percentile(0.5), 1000u);
+    EXPECT_EQ(h.max, 1000u);
+
+    LatencyHistogram spread;
+    for (uint64_t v = 1; v <= 100; v++) spread.Add(v);
+    EXPECT_EQ(spread.Percentile(0), 1u);
+    EXPECT_EQ(spread.Percentile(1.5), LatencyHistogram::BucketLow(LatencyHistogram::Bucket(100))); // clamped to the last
+    EXPECT_EQ(spread.Percentile(0.5), LatencyHistogram::BucketLow(LatencyHistogram::Bucket(51)));
+    EXPECT_EQ(spread.Mean(), 50u);
+
+    LatencyHistogram merged;
+    merged.Merge(h);
+    merged.Merge(spread);
+    EXPECT_EQ(merged.total, 101u);
+    EXPECT_EQ(merged.sum, 1000u + 5050u);
+    EXPECT_EQ(merged.max, 1000u);
+    EXPECT_EQ(merged.Percentile(1), LatencyHistogram::BucketLow(LatencyHistogram::Bucket(1000)));
+}
+
+TEST(Metrics, JsonEscapesHostsAndCarriesEveryField) {
+    MetricsSnapshot s;
+    s.requests = 3;
+    s.blocked = 1;
+    s.classify.Add(250);
+    s.tabs.push_back({ 7, 3, 1, 1500, 900 });
+    s.hosts.push_back({ L"ads.example", 2, 1 });
+    s.hosts.push_back({ L"\"q\"\\\U0001F600.example", 1, 0 });
+    std::string json = s.ToJson();
+    EXPECT_EQ(json.find("{\"requests\":3,\"blocked\":1,\"classifyNs\":{\"count\":1,\"mean\":250,"), 0u);
+    EXPECT_NE(json.find("\"loadNs\":{\"count\":0,\"mean\":0,\"p50\":0,\"p90\":0,\"p99\":0,\"max\":0}"), std::string::npos);
+    EXPECT_NE(json.find("\"tabs\":[{\"tab\":7,\"requests\":3,\"blocked\":1,\"loadNs\":1500,\"firstPaintNs\":900}]"), std::string::npos);
+    EXPECT_NE(json.find("\"hosts\":[{\"host\":\"ads.example\",\"requests\":2,\"blocked\":1},"
+        "{\"host\":\"\\\"q\\\"\\\\\\ud83d\\ude00.example\",\"requests\":1,\"blocked\":0}]}"), std::string::npos);
+}
+
+#if SARF_METRICS
+TEST(Metrics, SnapshotMergesThreadShards) {
+    RequestMetrics metrics;
+    const int THREADS = 4, EVENTS = 1000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; t++) {
+        threads.emplace_back([&metrics, t] {
+            for (int i = 0; i < EVENTS; i++) {
+                // Every thread counts the same tabs and hosts, so each lands in every shard
+                std::wstring host = i % 2 ? L"a.example" : L"b.example";
+                metrics.RequestClassified((uint64_t)(i % 3 + 1), host, i % 4 == 0, (uint64_t)(t + 1) * 100);
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    MetricsSnapshot s = metrics.Snapshot();
+    EXPECT_EQ(s.requests, (uint64_t)THREADS * EVENTS);
+    EXPECT_EQ(s.blocked, (uint64_t)THREADS * EVENTS / 4);
+    EXPECT_EQ(s.classify.total, (uint64_t)THREADS * EVENTS);
+    EXPECT_EQ(s.classify.max, 400u);
+    ASSERT_EQ(s.tabs.size(), 3u);
+    uint64_t tabRequests = 0;
+    for (size_t i = 0; i < s.tabs.size(); i++) {
+        EXPECT_EQ(s.tabs[i].key, i + 1);
+        tabRequests += s.tabs[i].requests;
+    }
+    EXPECT_EQ(tabRequests, s.requests);
+    ASSERT_EQ(s.hosts.size(), 2u);
+    EXPECT_TRUE(s.hosts[0].host == L"a.example" && s.hosts[1].host == L"b.example"); // ties by name
+    EXPECT_EQ(s.hosts[0].requests, (uint64_t)THREADS * EVENTS / 2);
+    EXPECT_EQ(s.hosts[1].blocked, (uint64_t)THREADS * EVENTS / 4);
+
+    // A precomputed key counts under the same host
+    metrics.RequestClassified(1, RequestMetrics::HostKey(L"a.example"), L"a.example", false, 10);
+    EXPECT_EQ(metrics.Snapshot().hosts[0].requests, (uint64_t)THREADS * EVENTS / 2 + 1);
+}
+
+TEST(Metrics, TablesOverflowIntoOneEntry) {
+    RequestMetrics metrics;
+    const uint64_t TABS = 1000, HOSTS = 3000;
+    for (uint64_t i = 0; i < HOSTS; i++) metrics.RequestClassified(1 + i % TABS, L"h" + std::to_wstring(i) + L".example", i % 2 == 0, 10);
+    MetricsSnapshot s = metrics.Snapshot();
+
+    uint64_t requests = 0, blocked = 0;
+    bool overflowTab = false;
+    for (const auto& t : s.tabs) {
+        requests += t.requests;
+        if (t.key == ~0ull) overflowTab = true;
+    }
+    EXPECT_TRUE(overflowTab);
+    EXPECT_LT(s.tabs.size(), (size_t)TABS);
+    EXPECT_EQ(requests, HOSTS);
+
+    requests = 0;
+    const MetricsSnapshot::Host* other = nullptr;
+    for (const auto& h : s.hosts) {
+        requests += h.requests;
+        blocked += h.blocked;
+        if (h.host == L"(other)") other = &h;
+        else EXPECT_EQ(h.requests, 1u);
+    }
+    ASSERT_TRUE(other != nullptr);
+    EXPECT_TRUE(other == &s.hosts[0]); // most requests first
+    EXPECT_LT(s.hosts.size(), (size_t)HOSTS);
+    EXPECT_EQ(requests, HOSTS);
+    EXPECT_EQ(blocked, HOSTS / 2);
+}
+
+TEST(Metrics, NavigationTimings) {
+    RequestMetrics metrics;
+    metrics.NavigationCompleted(5, 1000); // never started: ignored
+    metrics.NavigationStarted(5, 1000);
+    metrics.FirstPaint(5, 300);
+    metrics.NavigationCompleted(5, 1800);
+    metrics.NavigationCompleted(5, 2500); // a redirect completing again
+    metrics.NavigationStarted(6, 5000);
+    metrics.NavigationCompleted(6, 4000); // clock went backwards: ignored
+
+    MetricsSnapshot s = metrics.Snapshot();
+    EXPECT_EQ(s.load.total, 1u);
+    EXPECT_EQ(s.load.max, 800u);
+    EXPECT_EQ(s.firstPaint.total, 1u);
+    ASSERT_EQ(s.tabs.size(), 2u);
+    EXPECT_EQ(s.tabs[0].key, 5u);
+    EXPECT_EQ(s.tabs[0].loadNs, 800u);
+    EXPECT_EQ(s.tabs[0].firstPaintNs, 300u);
+    EXPECT_EQ(s.tabs[1].loadNs, 0u);
+}
+#endif
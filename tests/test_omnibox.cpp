@@ -0,0 +1,130 @@
+#include "test.h"
+
+#include "omnibox.h"
+
+#include <algorithm>
+#include <random>
+
+namespace {
+struct Page {
+    std::wstring url, title;
+    double frecency;
+};
+
+std::wstring Lower(std::wstring s) {
+    for (wchar_t& c : s) if (c >= L'A' && c <= L'Z') c += 32;
+    return s;
+}
+
+// What the index matches against: the address as typed, then the title
+std::wstring Searchable(const Page& p) {
+    std::wstring url = p.url.substr(std::wstring(L"https://").size());
+    if (url.compare(0, 4, L"www.") == 0) url = url.substr(4);
+    return Lower(url) + L"\n" + Lower(p.title);
+}
+
+// Every page holding every term, best first
+std::vector<std::wstring> BruteForce(const std::vector<Page>& pages, const std::wstring& query, size_t limit) {
+    std::vector<std::wstring> terms;
+    std::wstring q = Lower(query);
+    for (size_t i = 0; i < q.size();) {
+        size_t end = q.find(L' ', i);
+        if (end == std::wstring::npos) end = q.size();
+        if (end > i) terms.push_back(q.substr(i, end - i));
+        i = end + 1;
+    }
+    std::vector<const Page*> hits;
+    for (const Page& p : pages) {
+        std::wstring text = Searchable(p);
+        if (std::all_of(terms.begin(), terms.end(), [&](const std::wstring& t) { return text.find(t) != std::wstring::npos; })) hits.push_back(&p);
+    }
+    std::sort(hits.begin(), hits.end(), [](const Page* a, const Page* b) { return a->frecency > b->frecency; });
+    std::vector<std::wstring> urls;
+    for (size_t i = 0; i < hits.size() && i < limit; i++) urls.push_back(hits[i]->url);
+    return urls;
+}
+
+std::vector<std::wstring> Urls(const std::vector<OmniboxMatch>& matches) {
+    std::vector<std::wstring> urls;
+    for (const OmniboxMatch& m : matches) urls.push_back(m.url);
+    return urls;
+}
+
+std::vector<Page> Pages(size_t n, std::mt19937& rng) {
+    static const wchar_t* words[] = { L"News", L"Weather", L"Recipes", L"Forum", L"Docs", L"Blog", L"Shop", L"Video" };
+    static const wchar_t* tlds[] = { L".com", L".org", L".net", L".co.uk" };
+    std::vector<Page> pages;
+    for (size_t i = 0; i < n; i++) {
+        std::wstring host = (i % 3 ? L"www.site" : L"site") + std::to_wstring(rng() % 300) + tlds[rng() % 4];
+        pages.push_back({ L"https://" + host + L"/" + Lower(words[rng() % 8]) + L"/" + std::to_wstring(i),
+            std::wstring(words[rng() % 8]) + L" " + std::to_wstring(rng() % 5000), (double)(rng() % 1000000) + (double)i / n });
+    }
+    return pages;
+}
+}
+
+TEST(Omnibox, MatchesEveryTermAsASubstring) {
+    std::mt19937 rng(5);
+    std::vector<Page> pages = Pages(3000, rng);
+    OmniboxIndex index;
+    for (const Page& p : pages) index.Update(p.url, p.title, p.frecency);
+    EXPECT_EQ(index.Size(), pages.size());
+    for (int q = 0; q < 400; q++) {
+        // Pieces of a real entry's text, so most queries have matches
+        std::wstring text = Searchable(pages[rng() % pages.size()]);
+        text.erase(std::remove(text.begin(), text.end(), L'\n'), text.end());
+        size_t at = rng() % text.size(), len = 1 + rng() % 10;
+        std::wstring query = text.substr(at, len);
+        if (q % 3 == 0) query += L" " + std::to_wstring(rng() % 50);
+        if (query.find(L' ') == 0) continue;
+        EXPECT_EQ(Urls(index.Query(query)), BruteForce(pages, query, 8));
+    }
+}
+
+TEST(Omnibox, RefinesKeystrokeByKeystroke) {
+    std::mt19937 rng(6);
+    std::vector<Page> pages = Pages(3000, rng);
+    OmniboxIndex index;
+    for (const Page& p : pages) index.Update(p.url, p.title, p.frecency);
+    for (int t = 0; t < 40; t++) {
+        std::wstring typed = Searchable(pages[rng() % pages.size()]).substr(0, 18);
+        typed.erase(std::remove(typed.begin(), typed.end(), L'\n'), typed.end());
+        for (size_t len = 1; len <= typed.size(); len++) {
+            std::wstring prefix = typed.substr(0, len);
+            EXPECT_EQ(Urls(index.Query(prefix, 5)), BruteForce(pages, prefix, 5));
+        }
+    }
+}
+
+TEST(Omnibox, FollowsTitleAndFrecencyChanges) {
+    std::mt19937 rng(7);
+    std::vector<Page> pages = Pages(2000, rng);
+    OmniboxIndex index;
+    for (const Page& p : pages) index.Update(p.url, p.title, p.frecency);
+    index.Query(L"zebra"); // leaves a refinement behind that the updates must invalidate
+    for (size_t i = 0; i < pages.size(); i += 7) {
+        pages[i].title = L"Zebra crossing " + std::to_wstring(i);
+        pages[i].frecency += 5000000;
+        index.Update(pages[i].url, pages[i].title, pages[i].frecency);
+    }
+    for (size_t i = 0; i < pages.size(); i += 14) {
+        pages[i].title = L"Back to plain";
+        index.Update(pages[i].url, pages[i].title, pages[i].frecency);
+    }
+    EXPECT_EQ(index.Size(), pages.size());
+    for (const wchar_t* query : { L"zebra", L"zebra cross", L"crossing 7", L"plain", L"z", L"ze" })
+        EXPECT_EQ(Urls(index.Query(query, 20)), BruteForce(pages, query, 20));
+}
+
+TEST(Omnibox, TypedFormAndClear) {
+    OmniboxIndex index;
+    index.Update(L"https://www.Example.com/Path", L"Example Domain", 10);
+    index.Update(L"http://other.example/", L"Other", 5);
+    EXPECT_EQ(Urls(index.Query(L"https://www.example.com/p")), std::vector<std::wstring>{ L"https://www.Example.com/Path" });
+    EXPECT_EQ(index.Query(L"EXAMPLE").size(), (size_t)2);
+    EXPECT_TRUE(index.Query(L"www").empty()); // dropped from the typed form
+    EXPECT_TRUE(index.Query(L"example", 0).empty());
+    index.Clear();
+    EXPECT_EQ(index.Size(), (size_t)0);
+    EXPECT_TRUE(index.Query(L"example").empty());
+}
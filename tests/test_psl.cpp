@@ -0,0 +1,74 @@
+#include "test.h"
+
+#include "psl.h"
+
+#include <string>
+
+namespace {
+std::wstring Domain(std::wstring_view host) { return std::wstring(RegistrableDomain(host)); }
+}
+
+TEST(Psl, PlainRules) {
+    EXPECT_EQ(Domain(L"news.bbc.co.uk"), std::wstring(L"bbc.co.uk"));
+    EXPECT_EQ(Domain(L"example.com"), std::wstring(L"example.com"));
+    EXPECT_EQ(Domain(L"a.b.example.com"), std::wstring(L"example.com"));
+    EXPECT_EQ(Domain(L"com"), std::wstring());
+    EXPECT_EQ(Domain(L"co.uk"), std::wstring());
+    EXPECT_EQ(PublicSuffixLength(L"news.bbc.co.uk"), (size_t)5);
+    // A deeper rule wins over the one above it
+    EXPECT_EQ(Domain(L"foo.kyoto.jp"), std::wstring(L"foo.kyoto.jp"));
+    EXPECT_EQ(Domain(L"a.ide.kyoto.jp"), std::wstring(L"a.ide.kyoto.jp"));
+    EXPECT_EQ(Domain(L"b.a.ide.kyoto.jp"), std::wstring(L"a.ide.kyoto.jp"));
+}
+
+TEST(Psl, WildcardRules) {
+    // *.ck: every name under ck is a suffix
+    EXPECT_EQ(Domain(L"ck"), std::wstring());
+    EXPECT_EQ(Domain(L"test.ck"), std::wstring());
+    EXPECT_EQ(Domain(L"b.test.ck"), std::wstring(L"b.test.ck"));
+    EXPECT_EQ(Domain(L"a.b.test.ck"), std::wstring(L"b.test.ck"));
+    bool listed = false;
+    EXPECT_EQ(PublicSuffixLength(L"a.b.test.ck", &listed), (size_t)7);
+    EXPECT_TRUE(listed);
+    // *.kawasaki.jp below the plain jp rule
+    EXPECT_EQ(Domain(L"test.kawasaki.jp"), std::wstring());
+    EXPECT_EQ(Domain(L"b.test.kawasaki.jp"), std::wstring(L"b.test.kawasaki.jp"));
+}
+
+TEST(Psl, ExceptionRules) {
+    // !www.ck overrides *.ck
+    EXPECT_EQ(Domain(L"www.ck"), std::wstring(L"www.ck"));
+    EXPECT_EQ(Domain(L"www.www.ck"), std::wstring(L"www.ck"));
+    EXPECT_EQ(PublicSuffixLength(L"www.ck"), (size_t)2);
+    // !city.kawasaki.jp overrides *.kawasaki.jp
+    EXPECT_EQ(Domain(L"city.kawasaki.jp"), std::wstring(L"city.kawasaki.jp"));
+    EXPECT_EQ(Domain(L"www.city.kawasaki.jp"), std::wstring(L"city.kawasaki.jp"));
+    bool listed = false;
+    EXPECT_EQ(PublicSuffixLength(L"www.city.kawasaki.jp", &listed), (size_t)11);
+    EXPECT_TRUE(listed);
+}
+
+TEST(Psl, UnlistedNamesFallBackToTheLastLabel) {
+    bool listed = true;
+    EXPECT_EQ(PublicSuffixLength(L"b.example.example", &listed), (size_t)7);
+    EXPECT_FALSE(listed);
+    EXPECT_EQ(Domain(L"b.example.example"), std::wstring(L"example.example"));
+    EXPECT_EQ(Domain(L"localhost"), std::wstring());
+    // A label that only begins like a listed one
+    EXPECT_EQ(Domain(L"a.xuk"), std::wstring(L"a.xuk"));
+    EXPECT_EQ(Domain(L"a.b.xco.uk"), std::wstring(L"xco.uk"));
+}
+
+TEST(Psl, IgnoresCaseAndTrailingDots) {
+    EXPECT_EQ(Domain(L"News.BBC.Co.UK"), std::wstring(L"BBC.Co.UK"));
+    EXPECT_EQ(Domain(L"www.example.com."), std::wstring(L"example.com"));
+    EXPECT_EQ(Domain(L"A.B.TEST.CK"), std::wstring(L"B.TEST.CK"));
+    EXPECT_EQ(Domain(L"WWW.CK"), std::wstring(L"WWW.CK"));
+    EXPECT_EQ(Domain(L""), std::wstring());
+    EXPECT_EQ(Domain(L"."), std::wstring());
+}
+
+TEST(Psl, IpLiteralsAreReturnedWhole) {
+    EXPECT_EQ(Domain(L"192.168.0.1"), std::wstring(L"192.168.0.1"));
+    EXPECT_EQ(Domain(L"[::1]"), std::wstring(L"[::1]"));
+}
@@ -0,0 +1,186 @@
+#include "test.h"
+
+#include "classificationservice.h"
+#include "fakeeventsource.h"
+#include "requestclassifier.h"
+
+#include <chrono>
+#include <memory>
+#include <thread>
+
+namespace {
+void PublishList(RulesetStore& store, std::string_view list) {
+    FilterListBuilder builder;
+    builder.AddList(list);
+    auto ruleset = std::make_unique<Ruleset>();
+    ruleset->filters = builder.Build();
+    store.Publish(std::move(ruleset));
+}
+
+const wchar_t* PAGE = L"https://news.example.org/story";
+
+// Even ids go to a blocked tracker host of their own, odd ones to a CDN the rules allow
+ClassifyRequest Numbered(uint64_t id) {
+    std::wstring url = id % 2 ? L"https://cdn.example.org/app" + std::to_wstring(id) + L".js"
+                              : L"https://a" + std::to_wstring(id) + L".tracker.example/p.js";
+    return { id, id % 3, FT_SCRIPT, url, PAGE };
+}
+
+void WaitUntilCompleted(ClassificationService& service, uint64_t completed) {
+    while (service.GetStats().completed < completed) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+}
+
+TEST(RequestClassifier, KeywordsDecideInlineWithoutRules) {
+    RulesetStore store;
+    RequestClassifier classifier(store);
+    bool block = false;
+    EXPECT_TRUE(classifier.Cached(L"https://ad.doubleclick.net/x.js", PAGE, FT_SCRIPT, block));
+    EXPECT_TRUE(block);
+    EXPECT_TRUE(classifier.Cached(L"https://cdn.example.org/app.js", PAGE, FT_SCRIPT, block));
+    EXPECT_FALSE(block);
+    PublishList(store, ""); // a ruleset with no rules still falls back
+    EXPECT_TRUE(classifier.Cached(L"https://ad.doubleclick.net/x.js", PAGE, FT_SCRIPT, block));
+    EXPECT_TRUE(block);
+}
+
+TEST(RequestClassifier, RulesGoThroughTheCache) {
+    RulesetStore store;
+    PublishList(store, "||tracker.example^\n");
+    RequestClassifier classifier(store);
+    bool block = false;
+    EXPECT_FALSE(classifier.Cached(L"https://tracker.example/p.js", PAGE, FT_SCRIPT, block));
+    EXPECT_TRUE(classifier.Uncached(L"https://tracker.example/p.js", PAGE, FT_SCRIPT));
+    EXPECT_TRUE(classifier.Cached(L"https://tracker.example/q.js", PAGE, FT_SCRIPT, block));
+    EXPECT_TRUE(block);
+    EXPECT_FALSE(classifier.ShouldBlock(L"https://ad.doubleclick.net/x.js", PAGE, FT_SCRIPT)); // rules replace the keywords
+}
+
+TEST(ClassificationService, CountsInlineDecisions) {
+    RulesetStore store;
+    RequestClassifier classifier(store);
+    ClassificationService service(classifier, 1, [] {});
+    for (int i = 0; i < 10; i++) {
+        bool blocked = false;
+        EXPECT_TRUE(service.Submit({ (uint64_t)i, 1, FT_IMAGE, L"https://pagead2.example/i" + std::to_wstring(i), PAGE }, blocked));
+        EXPECT_TRUE(blocked);
+    }
+    ClassificationService::Stats stats = service.GetStats();
+    EXPECT_EQ(stats.decidedInline, 10u);
+    EXPECT_EQ(stats.deferred, 0u);
+}
+
+TEST(ClassificationService, DeferredRequestsComeBackThroughDrain) {
+    RulesetStore store;
+    PublishList(store, "||tracker.example^\n/banner/*\n");
+    RequestClassifier classifier(store);
+    FakeEventSource source;
+    ClassificationService service(classifier, 1, [&source] { source.Post(); });
+
+    // The worker posts after its first batch and waits there, so the rest queue behind it
+    source.Hold();
+    const uint64_t COUNT = 40;
+    for (uint64_t id = 0; id < COUNT; id++) {
+        bool blocked = false;
+        EXPECT_FALSE(service.Submit(Numbered(id), blocked));
+    }
+    source.WaitForPost();
+    EXPECT_EQ(service.GetStats().deferred, COUNT);
+    source.Release();
+    WaitUntilCompleted(service, COUNT);
+    EXPECT_EQ(service.GetStats().queued, 0u);
+    EXPECT_EQ(source.Posts(), 1u); // the later batches found a post already waiting for Drain
+
+    std::vector<ClassifyResult> decided;
+    EXPECT_EQ(service.Drain(decided), COUNT);
+    ASSERT_EQ(decided.size(), COUNT);
+    for (uint64_t id = 0; id < COUNT; id++) {
+        // One worker keeps the order requests were submitted in
+        EXPECT_EQ(decided[id].request.id, id);
+        EXPECT_EQ(decided[id].request.tab, id % 3);
+        EXPECT_EQ(decided[id].blocked, id % 2 == 0);
+    }
+    EXPECT_EQ(service.Drain(decided), 0u);
+
+    // Drain re-arms the post; tracker hosts already decided are now answered inline
+    bool blocked = false;
+    EXPECT_TRUE(service.Submit(Numbered(0), blocked));
+    EXPECT_TRUE(blocked);
+    EXPECT_FALSE(service.Submit(Numbered(COUNT + 1), blocked));
+    source.WaitForPost();
+    EXPECT_EQ(source.Posts(), 2u);
+    decided.clear();
+    EXPECT_EQ(service.Drain(decided), 1u);
+    EXPECT_EQ(decided[0].request.id, COUNT + 1);
+
+    ClassificationService::Stats stats = service.GetStats();
+    EXPECT_EQ(stats.decidedInline, 1u);
+    EXPECT_EQ(stats.deferred, COUNT + 1);
+    EXPECT_EQ(stats.completed, COUNT + 1);
+    EXPECT_GE(stats.maxQueued, COUNT - 16);
+}
+
+TEST(ClassificationService, SeveralWorkersDecideEveryRequestOnce) {
+    RulesetStore store;
+    PublishList(store, "||tracker.example^\n/banner/*\n");
+    RequestClassifier classifier(store);
+    FakeEventSource source;
+    ClassificationService service(classifier, 4, [&source] { source.Post(); });
+
+    // As the browser does: a bounded number held open, completing what was decided on each post
+    const uint64_t COUNT = 3000;
+    std::vector<int> seen(COUNT, 0);
+    std::vector<ClassifyResult> decided;
+    auto complete = [&] {
+        source.WaitForPost();
+        decided.clear();
+        source.open -= service.Drain(decided);
+        for (const ClassifyResult& r : decided) {
+            ASSERT_LT(r.request.id, COUNT);
+            seen[r.request.id]++;
+            EXPECT_EQ(r.blocked, r.request.id % 2 == 0);
+            EXPECT_TRUE(r.request.url == Numbered(r.request.id).url);
+        }
+    };
+    for (uint64_t id = 0; id < COUNT; id++) {
+        bool blocked = false;
+        if (service.Submit(Numbered(id), blocked)) seen[id]++;
+        else source.open++;
+        while (source.open >= 100) complete();
+    }
+    while (source.open) complete();
+    for (uint64_t id = 0; id < COUNT; id++) EXPECT_EQ(seen[id], 1);
+    EXPECT_EQ(service.GetStats().completed, service.GetStats().deferred);
+}
+
+TEST(ClassificationService, DestroyedWithRequestsQueued) {
+    RulesetStore store;
+    PublishList(store, "||tracker.example^\n");
+    RequestClassifier classifier(store);
+    FakeEventSource source;
+    auto service = std::make_unique<ClassificationService>(classifier, 1, [&source] { source.Post(); });
+
+    source.Hold();
+    const uint64_t COUNT = 200;
+    for (uint64_t id = 0; id < COUNT; id += 2) {
+        bool blocked = false;
+        EXPECT_FALSE(service->Submit(Numbered(id), blocked));
+    }
+    source.WaitForPost();
+    std::thread destroy([&service] { service.reset(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50)); // for the destructor to ask the worker to stop
+    source.Release();
+    destroy.join();
+
+    // The worker decided its first batch, and at most one more had it not seen the stop in
+    // time; the rest were dropped. A decided tracker host is cached, which is how to tell.
+    size_t decided = 0;
+    for (uint64_t id = 0; id < COUNT; id += 2) {
+        bool blocked = false;
+        const ClassifyRequest r = Numbered(id);
+        if (classifier.Cached(r.url, r.source, r.type, blocked)) decided++;
+    }
+    EXPECT_GE(decided, 1u);
+    EXPECT_LE(decided, 32u);
+    EXPECT_EQ(source.Posts(), 1u);
+}
@@ -0,0 +1,113 @@
+#include "test.h"
+
+#include "requestscheduler.h"
+
+namespace {
+const uint64_t FRONT = 1, BACK = 2, OTHER = 3;
+
+// Three tabs, the first in front
+struct Harness {
+    RequestScheduler scheduler{ RequestScheduler::Config() };
+    uint64_t nextId = 1;
+
+    Harness() {
+        for (uint64_t tab : { FRONT, BACK, OTHER }) scheduler.Add(tab);
+        scheduler.Activate(FRONT, 0);
+    }
+
+    RequestSchedule Submit(uint64_t tab, uint32_t type, std::wstring url, int64_t now = 0) {
+        return scheduler.Submit({ nextId++, tab, type, std::move(url) }, now);
+    }
+    std::vector<std::wstring> Released() {
+        std::vector<ScheduledRequest> out;
+        scheduler.Drain(out);
+        std::vector<std::wstring> urls;
+        for (const ScheduledRequest& r : out) urls.push_back(r.url);
+        return urls;
+    }
+};
+}
+
+TEST(RequestScheduler, ForegroundAndUnknownTabsAlwaysSend) {
+    Harness h;
+    for (int i = 0; i < 20; i++) EXPECT_EQ(h.Submit(FRONT, FT_IMAGE, L"f" + std::to_wstring(i)), REQUEST_SEND);
+    EXPECT_EQ(h.Submit(99, FT_SCRIPT, L"preload"), REQUEST_SEND);
+}
+
+TEST(RequestScheduler, LimitsSlotsPerTabAndOverall) {
+    Harness h;
+    EXPECT_EQ(h.Submit(BACK, FT_SCRIPT, L"b1"), REQUEST_SEND);
+    EXPECT_EQ(h.Submit(BACK, FT_SCRIPT, L"b2"), REQUEST_SEND);
+    EXPECT_EQ(h.Submit(BACK, FT_SCRIPT, L"b3"), REQUEST_HOLD);
+    h.scheduler.Finished(BACK, L"b1", 5);
+    EXPECT_EQ(h.Released(), std::vector<std::wstring>{ L"b3" });
+
+    RequestScheduler::Config config;
+    config.backgroundSlots = 3;
+    RequestScheduler shared(config);
+    for (uint64_t tab : { BACK, OTHER }) shared.Add(tab);
+    EXPECT_EQ(shared.Submit({ 1, BACK, FT_XHR, L"b1" }, 0), REQUEST_SEND);
+    EXPECT_EQ(shared.Submit({ 2, BACK, FT_XHR, L"b2" }, 0), REQUEST_SEND);
+    EXPECT_EQ(shared.Submit({ 3, OTHER, FT_XHR, L"o1" }, 0), REQUEST_SEND);
+    EXPECT_EQ(shared.Submit({ 4, OTHER, FT_XHR, L"o2" }, 0), REQUEST_HOLD); // budget spent
+}
+
+TEST(RequestScheduler, DefersLowPriorityUntilShown) {
+    Harness h;
+    EXPECT_EQ(h.Submit(BACK, FT_IMAGE, L"img"), REQUEST_HOLD);
+    EXPECT_EQ(h.Submit(BACK, FT_PING, L"beacon"), REQUEST_HOLD);
+    EXPECT_EQ(h.Submit(BACK, FT_PING, L"beacon"), REQUEST_COALESCED);
+    h.scheduler.Finished(BACK, L"anything", 1);
+    EXPECT_TRUE(h.Released().empty());
+    h.scheduler.Activate(BACK, 10);
+    EXPECT_EQ(h.Released(), (std::vector<std::wstring>{ L"img", L"beacon" }));
+    EXPECT_EQ(h.Submit(BACK, FT_IMAGE, L"img2"), REQUEST_SEND);
+    RequestScheduler::Stats stats = h.scheduler.GetStats();
+    EXPECT_EQ(stats.coalesced, 1u);
+    EXPECT_EQ(stats.holding, (size_t)0);
+    EXPECT_EQ(stats.maxWaitMs, (int64_t)10);
+}
+
+TEST(RequestScheduler, ServesTabsRoundRobin) {
+    RequestScheduler::Config config;
+    config.tabSlots = 4;
+    config.backgroundSlots = 4;
+    RequestScheduler scheduler(config);
+    scheduler.Add(BACK);
+    scheduler.Add(OTHER);
+    uint64_t id = 1;
+    for (int i = 0; i < 8; i++) scheduler.Submit({ id++, BACK, FT_XHR, L"b" + std::to_wstring(i) }, 0);
+    for (int i = 0; i < 4; i++) scheduler.Submit({ id++, OTHER, FT_XHR, L"o" + std::to_wstring(i) }, 0);
+    scheduler.Finished(BACK, L"b0", 1);
+    scheduler.Finished(BACK, L"b1", 1);
+    // BACK queued first and has room, but the freed slots are shared out one per tab
+    std::vector<ScheduledRequest> released;
+    scheduler.Drain(released);
+    ASSERT_EQ(released.size(), (size_t)2);
+    EXPECT_EQ(released[0].url, std::wstring(L"b4"));
+    EXPECT_EQ(released[1].url, std::wstring(L"o0"));
+}
+
+TEST(RequestScheduler, NothingWaitsForever) {
+    Harness h;
+    for (int i = 0; i < 4; i++) h.Submit(BACK, FT_XHR, L"x" + std::to_wstring(i), 0);
+    h.Submit(BACK, FT_IMAGE, L"img", 0);
+    h.scheduler.Tick(20000); // slots never seen finishing are given back
+    EXPECT_EQ(h.scheduler.GetStats().timedOut, 2u);
+    EXPECT_EQ(h.Released(), (std::vector<std::wstring>{ L"x2", L"x3" }));
+    h.scheduler.Tick(30000); // the deferred image has waited long enough
+    EXPECT_EQ(h.Released(), std::vector<std::wstring>{ L"img" });
+    EXPECT_EQ(h.scheduler.GetStats().aged, 1u);
+}
+
+TEST(RequestScheduler, RemovingATabLetsGoOfItsRequests) {
+    Harness h;
+    h.Submit(BACK, FT_IMAGE, L"img");
+    h.Submit(BACK, FT_XHR, L"a");
+    h.Submit(BACK, FT_XHR, L"b");
+    h.Submit(OTHER, FT_XHR, L"o");
+    h.scheduler.Remove(BACK, 1);
+    EXPECT_EQ(h.Released(), std::vector<std::wstring>{ L"img" });
+    EXPECT_EQ(h.Submit(BACK, FT_XHR, L"gone"), REQUEST_SEND);
+    EXPECT_EQ(h.scheduler.GetStats().holding, (size_t)0);
+}
@@ -0,0 +1,75 @@
+#include "test.h"
+
+#include "ruleset.h"
+
+#include <thread>
+
+namespace {
+std::unique_ptr<Ruleset> Stamped(uint64_t stamp) {
+    auto r = std::make_unique<Ruleset>();
+    r->sourceStamp = stamp;
+    return r;
+}
+}
+
+TEST(RulesetStore, PublishReplacesAndNumbers) {
+    RulesetStore store;
+    {
+        RulesetStore::Reader reader(store);
+        EXPECT_TRUE(reader.Get() == nullptr);
+    }
+    store.Publish(Stamped(1));
+    store.Publish(Stamped(2));
+    EXPECT_EQ(store.Generation(), 2u);
+    RulesetStore::Reader reader(store);
+    ASSERT_TRUE(reader.Get() != nullptr);
+    EXPECT_EQ(reader->sourceStamp, 2u);
+    EXPECT_EQ(reader->generation, 2u);
+}
+
+TEST(RulesetStore, RetiredSetOutlivesItsReaders) {
+    RulesetStore store;
+    store.Publish(Stamped(1));
+    EXPECT_EQ(store.RetiredCount(), (size_t)0);
+    {
+        RulesetStore::Reader pinned(store);
+        const Ruleset* old = pinned.Get();
+        store.Publish(Stamped(2));
+        EXPECT_EQ(store.RetiredCount(), (size_t)1); // still visible to `pinned`
+        store.Reclaim();
+        EXPECT_EQ(store.RetiredCount(), (size_t)1);
+        EXPECT_EQ(old->sourceStamp, 1u);
+    }
+    store.Reclaim();
+    EXPECT_EQ(store.RetiredCount(), (size_t)0);
+}
+
+TEST(RulesetStore, ReaderOnAnotherThreadHoldsRetirement) {
+    RulesetStore store;
+    store.Publish(Stamped(1));
+    std::mutex lock;
+    std::condition_variable cv;
+    int step = 0;
+    std::thread reader([&] {
+        RulesetStore::Reader r(store);
+        std::unique_lock<std::mutex> guard(lock);
+        step = 1;
+        cv.notify_all();
+        cv.wait(guard, [&] { return step == 2; });
+        EXPECT_EQ(r->sourceStamp, 1u);
+    });
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        cv.wait(guard, [&] { return step == 1; });
+    }
+    store.Publish(Stamped(2));
+    EXPECT_EQ(store.RetiredCount(), (size_t)1);
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        step = 2;
+    }
+    cv.notify_all();
+    reader.join();
+    store.Reclaim();
+    EXPECT_EQ(store.RetiredCount(), (size_t)0);
+}
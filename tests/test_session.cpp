@@ -0,0 +1,203 @@
+#include "test.h"
+
+#include "session.h"
+
+#include <fstream>
+#include <iterator>
+#include <random>
+
+#ifndef _WIN32
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace {
+Session Sample(size_t tabs) {
+    Session s;
+    for (size_t i = 0; i < tabs; i++) s.tabs.push_back({ L"https://example.com/" + std::to_wstring(i), L"Tab " + std::to_wstring(i) });
+    s.active = tabs / 2;
+    return s;
+}
+
+bool Same(const Session& a, const Session& b) {
+    if (a.active != b.active || a.tabs.size() != b.tabs.size()) return false;
+    for (size_t i = 0; i < a.tabs.size(); i++) {
+        if (a.tabs[i].url != b.tabs[i].url || a.tabs[i].title != b.tabs[i].title) return false;
+    }
+    return true;
+}
+}
+
+TEST(Session, EncodeDecodeRoundTrip) {
+    Session in = Sample(5);
+    in.tabs[1].title = L"Ünïcode \U0001F600";
+    std::string bytes = EncodeSession(in);
+    Session out;
+    ASSERT_TRUE(DecodeSession((const uint8_t*)bytes.data(), bytes.size(), out));
+    EXPECT_TRUE(Same(in, out));
+}
+
+TEST(Session, DecodeRejectsForeignData) {
+    Session out;
+    std::string junk = "{\"tabs\":[]}";
+    EXPECT_FALSE(DecodeSession((const uint8_t*)junk.data(), junk.size(), out));
+    EXPECT_FALSE(DecodeSession(nullptr, 0, out));
+}
+
+TEST(SessionStore, SaveAndLoad) {
+    std::filesystem::path path = test::TempDir("session-store") / "session.dat";
+    Session in = Sample(3);
+    {
+        SessionStore store(path);
+        Session none;
+        EXPECT_FALSE(store.Load(none));
+        store.MarkDirty();
+        EXPECT_TRUE(store.IsDirty());
+        store.Save(in);
+        EXPECT_FALSE(store.IsDirty());
+        store.Save(in); // the same bytes again are dropped
+        store.Flush();
+        SessionStore::Stats stats = store.GetStats();
+        EXPECT_EQ(stats.saves, 2u);
+        EXPECT_EQ(stats.unchanged, 1u);
+        EXPECT_EQ(stats.writes, 1u);
+    }
+    SessionStore store(path);
+    Session out;
+    ASSERT_TRUE(store.Load(out));
+    EXPECT_TRUE(Same(in, out));
+}
+
+TEST(SessionStore, TornFileIsNotLoaded) {
+    std::filesystem::path path = test::TempDir("session-torn") / "session.dat";
+    {
+        SessionStore store(path);
+        store.Save(Sample(4));
+    }
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 3);
+    SessionStore store(path);
+    Session out;
+    EXPECT_FALSE(store.Load(out));
+}
+
+TEST(Session, DecodeRejectsEveryTruncationAndFlip) {
+    Session in = Sample(3);
+    in.tabs[2].title = L"\U0001F600";
+    std::string bytes = EncodeSession(in);
+    for (size_t cut = 0; cut < bytes.size(); cut++) {
+        Session out;
+        EXPECT_FALSE(DecodeSession((const uint8_t*)bytes.data(), cut, out));
+    }
+    for (size_t at = 0; at < bytes.size(); at++) {
+        std::string flipped = bytes;
+        flipped[at] ^= 0x21;
+        Session out;
+        EXPECT_FALSE(DecodeSession((const uint8_t*)flipped.data(), flipped.size(), out));
+    }
+}
+
+TEST(SessionStore, FallsBackToThePreviousSnapshot) {
+    std::filesystem::path dir = test::TempDir("session-fallback");
+    std::filesystem::path path = dir / "session.dat", old = dir / "session.dat.old";
+    Session previous = Sample(2), latest = Sample(5);
+    {
+        SessionStore store(path);
+        store.Save(previous);
+        store.Flush();
+        store.Save(latest);
+    }
+    ASSERT_TRUE(std::filesystem::exists(old));
+    std::string bytes;
+    {
+        std::ifstream in(path, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    auto loads = [&](const std::string& file) {
+        std::ofstream(path, std::ios::binary | std::ios::trunc).write(file.data(), (std::streamsize)file.size());
+        SessionStore store(path);
+        Session out;
+        return store.Load(out) && Same(out, previous);
+    };
+    for (size_t cut = 0; cut < bytes.size(); cut++) EXPECT_TRUE(loads(bytes.substr(0, cut)));
+    for (size_t at = 0; at < bytes.size(); at++) {
+        std::string flipped = bytes;
+        flipped[at] ^= 0x21;
+        EXPECT_TRUE(loads(flipped));
+    }
+    // A crash between moving the file aside and moving the new one in
+    std::filesystem::remove(path);
+    SessionStore store(path);
+    Session out;
+    ASSERT_TRUE(store.Load(out));
+    EXPECT_TRUE(Same(out, previous));
+}
+
+#ifndef _WIN32
+// A writer killed at any point, over and over, must leave a snapshot Load can read, and it must
+// be the last one the writer finished or the one it was writing.
+TEST(SessionStore, SurvivesTheWriterBeingKilled) {
+    std::filesystem::path dir = test::TempDir("session-kill");
+    std::filesystem::path path = dir / "session.dat", tmp = dir / "session.dat.tmp";
+    // Big enough that a kill often lands inside a rename or an fsync rather than between saves
+    auto snapshot = [](uint64_t generation) {
+        Session s = Sample(2000);
+        s.tabs[0].url = L"gen:" + std::to_wstring(generation);
+        return s;
+    };
+    auto generationOf = [](const Session& s) { return std::stoull(s.tabs[0].url.substr(4)); };
+    {
+        SessionStore store(path);
+        store.Save(snapshot(0));
+    }
+    std::mt19937 random(7);
+    int partialTemp = 0, betweenRenames = 0;
+    for (int round = 0; round < 400 && (round < 40 || !partialTemp || !betweenRenames); round++) {
+        uint64_t start;
+        {
+            SessionStore store(path);
+            Session s;
+            ASSERT_TRUE(store.Load(s));
+            start = generationOf(s);
+        }
+        // What a power cut in the middle of writing the temporary file leaves; a kill alone can't,
+        // since one write to a regular file is not interrupted, but the writer must cope with it
+        std::string next = EncodeSession(snapshot(start + 1));
+        next.resize(std::uniform_int_distribution<size_t>(0, next.size() - 1)(random));
+        std::ofstream(tmp, std::ios::binary | std::ios::trunc).write(next.data(), (std::streamsize)next.size());
+
+        int acks[2];
+        ASSERT_EQ(pipe(acks), 0);
+        pid_t child = fork();
+        ASSERT_GE(child, 0);
+        if (child == 0) {
+            close(acks[0]);
+            SessionStore store(path);
+            for (uint64_t g = start + 1;; g++) {
+                store.Save(snapshot(g));
+                store.Flush();
+                if (write(acks[1], &g, sizeof(g)) != sizeof(g)) _exit(1);
+            }
+        }
+        close(acks[1]);
+        std::this_thread::sleep_for(std::chrono::microseconds(std::uniform_int_distribution<int>(0, 20000)(random)));
+        kill(child, SIGKILL);
+        int status = 0;
+        waitpid(child, &status, 0);
+        uint64_t finished = start, g;
+        while (read(acks[0], &g, sizeof(g)) == sizeof(g)) finished = g;
+        close(acks[0]);
+
+        if (std::filesystem::exists(tmp) && std::filesystem::file_size(tmp) < EncodeSession(snapshot(finished + 1)).size()) partialTemp++;
+        if (!std::filesystem::exists(path)) betweenRenames++;
+        SessionStore store(path);
+        Session s;
+        ASSERT_TRUE(store.Load(s));
+        uint64_t loaded = generationOf(s);
+        EXPECT_TRUE(loaded == finished || loaded == finished + 1);
+        EXPECT_TRUE(Same(s, snapshot(loaded)));
+    }
+    EXPECT_GT(partialTemp, 0);
+    EXPECT_GT(betweenRenames, 0);
+}
+#endif
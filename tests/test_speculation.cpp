@@ -0,0 +1,100 @@
+#include "test.h"
+
+#include "speculation.h"
+
+namespace {
+class FakePreload : public Preload {
+public:
+    FakePreload(std::wstring url, int& live) : url(std::move(url)), live(live) { live++; }
+    ~FakePreload() override { live--; }
+    std::wstring url;
+    int& live;
+};
+
+class FakeBackend : public PreloadBackend {
+public:
+    std::unique_ptr<Preload> Start(const std::wstring& url) override {
+        started.push_back(url);
+        return std::make_unique<FakePreload>(url, live);
+    }
+    std::vector<std::wstring> started;
+    int live = 0;
+};
+
+std::vector<OmniboxMatch> Matches() {
+    return { { L"https://github.com/", L"GitHub", 90 }, { L"https://gitlab.com/", L"GitLab", 5 } };
+}
+}
+
+TEST(Speculation, PredictsTheDominantAddressPrefix) {
+    OmniboxPrediction p = PredictOmniboxTarget(L"git", Matches());
+    EXPECT_EQ(p.url, std::wstring(L"https://github.com/"));
+    EXPECT_GT(p.confidence, 0.9);
+    // Matched only on the title: at most a coin toss
+    p = PredictOmniboxTarget(L"hub", { { L"https://github.com/", L"hub", 90 } });
+    EXPECT_LE(p.confidence, 0.5);
+    EXPECT_TRUE(PredictOmniboxTarget(L"   ", Matches()).url.empty());
+}
+
+TEST(Speculation, PreloadsAndHandsOverOnEnter) {
+    FakeBackend backend;
+    SpeculationEngine engine(backend, SpeculationEngine::Config());
+    engine.Input(L"git", Matches(), 0);
+    ASSERT_EQ(backend.started.size(), (size_t)1);
+    EXPECT_EQ(engine.Target(), std::wstring(L"https://github.com/"));
+    engine.Input(L"gith", Matches(), 10); // same target: the preload is kept
+    EXPECT_EQ(backend.started.size(), (size_t)1);
+    engine.Loaded(engine.Current(), 300);
+    std::unique_ptr<Preload> taken = engine.Take(L"HTTPS://GitHub.com", 500);
+    ASSERT_TRUE(taken != nullptr);
+    EXPECT_EQ(static_cast<FakePreload*>(taken.get())->url, std::wstring(L"https://github.com/"));
+    SpeculationEngine::Stats stats = engine.GetStats();
+    EXPECT_EQ(stats.hits, 1u);
+    EXPECT_EQ(stats.savedMs, (int64_t)300);
+    EXPECT_TRUE(engine.Current() == nullptr);
+}
+
+TEST(Speculation, CancelsOnMissAndStaleness) {
+    FakeBackend backend;
+    SpeculationEngine::Config config;
+    config.maxAgeMs = 1000;
+    SpeculationEngine engine(backend, config);
+    engine.Input(L"git", Matches(), 0);
+    EXPECT_TRUE(engine.Take(L"https://example.com/", 10) == nullptr);
+    EXPECT_EQ(backend.live, 0);
+    engine.Input(L"git", Matches(), 0);
+    EXPECT_TRUE(engine.Take(L"https://github.com/", 5000) == nullptr);
+    engine.Input(L"github", Matches(), 0);
+    engine.Cancel();
+    EXPECT_EQ(backend.live, 0);
+    SpeculationEngine::Stats stats = engine.GetStats();
+    EXPECT_EQ(stats.misses, 1u);
+    EXPECT_EQ(stats.stale, 1u);
+    EXPECT_EQ(stats.cancelled, 1u);
+}
+
+TEST(Speculation, LearnsFromWhatIsOpened) {
+    FakeBackend backend;
+    SpeculationEngine engine(backend, SpeculationEngine::Config());
+    // GitLab is opened after "git" every time, despite GitHub's frecency
+    for (int i = 0; i < 3; i++) {
+        engine.Input(L"git", Matches(), i * 100);
+        engine.Take(L"https://gitlab.com/", i * 100 + 50);
+    }
+    engine.Input(L"git", Matches(), 1000);
+    EXPECT_EQ(engine.Target(), std::wstring(L"https://gitlab.com/"));
+}
+
+TEST(Speculation, StopsWhenPreloadsGoUnopened) {
+    FakeBackend backend;
+    SpeculationEngine::Config config;
+    config.sessionWaste = 3;
+    SpeculationEngine engine(backend, config);
+    for (int i = 0; i < 10; i++) {
+        engine.Input(L"git", Matches(), i);
+        engine.Cancel();
+    }
+    EXPECT_TRUE(engine.Exhausted());
+    EXPECT_EQ(engine.GetStats().started, 3u);
+    EXPECT_GT(engine.GetStats().denied, 0u);
+}
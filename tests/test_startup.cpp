@@ -0,0 +1,209 @@
+#include "test.h"
+
+#include "startup.h"
+
+#include <atomic>
+#include <random>
+#include <thread>
+
+namespace {
+using T = StartupThread;
+
+// Start and finish order of every task, from whichever thread ran it
+struct Log {
+    void Started(size_t task) {
+        std::lock_guard<std::mutex> guard(lock);
+        started[task] = ++clock;
+    }
+    void Finished(size_t task) {
+        std::lock_guard<std::mutex> guard(lock);
+        finished[task] = ++clock;
+    }
+
+    explicit Log(size_t tasks) : started(tasks, 0), finished(tasks, 0) {}
+    std::mutex lock;
+    size_t clock = 0;
+    std::vector<size_t> started, finished;
+};
+}
+
+TEST(Startup, TasksRunAfterWhatTheyComeAfter) {
+    std::mt19937 rng(21);
+    for (int round = 0; round < 40; round++) {
+        StartupTrace trace;
+        StartupGraph graph(trace, 1 + round % 4, nullptr);
+        size_t count = 2 + rng() % 30;
+        Log log(count);
+        std::vector<std::vector<size_t>> after(count);
+        for (size_t task = 0; task < count; task++) {
+            for (size_t before = 0; before < task; before++)
+                if (rng() % 4 == 0) after[task].push_back(before);
+            T thread = rng() % 2 ? T::Main : T::Worker;
+            graph.Add("t" + std::to_string(task), thread, after[task], [&log, task] {
+                log.Started(task);
+                log.Finished(task);
+            });
+        }
+        graph.Start();
+        graph.Wait();
+        ASSERT_TRUE(graph.Finished());
+        for (size_t task = 0; task < count; task++) {
+            ASSERT_GT(log.started[task], (size_t)0);
+            for (size_t before : after[task]) ASSERT_GT(log.started[task], log.finished[before]);
+        }
+    }
+}
+
+TEST(Startup, MainTasksRunOnTheMainThread) {
+    StartupTrace trace;
+    std::atomic<int> ready{ 0 };
+    StartupGraph graph(trace, 2, [&ready] { ready++; });
+    std::thread::id main = std::this_thread::get_id(), worker, first, second, early;
+    std::atomic<bool> started{ false };
+    auto load = graph.Add("load", T::Worker, {}, [&worker, &started] {
+        worker = std::this_thread::get_id();
+        while (!started) std::this_thread::yield(); // finish once the main thread is out of Start
+    });
+    graph.Add("window", T::Main, {}, [&early] { early = std::this_thread::get_id(); });
+    graph.Add("publish", T::Main, { load }, [&first] { first = std::this_thread::get_id(); });
+    graph.Add("show", T::Main, { load }, [&second] { second = std::this_thread::get_id(); });
+    graph.Start();
+    started = true;
+    EXPECT_TRUE(early == main); // nothing before it, so it ran inside Start
+    while (!ready) std::this_thread::yield();
+    // Both tasks the worker released share one wake-up, and neither ran off the main thread
+    EXPECT_EQ(ready.load(), 1);
+    EXPECT_EQ(graph.RunMainTasks(), (size_t)2);
+    EXPECT_TRUE(graph.Finished());
+    EXPECT_TRUE(worker != main);
+    EXPECT_TRUE(first == main);
+    EXPECT_TRUE(second == main);
+    EXPECT_EQ(ready.load(), 1);
+}
+
+TEST(Startup, MainTasksReleasedOnTheMainThreadNeedNoWakeUp) {
+    StartupTrace trace;
+    int ready = 0, ran = 0;
+    StartupGraph graph(trace, 1, [&ready] { ready++; });
+    auto a = graph.Add("a", T::Main, {}, [&ran] { ran++; });
+    auto b = graph.Add("b", T::Main, { a }, [&ran] { ran++; });
+    graph.Add("c", T::Main, { b }, [&ran] { ran++; });
+    graph.Start();
+    EXPECT_EQ(ran, 3);
+    EXPECT_EQ(ready, 0);
+    EXPECT_TRUE(graph.Finished());
+}
+
+TEST(Startup, AsyncTasksFinishWhenTheySayDone) {
+    StartupTrace trace;
+    std::atomic<int> ready{ 0 };
+    StartupGraph graph(trace, 1, [&ready] { ready++; });
+    StartupGraph::Done finish;
+    bool after = false;
+    auto environment = graph.AddAsync("environment", T::Main, {}, [&finish](StartupGraph::Done done) { finish = done; });
+    graph.Add("tabs", T::Main, { environment }, [&after] { after = true; });
+    graph.Start();
+    EXPECT_FALSE(after);
+    EXPECT_FALSE(graph.Finished());
+    EXPECT_EQ(graph.RunMainTasks(), (size_t)0);
+    // The callback arrives on another thread, as WebView2's completion handlers may
+    std::thread([&finish] { finish(); finish(); }).join(); // a second call changes nothing
+    EXPECT_EQ(ready.load(), 1);
+    EXPECT_EQ(graph.RunMainTasks(), (size_t)1);
+    EXPECT_TRUE(after);
+    EXPECT_TRUE(graph.Finished());
+    size_t phases = 0;
+    for (const StartupTrace::Event& e : trace.Events()) phases += e.phase == 'X';
+    EXPECT_EQ(phases, (size_t)2);
+}
+
+TEST(Startup, WaitRunsMainTasksAsWorkersReleaseThem) {
+    StartupTrace trace;
+    StartupGraph graph(trace, 3, nullptr);
+    std::atomic<int> loaded{ 0 };
+    std::vector<StartupGraph::Task> loads;
+    for (int i = 0; i < 6; i++) {
+        loads.push_back(graph.Add("load" + std::to_string(i), T::Worker, {}, [&loaded] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            loaded++;
+        }));
+    }
+    int seen = -1;
+    graph.Add("publish", T::Main, loads, [&] { seen = loaded.load(); });
+    graph.Start();
+    graph.Wait();
+    EXPECT_EQ(seen, 6);
+}
+
+TEST(Startup, PhasesAreRecordedOnTheThreadThatRanThem) {
+    StartupTrace trace;
+    trace.NameThread("main");
+    StartupGraph graph(trace, 1, nullptr);
+    uint32_t worker = 0;
+    auto load = graph.Add("history.load", T::Worker, {}, [&] {
+        worker = StartupTrace::ThreadId();
+        std::this_thread::sleep_for(std::chrono::milliseconds(3));
+    });
+    graph.Add("history.publish", T::Main, { load }, [] {});
+    graph.Start();
+    graph.Wait();
+    trace.Mark("first paint");
+    std::vector<StartupTrace::Event> events = trace.Events();
+    ASSERT_EQ(events.size(), (size_t)4);
+    EXPECT_EQ(events[0].phase, 'M');
+    EXPECT_EQ(events[1].name, std::string("history.load"));
+    EXPECT_EQ(events[1].thread, worker);
+    EXPECT_GE(events[1].durationUs, (int64_t)2000);
+    EXPECT_EQ(events[2].name, std::string("history.publish"));
+    EXPECT_EQ(events[2].thread, StartupTrace::ThreadId());
+    EXPECT_GE(events[2].beginUs, events[1].beginUs + events[1].durationUs);
+    EXPECT_EQ(events[3].phase, 'i');
+}
+
+TEST(Startup, ExportsChromeTraceJson) {
+    StartupTrace trace;
+    trace.NameThread("ui");
+    StartupTrace::Clock::time_point t = StartupTrace::Clock::now();
+    trace.Phase("filters \"easylist\"\\load\n", t, t + std::chrono::microseconds(1500), 7);
+    trace.Mark("ready");
+    std::string json = trace.ToJson();
+    uint32_t self = StartupTrace::ThreadId();
+    EXPECT_EQ(json.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":["), (size_t)0);
+    EXPECT_NE(json.find("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string(self) + ",\"args\":{\"name\":\"ui\"}}"),
+        std::string::npos);
+    EXPECT_NE(json.find("{\"name\":\"filters \\\"easylist\\\"\\\\load\\u000a\",\"cat\":\"startup\",\"ph\":\"X\",\"pid\":1,\"tid\":7,"),
+        std::string::npos);
+    EXPECT_NE(json.find(",\"dur\":1500}"), std::string::npos);
+    EXPECT_NE(json.find("{\"name\":\"ready\",\"cat\":\"startup\",\"ph\":\"i\",\"s\":\"p\",\"pid\":1,\"tid\":" + std::to_string(self)),
+        std::string::npos);
+    EXPECT_EQ(json.substr(json.size() - 4), std::string("\n]}\n"));
+    // Brackets and braces balance outside strings
+    int depth = 0;
+    bool inString = false;
+    for (size_t i = 0; i < json.size(); i++) {
+        char c = json[i];
+        if (inString) {
+            if (c == '\\') i++;
+            else if (c == '"') inString = false;
+            ASSERT_GE((unsigned char)c, (unsigned char)0x20);
+            continue;
+        }
+        if (c == '"') inString = true;
+        else if (c == '{' || c == '[') depth++;
+        else if (c == '}' || c == ']') ASSERT_GT(depth--, 0);
+    }
+    EXPECT_EQ(depth, 0);
+    EXPECT_FALSE(inString);
+}
+
+TEST(Startup, TasksNotStartedNeverRun) {
+    std::atomic<bool> ran{ false };
+    {
+        StartupTrace trace;
+        StartupGraph graph(trace, 1, nullptr);
+        auto gate = graph.AddAsync("gate", T::Main, {}, [](StartupGraph::Done) {}); // never finishes
+        graph.Add("late", T::Worker, { gate }, [&ran] { ran = true; });
+        graph.Start();
+    }
+    EXPECT_FALSE(ran.load());
+}
@@ -0,0 +1,179 @@
+#include "test.h"
+
+#include "tablifecycle.h"
+
+#include <set>
+#include <vector>
+
+namespace {
+const int64_t MINUTE = 60 * 1000;
+const uint64_t MB = 1ull << 20;
+
+class FakeBackend : public TabLifecycleBackend {
+public:
+    bool Suspend(uint64_t tab) override {
+        suspended.push_back(tab);
+        return !refuse.count(tab);
+    }
+    void Discard(uint64_t tab) override {
+        discarded.push_back(tab);
+        available += freedPerDiscard;
+    }
+    uint64_t AvailableMemory() override { return available; }
+
+    std::vector<uint64_t> suspended, discarded;
+    std::set<uint64_t> refuse;
+    uint64_t available = 4096 * MB;
+    uint64_t freedPerDiscard = 0;
+};
+
+TabLifecyclePolicy::Config Config() {
+    TabLifecyclePolicy::Config config;
+    config.suspendAfterMs = 5 * MINUTE;
+    config.lowMemoryBytes = 512 * MB;
+    return config;
+}
+}
+
+TEST(TabLifecycle, SuspendsIdleBackgroundTabs) {
+    FakeBackend backend;
+    TabLifecyclePolicy policy(backend, Config());
+    policy.Add(1, 0);
+    policy.Add(2, 0);
+    policy.Activate(1, 0);
+    policy.Tick(4 * MINUTE);
+    EXPECT_TRUE(backend.suspended.empty());
+    policy.Tick(5 * MINUTE);
+    ASSERT_EQ(backend.suspended.size(), (size_t)1);
+    EXPECT_EQ(backend.suspended[0], (uint64_t)2);
+    EXPECT_EQ(policy.State(2), TAB_SUSPENDED);
+    EXPECT_EQ(policy.State(1), TAB_LIVE); // the active tab, however long it sits
+    policy.Tick(60 * MINUTE);
+    EXPECT_EQ(backend.suspended.size(), (size_t)1);
+    EXPECT_EQ(policy.GetStats().suspends, (uint64_t)1);
+}
+
+TEST(TabLifecycle, IdleTimeCountsFromLeavingATab) {
+    FakeBackend backend;
+    TabLifecyclePolicy policy(backend, Config());
+    policy.Add(1, 0);
+    policy.Add(2, 0);
+    policy.Activate(1, 0);
+    policy.Activate(2, 4 * MINUTE); // tab 1 goes to the background now
+    policy.Tick(8 * MINUTE);
+    EXPECT_TRUE(backend.suspended.empty());
+    policy.Tick(9 * MINUTE);
+    EXPECT_EQ(policy.State(1), TAB_SUSPENDED);
+    EXPECT_EQ(policy.Activate(1, 10 * MINUTE), TAB_SUSPENDED);
+    EXPECT_EQ(policy.State(1), TAB_LIVE);
+}
+
+TEST(TabLifecycle, RefusedSuspendsWaitAnotherPeriod) {
+    FakeBackend backend;
+    TabLifecyclePolicy policy(backend, Config());
+    policy.Add(1, 0);
+    policy.Add(2, 0);
+    policy.Add(3, 0);
+    policy.Activate(1, 0);
+    backend.refuse.insert(2);
+    policy.Tick(5 * MINUTE);
+    EXPECT_EQ(policy.State(2), TAB_LIVE);
+    EXPECT_EQ(policy.State(3), TAB_SUSPENDED);
+    policy.Tick(9 * MINUTE);
+    EXPECT_EQ(backend.suspended.size(), (size_t)2); // not asked again yet
+    backend.refuse.clear();
+    policy.Tick(10 * MINUTE);
+    EXPECT_EQ(policy.State(2), TAB_SUSPENDED);
+    // A refusal reported later, e.g. the page started playing audio
+    policy.SuspendRefused(3, 11 * MINUTE);
+    EXPECT_EQ(policy.State(3), TAB_LIVE);
+    policy.Tick(15 * MINUTE);
+    EXPECT_EQ(policy.State(3), TAB_LIVE);
+    policy.Tick(16 * MINUTE);
+    EXPECT_EQ(policy.State(3), TAB_SUSPENDED);
+    EXPECT_EQ(policy.GetStats().suspendRefusals, (uint64_t)2);
+}
+
+TEST(TabLifecycle, DiscardsLeastRecentlyUsedFirstOnePerTick) {
+    FakeBackend backend;
+    TabLifecyclePolicy policy(backend, Config());
+    // Used in the order 3, 1, 4, 2; 5 is in front
+    for (uint64_t tab = 1; tab <= 5; tab++) policy.Add(tab, 0);
+    policy.Activate(3, 1 * MINUTE);
+    policy.Activate(1, 2 * MINUTE);
+    policy.Activate(4, 3 * MINUTE);
+    policy.Activate(2, 4 * MINUTE);
+    policy.Activate(5, 4 * MINUTE + 1);
+    backend.available = 100 * MB;
+    policy.Tick(4 * MINUTE + 2);
+    EXPECT_TRUE(policy.LowOnMemory());
+    ASSERT_EQ(backend.discarded.size(), (size_t)1);
+    for (int i = 0; i < 10; i++) policy.Tick(4 * MINUTE + 3 + i);
+    // The active tab is never discarded, nor one already discarded
+    std::vector<uint64_t> expect = { 3, 1, 4, 2 };
+    EXPECT_TRUE(backend.discarded == expect);
+    EXPECT_EQ(policy.State(5), TAB_LIVE);
+    EXPECT_EQ(policy.GetStats().discards, (uint64_t)4);
+}
+
+TEST(TabLifecycle, SuspendedTabsAreDiscardedToo) {
+    FakeBackend backend;
+    TabLifecyclePolicy policy(backend, Config());
+    policy.Add(1, 0);
+    policy.Add(2, MINUTE);
+    policy.Activate(2, MINUTE);
+    policy.Tick(10 * MINUTE);
+    EXPECT_EQ(policy.State(1), TAB_SUSPENDED);
+    backend.available = 100 * MB;
+    policy.Tick(11 * MINUTE);
+    EXPECT_EQ(policy.State(1), TAB_DISCARDED);
+    EXPECT_TRUE(backend.discarded == std::vector<uint64_t>{ 1 });
+}
+
+TEST(TabLifecycle, StopsOnceMemoryRecovers) {
+    FakeBackend backend;
+    TabLifecyclePolicy policy(backend, Config());
+    for (uint64_t tab = 1; tab <= 4; tab++) policy.Add(tab, (int64_t)tab);
+    policy.Activate(4, 10);
+    backend.available = 300 * MB;
+    backend.freedPerDiscard = 150 * MB;
+    policy.Tick(20);
+    policy.Tick(21);
+    EXPECT_TRUE(policy.LowOnMemory());
+    policy.Tick(22); // 600 MB now
+    EXPECT_FALSE(policy.LowOnMemory());
+    policy.Tick(23);
+    EXPECT_TRUE(backend.discarded == (std::vector<uint64_t>{ 1, 2 }));
+    EXPECT_EQ(policy.GetStats().reclaimedBytes, 300 * MB); // measured by the tick after each
+}
+
+TEST(TabLifecycle, DiscardedTabsReloadWhenActivated) {
+    FakeBackend backend;
+    TabLifecyclePolicy policy(backend, Config());
+    policy.Add(1, 0);
+    policy.Add(2, 0, TAB_DISCARDED); // restored from the session, not loaded yet
+    policy.Activate(1, 0);
+    backend.available = 100 * MB;
+    policy.Tick(1);
+    policy.Tick(2);
+    EXPECT_TRUE(backend.discarded.empty()); // nothing left to discard
+    EXPECT_EQ(policy.Activate(2, 3), TAB_DISCARDED);
+    EXPECT_EQ(policy.State(2), TAB_LIVE);
+    EXPECT_EQ(policy.GetStats().restores, (uint64_t)1);
+    policy.Tick(4); // tab 1 is in the background now
+    EXPECT_TRUE(backend.discarded == std::vector<uint64_t>{ 1 });
+}
+
+TEST(TabLifecycle, ClosedTabsAreForgotten) {
+    FakeBackend backend;
+    TabLifecyclePolicy policy(backend, Config());
+    policy.Add(1, 0);
+    policy.Add(2, 0);
+    policy.Activate(2, 0);
+    policy.Remove(1);
+    policy.Remove(2); // the active one; nothing is active after
+    backend.available = 100 * MB;
+    policy.Tick(10 * MINUTE);
+    EXPECT_TRUE(backend.suspended.empty());
+    EXPECT_TRUE(backend.discarded.empty());
+}
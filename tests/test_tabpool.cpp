@@ -0,0 +1,161 @@
+#include "test.h"
+
+#include "tabpool.h"
+
+#include <vector>
+
+namespace {
+struct FakeHost : TabHost {
+    FakeHost(int id, int& open) : id(id), open(open) { open++; }
+    ~FakeHost() override { open--; }
+    int id;
+    int& open;
+};
+
+// Creations complete when the test says so, in the order they were asked for
+class FakeBackend : public TabHostBackend {
+public:
+    void CreateHost(Created done) override { pending.push_back(std::move(done)); }
+
+    void Complete(bool ok = true) {
+        Created done = std::move(pending.front());
+        pending.erase(pending.begin());
+        done(ok ? std::make_unique<FakeHost>(next++, open) : nullptr);
+    }
+
+    std::vector<Created> pending;
+    int next = 0, open = 0;
+};
+
+// Records what each claim received: a host id, -1 for a failure, or nothing yet
+struct Claims {
+    TabHostBackend::Created Next() {
+        got.push_back(-2);
+        size_t i = got.size() - 1;
+        return [this, i](std::unique_ptr<TabHost> host) {
+            got[i] = host ? static_cast<FakeHost*>(host.get())->id : -1;
+            hosts.push_back(std::move(host));
+        };
+    }
+    std::vector<int> got;
+    std::vector<std::unique_ptr<TabHost>> hosts;
+};
+}
+
+TEST(TabPool, FillsToSize) {
+    FakeBackend backend;
+    WarmTabPool pool(backend, 2);
+    pool.Fill();
+    EXPECT_EQ(backend.pending.size(), (size_t)2);
+    EXPECT_EQ(pool.InFlight(), (size_t)2);
+    pool.Fill(); // nothing more while those are on their way
+    EXPECT_EQ(backend.pending.size(), (size_t)2);
+    backend.Complete();
+    backend.Complete();
+    EXPECT_EQ(pool.WarmCount(), (size_t)2);
+    EXPECT_EQ(pool.InFlight(), (size_t)0);
+    EXPECT_TRUE(backend.pending.empty());
+}
+
+TEST(TabPool, WarmClaimIsServedAtOnceAndRefilled) {
+    FakeBackend backend;
+    Claims claims;
+    WarmTabPool pool(backend, 1);
+    pool.Fill();
+    backend.Complete();
+    pool.Claim(claims.Next());
+    EXPECT_EQ(claims.got[0], 0);
+    EXPECT_EQ(pool.WarmCount(), (size_t)0);
+    EXPECT_EQ(backend.pending.size(), (size_t)1); // the refill
+    backend.Complete();
+    EXPECT_EQ(pool.WarmCount(), (size_t)1);
+    WarmTabPool::Stats stats = pool.GetStats();
+    EXPECT_EQ(stats.claims, (uint64_t)1);
+    EXPECT_EQ(stats.warmHits, (uint64_t)1);
+}
+
+TEST(TabPool, ColdClaimsAreServedInOrder) {
+    FakeBackend backend;
+    Claims claims;
+    WarmTabPool pool(backend, 1);
+    pool.Claim(claims.Next());
+    pool.Claim(claims.Next());
+    // One creation per claim, and one to leave warm
+    EXPECT_EQ(backend.pending.size(), (size_t)3);
+    backend.Complete();
+    EXPECT_EQ(claims.got[0], 0);
+    EXPECT_EQ(claims.got[1], -2);
+    backend.Complete();
+    EXPECT_EQ(claims.got[1], 1);
+    EXPECT_EQ(pool.WarmCount(), (size_t)0);
+    backend.Complete();
+    EXPECT_EQ(pool.WarmCount(), (size_t)1);
+    EXPECT_EQ(pool.GetStats().warmHits, (uint64_t)0);
+}
+
+TEST(TabPool, FailureGoesToTheOldestClaim) {
+    FakeBackend backend;
+    Claims claims;
+    WarmTabPool pool(backend, 0);
+    pool.Claim(claims.Next());
+    pool.Claim(claims.Next());
+    ASSERT_EQ(backend.pending.size(), (size_t)2);
+    backend.Complete(false);
+    EXPECT_EQ(claims.got[0], -1);
+    EXPECT_EQ(claims.got[1], -2);
+    EXPECT_EQ(backend.pending.size(), (size_t)1); // not retried
+    backend.Complete();
+    EXPECT_EQ(claims.got[1], 0);
+    EXPECT_EQ(pool.GetStats().failures, (uint64_t)1);
+}
+
+TEST(TabPool, ResizeTrimsWarmHostsAndStopsRefilling) {
+    FakeBackend backend;
+    Claims claims;
+    WarmTabPool pool(backend, 3);
+    pool.Fill();
+    while (!backend.pending.empty()) backend.Complete();
+    EXPECT_EQ(backend.open, 3);
+    pool.Resize(1);
+    EXPECT_EQ(pool.WarmCount(), (size_t)1);
+    EXPECT_EQ(backend.open, 1); // the others are closed
+    pool.Resize(0);
+    EXPECT_EQ(backend.open, 0);
+    EXPECT_EQ(pool.GetStats().trimmed, (uint64_t)3);
+    // With nothing warm, a claim waits for its own creation and leaves none behind
+    pool.Claim(claims.Next());
+    ASSERT_EQ(backend.pending.size(), (size_t)1);
+    backend.Complete();
+    EXPECT_EQ(claims.got[0], 3);
+    EXPECT_EQ(pool.WarmCount(), (size_t)0);
+    EXPECT_TRUE(backend.pending.empty());
+    pool.Resize(2);
+    EXPECT_EQ(backend.pending.size(), (size_t)2);
+}
+
+TEST(TabPool, HostsArrivingAfterAShrinkAreClosed) {
+    FakeBackend backend;
+    WarmTabPool pool(backend, 2);
+    pool.Fill();
+    pool.Resize(0);
+    backend.Complete();
+    backend.Complete();
+    EXPECT_EQ(pool.WarmCount(), (size_t)0);
+    EXPECT_EQ(pool.InFlight(), (size_t)0);
+    EXPECT_EQ(backend.open, 0);
+    EXPECT_EQ(pool.GetStats().trimmed, (uint64_t)2);
+}
+
+TEST(TabPool, CreationsOutliveThePool) {
+    FakeBackend backend;
+    Claims claims;
+    {
+        WarmTabPool pool(backend, 1);
+        pool.Claim(claims.Next());
+    }
+    ASSERT_EQ(backend.pending.size(), (size_t)2);
+    backend.Complete();
+    backend.Complete();
+    EXPECT_EQ(claims.got[0], -2); // nobody left to hand it to
+    EXPECT_EQ(backend.open, 0);
+}
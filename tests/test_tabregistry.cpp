@@ -0,0 +1,74 @@
+#include "test.h"
+
+#include "tabregistry.h"
+
+#include <string>
+
+TEST(SlotMap, ReusesSlotsUnderANewGeneration) {
+    SlotMap<std::string> map;
+    TabHandle a = map.Insert("a");
+    TabHandle b = map.Insert("b");
+    ASSERT_TRUE(map.Get(a) != nullptr);
+    EXPECT_EQ(*map.Get(a), std::string("a"));
+    EXPECT_TRUE(map.Remove(a));
+    EXPECT_TRUE(map.Get(a) == nullptr);
+    EXPECT_EQ(map.Size(), (size_t)1);
+
+    TabHandle c = map.Insert("c");
+    EXPECT_EQ(c.slot, a.slot);              // the freed slot
+    EXPECT_NE(c.generation, a.generation);  // under a new generation
+    EXPECT_TRUE(map.Get(a) == nullptr);     // the stale handle still resolves to nothing
+    EXPECT_EQ(*map.Get(c), std::string("c"));
+    EXPECT_EQ(*map.Get(b), std::string("b"));
+}
+
+TEST(SlotMap, StaleAndForeignHandles) {
+    SlotMap<int> map;
+    TabHandle a = map.Insert(1);
+    EXPECT_FALSE(TabHandle());
+    EXPECT_TRUE(a);
+    EXPECT_TRUE(map.Get(TabHandle()) == nullptr);        // null
+    EXPECT_TRUE(map.Get({ a.slot + 5, 1 }) == nullptr);  // past the end
+    EXPECT_TRUE(map.Remove(a));
+    EXPECT_FALSE(map.Remove(a));                          // twice
+    EXPECT_EQ(map.Size(), (size_t)0);
+    TabHandle b = map.Insert(2);
+    EXPECT_FALSE(map.Remove(a));                          // stale, with its slot taken again
+    EXPECT_EQ(*map.Get(b), 2);
+}
+
+TEST(SlotMap, GenerationSurvivesManyReuses) {
+    SlotMap<int> map;
+    TabHandle first = map.Insert(0);
+    TabHandle last = first;
+    for (int i = 1; i < 10000; i++) {
+        map.Remove(last);
+        last = map.Insert(i);
+        ASSERT_EQ(last.slot, first.slot);
+    }
+    EXPECT_TRUE(map.Get(first) == nullptr);
+    EXPECT_EQ(*map.Get(last), 9999);
+    EXPECT_EQ(TabHandle::FromKey(last.Key()), last);
+}
+
+TEST(TabRegistry, KeepsOrderApartFromHandles) {
+    TabRegistry<std::string> tabs;
+    TabHandle a = tabs.Open("a");
+    TabHandle c = tabs.Open("c");
+    TabHandle b = tabs.Open("b", 1);
+    TabHandle z = tabs.Open("z", 100); // past the end appends
+    EXPECT_EQ(tabs.Size(), (size_t)4);
+    EXPECT_EQ(tabs.PositionOf(a), (size_t)0);
+    EXPECT_EQ(tabs.PositionOf(b), (size_t)1);
+    EXPECT_EQ(tabs.PositionOf(c), (size_t)2);
+    EXPECT_EQ(tabs.PositionOf(z), (size_t)3);
+    EXPECT_TRUE(tabs.Close(b));
+    EXPECT_FALSE(tabs.Close(b));
+    EXPECT_EQ(tabs.PositionOf(b), TabRegistry<std::string>::npos);
+    EXPECT_EQ(tabs.At(1), c);
+    EXPECT_FALSE(tabs.At(3));
+    EXPECT_EQ(*tabs.Get(c), std::string("c")); // handles held elsewhere still resolve
+    TabHandle d = tabs.Open("d", 0);
+    EXPECT_TRUE(tabs.Get(b) == nullptr);       // even with b's slot reused by d
+    EXPECT_EQ(tabs.Order().front(), d);
+}
@@ -0,0 +1,127 @@
+#include "test.h"
+
+#include "tabstrip.h"
+
+namespace {
+const int MID = 66 + 34 / 2; // halfway down the strip with the default metrics
+
+bool Inside(const StripRect& r, int x, int y) {
+    return x >= r.left && x < r.right && y >= r.top && y < r.bottom;
+}
+
+TabStripLayout Strip(int width, size_t count) {
+    TabStripLayout strip;
+    strip.SetWidth(width);
+    strip.SetCount(count);
+    return strip;
+}
+}
+
+TEST(TabStripLayout, HitTestsTabsCloseButtonsAndGaps) {
+    TabStripLayout strip = Strip(1280, 3);
+    EXPECT_EQ(strip.TabWidth(), 200);
+    size_t position = 99;
+    EXPECT_EQ(strip.HitTest(100, MID, position), TabStripLayout::TAB);
+    EXPECT_EQ(position, (size_t)0);
+    EXPECT_EQ(strip.HitTest(190, MID, position), TabStripLayout::CLOSE_BUTTON);
+    EXPECT_EQ(position, (size_t)0);
+    EXPECT_EQ(strip.HitTest(190, 67, position), TabStripLayout::TAB);     // above the close button
+    EXPECT_EQ(strip.HitTest(211, MID, position), TabStripLayout::NOTHING); // the gap after tab 0
+    EXPECT_EQ(strip.HitTest(214, MID, position), TabStripLayout::TAB);
+    EXPECT_EQ(position, (size_t)1);
+    EXPECT_EQ(strip.HitTest(100, 65, position), TabStripLayout::NOTHING);  // above the strip
+    EXPECT_EQ(strip.HitTest(100, 100, position), TabStripLayout::NOTHING); // bottom is exclusive
+    EXPECT_EQ(strip.HitTest(9, MID, position), TabStripLayout::NOTHING);
+    EXPECT_EQ(strip.HitTest(strip.ViewRect().right, MID, position), TabStripLayout::NOTHING); // past the last tab
+    EXPECT_EQ(strip.ButtonRect().left, strip.TabRect(2).right + 4);
+}
+
+TEST(TabStripLayout, ShrinksThenOverflows) {
+    EXPECT_EQ(Strip(1280, 1).TabWidth(), 200);
+    EXPECT_EQ(Strip(1280, 10).TabWidth(), 119);
+    TabStripLayout strip = Strip(1280, 100);
+    EXPECT_EQ(strip.TabWidth(), 72); // the minimum; the rest scrolls
+    EXPECT_EQ(strip.ViewRect().right, 1280 - 10 - 4 - 28);
+    EXPECT_EQ(strip.ButtonRect().right, 1280 - 10); // stays in the window
+    size_t first, end;
+    strip.VisibleRange(first, end);
+    EXPECT_EQ(first, (size_t)0);
+    EXPECT_EQ(end, (size_t)17);
+
+    strip.ScrollBy(-50);
+    EXPECT_EQ(strip.ScrollOffset(), 0);
+    strip.ScrollBy(1000000);
+    EXPECT_EQ(strip.ScrollOffset(), 100 * 76 - 4 - 1228); // the last tab at the right edge
+    strip.VisibleRange(first, end);
+    EXPECT_EQ(end, (size_t)100);
+    EXPECT_EQ(strip.TabRect(99).right, strip.ViewRect().right);
+}
+
+TEST(TabStripLayout, EnsureVisibleScrollsTheLeastNeeded) {
+    TabStripLayout strip = Strip(1280, 100);
+    strip.EnsureVisible(50);
+    EXPECT_EQ(strip.ScrollOffset(), 50 * 76 + 72 - 1228); // tab 50 just fits at the right
+    size_t first, end;
+    strip.VisibleRange(first, end);
+    EXPECT_EQ(first, (size_t)34);
+    EXPECT_EQ(end, (size_t)51);
+    size_t position;
+    EXPECT_EQ(strip.HitTest(strip.ViewRect().right - 1, MID, position), TabStripLayout::TAB);
+    EXPECT_EQ(position, (size_t)50);
+    int before = strip.ScrollOffset();
+    strip.EnsureVisible(45); // already in view
+    EXPECT_EQ(strip.ScrollOffset(), before);
+    strip.EnsureVisible(10);
+    EXPECT_EQ(strip.ScrollOffset(), 10 * 76); // at the left edge
+    strip.EnsureVisible(500); // no such tab
+    EXPECT_EQ(strip.ScrollOffset(), 10 * 76);
+}
+
+TEST(TabStripLayout, ClampsScrollWhenTheStripShrinks) {
+    TabStripLayout strip = Strip(1280, 100);
+    strip.ScrollBy(1000000);
+    strip.SetCount(10);
+    EXPECT_EQ(strip.ScrollOffset(), 0); // ten fit again
+    strip.SetWidth(400);
+    strip.ScrollBy(1000000);
+    EXPECT_EQ(strip.ScrollOffset(), 10 * 76 - 4 - 348);
+    strip.SetWidth(1280);
+    EXPECT_EQ(strip.ScrollOffset(), 0);
+    strip.SetCount(0);
+    size_t first, end;
+    strip.VisibleRange(first, end);
+    EXPECT_EQ(first, end);
+    size_t position;
+    EXPECT_EQ(strip.HitTest(20, MID, position), TabStripLayout::NOTHING);
+    EXPECT_EQ(strip.ButtonRect().left, 10);
+}
+
+// The arithmetic hit test against the rectangles it is meant to agree with, clipped to the view
+TEST(TabStripLayout, HitTestAgreesWithTheRectangles) {
+    for (size_t count : { 1, 7, 30, 250 }) {
+        for (int width : { 300, 1280 }) {
+            TabStripLayout strip = Strip(width, count);
+            for (int scroll : { 0, 37, 1000 }) {
+                strip.ScrollBy(scroll);
+                StripRect view = strip.ViewRect();
+                size_t first, end;
+                strip.VisibleRange(first, end);
+                for (int y = 60; y < 106; y += 3) {
+                    for (int x = 0; x < width; x++) {
+                        TabStripLayout::Part expected = TabStripLayout::NOTHING;
+                        size_t expectedPosition = 0;
+                        for (size_t i = 0; i < count && Inside(view, x, y); i++) {
+                            if (!Inside(strip.TabRect(i), x, y)) continue;
+                            ASSERT_TRUE(i >= first && i < end);
+                            expectedPosition = i;
+                            expected = Inside(strip.CloseRect(i), x, y) ? TabStripLayout::CLOSE_BUTTON : TabStripLayout::TAB;
+                        }
+                        size_t position = 0;
+                        ASSERT_EQ(strip.HitTest(x, y, position), expected);
+                        if (expected != TabStripLayout::NOTHING) ASSERT_EQ(position, expectedPosition);
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,72 @@
+#include "test.h"
+
+#include "textindex.h"
+
+namespace {
+TextIndex::Config SmallBuffers() {
+    TextIndex::Config config;
+    config.bufferPages = 4; // several segments, and merges, from a handful of pages
+    config.mergeFactor = 2;
+    config.idleFlush = std::chrono::milliseconds(10);
+    return config;
+}
+
+std::vector<std::wstring> Urls(const std::vector<TextSearchResult>& results) {
+    std::vector<std::wstring> urls;
+    for (const TextSearchResult& r : results) urls.push_back(r.url);
+    return urls;
+}
+}
+
+TEST(TextIndex, Tokenizes) {
+    std::vector<std::string> words;
+    TokenizeText(L"Hello, WORLD! café 42 東京", words);
+    ASSERT_EQ(words.size(), (size_t)6);
+    EXPECT_EQ(words[0], std::string("hello"));
+    EXPECT_EQ(words[1], std::string("world"));
+    EXPECT_EQ(words[2], std::string("caf\xC3\xA9"));
+    EXPECT_EQ(words[3], std::string("42"));
+    EXPECT_EQ(words[4], std::string("\xE6\x9D\xB1"));
+    words.clear();
+    TokenizeText(std::wstring(41, L'x') + L" short", words);
+    ASSERT_EQ(words.size(), (size_t)1);
+    EXPECT_EQ(words[0], std::string("short"));
+}
+
+TEST(TextIndex, JsonStringValue) {
+    EXPECT_EQ(JsonStringValue(L"\"a\\nb \\\"q\\\" \\u00e9\""), std::wstring(L"a\nb \"q\" \u00e9"));
+    EXPECT_EQ(JsonStringValue(L"null"), std::wstring());
+}
+
+TEST(TextIndex, FindsEveryWordWithPrefixOnTheLast) {
+    TextIndex index(test::TempDir("textindex-search"), SmallBuffers());
+    index.Add(L"https://a.example/", L"Gardening", L"tomatoes need sun and water");
+    index.Add(L"https://b.example/", L"Cooking", L"tomatoes with basil and garlic");
+    index.Add(L"https://c.example/", L"Weather", L"sun all week");
+    index.Flush();
+    EXPECT_EQ(Urls(index.Search(L"tomatoes sun", 10)), std::vector<std::wstring>{ L"https://a.example/" });
+    EXPECT_EQ(index.Search(L"tomat", 10).size(), (size_t)2);
+    EXPECT_TRUE(index.Search(L"tomat ", 10).empty()); // a trailing space ends the word
+    EXPECT_TRUE(index.Search(L"nothing", 10).empty());
+    EXPECT_EQ(index.Search(L"GARLIC", 10).size(), (size_t)1);
+}
+
+TEST(TextIndex, ReplacesRevisitedPagesAcrossSegments) {
+    std::filesystem::path dir = test::TempDir("textindex-replace");
+    {
+        TextIndex index(dir, SmallBuffers());
+        for (int i = 0; i < 20; i++) index.Add(L"https://p.example/" + std::to_wstring(i), L"Page", L"filler words " + std::to_wstring(i));
+        index.Add(L"https://p.example/3", L"Page", L"rewritten entirely");
+        index.Flush();
+        EXPECT_TRUE(index.Search(L"filler 3", 10).empty());
+        EXPECT_EQ(Urls(index.Search(L"rewritten", 10)), std::vector<std::wstring>{ L"https://p.example/3" });
+        TextIndex::Stats stats = index.GetStats();
+        EXPECT_EQ(stats.pages, 20u);
+        EXPECT_GT(stats.merges, 0u);
+    }
+    TextIndex reopened(dir, SmallBuffers());
+    reopened.Flush(); // segments are opened by the worker
+    EXPECT_EQ(reopened.Search(L"filler", 100).size(), (size_t)19);
+    reopened.Clear();
+    EXPECT_TRUE(reopened.Search(L"filler", 100).empty());
+}
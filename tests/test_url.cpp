@@ -0,0 +1,76 @@
+#include "test.h"
+
+#include "url.h"
+
+TEST(Url, SplitsComponents) {
+    Url u;
+    ASSERT_TRUE(ParseUrl(L"https://user:pw@Example.COM:8443/a/b?x=1#top", u));
+    EXPECT_EQ(u.scheme, std::wstring_view(L"https"));
+    EXPECT_EQ(u.userinfo, std::wstring_view(L"user:pw"));
+    EXPECT_EQ(u.host, std::wstring_view(L"Example.COM"));
+    EXPECT_EQ(u.port, std::wstring_view(L"8443"));
+    EXPECT_EQ(u.path, std::wstring_view(L"/a/b"));
+    EXPECT_EQ(u.query, std::wstring_view(L"x=1"));
+    EXPECT_EQ(u.fragment, std::wstring_view(L"top"));
+    EXPECT_EQ(u.Port(), 8443);
+    EXPECT_FALSE(u.IsDefaultPort());
+    EXPECT_EQ(u.HostToPath(), std::wstring_view(L"Example.COM:8443/a/b"));
+}
+
+TEST(Url, EmptyQueryAndFragmentAreKept) {
+    Url u;
+    ASSERT_TRUE(ParseUrl(L"http://example.com/?#", u));
+    EXPECT_TRUE(u.hasQuery);
+    EXPECT_TRUE(u.hasFragment);
+    EXPECT_TRUE(u.query.empty());
+    EXPECT_EQ(u.Port(), 80);
+    EXPECT_TRUE(u.IsDefaultPort());
+}
+
+TEST(Url, Ipv6HostKeepsBrackets) {
+    Url u;
+    ASSERT_TRUE(ParseUrl(L"http://[::1]:8080/", u));
+    EXPECT_EQ(u.host, std::wstring_view(L"[::1]"));
+    EXPECT_EQ(u.port, std::wstring_view(L"8080"));
+    EXPECT_TRUE(IsIpLiteral(u.host));
+    EXPECT_TRUE(IsIpLiteral(L"10.0.0.1"));
+    EXPECT_FALSE(IsIpLiteral(L"10.0.0"));
+    EXPECT_FALSE(IsIpLiteral(L"example.com"));
+}
+
+TEST(Url, RejectsRelativeText) {
+    Url u;
+    EXPECT_FALSE(ParseUrl(L"example.com/path", u));
+    EXPECT_FALSE(ParseUrl(L"", u));
+}
+
+TEST(Url, Canonicalizes) {
+    EXPECT_EQ(CanonicalUrl(L"HTTP://Example.COM:80"), std::wstring(L"http://example.com/"));
+    EXPECT_EQ(CanonicalUrl(L"https://example.com:443/a"), std::wstring(L"https://example.com/a"));
+    EXPECT_EQ(CanonicalUrl(L"https://example.com:8443/a"), std::wstring(L"https://example.com:8443/a"));
+    EXPECT_EQ(CanonicalUrl(L"https://example.com/%7euser/%2f%41"), std::wstring(L"https://example.com/~user/%2FA"));
+    EXPECT_EQ(CanonicalUrl(L"https://example.com/Path?Q=%2a%7E#Frag"), std::wstring(L"https://example.com/Path?Q=%2A~#Frag"));
+    EXPECT_EQ(CanonicalUrl(L"not a url"), std::wstring(L"not a url"));
+}
+
+TEST(Url, CanonicalizeReportsTheFullLength) {
+    Url u;
+    ASSERT_TRUE(ParseUrl(L"HTTPS://EXAMPLE.COM/abc", u));
+    wchar_t small[8];
+    size_t n = CanonicalizeUrl(u, small, 8);
+    ASSERT_EQ(n, std::wstring(L"https://example.com/abc").size());
+    std::wstring full(n, L'\0');
+    EXPECT_EQ(CanonicalizeUrl(u, full.data(), n), n);
+    EXPECT_EQ(full, std::wstring(L"https://example.com/abc"));
+}
+
+TEST(Url, ScanForAnyFindsTheFirst) {
+    std::wstring s(100, L'a');
+    EXPECT_EQ(ScanForAny(s.data(), s.size(), L'?', L'#', L'/'), s.size());
+    for (size_t at : { 0, 1, 15, 16, 17, 63, 99 }) {
+        std::wstring t = s;
+        t[at] = L'#';
+        if (at + 5 < t.size()) t[at + 5] = L'?';
+        EXPECT_EQ(ScanForAny(t.data(), t.size(), L'?', L'#', L'/'), at);
+    }
+}
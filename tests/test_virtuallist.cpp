@@ -0,0 +1,129 @@
+#include "test.h"
+
+#include "virtuallist.h"
+
+#include <random>
+
+namespace {
+// Rows of 25 pixels every 30, in a 300 pixel high view
+VirtualListLayout List(size_t rows) {
+    VirtualListLayout list;
+    list.SetViewport({ 20, 100, 220, 400 });
+    list.SetCount(rows);
+    return list;
+}
+
+int64_t ContentHeight(size_t rows) { return rows ? (int64_t)rows * 30 - 5 : 0; }
+}
+
+TEST(VirtualList, ScrollStaysWithinTheContent) {
+    VirtualListLayout list = List(1000);
+    EXPECT_EQ(list.ScrollOffset(), (int64_t)0);
+    list.ScrollBy(-50);
+    EXPECT_EQ(list.ScrollOffset(), (int64_t)0);
+    list.ScrollBy(95);
+    EXPECT_EQ(list.ScrollOffset(), (int64_t)95);
+    list.ScrollBy(1000000);
+    EXPECT_EQ(list.ScrollOffset(), ContentHeight(1000) - 300); // the last row's bottom at the view's
+    EXPECT_EQ(list.RowRect(999).bottom, 400);
+    list.ScrollBy(-1000000);
+    EXPECT_EQ(list.ScrollOffset(), (int64_t)0);
+}
+
+TEST(VirtualList, ShortListsDoNotScroll) {
+    VirtualListLayout list = List(5);
+    list.ScrollBy(200);
+    EXPECT_EQ(list.ScrollOffset(), (int64_t)0);
+    VirtualListLayout empty = List(0);
+    empty.ScrollBy(200);
+    EXPECT_EQ(empty.ScrollOffset(), (int64_t)0);
+    size_t first = 1, end = 1;
+    empty.VisibleRange(first, end);
+    EXPECT_EQ(first, (size_t)0);
+    EXPECT_EQ(end, (size_t)0);
+    EXPECT_EQ(empty.HitTest(50, 110), VirtualListLayout::npos);
+}
+
+TEST(VirtualList, ResizingAndShrinkingKeepTheScrollValid) {
+    VirtualListLayout list = List(1000);
+    list.ScrollBy(1000000);
+    list.SetViewport({ 20, 100, 220, 700 }); // taller: the end can't be further up than that
+    EXPECT_EQ(list.ScrollOffset(), ContentHeight(1000) - 600);
+    list.SetCount(20); // history cleared down to 20 entries
+    EXPECT_EQ(list.ScrollOffset(), (int64_t)0);
+    list.SetCount(100);
+    list.ScrollBy(600);
+    list.SetViewport({ 20, 100, 220, 100 }); // collapsed
+    EXPECT_EQ(list.ScrollOffset(), (int64_t)600);
+    size_t first = 1, end = 1;
+    list.VisibleRange(first, end);
+    EXPECT_EQ(first, end);
+    EXPECT_EQ(list.HitTest(50, 100), VirtualListLayout::npos);
+}
+
+TEST(VirtualList, VisibleRangeAtRowEdges) {
+    VirtualListLayout list = List(1000);
+    size_t first, end;
+    list.VisibleRange(first, end);
+    EXPECT_EQ(first, (size_t)0);
+    EXPECT_EQ(end, (size_t)10); // rows 0-9 fill 0-295
+    list.ScrollBy(24); // row 0 still shows its last pixel
+    list.VisibleRange(first, end);
+    EXPECT_EQ(first, (size_t)0);
+    list.ScrollBy(1); // now only its gap does
+    list.VisibleRange(first, end);
+    EXPECT_EQ(first, (size_t)1);
+    EXPECT_EQ(end, (size_t)11); // row 10 starts at 300 - 25
+    EXPECT_TRUE(list.RowRect(1) == (DisplayRect{ 20, 105, 220, 130 }));
+}
+
+TEST(VirtualList, HitTestsRowsNotGaps) {
+    VirtualListLayout list = List(1000);
+    list.ScrollBy(10);
+    EXPECT_EQ(list.HitTest(20, 100), (size_t)0);
+    EXPECT_EQ(list.HitTest(219, 114), (size_t)0);
+    EXPECT_EQ(list.HitTest(50, 115), VirtualListLayout::npos); // between rows 0 and 1
+    EXPECT_EQ(list.HitTest(50, 120), (size_t)1);
+    EXPECT_EQ(list.HitTest(19, 120), VirtualListLayout::npos);
+    EXPECT_EQ(list.HitTest(220, 120), VirtualListLayout::npos);
+    EXPECT_EQ(list.HitTest(50, 99), VirtualListLayout::npos);
+    EXPECT_EQ(list.HitTest(50, 400), VirtualListLayout::npos);
+}
+
+// Against laying out every row, through random scrolls, resizes and counts
+TEST(VirtualList, MatchesLayingOutEveryRow) {
+    std::mt19937 rng(17);
+    VirtualListLayout::Metrics metrics;
+    metrics.rowHeight = 19;
+    metrics.rowPitch = 23;
+    VirtualListLayout list(metrics);
+    for (int round = 0; round < 500; round++) {
+        switch (rng() % 3) {
+        case 0: list.SetCount(rng() % 400); break;
+        case 1: list.SetViewport({ 0, 50, 100, 50 + (int)(rng() % 600) }); break;
+        default: list.ScrollBy((int64_t)(rng() % 4001) - 2000); break;
+        }
+        const DisplayRect& view = list.ViewRect();
+        size_t first, end, expectFirst = list.Count(), expectEnd = 0;
+        for (size_t row = 0; row < list.Count(); row++) {
+            if (!list.RowRect(row).Intersects(view)) continue;
+            expectFirst = (std::min)(expectFirst, row);
+            expectEnd = row + 1;
+        }
+        list.VisibleRange(first, end);
+        if (expectEnd == 0) ASSERT_EQ(first, end);
+        else {
+            ASSERT_EQ(first, expectFirst);
+            ASSERT_EQ(end, expectEnd);
+        }
+        for (int i = 0; i < 20; i++) {
+            int x = (int)(rng() % 120) - 10, y = (int)(rng() % 700);
+            size_t expect = VirtualListLayout::npos;
+            for (size_t row = first; row < end; row++) {
+                DisplayRect r = list.RowRect(row);
+                if (x >= view.left && x < view.right && y >= view.top && y < view.bottom && y >= r.top && y < r.bottom) expect = row;
+            }
+            ASSERT_EQ(list.HitTest(x, y), expect);
+        }
+    }
+}
@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+"""Compiles the Public Suffix List into browser/psl.inc.
+
+The rules become a trie over reversed host names ("co.uk" is stored as "ku.oc"), which is
+minimized into a DAFSA by merging equivalent sub-trees; chains of single-child nodes are then
+folded into multi-character edges. psl.cpp walks the result from the end of a host name.
+
+Usage: make_psl_dafsa.py [public_suffix_list.dat] [output.inc]
+"""
+
+import sys
+
+RULE = 1       # the name is a public suffix
+WILDCARD = 2   # "*.name": every child label of the name is a public suffix
+EXCEPTION = 4  # "!name": the name is not a public suffix, despite a wildcard above it
+
+
+def to_ascii(name):
+    labels = []
+    for label in name.split('.'):
+        if label.isascii():
+            labels.append(label.lower())
+            continue
+        try:
+            labels.append(label.encode('idna').decode('ascii'))
+        except UnicodeError:
+            labels.append('xn--' + label.lower().encode('punycode').decode('ascii'))
+    return '.'.join(labels)
+
+
+def read_rules(path):
+    rules = []
+    with open(path, encoding='utf-8') as f:
+        for line in f:
+            line = line.strip()
+            if not line or line.startswith('//'):
+                continue
+            rule = line.split()[0]
+            flag = RULE
+            if rule.startswith('!'):
+                flag, rule = EXCEPTION, rule[1:]
+            elif rule.startswith('*.'):
+                flag, rule = WILDCARD, rule[2:]
+            rules.append((to_ascii(rule), flag))
+    return rules
+
+
+class Node:
+    __slots__ = ('flags', 'children')
+
+    def __init__(self):
+        self.flags = 0
+        self.children = {}
+
+
+def build_trie(rules):
+    root = Node()
+    for name, flag in rules:
+        node = root
+        for ch in reversed(name):
+            node = node.children.setdefault(ch, Node())
+        node.flags |= flag
+    return root
+
+
+def minimize(root):
+    """Returns (nodes, root_id); nodes[id] = (flags, [(char, child_id), ...])."""
+    ids = {}
+    nodes = []
+
+    def visit(node):
+        key = (node.flags, tuple(sorted((ch, visit(child)) for ch, child in node.children.items())))
+        if key not in ids:
+            ids[key] = len(nodes)
+            nodes.append((key[0], list(key[1])))
+        return ids[key]
+
+    sys.setrecursionlimit(10000)
+    return nodes, visit(root)
+
+
+def compress(nodes, root):
+    """Folds single-child chains into string edges; returns (nodes, edges, text) ready to emit."""
+    indegree = [0] * len(nodes)
+    for _, edges in nodes:
+        for _, child in edges:
+            indegree[child] += 1
+
+    order = {root: 0}
+    queue = [root]
+    out_nodes, out_edges = [], []
+    text, text_at = [], {}
+    while queue:
+        n = queue.pop(0)
+        flags, edges = nodes[n]
+        first = len(out_edges)
+        for ch, child in edges:
+            label = ch
+            while nodes[child][0] == 0 and len(nodes[child][1]) == 1 and indegree[child] == 1 and len(label) < 255:
+                c2, child = nodes[child][1][0]
+                label += c2
+            if label not in text_at:
+                text_at[label] = sum(len(t) for t in text)
+                text.append(label)
+            if child not in order:
+                order[child] = len(order)
+                queue.append(child)
+            out_edges.append((text_at[label], len(label), child))
+        assert len(edges) < 256, 'PslNode::edgeCount is 8 bits'
+        out_nodes.append((first, len(edges), flags))
+    out_edges = [(offset, length, order[child]) for offset, length, child in out_edges]
+    return out_nodes, out_edges, ''.join(text)
+
+
+def emit(path, source, nodes, edges, text):
+    with open(path, 'w', newline='\n') as f:
+        f.write('// Generated by tools/make_psl_dafsa.py from %s. Do not edit.\n' % source)
+        f.write('// %d nodes, %d edges, %d bytes of edge text.\n\n' % (len(nodes), len(edges), len(text)))
+        f.write('static const char PSL_TEXT[] =\n')
+        for i in range(0, len(text), 96):
+            f.write('    "%s"\n' % text[i:i + 96])
+        f.write('    ;\n\n')
+        f.write('static const PslNode PSL_NODES[] = {\n')
+        for i in range(0, len(nodes), 8):
+            f.write('    ' + ' '.join('{ %d, %d, %d },' % n for n in nodes[i:i + 8]) + '\n')
+        f.write('};\n\n')
+        f.write('static const PslEdge PSL_EDGES[] = {\n')
+        for i in range(0, len(edges), 8):
+            f.write('    ' + ' '.join('{ %d, %d, %d },' % e for e in edges[i:i + 8]) + '\n')
+        f.write('};\n')
+
+
+def main():
+    source = sys.argv[1] if len(sys.argv) > 1 else '/usr/share/publicsuffix/public_suffix_list.dat'
+    output = sys.argv[2] if len(sys.argv) > 2 else 'browser/psl.inc'
+    rules = read_rules(source)
+    nodes, root = minimize(build_trie(rules))
+    out_nodes, out_edges, text = compress(nodes, root)
+    emit(output, 'public_suffix_list.dat', out_nodes, out_edges, text)
+    print('%d rules -> %d nodes, %d edges, %d text bytes' % (len(rules), len(out_nodes), len(out_edges), len(text)))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,191 @@
+// Replays request traces captured by the browser (Settings > Record Requests) through the
+// blocking pipeline, without WebView2, at full speed.
+//
+// Reports throughput and per-request latency, and the decisions that differ from the ones made
+// at capture time or, with --against, between two rulesets. Exits 1 when any differ, so a
+// folder of traces serves as a regression corpus for filter engine changes.
+//
+// Usage: tracereplay [--rules PATH] [--against PATH] [--threads N] [--repeat N] [--show N] TRACE...
+//   PATH is a folder of filter lists (*.txt) or a filters.bin snapshot. Without --rules the
+//   built-in keyword list decides, as in the browser before any list is loaded.
+//
+// Built by the CMake build (target tracereplay), or straight from the portable modules, e.g.
+//   g++ -std=c++17 -O2 -pthread -Ibrowser tools/tracereplay.cpp browser/{requestclassifier,requesttrace,
+//       ruleset,filterlist,decisioncache,admatcher,url,psl,mappedfile,metrics}.cpp -o tracereplay
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "metrics.h"
+#include "requestclassifier.h"
+#include "requesttrace.h"
+#include "ruleset.h"
+
+namespace {
+struct Options {
+    std::string rules;
+    std::string against;
+    unsigned threads = 1;
+    unsigned repeat = 1;
+    size_t show = 20;
+    std::vector<std::string> traces;
+};
+
+struct ReplayResult {
+    double seconds = 0;
+    LatencyHistogram latency;
+    std::vector<uint8_t> blocked; // per record, from the first pass
+    DecisionCache::Stats cache;
+};
+
+int Usage() {
+    fprintf(stderr, "usage: tracereplay [--rules PATH] [--against PATH] [--threads N] [--repeat N] [--show N] TRACE...\n");
+    return 2;
+}
+
+std::string Narrow(const std::wstring& s) {
+    std::string out;
+    for (wchar_t c : s) out.push_back(c >= 0x20 && c < 0x7F ? (char)c : '?');
+    return out;
+}
+
+const char* TypeName(uint32_t type) {
+    static const char* names[] = { "script", "image", "stylesheet", "xhr", "subdocument", "font", "media", "object",
+                                   "ping", "websocket", "document", "other" };
+    for (int i = 0; i < 12; i++)
+        if (type == (1u << i)) return names[i];
+    return "?";
+}
+
+// A folder is compiled like the browser's reloader does; anything else is taken as a snapshot
+bool LoadRuleset(const std::string& path, RulesetStore& store) {
+    auto ruleset = std::make_unique<Ruleset>();
+    std::error_code ec;
+    if (std::filesystem::is_directory(path, ec)) {
+        std::vector<std::filesystem::path> lists = FilterListFiles(path);
+        FilterListBuilder builder;
+        for (const auto& list : lists) builder.AddFile(list);
+        ruleset->filters = builder.Build();
+        ruleset->sourceStamp = FilterListStamp(lists);
+    }
+    else if (!ruleset->filters.LoadSnapshot(path, ruleset->sourceStamp)) return false;
+    printf("%s: %u rules\n", path.c_str(), ruleset->filters.RuleCount());
+    store.Publish(std::move(ruleset));
+    return true;
+}
+
+// Each thread takes a contiguous share of the trace and all share one classifier, as the
+// browser's request handlers do
+ReplayResult Replay(const std::vector<RequestTraceRecord>& records, const RulesetStore& rules, const Options& options) {
+    RequestClassifier classifier(rules);
+    ReplayResult result;
+    result.blocked.resize(records.size());
+    std::vector<LatencyHistogram> latency(options.threads);
+    auto run = [&](unsigned t) {
+        size_t begin = records.size() * t / options.threads, end = records.size() * (t + 1) / options.threads;
+        for (unsigned pass = 0; pass < options.repeat; pass++) {
+            for (size_t i = begin; i < end; i++) {
+                const RequestTraceRecord& r = records[i];
+                auto started = std::chrono::steady_clock::now();
+                bool block = classifier.ShouldBlock(r.url, r.source, r.type);
+                latency[t].Add((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - started).count());
+                if (pass == 0) result.blocked[i] = block;
+            }
+        }
+    };
+    auto started = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < options.threads; t++) workers.emplace_back(run, t);
+    run(0);
+    for (std::thread& w : workers) w.join();
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    for (const LatencyHistogram& h : latency) result.latency.Merge(h);
+    result.cache = classifier.CacheStats();
+    return result;
+}
+
+void Report(const char* name, const ReplayResult& result, const Options& options) {
+    const LatencyHistogram& h = result.latency;
+    printf("%s: %llu requests on %u thread%s in %.3f s, %.0f requests/s\n", name, (unsigned long long)h.total, options.threads,
+        options.threads == 1 ? "" : "s", result.seconds, result.seconds > 0 ? h.total / result.seconds : 0.0);
+    printf("  latency ns: mean %llu, p50 %llu, p90 %llu, p99 %llu, p99.9 %llu, max %llu\n", (unsigned long long)h.Mean(),
+        (unsigned long long)h.Percentile(0.5), (unsigned long long)h.Percentile(0.9), (unsigned long long)h.Percentile(0.99),
+        (unsigned long long)h.Percentile(0.999), (unsigned long long)h.max);
+    if (result.cache.hits + result.cache.misses)
+        printf("  decision cache: %.1f%% hits, %llu stores\n", 100 * result.cache.HitRate(), (unsigned long long)result.cache.stores);
+}
+
+// Lists records where `after` decided differently from `before`; returns how many
+size_t Differences(const char* title, const std::vector<RequestTraceRecord>& records, const std::vector<uint8_t>& before,
+    const std::vector<uint8_t>& after, size_t show) {
+    size_t nowBlocked = 0, nowAllowed = 0, shown = 0;
+    for (size_t i = 0; i < records.size(); i++) {
+        if (before[i] == after[i]) continue;
+        (after[i] ? nowBlocked : nowAllowed)++;
+        if (shown++ < show) {
+            printf("  %c %s %s (from %s)\n", after[i] ? '+' : '-', TypeName(records[i].type), Narrow(records[i].url).c_str(),
+                Narrow(records[i].source).c_str());
+        }
+    }
+    printf("%s: %zu differ, %zu newly blocked, %zu newly allowed\n", title, nowBlocked + nowAllowed, nowBlocked, nowAllowed);
+    return nowBlocked + nowAllowed;
+}
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--rules" && hasValue) options.rules = argv[++i];
+        else if (arg == "--against" && hasValue) options.against = argv[++i];
+        else if (arg == "--threads" && hasValue) options.threads = (std::max)(1, atoi(argv[++i]));
+        else if (arg == "--repeat" && hasValue) options.repeat = (std::max)(1, atoi(argv[++i]));
+        else if (arg == "--show" && hasValue) options.show = (size_t)(std::max)(0, atoi(argv[++i]));
+        else if (arg.rfind("--", 0) == 0) return Usage();
+        else options.traces.push_back(arg);
+    }
+    if (options.traces.empty()) return Usage();
+
+    std::vector<RequestTraceRecord> records;
+    for (const std::string& trace : options.traces) {
+        size_t before = records.size();
+        bool complete = true;
+        if (!ReadRequestTrace(trace, records, &complete)) {
+            fprintf(stderr, "%s: not a request trace\n", trace.c_str());
+            return 2;
+        }
+        size_t blocked = 0;
+        for (size_t i = before; i < records.size(); i++) blocked += records[i].blocked;
+        printf("%s: %zu requests, %zu blocked when captured%s\n", trace.c_str(), records.size() - before, blocked,
+            complete ? "" : " (cut short)");
+    }
+
+    RulesetStore rules, againstRules;
+    if (!options.rules.empty() && !LoadRuleset(options.rules, rules)) {
+        fprintf(stderr, "%s: cannot load rules\n", options.rules.c_str());
+        return 2;
+    }
+    if (!options.against.empty() && !LoadRuleset(options.against, againstRules)) {
+        fprintf(stderr, "%s: cannot load rules\n", options.against.c_str());
+        return 2;
+    }
+
+    ReplayResult replay = Replay(records, rules, options);
+    Report("replay", replay, options);
+    if (options.against.empty()) {
+        std::vector<uint8_t> captured(records.size());
+        for (size_t i = 0; i < records.size(); i++) captured[i] = records[i].blocked;
+        return Differences("against capture", records, captured, replay.blocked, options.show) ? 1 : 0;
+    }
+    ReplayResult against = Replay(records, againstRules, options);
+    Report("against", against, options);
+    return Differences("rules -> against", records, replay.blocked, against.blocked, options.show) ? 1 : 0;
+}